@@ -0,0 +1,70 @@
+// KMPRS485Tx.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		RS485 transmit layer shared by ProDino WiFi-ESP, ProDino MKR Zero and ProDino Ethernet boards.
+//		The transceiver is switched to transmit, the data is written with one bulk write and the transceiver
+//		is switched back to receive right after the last stop bit. The end of transmission is detected by
+//		UART flush, on SAMD by the TX complete flag after the flush.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPRS485TX_H
+#define _KMPRS485TX_H
+
+#include <Arduino.h>
+
+// SERCOM of the RS485 UART on SAMD boards. Serial1 on MKR boards is SERCOM5.
+#if defined(ARDUINO_ARCH_SAMD) && !defined(RS485_SERCOM)
+#define RS485_SERCOM SERCOM5
+#endif
+
+// Max wait for the SAMD TX complete flag after the flush in character times. It doesn't come if the UART isn't running.
+#define RS485_TXC_TIMEOUT_CHARS 4
+
+class KMPRS485TxClass
+{
+ public:
+	/**
+	* @brief Create RS485 transmitter.
+	*
+	* @param serial RS485 UART.
+	* @param dePin Transceiver DE (transmit enable) pin.
+	* @param transmitLevel DE pin level for transmit.
+	*/
+	KMPRS485TxClass(HardwareSerial& serial, uint8_t dePin, uint8_t transmitLevel);
+
+	/**
+	* @brief Set the transceiver in receive mode. Call it after the UART begin.
+	*
+	* @param baud Speed. On SAMD it bounds the TX complete wait.
+	* @param config UART configuration - SERIAL_8N1 ...
+	*
+	* @return void
+	*/
+	void begin(unsigned long baud, uint32_t config);
+
+	/**
+	* @brief Transmit data. It returns after the last stop bit, when the transceiver is in receive mode.
+	*
+	* @param data Data to transmit.
+	* @param len Data length.
+	*
+	* @return size_t Count of transmitted bytes.
+	*/
+	size_t write(const uint8_t* data, size_t len);
+
+ private:
+	HardwareSerial& _serial;
+	uint8_t _dePin;
+	uint8_t _transmitLevel;
+#if defined(ARDUINO_ARCH_SAMD)
+	// One character time for current baud and configuration.
+	uint32_t _charTimeuS;
+
+	static uint8_t getCharBits(uint32_t config);
+#endif
+};
+
+#endif
@@ -11,9 +11,12 @@
 // Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
 
 #include "KmpDinoEthernet.h"
+#include "KMPRS485Tx.h"
 #include <Arduino.h>
 #include <assert.h>
 
+KMPRS485TxClass _rs485Tx(Serial1, RS485TXControlPin, RS485Transmit);
+
 void DinoInit()
 {
 	DinoInit(true);
@@ -228,6 +231,7 @@ void RS485Begin(unsigned long boud)
 void RS485Begin(unsigned long boud, uint8_t config)
 {
     Serial1.begin(boud, config);
+    _rs485Tx.begin(boud, config);
 }
 
 void RS485End()
@@ -235,27 +239,9 @@ void RS485End()
     Serial1.end();
 }
 
-void RS485BeginWrite()
-{
-    digitalWrite(RS485TXControlPin, RS485Transmit);
-    delay(1);
-}
-
-void RS485EndWrite()
-{
-    Serial1.flush();
-    digitalWrite(RS485TXControlPin, RS485Receive);
-}
-
 size_t RS485Write(uint8_t data)
 {
-    RS485BeginWrite();
-    
-    size_t result = Serial1.write(data);
-    
-    RS485EndWrite();
-        
-    return result;
+    return _rs485Tx.write(&data, 1);
 }
 
 size_t RS485Write(char data)
@@ -265,33 +251,12 @@ size_t RS485Write(char data)
 
 size_t RS485Write(char* data)
 {
-    RS485BeginWrite();
-    
-    size_t len = strlen(data);
-    size_t result = 0;
-    for(size_t i = 0; i < len; i++)
-    {
-        result += Serial1.write(data[i]);
-    }
-    
-    RS485EndWrite();
-    
-    return result;
+    return _rs485Tx.write((const uint8_t*)data, strlen(data));
 }
 
 size_t RS485Write(uint8_t* data, uint8_t dataLen)
 {
-    RS485BeginWrite();
-    
-    size_t result = 0;
-    for(size_t i = 0; i < dataLen; i++)
-    {
-	    result += Serial1.write(data[i]);
-    }
-    
-    RS485EndWrite();
-    
-    return result;
+    return _rs485Tx.write(data, dataLen);
 }
 
 int RS485Read()
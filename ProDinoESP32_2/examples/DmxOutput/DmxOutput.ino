@@ -0,0 +1,96 @@
+// DmxOutput.ino
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		ProDino ESP32 V1 https://kmpelectronics.eu/products/prodino-esp32-v1/
+//		ProDino ESP32 Ethernet V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/
+//		ProDino ESP32 GSM V1 https://kmpelectronics.eu/products/prodino-esp32-gsm-v1/
+//		ProDino ESP32 LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-lora-v1/
+//		ProDino ESP32 LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-lora-rfm-v1/
+//		ProDino ESP32 Ethernet GSM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-gsm-v1/
+//		ProDino ESP32 Ethernet LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-v1/
+//		ProDino ESP32 Ethernet LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-rfm-v1/
+// Description:
+//		DMX512 output example. Channels 1-3 (RGB dimmer) fade in turn, channel 4 is full when opto input 1 is on.
+//		The universe is transmitted in the background about 44 times per second.
+// Example link: https://kmpelectronics.eu/tutorials-examples/prodino-esp32-versions-examples/
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPProDinoESP32.h"
+#include "KMPCommon.h"
+#include "KMPDmx.h"
+
+#define FADE_STEP_MS 20
+#define RGB_FIRST_CHANNEL 1
+#define SWITCH_CHANNEL 4
+
+unsigned long _fadeTime = 0;
+uint16_t _fadeStep = 0;
+
+/**
+* @brief Setup void. Ii is Arduino executed first. Initialize DiNo board.
+*
+*
+* @return void
+*/
+void setup()
+{
+	Serial.begin(115200);
+	Serial.println("The example DmxOutput is starting...");
+
+	// Relays, inputs and RS485 are ready on return, other modules finish their reset in loop.
+	KMPProDinoESP32.begin(ProDino_ESP32, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
+	KMPProDinoESP32.setStatusLed(blue);
+
+	KMPProDinoESP32.rs485Begin(DMX_BAUD, DMX_CONFIG);
+	if (!KMPDmx.begin(RS485Serial))
+	{
+		Serial.println("DMX can't be started");
+	}
+
+	Serial.println("The example DmxOutput is started");
+	KMPProDinoESP32.offStatusLed();
+}
+
+/**
+* @brief Loop void. Arduino executed second.
+*
+*
+* @return void
+*/
+void loop()
+{
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
+	KMPProDinoESP32.processStatusLed(green, 1000);
+
+	if (millis() - _fadeTime < FADE_STEP_MS)
+	{
+		return;
+	}
+
+	_fadeTime = millis();
+
+	// Every color goes up and down in 512 steps.
+	uint8_t color = (_fadeStep >> 9) % 3;
+	uint16_t level = _fadeStep & 0x1FF;
+	uint8_t rgb[3] = { 0, 0, 0 };
+	rgb[color] = level < 256 ? level : 511 - level;
+	_fadeStep += 4;
+
+	KMPDmx.setChannels(RGB_FIRST_CHANNEL, rgb, sizeof(rgb));
+	KMPDmx.setChannel(SWITCH_CHANNEL, KMPProDinoESP32.getOptoInState(OptoIn1) ? 255 : 0);
+
+	// All channels are sent together in the next frame.
+	KMPDmx.update();
+}
@@ -0,0 +1,116 @@
+// ModbusGatewayE.ino
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		KMP ProDino ESP32 Ethernet V1 (https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/)
+//		KMP ProDino ESP32 Ethernet GSM V1 (https://kmpelectronics.eu/products/prodino-esp32-GSM-ethernet-v1/)
+//		KMP ProDino ESP32 Ethernet LoRa V1 (https://kmpelectronics.eu/products/prodino-esp32-GSM-ethernet-v1/)
+//		KMP ProDino ESP32 Ethernet LoRa RFM V1 (https://kmpelectronics.eu/products/prodino-esp32-GSM-ethernet-v1/)
+// Description:
+//		Modbus TCP to Modbus RTU gateway example. Modbus TCP clients connect to port 502, the unit ID is the RS485 slave address.
+//		Gateway statistics are printed in the Serial every 10 seconds.
+// Example link: https://kmpelectronics.eu/tutorials-examples/prodino-esp32-versions-examples/
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPProDinoESP32.h"
+#include "KMPCommon.h"
+#include "KMPModbusGateway.h"
+
+#define MODBUS_BAUD 19200
+#define STATS_INTERVAL_MS 10000
+
+// Enter a MAC address and IP address for your controller below.
+byte _mac[] = { 0x00, 0x08, 0xDC, 0x72, 0xE7, 0x41 };
+
+EthernetServer _server(MODBUS_TCP_PORT);
+
+unsigned long _statsTime = 0;
+
+/**
+* @brief Setup void. It is Arduino executed first. Initialize DiNo board.
+*
+*
+* @return void
+*/
+void setup()
+{
+	Serial.begin(115200);
+	Serial.println("The example ModbusGatewayE is starting...");
+
+	// Init Dino board. Set pins, start W5500.
+	// Relays, inputs and RS485 are ready on return, other modules finish their reset in loop.
+	KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
+	KMPProDinoESP32.setStatusLed(blue);
+
+	// Start RS485 with baud 19200 and 8N1.
+	KMPProDinoESP32.rs485Begin(MODBUS_BAUD);
+	KMPModbusMaster.begin(RS485Serial, MODBUS_BAUD);
+	// Never coalesce requests from different clients.
+	KMPModbusMaster.setCoalesceGap(0xFFFF);
+
+	// W5500 driver waits only for the rest of the reset.
+	if (Ethernet.begin(_mac) == 0) {
+		Serial.println("Failed to configure Ethernet using DHCP");
+		// no point in carrying on, so do nothing forevermore:
+		while (1);
+	}
+
+	KMPModbusGateway.begin(_server, KMPModbusMaster);
+
+	Serial.print("Modbus TCP gateway: ");
+	Serial.print(Ethernet.localIP());
+	Serial.print(":");
+	Serial.println(MODBUS_TCP_PORT);
+	Serial.print("IO ready mS: ");
+	Serial.print(KMPProDinoESP32.getInitMetrics().IOReadyMs);
+	Serial.print(" Ethernet ready mS: ");
+	Serial.println(KMPProDinoESP32.getInitMetrics().EthernetReadyMs);
+
+	KMPProDinoESP32.offStatusLed();
+}
+
+/**
+* @brief Loop void. Arduino executed second.
+*
+*
+* @return void
+*/
+void loop()
+{
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
+	KMPProDinoESP32.processStatusLed(green, 1000);
+
+	KMPModbusGateway.process();
+
+	if (millis() - _statsTime < STATS_INTERVAL_MS)
+	{
+		return;
+	}
+
+	_statsTime = millis();
+
+	const ModbusGatewayStats_t& stats = KMPModbusGateway.getStats();
+	Serial.print("Connections: ");
+	Serial.print(KMPModbusGateway.connections());
+	Serial.print(" requests: ");
+	Serial.print(stats.Requests);
+	Serial.print(" failed: ");
+	Serial.print(stats.TargetFailed);
+	Serial.print(" rejected: ");
+	Serial.print(stats.Rejected);
+	Serial.print(" queue latency avg/max mS: ");
+	Serial.print(KMPModbusGateway.getAverageQueueLatencyMs());
+	Serial.print("/");
+	Serial.print(stats.QueueLatencyMaxMs);
+	Serial.print(" bus utilization %: ");
+	Serial.println(KMPModbusGateway.getBusUtilization());
+
+	KMPModbusGateway.resetStats();
+}
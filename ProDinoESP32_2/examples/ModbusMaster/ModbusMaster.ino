@@ -0,0 +1,132 @@
+// ModbusMaster.ino
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		ProDino ESP32 V1 https://kmpelectronics.eu/products/prodino-esp32-v1/
+//		ProDino ESP32 Ethernet V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/
+//		ProDino ESP32 GSM V1 https://kmpelectronics.eu/products/prodino-esp32-gsm-v1/
+//		ProDino ESP32 LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-lora-v1/
+//		ProDino ESP32 LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-lora-rfm-v1/
+//		ProDino ESP32 Ethernet GSM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-gsm-v1/
+//		ProDino ESP32 Ethernet LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-v1/
+//		ProDino ESP32 Ethernet LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-rfm-v1/
+// Description:
+//		Modbus RTU master example. It polls holding registers of several slaves every second and shows the values.
+//		Requests to registers 0-3 and 4-7 of the same slave are sent as one request.
+//		Relay 1 follows bit 0 of register 0 of the first slave.
+// Example link: https://kmpelectronics.eu/tutorials-examples/prodino-esp32-versions-examples/
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPProDinoESP32.h"
+#include "KMPCommon.h"
+#include "KMPModbusMaster.h"
+
+#define MODBUS_BAUD 19200
+#define POLL_INTERVAL_MS 1000
+
+const uint8_t SLAVES[] = { 1, 2, 3 };
+const uint8_t SLAVES_COUNT = sizeof(SLAVES) / sizeof(SLAVES[0]);
+
+uint16_t _registersA[SLAVES_COUNT][4];
+uint16_t _registersB[SLAVES_COUNT][4];
+
+unsigned long _pollTime = 0;
+
+/**
+* @brief Called when a read request is finished.
+*
+* @return void
+*/
+void onRead(const ModbusRequest_t& request, ModbusResult result)
+{
+	Serial.print("Slave ");
+	Serial.print(request.SlaveId);
+	Serial.print(" registers ");
+	Serial.print(request.Address);
+	Serial.print(": ");
+
+	if (result != ModbusResultOK)
+	{
+		Serial.print("error ");
+		Serial.print(result);
+		Serial.print(" exception ");
+		Serial.println(request.Exception);
+		return;
+	}
+
+	uint16_t* registers = (uint16_t*)request.Data;
+	for (uint16_t i = 0; i < request.Count; i++)
+	{
+		Serial.print(registers[i]);
+		Serial.print(' ');
+	}
+	Serial.println();
+
+	if (request.SlaveId == SLAVES[0] && request.Address == 0)
+	{
+		KMPProDinoESP32.setRelayState(Relay1, registers[0] & 0x01, SourceRS485);
+	}
+}
+
+/**
+* @brief Setup void. Ii is Arduino executed first. Initialize DiNo board.
+*
+*
+* @return void
+*/
+void setup()
+{
+	Serial.begin(115200);
+	Serial.println("The example ModbusMaster is starting...");
+
+	// Relays, inputs and RS485 are ready on return, other modules finish their reset in loop.
+	KMPProDinoESP32.begin(ProDino_ESP32, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
+	KMPProDinoESP32.setStatusLed(blue);
+
+	// Start RS485 with baud 19200 and 8N1.
+	KMPProDinoESP32.rs485Begin(MODBUS_BAUD);
+	KMPModbusMaster.begin(RS485Serial, MODBUS_BAUD);
+	KMPModbusMaster.setResponseTimeout(100);
+
+	Serial.println("The example ModbusMaster is started");
+	KMPProDinoESP32.offStatusLed();
+}
+
+/**
+* @brief Loop void. Arduino executed second.
+*
+*
+* @return void
+*/
+void loop()
+{
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
+	KMPProDinoESP32.processStatusLed(green, 1000);
+
+	// Never waits.
+	KMPModbusMaster.process();
+
+	if (millis() - _pollTime < POLL_INTERVAL_MS || KMPModbusMaster.isBusy())
+	{
+		return;
+	}
+
+	_pollTime = millis();
+
+	for (uint8_t i = 0; i < SLAVES_COUNT; i++)
+	{
+		KMPModbusMaster.readHoldingRegisters(SLAVES[i], 0, 4, _registersA[i], onRead);
+		KMPModbusMaster.readHoldingRegisters(SLAVES[i], 4, 4, _registersB[i], onRead);
+	}
+}
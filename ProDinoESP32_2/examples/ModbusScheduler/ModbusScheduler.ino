@@ -0,0 +1,159 @@
+// ModbusScheduler.ino
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		ProDino ESP32 V1 https://kmpelectronics.eu/products/prodino-esp32-v1/
+//		ProDino ESP32 Ethernet V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/
+//		ProDino ESP32 GSM V1 https://kmpelectronics.eu/products/prodino-esp32-gsm-v1/
+//		ProDino ESP32 LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-lora-v1/
+//		ProDino ESP32 LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-lora-rfm-v1/
+//		ProDino ESP32 Ethernet GSM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-gsm-v1/
+//		ProDino ESP32 Ethernet LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-v1/
+//		ProDino ESP32 Ethernet LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-rfm-v1/
+// Description:
+//		Modbus RTU scheduler example. Energy meters are polled every second, temperature sensors every 30 seconds.
+//		When opto input 1 changes, coil 0 of the relay module is written as an operator command with deadline 500 ms.
+//		Statistics per slave are shown every 10 seconds.
+// Example link: https://kmpelectronics.eu/tutorials-examples/prodino-esp32-versions-examples/
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPProDinoESP32.h"
+#include "KMPCommon.h"
+#include "KMPModbusScheduler.h"
+
+#define MODBUS_BAUD 19200
+#define METER_PERIOD_MS 1000
+#define SENSOR_PERIOD_MS 30000
+#define OPERATOR_DEADLINE_MS 500
+#define STATS_INTERVAL_MS 10000
+
+const uint8_t METERS[] = { 1, 2, 3, 4 };
+const uint8_t METERS_COUNT = sizeof(METERS) / sizeof(METERS[0]);
+const uint8_t SENSORS[] = { 10, 11, 12 };
+const uint8_t SENSORS_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+const uint8_t RELAY_MODULE = 20;
+
+// Voltage, current, power and energy.
+uint16_t _meters[METERS_COUNT][8];
+uint16_t _sensors[SENSORS_COUNT][2];
+uint8_t _relayCoil;
+
+bool _lastInput = false;
+unsigned long _statsTime = 0;
+
+/**
+* @brief Called when a job is finished.
+*
+* @return void
+*/
+void onJob(const ModbusRequest_t& request, ModbusResult result)
+{
+	if (result == ModbusResultOK)
+	{
+		return;
+	}
+
+	Serial.print("Slave ");
+	Serial.print(request.SlaveId);
+	Serial.print(" function ");
+	Serial.print(request.Function);
+	Serial.print(": error ");
+	Serial.println(result);
+}
+
+/**
+* @brief Print statistics of all slaves.
+*
+* @return void
+*/
+void printStats()
+{
+	Serial.println("Slave Req Resp Timeout% AvgMs MaxMs Expired Rate/Target");
+
+	for (uint8_t i = 0; i < KMPModbusScheduler.slaves(); i++)
+	{
+		const ModbusSchedulerSlaveStats_t& stats = KMPModbusScheduler.getSlaveStatsAt(i);
+
+		Serial.printf("%5u %3u %4u %8u %5u %5u %7u %.2f/%.2f\r\n",
+			stats.SlaveId, stats.Requests, stats.Responses,
+			KMPModbusScheduler.getTimeoutRate(stats.SlaveId),
+			KMPModbusScheduler.getAverageResponseTimeMs(stats.SlaveId), stats.ResponseTimeMaxMs, stats.Expired,
+			KMPModbusScheduler.getPollRate(stats.SlaveId), KMPModbusScheduler.getTargetPollRate(stats.SlaveId));
+	}
+}
+
+/**
+* @brief Setup void. Ii is Arduino executed first. Initialize DiNo board.
+*
+*
+* @return void
+*/
+void setup()
+{
+	Serial.begin(115200);
+	Serial.println("The example ModbusScheduler is starting...");
+
+	// Relays, inputs and RS485 are ready on return, other modules finish their reset in loop.
+	KMPProDinoESP32.begin(ProDino_ESP32, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
+	KMPProDinoESP32.setStatusLed(blue);
+
+	// Start RS485 with baud 19200 and 8N1.
+	KMPProDinoESP32.rs485Begin(MODBUS_BAUD);
+	KMPModbusMaster.begin(RS485Serial, MODBUS_BAUD);
+	KMPModbusMaster.setResponseTimeout(100);
+	KMPModbusScheduler.begin(KMPModbusMaster);
+
+	for (uint8_t i = 0; i < METERS_COUNT; i++)
+	{
+		KMPModbusScheduler.addPeriodic(METERS[i], ModbusReadInputRegisters, 0, 8, _meters[i], METER_PERIOD_MS, ModbusPriorityHigh, onJob);
+	}
+
+	for (uint8_t i = 0; i < SENSORS_COUNT; i++)
+	{
+		KMPModbusScheduler.addPeriodic(SENSORS[i], ModbusReadInputRegisters, 0, 2, _sensors[i], SENSOR_PERIOD_MS, ModbusPriorityLow, onJob);
+	}
+
+	Serial.println("The example ModbusScheduler is started");
+	KMPProDinoESP32.offStatusLed();
+}
+
+/**
+* @brief Loop void. Arduino executed second.
+*
+*
+* @return void
+*/
+void loop()
+{
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
+	KMPProDinoESP32.processStatusLed(green, 1000);
+
+	// Never waits.
+	KMPModbusScheduler.process();
+
+	bool input = KMPProDinoESP32.getOptoInState(OptoIn1);
+	if (input != _lastInput)
+	{
+		_lastInput = input;
+		_relayCoil = input ? 1 : 0;
+		// It is sent right after the current frame.
+		KMPModbusScheduler.submit(RELAY_MODULE, ModbusWriteSingleCoil, 0, 1, &_relayCoil, ModbusPriorityOperator, OPERATOR_DEADLINE_MS, onJob);
+	}
+
+	if (millis() - _statsTime >= STATS_INTERVAL_MS)
+	{
+		_statsTime = millis();
+		printStats();
+	}
+}
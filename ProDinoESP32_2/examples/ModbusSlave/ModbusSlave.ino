@@ -0,0 +1,117 @@
+// ModbusSlave.ino
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		ProDino ESP32 V1 https://kmpelectronics.eu/products/prodino-esp32-v1/
+//		ProDino ESP32 Ethernet V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/
+//		ProDino ESP32 GSM V1 https://kmpelectronics.eu/products/prodino-esp32-gsm-v1/
+//		ProDino ESP32 LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-lora-v1/
+//		ProDino ESP32 LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-lora-rfm-v1/
+//		ProDino ESP32 Ethernet GSM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-gsm-v1/
+//		ProDino ESP32 Ethernet LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-v1/
+//		ProDino ESP32 Ethernet LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-rfm-v1/
+// Description:
+//		Modbus RTU slave example. The board is polled by a Modbus master (SCADA) through RS485.
+//		Registers map:
+//			Coils 0 - 3 (FC01, FC05, FC15): Relay1 - Relay4.
+//			Discrete inputs 0 - 3 (FC02): OptoIn1 - OptoIn4.
+//			Input register 0 (FC04): DHT temperature * 10, signed. Input register 1: DHT humidity * 10.
+//		Responses are sent from the serial event task, the loop duration doesn't matter. Written relays are set by KMPModbusSlave.process().
+// Example link: https://kmpelectronics.eu/tutorials-examples/prodino-esp32-versions-examples/
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+// --------------------------------------------------------------------------------
+// Prerequisites:
+//		Install DHT library: Sketch\Include library\Menage Libraries... find ... and click Install.
+//         - SimpleDHT by Winlin
+//		Connect DHT22 sensor to GROVE connector. Use pins: 
+//			- first  sensor GROVE_D0, Vcc+, Gnd(-);
+//		DS18B20 sensors can be added the same way in input registers 2 and next.
+
+#include "KMPProDinoESP32.h"
+#include "KMPCommon.h"
+#include "KMPModbusSlave.h"
+
+#include <SimpleDHT.h>
+
+#define MODBUS_SLAVE_ID 1
+#define MODBUS_BAUD 19200
+
+#define SENSORS_PIN GROVE_D0
+#define REG_TEMPERATURE 0
+#define REG_HUMIDITY 1
+
+// Check sensor data, interval in milliseconds.
+const long CHECK_HT_INTERVAL_MS = 10000;
+
+SimpleDHT22 _dht(SENSORS_PIN);
+unsigned long _checkHTTimeout = 0;
+
+/**
+* @brief Setup void. Ii is Arduino executed first. Initialize DiNo board.
+*
+*
+* @return void
+*/
+void setup()
+{
+	Serial.begin(115200);
+	Serial.println("The example ModbusSlave is starting...");
+
+	// Relays states are restored in begin and saved after every change.
+	KMPProDinoESP32.enableRelaysPersistence();
+
+	// Relays, inputs and RS485 are ready on return, other modules finish their reset in loop.
+	KMPProDinoESP32.begin(ProDino_ESP32, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
+	KMPProDinoESP32.setStatusLed(blue);
+
+	// Start RS485 with baud 19200 and 8N1.
+	KMPProDinoESP32.rs485Begin(MODBUS_BAUD);
+	KMPModbusSlave.begin(RS485Serial, MODBUS_SLAVE_ID, MODBUS_BAUD);
+
+	Serial.println("The example ModbusSlave is started");
+	KMPProDinoESP32.offStatusLed();
+}
+
+/**
+* @brief Loop void. Arduino executed second.
+*
+*
+* @return void
+*/
+void loop()
+{
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
+	// Saves changed relays states in flash after a quiet interval.
+	KMPProDinoESP32.processRelaysPersistence();
+
+	KMPProDinoESP32.processStatusLed(green, 1000);
+
+	// Sets the relays written by the master and publishes the inputs.
+	KMPModbusSlave.process();
+
+	if (millis() > _checkHTTimeout)
+	{
+		float temperature;
+		float humidity;
+
+		// Reading takes about 20 mS, Modbus requests are answered meanwhile.
+		if (_dht.read2(&temperature, &humidity, NULL) == SimpleDHTErrSuccess)
+		{
+			KMPModbusSlave.setInputRegister(REG_TEMPERATURE, temperature);
+			KMPModbusSlave.setInputRegister(REG_HUMIDITY, humidity);
+		}
+
+		_checkHTTimeout = millis() + CHECK_HT_INTERVAL_MS;
+	}
+}
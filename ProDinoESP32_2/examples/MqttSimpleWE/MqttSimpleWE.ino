@@ -116,28 +116,29 @@ unsigned long _mesureTimeout = 0;
 */
 void setup()
 {
-	delay(5000);
 	Serial.begin(115200);
 	Serial.println("The example simple MQTT is starting...");
 
+	// Relays and inputs are ready on return, other modules finish their reset in loop.
 #ifdef ETH_TEST
-	KMPProDinoESP32.begin(ProDino_ESP32_Ethernet);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM);
+	KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
 #else	
-	//KMPProDinoESP32.begin(ProDino_ESP32);
-	//KMPProDinoESP32.begin(ProDino_ESP32_GSM);
-	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa);
-	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM);
-	KMPProDinoESP32.begin(ProDino_ESP32_Ethernet);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM);
+	//KMPProDinoESP32.begin(ProDino_ESP32, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM, false);
+	KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
 #endif
 
 #ifdef ETH_TEST
 	// Start the Ethernet and takes an IP address form DHCP.
+	// W5500 driver waits only for the rest of the reset.
 	if (Ethernet.begin(_mac) == 0) {
 		Serial.println("Failed to configure Ethernet using DHCP");
 		// no point in carrying on, so do nothing forevermore:
@@ -178,6 +179,9 @@ void setup()
 */
 void loop()
 {
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
 	KMPProDinoESP32.processStatusLed(green, 1000);
 
 	// Checking is device connected to MQTT server.
@@ -343,7 +347,7 @@ void callback(char* topics, byte* payload, unsigned int payloadLen)
 				printSubscribeTopic(topics, payload, payloadLen);
 				// Set relay new state.
 				if (KMPProDinoESP32.getRelayState(relNum) != isOn)
-					KMPProDinoESP32.setRelayState(relNum, isOn);
+					KMPProDinoESP32.setRelayState(relNum, isOn, SourceMqtt);
 				else
 					// Publish current relay state.
 					publishTopic(RelayState, relNum);
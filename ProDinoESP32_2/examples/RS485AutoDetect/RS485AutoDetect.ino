@@ -0,0 +1,137 @@
+// RS485AutoDetect.ino
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		ProDino ESP32 V1 https://kmpelectronics.eu/products/prodino-esp32-v1/
+//		ProDino ESP32 Ethernet V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/
+//		ProDino ESP32 GSM V1 https://kmpelectronics.eu/products/prodino-esp32-gsm-v1/
+//		ProDino ESP32 LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-lora-v1/
+//		ProDino ESP32 LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-lora-rfm-v1/
+//		ProDino ESP32 Ethernet GSM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-gsm-v1/
+//		ProDino ESP32 Ethernet LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-v1/
+//		ProDino ESP32 Ethernet LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-rfm-v1/
+// Description:
+//		RS485 auto detection example. The board listens to the Modbus RTU traffic on the line (or probes a slave)
+//		and finds the baud and configuration. The status led blinks while the detection is running, the relays work as usual.
+// Example link: https://kmpelectronics.eu/tutorials-examples/prodino-esp32-versions-examples/
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPProDinoESP32.h"
+#include "KMPCommon.h"
+#include "KMPRS485AutoDetect.h"
+
+// 0 - passive listening to an existing master and slaves. Set a slave address to probe it.
+#define PROBE_SLAVE_ID 0
+
+RS485DetectState _lastState = RS485DetectIdle;
+uint8_t _lastProgress = 0xFF;
+
+/**
+* @brief Print configuration as text: 8N1, 8E1 ...
+*
+* @return void
+*/
+void printConfig(uint32_t config)
+{
+	switch (config)
+	{
+	case SERIAL_8N1:
+		Serial.print("8N1");
+		break;
+	case SERIAL_8E1:
+		Serial.print("8E1");
+		break;
+	case SERIAL_8O1:
+		Serial.print("8O1");
+		break;
+	case SERIAL_8N2:
+		Serial.print("8N2");
+		break;
+	default:
+		Serial.print(config, HEX);
+		break;
+	}
+}
+
+/**
+* @brief Setup void. Ii is Arduino executed first. Initialize DiNo board.
+*
+*
+* @return void
+*/
+void setup()
+{
+	Serial.begin(115200);
+	Serial.println("The example RS485AutoDetect is starting...");
+
+	// Relays, inputs and RS485 are ready on return, other modules finish their reset in loop.
+	KMPProDinoESP32.begin(ProDino_ESP32, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
+
+	KMPRS485AutoDetect.begin(PROBE_SLAVE_ID);
+
+	Serial.println("The example RS485AutoDetect is started");
+}
+
+/**
+* @brief Loop void. Arduino executed second.
+*
+*
+* @return void
+*/
+void loop()
+{
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
+	// Never waits.
+	KMPRS485AutoDetect.process();
+
+	// The board works while detecting.
+	KMPProDinoESP32.setRelayState(Relay1, KMPProDinoESP32.getOptoInState(OptoIn1));
+
+	RS485DetectState state = KMPRS485AutoDetect.getState();
+	if (state == RS485DetectRunning)
+	{
+		KMPProDinoESP32.processStatusLed(blue, 500);
+
+		uint8_t progress = KMPRS485AutoDetect.getProgress();
+		if (progress != _lastProgress)
+		{
+			_lastProgress = progress;
+			Serial.print("Progress: ");
+			Serial.print(progress);
+			Serial.println("%");
+		}
+	}
+
+	if (state == _lastState)
+	{
+		return;
+	}
+
+	_lastState = state;
+
+	if (state == RS485DetectDone)
+	{
+		KMPProDinoESP32.setStatusLed(green);
+		Serial.print("Detected: ");
+		Serial.print(KMPRS485AutoDetect.getBaud());
+		Serial.print(" ");
+		printConfig(KMPRS485AutoDetect.getConfig());
+		Serial.println();
+	}
+	else if (state == RS485DetectFailed)
+	{
+		KMPProDinoESP32.setStatusLed(red);
+		Serial.println("RS485 configuration is not detected");
+	}
+}
@@ -39,24 +39,28 @@ char _resultBuffer[BUFF_MAX];
 */
 void setup()
 {
-	delay(5000);
 	Serial.begin(115200);
 	Serial.println("The example RS485Relay is starting...");
 
-	KMPProDinoESP32.begin(ProDino_ESP32);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet);
-	//KMPProDinoESP32.begin(ProDino_ESP32_GSM);
-	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa);
-	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM);
+	// Relays states are restored in begin and saved after every change.
+	KMPProDinoESP32.enableRelaysPersistence();
+
+	// Relays, inputs and RS485 are ready on return, other modules finish their reset in loop.
+	KMPProDinoESP32.begin(ProDino_ESP32, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
 	KMPProDinoESP32.setStatusLed(blue);
 
 	// Start RS485 with baud 19200 and 8N1.
 	KMPProDinoESP32.rs485Begin(19200);
+	// Received data is grouped in frames by 4 characters idle time.
+	RS485Serial.beginFrames();
 	Serial.println("The example RS485Relay is started.");
-	delay(1000);
 
 	KMPProDinoESP32.offStatusLed();
 }
@@ -67,12 +71,22 @@ void setup()
 *
 * @return void
 */
-void loop() {
+void loop()
+{
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
+	// Saves changed relays states in flash after a quiet interval.
+	KMPProDinoESP32.processRelaysPersistence();
+
 	KMPProDinoESP32.processStatusLed(green, 1000);
-	// Waiting for a data.
-	int i = KMPProDinoESP32.rs485Read();
+	// Needed only for cores without RX timeout event.
+	RS485Serial.processFrames();
+
+	// Waiting for a frame.
+	size_t buffPos = RS485Serial.readFrame((uint8_t*)_dataBuffer, BUFF_MAX - 1);
 
-	if (i == -1)
+	if (buffPos == 0)
 	{
 		return;
 	}
@@ -82,17 +96,7 @@ void loop() {
 	// If in RS485 port has any data - Status led is Yellow
 	KMPProDinoESP32.setStatusLed(yellow);
 
-	uint8_t buffPos = 0;
-
-	// Reading data from the RS485 port.
-	while (i > -1 && buffPos < BUFF_MAX)
-	{
-		// Adding received data in a buffer.
-		_dataBuffer[buffPos++] = (char)i;
-		Serial.write((char)i);
-		// Reading a next char.
-		i = KMPProDinoESP32.rs485Read();
-	}
+	Serial.write((const uint8_t*)_dataBuffer, buffPos);
 
 	_dataBuffer[buffPos] = CH_NONE;
 
@@ -123,7 +127,7 @@ void ProcessData()
 			// Set relay status if only chars are 0 or 1.
 			if (_dataBuffer[i] == CH_0 || _dataBuffer[i] == CH_1)
 			{
-				KMPProDinoESP32.setRelayState(relayNum, _dataBuffer[i] == CH_1);
+				KMPProDinoESP32.setRelayState(relayNum, _dataBuffer[i] == CH_1, SourceRS485);
 			}
 
 			++relayNum;
@@ -0,0 +1,106 @@
+// RS485SnifferE.ino
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		KMP ProDino ESP32 Ethernet V1 (https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/)
+//		KMP ProDino ESP32 Ethernet GSM V1 (https://kmpelectronics.eu/products/prodino-esp32-GSM-ethernet-v1/)
+//		KMP ProDino ESP32 Ethernet LoRa V1 (https://kmpelectronics.eu/products/prodino-esp32-GSM-ethernet-v1/)
+//		KMP ProDino ESP32 Ethernet LoRa RFM V1 (https://kmpelectronics.eu/products/prodino-esp32-GSM-ethernet-v1/)
+// Description:
+//		RS485 bus sniffer example. The board listens the RS485 bus and streams captured frames in pcap format to a TCP client.
+//		Capture in a file:       nc <board IP> 4000 > capture.pcap
+//		Live view in Wireshark:  nc <board IP> 4000 | wireshark -k -i -
+// Example link: https://kmpelectronics.eu/tutorials-examples/prodino-esp32-versions-examples/
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPProDinoESP32.h"
+#include "KMPCommon.h"
+#include "KMPRS485Sniffer.h"
+
+#define RS485_BAUD 115200
+#define SNIFFER_PORT 4000
+
+// Enter a MAC address and IP address for your controller below.
+byte _mac[] = { 0x00, 0x08, 0xDC, 0x72, 0xE7, 0x42 };
+
+EthernetServer _server(SNIFFER_PORT);
+EthernetClient _client;
+
+/**
+* @brief Setup void. It is Arduino executed first. Initialize DiNo board.
+*
+*
+* @return void
+*/
+void setup()
+{
+	Serial.begin(115200);
+	Serial.println("The example RS485SnifferE is starting...");
+
+	// Init Dino board. Set pins, start W5500.
+	// Relays, inputs and RS485 are ready on return, other modules finish their reset in loop.
+	KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
+	KMPProDinoESP32.setStatusLed(blue);
+
+	// Bigger UART buffer keeps 115200 baud without losses while the capture is sent.
+	RS485Serial.setRxBufferSize(RS485_SNIFFER_RX_BUFFER);
+	KMPProDinoESP32.rs485Begin(RS485_BAUD);
+	KMPRS485Sniffer.begin(RS485Serial);
+
+	// W5500 driver waits only for the rest of the reset.
+	if (Ethernet.begin(_mac) == 0) {
+		Serial.println("Failed to configure Ethernet using DHCP");
+		// no point in carrying on, so do nothing forevermore:
+		while (1);
+	}
+	_server.begin();
+
+	Serial.print("Sniffer: ");
+	Serial.print(Ethernet.localIP());
+	Serial.print(":");
+	Serial.println(SNIFFER_PORT);
+	Serial.print("IO ready mS: ");
+	Serial.print(KMPProDinoESP32.getInitMetrics().IOReadyMs);
+	Serial.print(" Ethernet ready mS: ");
+	Serial.println(KMPProDinoESP32.getInitMetrics().EthernetReadyMs);
+
+	KMPProDinoESP32.offStatusLed();
+}
+
+/**
+* @brief Loop void. Arduino executed second.
+*
+*
+* @return void
+*/
+void loop()
+{
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
+	// Needed only for cores without RX timeout event.
+	KMPRS485Sniffer.process();
+
+	if (!_client.connected())
+	{
+		KMPProDinoESP32.processStatusLed(green, 1000);
+
+		_client = _server.accept();
+		if (!_client)
+		{
+			return;
+		}
+
+		// Every stream starts with pcap header and the frames captured after the connection.
+		KMPRS485Sniffer.clear();
+		KMPRS485Sniffer.writePcapHeader(_client);
+		KMPProDinoESP32.setStatusLed(yellow);
+	}
+
+	KMPRS485Sniffer.stream(_client);
+}
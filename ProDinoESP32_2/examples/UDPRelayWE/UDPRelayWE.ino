@@ -59,6 +59,9 @@ void setup()
 	Serial.begin(115200);
 	Serial.println("The example UDPRelay is starting...");
 
+	// Relays states are restored in begin and saved after every change.
+	KMPProDinoESP32.enableRelaysPersistence();
+
 	//KMPProDinoESP32.begin(ProDino_ESP32);
 	//KMPProDinoESP32.begin(ProDino_ESP32_GSM);
 	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa);
@@ -121,6 +124,9 @@ void setup()
 */
 void loop()
 {
+	// Saves changed relays states in flash after a quiet interval.
+	KMPProDinoESP32.processRelaysPersistence();
+
 	KMPProDinoESP32.processStatusLed(green, 1000);
 
 	UDP * udp = NULL;
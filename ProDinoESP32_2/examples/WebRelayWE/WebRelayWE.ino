@@ -43,19 +43,22 @@ WiFiServer _wifiServer(LOCAL_PORT);
  */
 void setup(void)
 {
-	delay(5000);
 	Serial.begin(115200);
 	Serial.println("The example WebRelay is starting...");
 
-	//KMPProDinoESP32.begin(ProDino_ESP32);
-	//KMPProDinoESP32.begin(ProDino_ESP32_GSM);
-	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa);
-	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM);
+	// Relays states are restored in begin and saved after every change.
+	KMPProDinoESP32.enableRelaysPersistence();
+
+	// Relays and inputs are ready on return, other modules finish their reset in loop.
+	//KMPProDinoESP32.begin(ProDino_ESP32, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_LoRa_RFM, false);
 #ifdef ETH_TEST
-	KMPProDinoESP32.begin(ProDino_ESP32_Ethernet);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa);
-	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM);
+	KMPProDinoESP32.begin(ProDino_ESP32_Ethernet, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_GSM, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa, false);
+	//KMPProDinoESP32.begin(ProDino_ESP32_Ethernet_LoRa_RFM, false);
 #endif // ETH_TEST
 
 	KMPProDinoESP32.setStatusLed(blue);
@@ -81,6 +84,7 @@ void setup(void)
 #ifdef ETH_TEST
 	// Start the Ethernet connection and the server.
 	//Ethernet.begin(_mac, _ip);
+	// W5500 driver waits only for the rest of the reset.
 	if (Ethernet.begin(_mac) == 0) {
 		Serial.println("Failed to configure Ethernet using DHCP");
 		// no point in carrying on, so do nothing forevermore:
@@ -108,6 +112,12 @@ void setup(void)
 */
 void loop()
 {
+	// Completes the modules initialization. It returns immediately when all are ready.
+	KMPProDinoESP32.isReady();
+
+	// Saves changed relays states in flash after a quiet interval.
+	KMPProDinoESP32.processRelaysPersistence();
+
 	KMPProDinoESP32.processStatusLed(green, 1000);
 
 	Client* client = NULL;
@@ -196,7 +206,7 @@ bool ReadClientRequest(Stream* client)
 		uint8_t relay = CharToInt(lastRow[1]) - 1;
 		bool newState = lastRow.endsWith(W_ON);
 
-		KMPProDinoESP32.setRelayState(relay, newState);
+		KMPProDinoESP32.setRelayState(relay, newState, SourceWeb);
 	}
 
 	Serial.println(">> End client request.");
@@ -0,0 +1,48 @@
+// HostTest.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Checks for the host tests. A failed check is printed and counted, the test continues.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _HOSTTEST_H
+#define _HOSTTEST_H
+
+#include <stdio.h>
+
+extern int hostTestFailures;
+
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) \
+		{ \
+			++hostTestFailures; \
+			printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+		} \
+	} while (0)
+
+#define CHECK_EQUAL(expected, actual) \
+	do { \
+		long long e_ = (long long)(expected); \
+		long long a_ = (long long)(actual); \
+		if (e_ != a_) \
+		{ \
+			++hostTestFailures; \
+			printf("%s:%d: %s expected %lld, actual %lld\n", __FILE__, __LINE__, #actual, e_, a_); \
+		} \
+	} while (0)
+
+#define RUN_TEST(test) \
+	do { \
+		int failures_ = hostTestFailures; \
+		test(); \
+		printf("%s %s\n", failures_ == hostTestFailures ? "PASS" : "FAIL", #test); \
+	} while (0)
+
+#define HOST_TEST_MAIN_END() \
+	printf("%s: %d failed checks\n", hostTestFailures == 0 ? "OK" : "FAILED", hostTestFailures); \
+	return hostTestFailures == 0 ? 0 : 1
+
+#endif
@@ -0,0 +1,544 @@
+// Arduino.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Minimal Arduino API for the Linux host build.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <unistd.h>
+
+#include <deque>
+#include <vector>
+
+// Virtual time starts from 1 second, so "millis() - 0" checks aren't special.
+static unsigned long _hostMicros = 1000000UL;
+static HostIdleCallback _idleCallback = NULL;
+
+unsigned long millis()
+{
+	return _hostMicros / 1000;
+}
+
+unsigned long micros()
+{
+	return _hostMicros;
+}
+
+void hostAdvanceMicros(unsigned long us)
+{
+	_hostMicros += us;
+}
+
+void hostSetIdleCallback(HostIdleCallback callback)
+{
+	_idleCallback = callback;
+}
+
+void yield()
+{
+	hostRunTasks();
+
+	if (_idleCallback != NULL)
+	{
+		_idleCallback();
+	}
+}
+
+void delay(unsigned long ms)
+{
+	// Step by 1 mS, the idle callback serves the peer meanwhile.
+	while (ms-- > 0)
+	{
+		yield();
+		_hostMicros += 1000;
+	}
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	_hostMicros += us;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+	(void)pin;
+	(void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+	(void)pin;
+	(void)value;
+}
+
+int digitalRead(uint8_t pin)
+{
+	(void)pin;
+	return LOW;
+}
+
+void String::trim()
+{
+	size_t first = find_first_not_of(" \t\r\n");
+	if (first == npos)
+	{
+		clear();
+		return;
+	}
+
+	size_t last = find_last_not_of(" \t\r\n");
+	*this = substr(first, last - first + 1);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+	size_t n = 0;
+	while (size--)
+	{
+		n += write(*buffer++);
+	}
+
+	return n;
+}
+
+size_t Print::print(long value, int base)
+{
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%ld", value);
+
+	return write(buffer);
+}
+
+size_t Print::print(unsigned long value, int base)
+{
+	char buffer[24];
+	snprintf(buffer, sizeof(buffer), base == HEX ? "%lX" : "%lu", value);
+
+	return write(buffer);
+}
+
+size_t Print::print(double value, int digits)
+{
+	char buffer[40];
+	snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+
+	return write(buffer);
+}
+
+size_t Print::printf(const char* format, ...)
+{
+	char buffer[256];
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(buffer, sizeof(buffer), format, args);
+	va_end(args);
+
+	if (len < 0)
+	{
+		return 0;
+	}
+
+	return write((const uint8_t*)buffer, min((size_t)len, sizeof(buffer) - 1));
+}
+
+size_t Stream::readBytes(uint8_t* buffer, size_t length)
+{
+	size_t count = 0;
+	unsigned long start = millis();
+
+	while (count < length)
+	{
+		int c = read();
+		if (c >= 0)
+		{
+			buffer[count++] = (uint8_t)c;
+			continue;
+		}
+
+		if (millis() - start >= _timeout)
+		{
+			break;
+		}
+		delay(1);
+	}
+
+	return count;
+}
+
+bool IPAddress::fromString(const char* address)
+{
+	unsigned int b[4];
+	char end;
+	if (sscanf(address, "%u.%u.%u.%u%c", &b[0], &b[1], &b[2], &b[3], &end) != 4)
+	{
+		return false;
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		if (b[i] > 255)
+		{
+			return false;
+		}
+		_address[i] = (uint8_t)b[i];
+	}
+
+	return true;
+}
+
+String IPAddress::toString() const
+{
+	char buffer[16];
+	snprintf(buffer, sizeof(buffer), "%u.%u.%u.%u", _address[0], _address[1], _address[2], _address[3]);
+
+	return String(buffer);
+}
+
+struct HostQueue {
+	size_t Length;
+	size_t ItemSize;
+	std::deque<std::string> Items;
+};
+
+struct HostTask {
+	TaskFunction_t Function;
+	void* Arg;
+};
+
+static std::vector<HostTask*> _tasks;
+static HostTask* _runningTask = NULL;
+// Return point of the running task when it waits.
+static jmp_buf* _taskWait = NULL;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+	HostQueue* queue = new HostQueue();
+	queue->Length = length;
+	queue->ItemSize = itemSize;
+
+	return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+	delete queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait)
+{
+	(void)wait;
+
+	if (queue->Items.size() >= queue->Length)
+	{
+		return pdFALSE;
+	}
+
+	queue->Items.push_back(std::string((const char*)item, queue->ItemSize));
+
+	return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait)
+{
+	if (queue->Items.empty())
+	{
+		// The task waits: it continues from here when it runs next time, it is started again.
+		if (wait > 0 && _taskWait != NULL)
+		{
+			longjmp(*_taskWait, 1);
+		}
+
+		return pdFALSE;
+	}
+
+	memcpy(item, queue->Items.front().data(), queue->ItemSize);
+	queue->Items.pop_front();
+
+	return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t queue)
+{
+	queue->Items.clear();
+
+	return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* arg, UBaseType_t priority, TaskHandle_t* task)
+{
+	(void)name;
+	(void)stackDepth;
+	(void)priority;
+
+	HostTask* created = new HostTask();
+	created->Function = function;
+	created->Arg = arg;
+	_tasks.push_back(created);
+
+	if (task != NULL)
+	{
+		*task = created;
+	}
+
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+	bool self = task == NULL || task == _runningTask;
+	if (self)
+	{
+		task = _runningTask;
+	}
+
+	for (size_t i = 0; i < _tasks.size(); i++)
+	{
+		if (_tasks[i] == task)
+		{
+			_tasks.erase(_tasks.begin() + i);
+			delete task;
+			break;
+		}
+	}
+
+	// The deleted task doesn't continue.
+	if (self && _taskWait != NULL)
+	{
+		_runningTask = NULL;
+		longjmp(*_taskWait, 1);
+	}
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	delay(ticks * portTICK_PERIOD_MS);
+}
+
+void hostRunTasks()
+{
+	// A task function has only trivial locals, so it is left by longjmp when it waits and it is started again next time.
+	if (_taskWait != NULL)
+	{
+		return;
+	}
+
+	std::vector<HostTask*> tasks = _tasks;
+	for (size_t i = 0; i < tasks.size(); i++)
+	{
+		jmp_buf wait;
+		if (setjmp(wait) == 0)
+		{
+			_taskWait = &wait;
+			_runningTask = tasks[i];
+			tasks[i]->Function(tasks[i]->Arg);
+		}
+		_taskWait = NULL;
+		_runningTask = NULL;
+	}
+}
+
+// Up to 3 UARTs as ESP32.
+struct uart_struct_t {
+	HardwareSerial* Serial;
+	QueueHandle_t Queue;
+};
+
+static uart_t* _uarts[3];
+
+void uartGetEventQueue(uart_t* uart, QueueHandle_t* q)
+{
+	*q = uart != NULL ? uart->Queue : NULL;
+}
+
+int uart_flush_input(uart_port_t port)
+{
+	if (port >= 0 && port < 3 && _uarts[port] != NULL)
+	{
+		_uarts[port]->Serial->hostFlushInput();
+	}
+
+	return 0;
+}
+
+HardwareSerial Serial(0);
+
+HardwareSerial::HardwareSerial(int uartNr) :
+	_uart_nr(uartNr),
+	_uart(NULL),
+	_baud(0),
+	_fd(-1),
+	_rxPos(0)
+{
+	// The event queue length of the ESP32 core.
+	_uart = new uart_t();
+	_uart->Serial = this;
+	_uart->Queue = xQueueCreate(20, sizeof(uart_event_t));
+
+	if (uartNr >= 0 && uartNr < 3)
+	{
+		_uarts[uartNr] = _uart;
+	}
+}
+
+HardwareSerial::~HardwareSerial()
+{
+	if (_uart_nr >= 0 && _uart_nr < 3 && _uarts[_uart_nr] == _uart)
+	{
+		_uarts[_uart_nr] = NULL;
+	}
+
+	vQueueDelete(_uart->Queue);
+	delete _uart;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin, bool invert, unsigned long timeout_ms)
+{
+	(void)config;
+	(void)rxPin;
+	(void)txPin;
+	(void)invert;
+	(void)timeout_ms;
+
+	_baud = baud;
+}
+
+void HardwareSerial::end()
+{
+	_rx.clear();
+	_rxPos = 0;
+}
+
+void HardwareSerial::hostAttach(int fd)
+{
+	_fd = fd;
+	_rx.clear();
+	_rxPos = 0;
+
+	if (_fd >= 0)
+	{
+		fcntl(_fd, F_SETFL, fcntl(_fd, F_GETFL) | O_NONBLOCK);
+	}
+}
+
+void HardwareSerial::hostReceive(const uint8_t* data, size_t size, bool timeout)
+{
+	_rx.append((const char*)data, size);
+
+	uart_event_t event;
+	memset(&event, 0, sizeof(event));
+	event.type = UART_DATA;
+	event.size = size;
+	event.timeout_flag = timeout;
+	xQueueSend(_uart->Queue, &event, 0);
+}
+
+void HardwareSerial::hostFlushInput()
+{
+	_rx.clear();
+	_rxPos = 0;
+}
+
+/**
+* @brief Move the data waiting in the file descriptor to the RX buffer.
+*
+* @return void
+*/
+void HardwareSerial::receive()
+{
+	if (_fd < 0)
+	{
+		return;
+	}
+
+	uint8_t buffer[256];
+	ssize_t n;
+	while ((n = ::read(_fd, buffer, sizeof(buffer))) > 0)
+	{
+		_rx.append((const char*)buffer, n);
+	}
+}
+
+int HardwareSerial::available()
+{
+	receive();
+
+	// The library waits for the peer in a loop. The peer is served and an empty poll takes one character time,
+	// so the virtual time moves and the timeouts of the loop work.
+	if (_rxPos == _rx.size() && _fd >= 0)
+	{
+		yield();
+		receive();
+
+		if (_rxPos == _rx.size())
+		{
+			hostAdvanceMicros(_baud > 0 ? 10000000UL / _baud : 10);
+		}
+	}
+
+	return (int)(_rx.size() - _rxPos);
+}
+
+int HardwareSerial::peek()
+{
+	if (available() == 0)
+	{
+		return -1;
+	}
+
+	return (uint8_t)_rx[_rxPos];
+}
+
+int HardwareSerial::read()
+{
+	int c = peek();
+	if (c < 0)
+	{
+		return c;
+	}
+
+	if (++_rxPos == _rx.size())
+	{
+		_rx.clear();
+		_rxPos = 0;
+	}
+
+	return c;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+	if (_fd < 0)
+	{
+		return size;
+	}
+
+	size_t written = 0;
+	while (written < size)
+	{
+		ssize_t n = ::write(_fd, buffer + written, size - written);
+		if (n > 0)
+		{
+			written += n;
+		}
+		else if (n < 0 && errno != EAGAIN && errno != EINTR)
+		{
+			break;
+		}
+		else
+		{
+			// The peer reads in the idle callback.
+			yield();
+		}
+	}
+
+	return written;
+}
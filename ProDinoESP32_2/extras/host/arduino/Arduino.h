@@ -0,0 +1,213 @@
+// Arduino.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Minimal Arduino API for the Linux host build of the library. Only the parts used by the library sources
+//		built in extras/host are implemented. Time is virtual: it moves only by delay(), delayMicroseconds()
+//		and hostAdvanceMicros(), so the tests are repeatable and a busy wait in the library never ends.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _ARDUINO_HOST_H
+#define _ARDUINO_HOST_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+
+#define DEC 10
+#define HEX 16
+
+#define IRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define F(x) (x)
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// ESP32 serial configuration values.
+#define SERIAL_5N1 0x8000010
+#define SERIAL_7E1 0x800001a
+#define SERIAL_7O1 0x800001b
+#define SERIAL_8N1 0x800001c
+#define SERIAL_8E1 0x800001e
+#define SERIAL_8O1 0x800001f
+#define SERIAL_8N2 0x800003c
+#define SERIAL_8E2 0x800003e
+#define SERIAL_8O2 0x800003f
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+
+/**
+ * @brief Move the virtual time. Host build only.
+ *
+ * @param us Microseconds.
+ *
+ * @return void
+ */
+void hostAdvanceMicros(unsigned long us);
+
+/**
+ * @brief Called by delay() and yield() before the time moves. Host build only.
+ *        The modem emulator uses it to serve the pty while the library waits.
+ */
+typedef void (*HostIdleCallback)();
+void hostSetIdleCallback(HostIdleCallback callback);
+
+// FreeRTOS critical sections. The host build is single threaded.
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux) (void)(mux)
+
+// FreeRTOS tasks and queues. A task runs in yield() and delay() of the main program until it waits for an empty queue,
+// so a test decides when the tasks run and can make them late.
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+typedef struct HostQueue* QueueHandle_t;
+typedef struct HostTask* TaskHandle_t;
+typedef void (*TaskFunction_t)(void*);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define portTICK_PERIOD_MS 1
+#define configMAX_PRIORITIES 25
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait);
+BaseType_t xQueueReset(QueueHandle_t queue);
+BaseType_t xTaskCreate(TaskFunction_t function, const char* name, uint32_t stackDepth, void* arg, UBaseType_t priority, TaskHandle_t* task);
+void vTaskDelete(TaskHandle_t task);
+// The tick is 1 mS as in the ESP32 core, it is delay().
+void vTaskDelay(TickType_t ticks);
+
+/**
+ * @brief Run the tasks until they wait for an empty queue. yield() and delay() call it. Host build only.
+ *
+ * @return void
+ */
+void hostRunTasks();
+
+class String : public std::string
+{
+ public:
+	String() {}
+	String(const char* s) : std::string(s != NULL ? s : "") {}
+	String(const std::string& s) : std::string(s) {}
+	String(char c) : std::string(1, c) {}
+	String(int value) : std::string(std::to_string(value)) {}
+	String(unsigned int value) : std::string(std::to_string(value)) {}
+	String(long value) : std::string(std::to_string(value)) {}
+	String(unsigned long value) : std::string(std::to_string(value)) {}
+
+	unsigned int length() const { return size(); }
+	char charAt(unsigned int index) const { return index < size() ? at(index) : 0; }
+	bool startsWith(const String& prefix) const { return compare(0, prefix.size(), prefix) == 0; }
+	bool endsWith(const String& suffix) const { return size() >= suffix.size() && compare(size() - suffix.size(), suffix.size(), suffix) == 0; }
+	bool equalsIgnoreCase(const String& s) const { return size() == s.size() && strncasecmp(c_str(), s.c_str(), size()) == 0; }
+	int indexOf(char c, unsigned int from = 0) const { size_t r = find(c, from); return r == npos ? -1 : (int)r; }
+	int indexOf(const String& s, unsigned int from = 0) const { size_t r = find(s, from); return r == npos ? -1 : (int)r; }
+	int lastIndexOf(char c) const { size_t r = rfind(c); return r == npos ? -1 : (int)r; }
+	int lastIndexOf(char c, unsigned int from) const { size_t r = rfind(c, from); return r == npos ? -1 : (int)r; }
+	int lastIndexOf(const String& s) const { size_t r = rfind(s); return r == npos ? -1 : (int)r; }
+	String substring(unsigned int from) const { return from < size() ? String(substr(from)) : String(); }
+	String substring(unsigned int from, unsigned int to) const { return from < to && from < size() ? String(substr(from, to - from)) : String(); }
+	long toInt() const { return atol(c_str()); }
+	float toFloat() const { return (float)atof(c_str()); }
+	void remove(unsigned int index) { if (index < size()) erase(index); }
+	void remove(unsigned int index, unsigned int count) { if (index < size()) erase(index, count); }
+	void trim();
+	bool reserve(unsigned int size) { std::string::reserve(size); return true; }
+	void toCharArray(char* buffer, unsigned int size) const { if (size > 0) { strncpy(buffer, c_str(), size - 1); buffer[size - 1] = '\0'; } }
+
+	String& operator+=(const String& s) { append(s); return *this; }
+	String& operator+=(const char* s) { append(s != NULL ? s : ""); return *this; }
+	String& operator+=(char c) { push_back(c); return *this; }
+	String& operator+=(int value) { append(std::to_string(value)); return *this; }
+	String& operator+=(unsigned int value) { append(std::to_string(value)); return *this; }
+	String& operator+=(long value) { append(std::to_string(value)); return *this; }
+	String& operator+=(unsigned long value) { append(std::to_string(value)); return *this; }
+};
+
+class Print
+{
+ public:
+	virtual ~Print() {}
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size);
+	size_t write(const char* s) { return s != NULL ? write((const uint8_t*)s, strlen(s)) : 0; }
+	size_t write(const char* buffer, size_t size) { return write((const uint8_t*)buffer, size); }
+	virtual int availableForWrite() { return 0; }
+	virtual void flush() {}
+
+	size_t print(const char* s) { return write(s); }
+	size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+	size_t print(char c) { return write((uint8_t)c); }
+	size_t print(unsigned char value, int base = DEC) { return print((unsigned long)value, base); }
+	size_t print(int value, int base = DEC) { return print((long)value, base); }
+	size_t print(unsigned int value, int base = DEC) { return print((unsigned long)value, base); }
+	size_t print(long value, int base = DEC);
+	size_t print(unsigned long value, int base = DEC);
+	size_t print(double value, int digits = 2);
+
+	size_t println() { return write("\r\n"); }
+	template<typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+	template<typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+	size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print
+{
+ public:
+	Stream() : _timeout(1000) {}
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int peek() = 0;
+
+	void setTimeout(unsigned long timeout) { _timeout = timeout; }
+	size_t readBytes(uint8_t* buffer, size_t length);
+	size_t readBytes(char* buffer, size_t length) { return readBytes((uint8_t*)buffer, length); }
+
+ protected:
+	unsigned long _timeout;
+};
+
+#include "HardwareSerial.h"
+
+// Not attached, the output is dropped.
+extern HardwareSerial Serial;
+
+#endif
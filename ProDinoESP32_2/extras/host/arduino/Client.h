@@ -0,0 +1,33 @@
+// Client.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Arduino Client interface for the Linux host build.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _CLIENT_HOST_H
+#define _CLIENT_HOST_H
+
+#include "Arduino.h"
+#include "IPAddress.h"
+
+class Client : public Stream
+{
+ public:
+	virtual int connect(IPAddress ip, uint16_t port) = 0;
+	virtual int connect(const char* host, uint16_t port) = 0;
+	virtual size_t write(uint8_t c) = 0;
+	virtual size_t write(const uint8_t* buffer, size_t size) = 0;
+	virtual int available() = 0;
+	virtual int read() = 0;
+	virtual int read(uint8_t* buffer, size_t size) = 0;
+	virtual int peek() = 0;
+	virtual void flush() = 0;
+	virtual void stop() = 0;
+	virtual uint8_t connected() = 0;
+	virtual operator bool() = 0;
+};
+
+#endif
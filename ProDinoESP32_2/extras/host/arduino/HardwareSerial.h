@@ -0,0 +1,102 @@
+// HardwareSerial.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		ESP32 HardwareSerial for the Linux host build. A port can be attached to a file descriptor (pty),
+//		otherwise received data is empty and written data is dropped. When an attached port has no data
+//		available() serves the peer by yield() and moves the virtual time by one character time.
+//		hostReceive() gives data as the UART interrupt: it is buffered and a UART_DATA event is queued.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _HARDWARESERIAL_HOST_H
+#define _HARDWARESERIAL_HOST_H
+
+#include "Arduino.h"
+#include "driver/uart.h"
+
+#define UART_MODE_UART 0x00
+#define UART_MODE_RS485_HALF_DUPLEX 0x01
+#define UART_HW_FLOWCTRL_DISABLE 0x00
+#define UART_HW_FLOWCTRL_CTS_RTS 0x03
+
+enum hardwareSerial_error_t {
+	UART_NO_ERROR,
+	UART_BREAK_ERROR,
+	UART_BUFFER_FULL_ERROR,
+	UART_FIFO_OVF_ERROR,
+	UART_FRAME_ERROR,
+	UART_PARITY_ERROR
+};
+
+// The UART driver of a port, it has the event queue.
+typedef struct uart_struct_t uart_t;
+void uartGetEventQueue(uart_t* uart, QueueHandle_t* q);
+
+typedef void (*OnReceiveCb)(void);
+typedef void (*OnReceiveErrorCb)(hardwareSerial_error_t);
+
+class HardwareSerial : public Stream
+{
+ public:
+	HardwareSerial(int uartNr);
+	~HardwareSerial();
+
+	void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1, bool invert = false, unsigned long timeout_ms = 20000UL);
+	void end();
+	void updateBaudRate(unsigned long baud) { _baud = baud; }
+	uint32_t baudRate() { return _baud; }
+
+	int available();
+	int availableForWrite() { return 128; }
+	int peek();
+	int read();
+	using Print::write;
+	size_t write(uint8_t c) { return write(&c, 1); }
+	size_t write(const uint8_t* buffer, size_t size);
+	void flush() {}
+	operator bool() const { return true; }
+
+	size_t setRxBufferSize(size_t size) { return size; }
+	bool setRxTimeout(uint8_t symbols) { (void)symbols; return true; }
+	bool setRxFIFOFull(uint8_t fifoBytes) { (void)fifoBytes; return true; }
+	void onReceive(OnReceiveCb callback, bool onlyOnTimeout = false) { (void)callback; (void)onlyOnTimeout; }
+	void onReceiveError(OnReceiveErrorCb callback) { (void)callback; }
+	bool setPins(int8_t rxPin, int8_t txPin, int8_t ctsPin = -1, int8_t rtsPin = -1) { (void)rxPin; (void)txPin; (void)ctsPin; (void)rtsPin; return true; }
+	bool setHwFlowCtrlMode(uint8_t mode = UART_HW_FLOWCTRL_CTS_RTS, uint8_t threshold = 64) { (void)mode; (void)threshold; return true; }
+	bool setMode(uint8_t mode) { (void)mode; return true; }
+
+	/**
+	 * @brief Attach the port to a file descriptor, e.g. pty master or slave. Host build only.
+	 *
+	 * @param fd File descriptor. It is set in non blocking mode. -1 - detach.
+	 *
+	 * @return void
+	 */
+	void hostAttach(int fd);
+
+	/**
+	 * @brief Data received by the UART, as FIFO full (timeout false) or RX timeout (timeout true) interrupt.
+	 *        A UART_DATA event with its size is queued, the driver drops the event if the queue is full. Host build only.
+	 *
+	 * @return void
+	 */
+	void hostReceive(const uint8_t* data, size_t size, bool timeout);
+
+	// Drop the received and not read data, see uart_flush_input().
+	void hostFlushInput();
+
+ protected:
+	int _uart_nr;
+	uart_t* _uart;
+	unsigned long _baud;
+	int _fd;
+	// Received and not read data.
+	std::string _rx;
+	size_t _rxPos;
+
+	void receive();
+};
+
+#endif
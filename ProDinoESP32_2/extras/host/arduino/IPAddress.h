@@ -0,0 +1,36 @@
+// IPAddress.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		IPv4 address for the Linux host build.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _IPADDRESS_HOST_H
+#define _IPADDRESS_HOST_H
+
+#include "Arduino.h"
+
+class IPAddress
+{
+ public:
+	IPAddress() { memset(_address, 0, sizeof(_address)); }
+	IPAddress(uint8_t b1, uint8_t b2, uint8_t b3, uint8_t b4) { _address[0] = b1; _address[1] = b2; _address[2] = b3; _address[3] = b4; }
+	IPAddress(uint32_t address) { memcpy(_address, &address, sizeof(_address)); }
+
+	bool fromString(const char* address);
+	bool fromString(const String& address) { return fromString(address.c_str()); }
+	String toString() const;
+
+	operator uint32_t() const { uint32_t address; memcpy(&address, _address, sizeof(address)); return address; }
+	bool operator==(const IPAddress& ip) const { return memcmp(_address, ip._address, sizeof(_address)) == 0; }
+	bool operator!=(const IPAddress& ip) const { return !(*this == ip); }
+	uint8_t operator[](int index) const { return _address[index]; }
+	uint8_t& operator[](int index) { return _address[index]; }
+
+ private:
+	uint8_t _address[4];
+};
+
+#endif
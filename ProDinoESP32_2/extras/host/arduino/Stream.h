@@ -0,0 +1,15 @@
+// Stream.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Stream is declared in Arduino.h of the Linux host build.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _STREAM_HOST_H
+#define _STREAM_HOST_H
+
+#include "Arduino.h"
+
+#endif
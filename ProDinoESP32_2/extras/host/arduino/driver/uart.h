@@ -0,0 +1,40 @@
+// uart.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		ESP-IDF UART driver functions used by the library. Host build only, the line inversion does nothing.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _UART_HOST_H
+#define _UART_HOST_H
+
+typedef int uart_port_t;
+
+typedef enum {
+	UART_DATA,
+	UART_BREAK,
+	UART_BUFFER_FULL,
+	UART_FIFO_OVF,
+	UART_FRAME_ERR,
+	UART_PARITY_ERR,
+	UART_DATA_BREAK,
+	UART_PATTERN_DET,
+	UART_EVENT_MAX
+} uart_event_type_t;
+
+typedef struct {
+	uart_event_type_t type;
+	size_t size;
+	bool timeout_flag;
+} uart_event_t;
+
+#define UART_SIGNAL_INV_DISABLE 0x00
+#define UART_SIGNAL_TXD_INV 0x02
+
+inline int uart_set_line_inverse(uart_port_t port, uint32_t mask) { (void)port; (void)mask; return 0; }
+// Drop the received and not read data of the HardwareSerial with this number.
+int uart_flush_input(uart_port_t port);
+
+#endif
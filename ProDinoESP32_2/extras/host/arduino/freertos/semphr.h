@@ -0,0 +1,47 @@
+// semphr.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		FreeRTOS recursive mutex used by the library. Host build only: the program is single threaded,
+//		so a take never waits, the mutex counts the takes.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _SEMPHR_HOST_H
+#define _SEMPHR_HOST_H
+
+#include "Arduino.h"
+
+struct HostSemaphore {
+	int Takes;
+};
+
+typedef HostSemaphore* SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()
+{
+	return new HostSemaphore();
+}
+
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t semaphore, TickType_t wait)
+{
+	(void)wait;
+	++semaphore->Takes;
+
+	return pdTRUE;
+}
+
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t semaphore)
+{
+	if (semaphore->Takes == 0)
+	{
+		return pdFALSE;
+	}
+
+	--semaphore->Takes;
+
+	return pdTRUE;
+}
+
+#endif
@@ -0,0 +1,1293 @@
+// ModemEmulator.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		u-blox SARA modem emulator on a pty for the host tests of the MKRGSM library.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "ModemEmulator.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define SMS_CTRL_Z 0x1A
+#define SMS_ESC 0x1B
+// The local address of the emulated packet data context.
+#define PDP_ADDRESS "10.0.0.2"
+// Free space of the file system.
+#define FILE_SYSTEM_SIZE 1048576
+// Multiplexer frames, the modem is the responder: its commands have C/R 0, its responses C/R 1.
+#define MUX_FLAG 0xf9
+#define MUX_EA   0x01
+#define MUX_CR   0x02
+#define MUX_PF   0x10
+#define MUX_SABM 0x2f
+#define MUX_UA   0x63
+#define MUX_DISC 0x43
+#define MUX_UIH  0xef
+#define MUX_MSC  0xe1
+#define MUX_CLD  0xc1
+#define MUX_SIGNAL_FC  0x02
+#define MUX_SIGNAL_RTC 0x04
+#define MUX_SIGNAL_RTR 0x08
+#define MUX_SIGNAL_DV  0x80
+#define MUX_FCS_GOOD 0xcf
+// The response of AT&V.
+#define ACTIVE_PROFILE \
+	"ACTIVE PROFILE:\r\n" \
+	"&C1, &D1, &S1, &K3, E1, Q0, V1, X4, S00:000, S02:043, S03:013, S04:010, S05:008, S07:060, S08:002, S10:002, " \
+	"S12:050, +CBST:007,000,001, +CRLP:061,061,048,006, +CR:000, +CRC:000, +CMGF:000, +CSDH:000, +CNMI:1,0,0,0,0, " \
+	"+ICF:3,1, +UPSV:0, +CMEE:2, +USTS:0, +CSCS:\"IRA\", +CLIP:000, +COLP:000, +CCWA:000, +CSNS:000, +CVHU:001, " \
+	"+UCALLSTAT:000, +CTZU:000, +CTZR:000, +UDCONF:10,0, +UDCONF:20,1, +UPSD:0,0,0\r\n" \
+	"\r\nOK"
+
+static uint8_t muxCrc(uint8_t crc, uint8_t c)
+{
+	// Reversed polynomial x^8 + x^2 + x + 1.
+	crc ^= c;
+	for (int i = 0; i < 8; i++)
+	{
+		crc = (crc & 0x01) ? (crc >> 1) ^ 0xe0 : (crc >> 1);
+	}
+
+	return crc;
+}
+
+ModemEmulator::ModemEmulator() :
+	_masterFd(-1),
+	_slaveFd(-1),
+	_latencyuS(0),
+	_networkDelayuS(0),
+	_uart(NULL),
+	_maxStableBaud(0),
+	_byteuS(0)
+{
+	reset();
+}
+
+ModemEmulator::~ModemEmulator()
+{
+	end();
+}
+
+bool ModemEmulator::begin()
+{
+	end();
+	reset();
+
+	_masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (_masterFd < 0 || grantpt(_masterFd) != 0 || unlockpt(_masterFd) != 0)
+	{
+		end();
+		return false;
+	}
+
+	_slaveName = ptsname(_masterFd);
+	_slaveFd = open(_slaveName.c_str(), O_RDWR | O_NOCTTY);
+	if (_slaveFd < 0)
+	{
+		end();
+		return false;
+	}
+
+	// The line is binary: no echo, no line editing, no CR/LF translation.
+	struct termios tio;
+	tcgetattr(_slaveFd, &tio);
+	cfmakeraw(&tio);
+	tcsetattr(_slaveFd, TCSANOW, &tio);
+
+	fcntl(_masterFd, F_SETFL, fcntl(_masterFd, F_GETFL) | O_NONBLOCK);
+
+	return true;
+}
+
+void ModemEmulator::end()
+{
+	if (_slaveFd >= 0)
+	{
+		close(_slaveFd);
+		_slaveFd = -1;
+	}
+
+	if (_masterFd >= 0)
+	{
+		close(_masterFd);
+		_masterFd = -1;
+	}
+}
+
+void ModemEmulator::reset()
+{
+	_input = INPUT_COMMAND;
+	_rxFreeuS = _txFreeuS = 0;
+	_line.clear();
+	_lastCr = false;
+	_busy = false;
+	_binaryLen = 0;
+	_output.clear();
+	_urcs.clear();
+	_commands.clear();
+	_txBytes = _rxBytes = 0;
+	_baud = MODEM_EMULATOR_AUTOBAUD_RATE;
+	_nextBaud = 0;
+	_outputBytes = 0;
+	_mux = false;
+	_muxDlci = 1;
+	_muxLoopback = 0;
+	_muxFrame.clear();
+
+	for (int i = 0; i < MODEM_EMULATOR_SOCKETS; i++)
+	{
+		_sockets[i] = Socket_t();
+		_sockets[i].Used = false;
+		_sockets[i].Udp = false;
+		_sockets[i].Connected = false;
+	}
+
+	_peerEcho = false;
+	_udpSent.clear();
+	_attached = false;
+	_pdpActive = false;
+	_dnsAddress = "93.184.216.34";
+	_sms.clear();
+	_smsSent.clear();
+	_smsIndex = 0;
+	_files.clear();
+}
+
+void ModemEmulator::setResponse(const char* command, const char* response)
+{
+	for (size_t i = 0; i < _scripts.size(); i++)
+	{
+		if (_scripts[i].first == command)
+		{
+			_scripts.erase(_scripts.begin() + i);
+			break;
+		}
+	}
+
+	// NULL is kept as a single NUL character, a response can't contain it.
+	_scripts.push_back(std::make_pair(std::string(command), response != NULL ? std::string(response) : std::string(1, '\0')));
+}
+
+void ModemEmulator::injectUrc(const char* urc, unsigned long delayuS)
+{
+	Urc_t item = { micros() + delayuS, urc };
+
+	// In time order, the URCs with the same time in the order they are added.
+	std::deque<Urc_t>::iterator it = _urcs.end();
+	while (it != _urcs.begin() && (long)((it - 1)->TimeuS - item.TimeuS) > 0)
+	{
+		--it;
+	}
+	_urcs.insert(it, item);
+}
+
+void ModemEmulator::peerSend(int socket, const std::string& data, unsigned long delayuS)
+{
+	Socket_t& s = _sockets[socket];
+	if (!s.Used || s.Udp)
+	{
+		return;
+	}
+
+	s.Received += data;
+	announce(socket, micros() + delayuS);
+}
+
+void ModemEmulator::peerClose(int socket)
+{
+	_sockets[socket].Connected = false;
+
+	char urc[24];
+	snprintf(urc, sizeof(urc), "+UUSOCL: %d", socket);
+	injectUrc(urc);
+}
+
+void ModemEmulator::udpReceive(int socket, const char* ip, uint16_t port, const std::string& data)
+{
+	Socket_t& s = _sockets[socket];
+	if (!s.Used || !s.Udp)
+	{
+		return;
+	}
+
+	ModemDatagram_t datagram = { ip, port, data };
+	s.Datagrams.push_back(datagram);
+
+	char urc[32];
+	snprintf(urc, sizeof(urc), "+UUSORF: %d,%u", socket, (unsigned int)data.size());
+	injectUrc(urc);
+}
+
+void ModemEmulator::addSms(const char* number, const char* text)
+{
+	ModemSms_t sms = { ++_smsIndex, false, number, text };
+	_sms.push_back(sms);
+}
+
+size_t ModemEmulator::count(const char* command)
+{
+	size_t result = 0;
+	size_t length = strlen(command);
+
+	for (size_t i = 0; i < _commands.size(); i++)
+	{
+		if (_commands[i].compare(0, length, command) == 0)
+		{
+			++result;
+		}
+	}
+
+	return result;
+}
+
+/**
+* @brief Announce the data of a TCP socket with +UUSORD. The count is all data in the modem.
+*
+* @return void
+*/
+void ModemEmulator::announce(int socket, unsigned long timeuS)
+{
+	char urc[32];
+	snprintf(urc, sizeof(urc), "+UUSORD: %d,%u", socket, (unsigned int)_sockets[socket].Received.size());
+
+	Urc_t item = { timeuS, urc };
+	std::deque<Urc_t>::iterator it = _urcs.end();
+	while (it != _urcs.begin() && (long)((it - 1)->TimeuS - item.TimeuS) > 0)
+	{
+		--it;
+	}
+	_urcs.insert(it, item);
+}
+
+void ModemEmulator::serve()
+{
+	if (_masterFd < 0)
+	{
+		return;
+	}
+
+	unsigned long now = micros();
+
+	flushUrcs();
+
+	// The bytes arrive one after another at the line speed.
+	uint8_t buffer[256];
+	ssize_t n;
+	while ((n = ::read(_masterFd, buffer, sizeof(buffer))) > 0)
+	{
+		for (ssize_t i = 0; i < n; i++)
+		{
+			_rxFreeuS = max(_rxFreeuS, (double)now) + _byteuS;
+			++_rxBytes;
+
+			// A byte at another rate is a framing error.
+			if (_uart != NULL && _uart->baudRate() != _baud)
+			{
+				continue;
+			}
+
+			if (_mux)
+			{
+				receiveMux(buffer[i], (unsigned long)_rxFreeuS);
+			}
+			else
+			{
+				receive(buffer[i], (unsigned long)_rxFreeuS);
+			}
+		}
+	}
+
+	if (_lastCr)
+	{
+		endLine((unsigned long)_rxFreeuS);
+	}
+
+	flushUrcs();
+
+	// The output which is due at the line speed.
+	while (!_output.empty())
+	{
+		Output_t& out = _output.front();
+		if ((long)(now - out.StartuS) < 0)
+		{
+			break;
+		}
+
+		size_t due = out.Data.size();
+		if (_byteuS > 0)
+		{
+			due = min(due, (size_t)((now - out.StartuS) / _byteuS));
+		}
+
+		if (due <= out.Written)
+		{
+			break;
+		}
+
+		std::string data = out.Data.substr(out.Written, due - out.Written);
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			// The library reads garbage at another rate and bit errors above the max stable rate.
+			if ((_uart != NULL && _uart->baudRate() != _baud) ||
+				(_maxStableBaud > 0 && _baud > _maxStableBaud && ++_outputBytes % MODEM_EMULATOR_UNSTABLE_BYTES == 0))
+			{
+				data[i] ^= 0x01;
+			}
+		}
+
+		ssize_t written = ::write(_masterFd, data.data(), data.size());
+		if (written <= 0)
+		{
+			// The library doesn't read, the pty is full.
+			break;
+		}
+
+		out.Written += written;
+		_txBytes += written;
+
+		if (out.Written < out.Data.size())
+		{
+			break;
+		}
+		_output.pop_front();
+	}
+
+	// AT+IPR changes the rate after its response is sent.
+	if (_nextBaud > 0 && _output.empty())
+	{
+		_baud = _nextBaud;
+		_nextBaud = 0;
+	}
+}
+
+/**
+* @brief Send the URCs which are due when no command runs.
+*
+* @return void
+*/
+void ModemEmulator::flushUrcs()
+{
+	while (!_busy && !_urcs.empty() && (long)(micros() - _urcs.front().TimeuS) >= 0)
+	{
+		// The URCs go to channel 1 of the multiplexer.
+		uint8_t dlci = _muxDlci;
+		_muxDlci = 1;
+		output("\r\n" + _urcs.front().Text + "\r\n", _urcs.front().TimeuS);
+		_muxDlci = dlci;
+		_urcs.pop_front();
+	}
+}
+
+/**
+* @brief Put data in the output of the running command. In the multiplexer mode it goes in the frames of its channel.
+*
+* @return void
+*/
+void ModemEmulator::output(const std::string& data, unsigned long timeuS)
+{
+	if (!_mux)
+	{
+		outputLine(data, timeuS);
+		return;
+	}
+
+	for (size_t i = 0; i < data.size(); i += MODEM_EMULATOR_MUX_FRAME_SIZE)
+	{
+		outputLine(muxFrame(_muxDlci, MUX_UIH, true, data.substr(i, MODEM_EMULATOR_MUX_FRAME_SIZE)), timeuS);
+	}
+}
+
+/**
+* @brief Put bytes in the line output. They start at the time or after the previous output.
+*
+* @return void
+*/
+void ModemEmulator::outputLine(const std::string& data, unsigned long timeuS)
+{
+	if (!_output.empty() && timeuS <= _txFreeuS)
+	{
+		_output.back().Data += data;
+	}
+	else
+	{
+		_txFreeuS = max(_txFreeuS, (double)timeuS);
+		Output_t out = { (unsigned long)_txFreeuS, data, 0 };
+		_output.push_back(out);
+	}
+
+	_txFreeuS += data.size() * _byteuS;
+}
+
+void ModemEmulator::muxFlow(uint8_t dlci, bool stop, unsigned long delayuS)
+{
+	uint8_t msc[4] = {
+		MUX_MSC | MUX_CR,
+		(2 << 1) | MUX_EA,
+		(uint8_t)((dlci << 2) | MUX_CR | MUX_EA),
+		(uint8_t)(MUX_EA | MUX_SIGNAL_RTC | MUX_SIGNAL_RTR | MUX_SIGNAL_DV | (stop ? MUX_SIGNAL_FC : 0))
+	};
+
+	outputLine(muxFrame(0, MUX_UIH, true, std::string((const char*)msc, sizeof(msc))), micros() + delayuS);
+}
+
+/**
+* @brief Receive a byte of a multiplexer frame. The frame length is in its header, the data can contain flags.
+*
+* @return void
+*/
+void ModemEmulator::receiveMux(uint8_t c, unsigned long timeuS)
+{
+	// The flags between the frames.
+	if (_muxFrame.empty() && c == MUX_FLAG)
+	{
+		return;
+	}
+
+	_muxFrame += (char)c;
+	if (_muxFrame.size() < 3)
+	{
+		return;
+	}
+
+	size_t headerLength = (_muxFrame[2] & MUX_EA) ? 3 : 4;
+	if (_muxFrame.size() < headerLength)
+	{
+		return;
+	}
+
+	size_t length = (uint8_t)_muxFrame[2] >> 1;
+	if (headerLength == 4)
+	{
+		length |= (size_t)(uint8_t)_muxFrame[3] << 7;
+	}
+
+	// The FCS and the closing flag.
+	if (_muxFrame.size() < headerLength + length + 2)
+	{
+		return;
+	}
+
+	std::string frame;
+	frame.swap(_muxFrame);
+
+	uint8_t control = frame[1];
+	uint8_t fcs = 0xff;
+	size_t fcsLength = ((control & ~MUX_PF) == MUX_UIH) ? headerLength : headerLength + length;
+	for (size_t i = 0; i < fcsLength; i++)
+	{
+		fcs = muxCrc(fcs, frame[i]);
+	}
+	fcs = muxCrc(fcs, frame[headerLength + length]);
+
+	if ((uint8_t)frame[headerLength + length + 1] != MUX_FLAG || fcs != MUX_FCS_GOOD)
+	{
+		return;
+	}
+
+	handleMuxFrame((uint8_t)frame[0] >> 2, control, frame.substr(headerLength, length), timeuS);
+}
+
+void ModemEmulator::handleMuxFrame(uint8_t dlci, uint8_t control, const std::string& data, unsigned long timeuS)
+{
+	switch (control & ~MUX_PF)
+	{
+	case MUX_SABM:
+	case MUX_DISC:
+		outputLine(muxFrame(dlci, MUX_UA | MUX_PF, false, ""), timeuS + _latencyuS);
+		break;
+	case MUX_UIH:
+		if (dlci == 0)
+		{
+			handleMuxControl(data, timeuS);
+		}
+		else if (dlci == _muxLoopback)
+		{
+			uint8_t command = _muxDlci;
+			_muxDlci = dlci;
+			output(data, timeuS + _networkDelayuS);
+			_muxDlci = command;
+		}
+		else
+		{
+			_muxDlci = dlci;
+			for (size_t i = 0; i < data.size(); i++)
+			{
+				receive(data[i], timeuS);
+			}
+		}
+		break;
+	}
+}
+
+/**
+* @brief Confirm the control channel commands of the library. CLD ends the multiplexer.
+*
+* @return void
+*/
+void ModemEmulator::handleMuxControl(const std::string& data, unsigned long timeuS)
+{
+	// The responses of the library to the commands of the modem.
+	if (data.size() < 2 || !(data[0] & MUX_CR))
+	{
+		return;
+	}
+
+	std::string response = data;
+	response[0] &= ~MUX_CR;
+	outputLine(muxFrame(0, MUX_UIH, false, response), timeuS + _latencyuS);
+
+	if (((uint8_t)data[0] & ~MUX_CR) == MUX_CLD)
+	{
+		_mux = false;
+		_muxDlci = 1;
+	}
+}
+
+/**
+* @brief Send the response of the running command. After it the URCs can be sent.
+*
+* @return void
+*/
+void ModemEmulator::respond(const std::string& response, unsigned long timeuS)
+{
+	output("\r\n" + response + "\r\n", timeuS);
+	_busy = false;
+}
+
+/**
+* @brief Run the command line ended by CR. The modem echoes the LF which follows it before the response.
+*
+* @return void
+*/
+void ModemEmulator::endLine(unsigned long timeuS)
+{
+	_lastCr = false;
+
+	std::string command = _line;
+	_line.clear();
+
+	if (command.size() >= 2 && toupper(command[0]) == 'A' && toupper(command[1]) == 'T')
+	{
+		_commands.push_back(command);
+		execute(command, timeuS);
+	}
+	else
+	{
+		_busy = false;
+	}
+}
+
+void ModemEmulator::receive(uint8_t c, unsigned long timeuS)
+{
+	if (_lastCr)
+	{
+		if (c == '\n')
+		{
+			output(std::string(1, (char)c), timeuS);
+			endLine(timeuS);
+			return;
+		}
+		endLine(timeuS);
+	}
+
+	switch (_input)
+	{
+	case INPUT_COMMAND:
+	default:
+	{
+		output(std::string(1, (char)c), timeuS);
+
+		if (c == '\r')
+		{
+			_lastCr = true;
+		}
+		else if (c != '\n' || !_line.empty())
+		{
+			_line += (char)c;
+			_busy = true;
+		}
+		break;
+	}
+	case INPUT_BINARY:
+	{
+		_binary += (char)c;
+		if (_binary.size() == _binaryLen)
+		{
+			finishBinary(timeuS);
+		}
+		break;
+	}
+	case INPUT_SMS_TEXT:
+	{
+		output(std::string(1, (char)c), timeuS);
+
+		if (c == SMS_CTRL_Z)
+		{
+			ModemSms_t sms = { ++_smsIndex, true, _smsNumber, _binary };
+			_smsSent.push_back(sms);
+			_input = INPUT_COMMAND;
+
+			char response[32];
+			snprintf(response, sizeof(response), "+CMGS: %d\r\n\r\nOK", sms.Index);
+			respond(response, timeuS + _latencyuS);
+		}
+		else if (c == SMS_ESC)
+		{
+			_input = INPUT_COMMAND;
+			respond("OK", timeuS + _latencyuS);
+		}
+		else
+		{
+			_binary += (char)c;
+		}
+		break;
+	}
+	}
+}
+
+void ModemEmulator::execute(const std::string& command, unsigned long timeuS)
+{
+	if (executeScript(command, timeuS))
+	{
+		return;
+	}
+
+	std::string name = command.substr(0, command.find_first_of("=?"));
+	for (size_t i = 0; i < name.size(); i++)
+	{
+		name[i] = toupper(name[i]);
+	}
+
+	std::string response;
+	unsigned long responseuS = timeuS + _latencyuS;
+
+	if (name.compare(0, 6, "AT+USO") == 0)
+	{
+		response = executeSocket(command, timeuS);
+		// The connection is made in the network.
+		if (name == "AT+USOCO")
+		{
+			responseuS += _networkDelayuS;
+		}
+	}
+	else if (name == "AT+CGATT" || name.compare(0, 7, "AT+UPSD") == 0 || name == "AT+UPSND" || name == "AT+UDNSRN")
+	{
+		response = executeData(command);
+	}
+	else if (name.compare(0, 6, "AT+CMG") == 0)
+	{
+		response = executeSms(command, timeuS);
+	}
+	else if (name == "AT+ULSTFILE" || name == "AT+UDWNFILE" || name == "AT+URDFILE" || name == "AT+URDBLOCK" || name == "AT+UDELFILE")
+	{
+		response = executeFile(command, timeuS);
+	}
+	else if (name == "AT+IPR")
+	{
+		int baud = intParameter(command, 0);
+		response = "OK";
+		if (command.find('=') == std::string::npos)
+		{
+			response = "+IPR: " + std::to_string(_baud) + "\r\n\r\nOK";
+		}
+		else if (baud == 0 || baud == 115200 || baud == 230400 || baud == 460800 || baud == 921600)
+		{
+			_nextBaud = baud > 0 ? baud : MODEM_EMULATOR_AUTOBAUD_RATE;
+		}
+		else
+		{
+			response = "ERROR";
+		}
+	}
+	else if (name == "AT&V")
+	{
+		response = ACTIVE_PROFILE;
+	}
+	else if (name == "AT+CMUX")
+	{
+		// Basic option with the N1 of the emulator.
+		response = (intParameter(command, 0) == 0 && intParameter(command, 3, MODEM_EMULATOR_MUX_FRAME_SIZE) <= MODEM_EMULATOR_MUX_FRAME_SIZE) ? "OK" : "ERROR";
+	}
+	else
+	{
+		response = "OK";
+	}
+
+	// Empty - the command waits for data after a prompt.
+	if (!response.empty())
+	{
+		respond(response, responseuS);
+	}
+
+	// The frames start after the OK.
+	if (name == "AT+CMUX" && response == "OK")
+	{
+		_mux = true;
+		_muxDlci = 1;
+		_muxFrame.clear();
+	}
+}
+
+/**
+* @brief Send the scripted response of the command if there is one.
+*
+* @return bool true - the command is scripted.
+*/
+bool ModemEmulator::executeScript(const std::string& command, unsigned long timeuS)
+{
+	for (size_t i = 0; i < _scripts.size(); i++)
+	{
+		if (command.compare(0, _scripts[i].first.size(), _scripts[i].first) != 0)
+		{
+			continue;
+		}
+
+		if (_scripts[i].second == std::string(1, '\0'))
+		{
+			// No response, the command doesn't block the URCs.
+			_busy = false;
+		}
+		else
+		{
+			respond(_scripts[i].second, timeuS + _latencyuS);
+		}
+		return true;
+	}
+
+	return false;
+}
+
+std::string ModemEmulator::executeSocket(const std::string& command, unsigned long timeuS)
+{
+	std::string name = command.substr(0, command.find('='));
+	int socket = intParameter(command, 0);
+	bool valid = socket >= 0 && socket < MODEM_EMULATOR_SOCKETS && _sockets[socket].Used;
+	char response[64];
+
+	if (name == "AT+USOCR")
+	{
+		for (int i = 0; i < MODEM_EMULATOR_SOCKETS; i++)
+		{
+			if (!_sockets[i].Used)
+			{
+				_sockets[i] = Socket_t();
+				_sockets[i].Used = true;
+				_sockets[i].Udp = socket == 17;
+				_sockets[i].Connected = false;
+
+				snprintf(response, sizeof(response), "+USOCR: %d\r\n\r\nOK", i);
+				return response;
+			}
+		}
+		return "ERROR";
+	}
+
+	if (!valid)
+	{
+		return "ERROR";
+	}
+
+	Socket_t& s = _sockets[socket];
+
+	if (name == "AT+USOCO")
+	{
+		if (!_pdpActive || s.Udp)
+		{
+			return "ERROR";
+		}
+		s.Connected = true;
+		return "OK";
+	}
+
+	if (name == "AT+USOWR" || name == "AT+USOST")
+	{
+		// USOST has the remote address before the length.
+		size_t lengthIndex = name == "AT+USOWR" ? 1 : 3;
+		int length = intParameter(command, lengthIndex);
+		std::string hex;
+
+		if ((name == "AT+USOWR" && (!s.Connected || s.Udp)) || (name == "AT+USOST" && !s.Udp) || length <= 0)
+		{
+			return "ERROR";
+		}
+
+		if (parameter(command, lengthIndex + 1, hex))
+		{
+			_binaryCommand = command;
+			_binary = fromHex(hex);
+			finishBinary(timeuS);
+			return "";
+		}
+
+		if (length > MODEM_EMULATOR_BINARY_WRITE_MAX)
+		{
+			return "ERROR";
+		}
+
+		// Binary data after the prompt.
+		output("@", timeuS + _latencyuS);
+		_binaryCommand = command;
+		_binaryLen = length;
+		_binary.clear();
+		_input = INPUT_BINARY;
+		return "";
+	}
+
+	if (name == "AT+USORD")
+	{
+		int length = intParameter(command, 1);
+		if (length < 0)
+		{
+			return "ERROR";
+		}
+
+		if (length == 0)
+		{
+			snprintf(response, sizeof(response), "+USORD: %d,%u", socket, (unsigned int)s.Received.size());
+			return response;
+		}
+
+		size_t n = min(min((size_t)length, (size_t)MODEM_EMULATOR_HEX_READ_MAX), s.Received.size());
+		std::string data = s.Received.substr(0, n);
+		s.Received.erase(0, n);
+
+		snprintf(response, sizeof(response), "+USORD: %d,%u,\"", socket, (unsigned int)n);
+		return response + toHex(data) + "\"\r\n\r\nOK";
+	}
+
+	if (name == "AT+USORF")
+	{
+		int length = intParameter(command, 1);
+		if (!s.Udp || length < 0 || (length > 0 && s.Datagrams.empty()))
+		{
+			return "ERROR";
+		}
+
+		if (length == 0)
+		{
+			size_t total = 0;
+			for (size_t i = 0; i < s.Datagrams.size(); i++)
+			{
+				total += s.Datagrams[i].Data.size();
+			}
+			snprintf(response, sizeof(response), "+USORF: %d,%u", socket, (unsigned int)total);
+			return response;
+		}
+
+		// The rest of a longer datagram is lost.
+		ModemDatagram_t datagram = s.Datagrams.front();
+		s.Datagrams.pop_front();
+		size_t n = min(min((size_t)length, (size_t)MODEM_EMULATOR_HEX_READ_MAX), datagram.Data.size());
+
+		snprintf(response, sizeof(response), "+USORF: %d,\"%s\",%u,%u,\"", socket, datagram.Ip.c_str(), datagram.Port, (unsigned int)n);
+		return response + toHex(datagram.Data.substr(0, n)) + "\"\r\n\r\nOK";
+	}
+
+	if (name == "AT+USOCL")
+	{
+		s.Used = false;
+		s.Connected = false;
+		return "OK";
+	}
+
+	// USOLI, USOSEC, USOSO ...
+	return "OK";
+}
+
+/**
+* @brief The binary data of USOWR, USOST or UDWNFILE is received.
+*
+* @return void
+*/
+void ModemEmulator::finishBinary(unsigned long timeuS)
+{
+	std::string name = _binaryCommand.substr(0, _binaryCommand.find('='));
+	char response[48];
+
+	_input = INPUT_COMMAND;
+
+	if (name == "AT+UDWNFILE")
+	{
+		std::string file;
+		parameter(_binaryCommand, 0, file);
+		_files[file] += _binary;
+
+		respond("OK", timeuS + _latencyuS);
+		return;
+	}
+
+	int socket = intParameter(_binaryCommand, 0);
+	Socket_t& s = _sockets[socket];
+
+	if (name == "AT+USOST")
+	{
+		ModemDatagram_t datagram;
+		parameter(_binaryCommand, 1, datagram.Ip);
+		datagram.Port = intParameter(_binaryCommand, 2);
+		datagram.Data = _binary;
+		_udpSent.push_back(datagram);
+
+		snprintf(response, sizeof(response), "+USOST: %d,%u\r\n\r\nOK", socket, (unsigned int)_binary.size());
+		respond(response, timeuS + _latencyuS);
+		return;
+	}
+
+	s.Sent += _binary;
+	if (_peerEcho)
+	{
+		s.Received += _binary;
+		announce(socket, timeuS + _networkDelayuS);
+	}
+
+	snprintf(response, sizeof(response), "+USOWR: %d,%u\r\n\r\nOK", socket, (unsigned int)_binary.size());
+	respond(response, timeuS + _latencyuS);
+}
+
+std::string ModemEmulator::executeData(const std::string& command)
+{
+	std::string name = command.substr(0, command.find_first_of("=?"));
+	int first = intParameter(command, 0);
+	int second = intParameter(command, 1);
+	char response[64];
+
+	if (name == "AT+CGATT")
+	{
+		if (command.find('?') != std::string::npos)
+		{
+			snprintf(response, sizeof(response), "+CGATT: %d\r\n\r\nOK", _attached ? 1 : 0);
+			return response;
+		}
+
+		_attached = first == 1;
+		if (!_attached)
+		{
+			_pdpActive = false;
+		}
+		return "OK";
+	}
+
+	if (name == "AT+UPSDA")
+	{
+		// 3 - activate, 4 - deactivate.
+		if (second == 3)
+		{
+			if (!_attached)
+			{
+				return "ERROR";
+			}
+			_pdpActive = true;
+		}
+		else if (second == 4)
+		{
+			_pdpActive = false;
+		}
+		return "OK";
+	}
+
+	if (name == "AT+UPSND")
+	{
+		if (second == 0)
+		{
+			if (!_pdpActive)
+			{
+				return "ERROR";
+			}
+			return "+UPSND: 0,0,\"" PDP_ADDRESS "\"\r\n\r\nOK";
+		}
+
+		snprintf(response, sizeof(response), "+UPSND: 0,%d,%d\r\n\r\nOK", second, _pdpActive ? 1 : 0);
+		return response;
+	}
+
+	if (name == "AT+UDNSRN")
+	{
+		if (!_pdpActive)
+		{
+			return "ERROR";
+		}
+		return "+UDNSRN: \"" + _dnsAddress + "\"\r\n\r\nOK";
+	}
+
+	// UPSD profile parameters.
+	return "OK";
+}
+
+std::string ModemEmulator::executeSms(const std::string& command, unsigned long timeuS)
+{
+	std::string name = command.substr(0, command.find_first_of("=?"));
+
+	if (name == "AT+CMGL")
+	{
+		std::string status = "REC UNREAD";
+		parameter(command, 0, status);
+		bool all = status == "ALL";
+
+		std::string response;
+		for (size_t i = 0; i < _sms.size(); i++)
+		{
+			ModemSms_t& sms = _sms[i];
+			if (!all && sms.Read != (status == "REC READ"))
+			{
+				continue;
+			}
+
+			char header[96];
+			snprintf(header, sizeof(header), "+CMGL: %d,\"%s\",\"%s\",,\"26/10/19,12:00:00+12\"\r\n",
+				sms.Index, sms.Read ? "REC READ" : "REC UNREAD", sms.Number.c_str());
+			response += header + sms.Text + "\r\n";
+			sms.Read = true;
+		}
+
+		return response + (response.empty() ? "OK" : "\r\nOK");
+	}
+
+	if (name == "AT+CMGS")
+	{
+		parameter(command, 0, _smsNumber);
+		output("\r\n> ", timeuS + _latencyuS);
+		_binary.clear();
+		_input = INPUT_SMS_TEXT;
+		return "";
+	}
+
+	if (name == "AT+CMGD")
+	{
+		int index = intParameter(command, 0);
+		for (size_t i = 0; i < _sms.size(); i++)
+		{
+			if (_sms[i].Index == index)
+			{
+				_sms.erase(_sms.begin() + i);
+				return "OK";
+			}
+		}
+		return "ERROR";
+	}
+
+	// CMGF, CNMI ...
+	return "OK";
+}
+
+std::string ModemEmulator::executeFile(const std::string& command, unsigned long timeuS)
+{
+	std::string name = command.substr(0, command.find('='));
+	std::string file;
+	char response[64];
+
+	if (name == "AT+ULSTFILE")
+	{
+		int op = intParameter(command, 0, 0);
+
+		if (op == 0)
+		{
+			std::string list;
+			for (std::map<std::string, std::string>::iterator it = _files.begin(); it != _files.end(); ++it)
+			{
+				list += (list.empty() ? "\"" : ",\"") + it->first + "\"";
+			}
+			return "+ULSTFILE: " + list + "\r\n\r\nOK";
+		}
+
+		if (op == 1)
+		{
+			size_t used = 0;
+			for (std::map<std::string, std::string>::iterator it = _files.begin(); it != _files.end(); ++it)
+			{
+				used += it->second.size();
+			}
+			snprintf(response, sizeof(response), "+ULSTFILE: %u\r\n\r\nOK", (unsigned int)(FILE_SYSTEM_SIZE - used));
+			return response;
+		}
+
+		parameter(command, 1, file);
+		if (_files.find(file) == _files.end())
+		{
+			return "ERROR";
+		}
+		snprintf(response, sizeof(response), "+ULSTFILE: %u\r\n\r\nOK", (unsigned int)_files[file].size());
+		return response;
+	}
+
+	parameter(command, 0, file);
+
+	if (name == "AT+UDWNFILE")
+	{
+		int length = intParameter(command, 1);
+		if (length <= 0)
+		{
+			return "ERROR";
+		}
+
+		output(">", timeuS + _latencyuS);
+		_binaryCommand = command;
+		_binaryLen = length;
+		_binary.clear();
+		_input = INPUT_BINARY;
+		return "";
+	}
+
+	if (_files.find(file) == _files.end())
+	{
+		return "ERROR";
+	}
+
+	const std::string& content = _files[file];
+
+	if (name == "AT+URDFILE")
+	{
+		snprintf(response, sizeof(response), "+URDFILE: \"%s\",%u,\"", file.c_str(), (unsigned int)content.size());
+		return response + content + "\"\r\n\r\nOK";
+	}
+
+	if (name == "AT+URDBLOCK")
+	{
+		size_t offset = min((size_t)max(intParameter(command, 1), 0), content.size());
+		std::string block = content.substr(offset, max(intParameter(command, 2), 0));
+
+		snprintf(response, sizeof(response), "+URDBLOCK: \"%s\",%u,\"", file.c_str(), (unsigned int)block.size());
+		return response + block + "\"\r\n\r\nOK";
+	}
+
+	// UDELFILE
+	_files.erase(file);
+	return "OK";
+}
+
+/**
+* @brief Build a multiplexer frame. The FCS of UIH frames is calculated without the data.
+*
+* @return std::string Frame with the flags.
+*/
+std::string ModemEmulator::muxFrame(uint8_t dlci, uint8_t control, bool command, const std::string& data)
+{
+	std::string frame(1, (char)MUX_FLAG);
+	frame += (char)((dlci << 2) | (command ? 0 : MUX_CR) | MUX_EA);
+	frame += (char)control;
+	if (data.size() <= 0x7f)
+	{
+		frame += (char)((data.size() << 1) | MUX_EA);
+	}
+	else
+	{
+		frame += (char)((data.size() << 1) & 0xfe);
+		frame += (char)(data.size() >> 7);
+	}
+
+	uint8_t fcs = 0xff;
+	for (size_t i = 1; i < frame.size(); i++)
+	{
+		fcs = muxCrc(fcs, frame[i]);
+	}
+
+	if (control != MUX_UIH)
+	{
+		for (size_t i = 0; i < data.size(); i++)
+		{
+			fcs = muxCrc(fcs, data[i]);
+		}
+	}
+
+	frame += data;
+	frame += (char)(0xff - fcs);
+	frame += (char)MUX_FLAG;
+
+	return frame;
+}
+
+std::string ModemEmulator::toHex(const std::string& data)
+{
+	static const char DIGITS[] = "0123456789ABCDEF";
+	std::string result;
+	result.reserve(data.size() * 2);
+
+	for (size_t i = 0; i < data.size(); i++)
+	{
+		uint8_t b = (uint8_t)data[i];
+		result += DIGITS[b >> 4];
+		result += DIGITS[b & 0x0F];
+	}
+
+	return result;
+}
+
+std::string ModemEmulator::fromHex(const std::string& hex)
+{
+	std::string result;
+
+	for (size_t i = 0; i + 1 < hex.size(); i += 2)
+	{
+		result += (char)strtoul(hex.substr(i, 2).c_str(), NULL, 16);
+	}
+
+	return result;
+}
+
+/**
+* @brief Get a command parameter. The parameters are after '=' and separated by ',', quotes are removed.
+*
+* @param command AT command.
+* @param index Parameter index from 0.
+* @param value Result.
+*
+* @return bool true - the parameter exists.
+*/
+bool ModemEmulator::parameter(const std::string& command, size_t index, std::string& value)
+{
+	size_t pos = command.find('=');
+	if (pos == std::string::npos)
+	{
+		return false;
+	}
+
+	size_t current = 0;
+	bool quoted = false;
+	std::string result;
+
+	for (pos++; pos < command.size(); pos++)
+	{
+		char c = command[pos];
+
+		if (c == '"')
+		{
+			quoted = !quoted;
+		}
+		else if (c == ',' && !quoted)
+		{
+			if (current == index)
+			{
+				break;
+			}
+			++current;
+			result.clear();
+		}
+		else
+		{
+			result += c;
+		}
+	}
+
+	if (current != index)
+	{
+		return false;
+	}
+
+	value = result;
+	return true;
+}
+
+int ModemEmulator::intParameter(const std::string& command, size_t index, int defaultValue)
+{
+	std::string value;
+	if (!parameter(command, index, value) || value.empty())
+	{
+		return defaultValue;
+	}
+
+	return atoi(value.c_str());
+}
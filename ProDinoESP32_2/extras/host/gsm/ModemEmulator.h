@@ -0,0 +1,350 @@
+// ModemEmulator.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		u-blox SARA modem emulator on a pty for the host tests of the MKRGSM library. The library opens the pty slave
+//		as its UART (HardwareSerial::hostAttach), the emulator serves the master from the idle callback.
+//		It implements the AT subset used by the library: sockets (USOCR, USOCO, USOWR, USORD, USORF, USOST, USOLI, USOCL),
+//		packet data (CGATT, UPSD, UPSDA, UPSND, UDNSRN), SMS (CMGL, CMGS, CMGD), files (ULSTFILE, UDWNFILE,
+//		URDFILE, URDBLOCK, UDELFILE), the UART rate (IPR, the active profile of AT&V) and the 3GPP TS 27.010
+//		multiplexer (CMUX, basic option): AT commands run on any channel, a channel can send its data back as a PPP peer.
+//		Other commands answer OK, a test can script any response.
+//		Timing is in the virtual time of the host build: the line bandwidth limits both directions, the response
+//		latency is the time from the end of the command to the first response byte. URCs wait while a command runs.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _MODEMEMULATOR_H
+#define _MODEMEMULATOR_H
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <Arduino.h>
+
+#define MODEM_EMULATOR_SOCKETS 7
+// Max data length of AT+USORD and AT+USORF in hex mode.
+#define MODEM_EMULATOR_HEX_READ_MAX 512
+// Max data length of AT+USOWR and AT+USOST in binary mode.
+#define MODEM_EMULATOR_BINARY_WRITE_MAX 1024
+// The rate after the reset.
+#define MODEM_EMULATOR_AUTOBAUD_RATE 115200
+// Above the max stable rate one output byte in this count has a bit error.
+#define MODEM_EMULATOR_UNSTABLE_BYTES 256
+// Max information field length (N1) of the multiplexer frames.
+#define MODEM_EMULATOR_MUX_FRAME_SIZE 127
+
+/**
+ * @brief UDP datagram in the emulated network.
+ */
+struct ModemDatagram_t {
+	std::string Ip;
+	uint16_t Port;
+	std::string Data;
+};
+
+/**
+ * @brief SMS in the emulated modem storage.
+ */
+struct ModemSms_t {
+	int Index;
+	bool Read;
+	std::string Number;
+	std::string Text;
+};
+
+class ModemEmulator
+{
+ public:
+	ModemEmulator();
+	~ModemEmulator();
+
+	/**
+	* @brief Open the pty and reset the modem state.
+	*
+	* @return bool true - the pty is open.
+	*/
+	bool begin();
+
+	/**
+	* @brief Close the pty.
+	*
+	* @return void
+	*/
+	void end();
+
+	/**
+	* @brief The pty slave, the library UART.
+	*/
+	int slaveFd() { return _slaveFd; }
+	const char* slaveName() { return _slaveName.c_str(); }
+
+	/**
+	* @brief Read the received commands and write the due output. Call it from the host idle callback.
+	*
+	* @return void
+	*/
+	void serve();
+
+	/**
+	* @brief Set the time from the end of a command to its response.
+	*
+	* @param us Microseconds.
+	*
+	* @return void
+	*/
+	void setLatency(unsigned long us) { _latencyuS = us; }
+
+	/**
+	* @brief Set the line speed in both directions.
+	*
+	* @param bytesPerSecond Bytes per second (baud / 10). 0 - unlimited.
+	*
+	* @return void
+	*/
+	void setBandwidth(unsigned long bytesPerSecond) { _byteuS = bytesPerSecond > 0 ? 1000000.0 / bytesPerSecond : 0; }
+
+	/**
+	* @brief Check the rate of the library UART. A byte received at another rate is lost, the output is garbled.
+	*
+	* @param uart Library UART. NULL - no check, e.g. the transport has no rate.
+	*
+	* @return void
+	*/
+	void setUart(HardwareSerial* uart) { _uart = uart; }
+
+	/**
+	* @brief Set the max rate of a stable line. Above it one output byte in MODEM_EMULATOR_UNSTABLE_BYTES has a bit error.
+	*
+	* @param baud Baud. 0 - all rates are stable.
+	*
+	* @return void
+	*/
+	void setMaxStableBaud(unsigned long baud) { _maxStableBaud = baud; }
+
+	/**
+	* @brief The UART rate of the modem, AT+IPR changes it after its response.
+	*/
+	unsigned long baud() { return _baud; }
+
+	/**
+	* @brief The multiplexer is on (AT+CMUX), the line carries frames.
+	*/
+	bool muxActive() { return _mux; }
+
+	/**
+	* @brief The data of a multiplexer channel is sent back, as a PPP peer. The other channels run AT commands.
+	*
+	* @param dlci Channel. 0 - none.
+	*
+	* @return void
+	*/
+	void setMuxLoopback(uint8_t dlci) { _muxLoopback = dlci; }
+
+	/**
+	* @brief Stop or resume the data of the library on a multiplexer channel (MSC with the FC signal).
+	*
+	* @param dlci Channel.
+	* @param stop true - the library must not send.
+	* @param delayuS Delay from now.
+	*
+	* @return void
+	*/
+	void muxFlow(uint8_t dlci, bool stop, unsigned long delayuS = 0);
+
+	/**
+	* @brief Set the time from the data sent by a socket to the data received from the peer (echo).
+	*/
+	void setNetworkDelay(unsigned long us) { _networkDelayuS = us; }
+
+	/**
+	* @brief Script the response of a command. It replaces the built in command.
+	*
+	* @param command Command beginning, e.g. "AT+CSQ".
+	* @param response Response text without the echo, e.g. "+CSQ: 20,0\r\n\r\nOK". NULL - the modem doesn't respond.
+	*
+	* @return void
+	*/
+	void setResponse(const char* command, const char* response);
+
+	/**
+	* @brief Send an unsolicited result code. It waits while a command runs.
+	*
+	* @param urc URC text, e.g. "+UUPSDD: 0".
+	* @param delayuS Delay from now.
+	*
+	* @return void
+	*/
+	void injectUrc(const char* urc, unsigned long delayuS = 0);
+
+	/**
+	* @brief TCP peers send back the received data.
+	*/
+	void setPeerEcho(bool echo) { _peerEcho = echo; }
+
+	/**
+	* @brief Data from the TCP peer of a connected socket. The modem announces it by +UUSORD.
+	*/
+	void peerSend(int socket, const std::string& data, unsigned long delayuS = 0);
+
+	/**
+	* @brief The TCP peer closes the connection (+UUSOCL).
+	*/
+	void peerClose(int socket);
+
+	/**
+	* @brief A datagram for a UDP socket (+UUSORF).
+	*/
+	void udpReceive(int socket, const char* ip, uint16_t port, const std::string& data);
+
+	/**
+	* @brief Data written by the library to a TCP socket since its creation.
+	*/
+	const std::string& peerReceived(int socket) { return _sockets[socket].Sent; }
+
+	/**
+	* @brief Datagrams sent by the library.
+	*/
+	const std::vector<ModemDatagram_t>& udpSent() { return _udpSent; }
+
+	/**
+	* @brief Put a new (unread) SMS in the storage.
+	*/
+	void addSms(const char* number, const char* text);
+	const std::vector<ModemSms_t>& smsStorage() { return _sms; }
+	// SMS sent by AT+CMGS.
+	const std::vector<ModemSms_t>& smsSent() { return _smsSent; }
+
+	/**
+	* @brief Files in the modem file system. The library stores them as hex text.
+	*/
+	void setFile(const char* name, const std::string& content) { _files[name] = content; }
+	const std::map<std::string, std::string>& files() { return _files; }
+
+	/**
+	* @brief Result of the DNS resolution (AT+UDNSRN) for all names.
+	*/
+	void setDnsAddress(const char* ip) { _dnsAddress = ip; }
+
+	/**
+	* @brief Received commands (without the binary data).
+	*/
+	const std::vector<std::string>& commands() { return _commands; }
+	size_t count(const char* command);
+	void clearCommands() { _commands.clear(); }
+
+	/**
+	* @brief Bytes written and received by the emulator.
+	*/
+	unsigned long txBytes() { return _txBytes; }
+	unsigned long rxBytes() { return _rxBytes; }
+
+ private:
+	struct Socket_t {
+		bool Used;
+		bool Udp;
+		bool Connected;
+		// Data from the peer in the modem.
+		std::string Received;
+		// Data from the library.
+		std::string Sent;
+		std::deque<ModemDatagram_t> Datagrams;
+	};
+
+	struct Output_t {
+		unsigned long StartuS;
+		std::string Data;
+		size_t Written;
+	};
+
+	struct Urc_t {
+		unsigned long TimeuS;
+		std::string Text;
+	};
+
+	enum {
+		INPUT_COMMAND,
+		INPUT_BINARY,
+		INPUT_SMS_TEXT
+	} _input;
+
+	int _masterFd;
+	int _slaveFd;
+	std::string _slaveName;
+
+	unsigned long _latencyuS;
+	unsigned long _networkDelayuS;
+	HardwareSerial* _uart;
+	unsigned long _maxStableBaud;
+	unsigned long _baud;
+	// The rate of AT+IPR, it is used when its response is sent. 0 - none.
+	unsigned long _nextBaud;
+	unsigned long _outputBytes;
+	bool _mux;
+	// The channel of the running command, its output goes in the frames of this channel. URCs go to channel 1.
+	uint8_t _muxDlci;
+	uint8_t _muxLoopback;
+	// The received frame from the address to the closing flag.
+	std::string _muxFrame;
+	double _byteuS;
+	// End of the last byte in each direction.
+	double _rxFreeuS;
+	double _txFreeuS;
+
+	std::string _line;
+	// The command line is ended by CR, it runs after the LF.
+	bool _lastCr;
+	bool _busy;
+	std::string _binaryCommand;
+	size_t _binaryLen;
+	std::string _binary;
+
+	std::deque<Output_t> _output;
+	std::deque<Urc_t> _urcs;
+	std::vector<std::pair<std::string, std::string> > _scripts;
+	std::vector<std::string> _commands;
+	unsigned long _txBytes;
+	unsigned long _rxBytes;
+
+	Socket_t _sockets[MODEM_EMULATOR_SOCKETS];
+	bool _peerEcho;
+	std::vector<ModemDatagram_t> _udpSent;
+	bool _attached;
+	bool _pdpActive;
+	std::string _dnsAddress;
+	std::vector<ModemSms_t> _sms;
+	std::vector<ModemSms_t> _smsSent;
+	int _smsIndex;
+	std::string _smsNumber;
+	std::map<std::string, std::string> _files;
+
+	void reset();
+	void receive(uint8_t c, unsigned long timeuS);
+	void endLine(unsigned long timeuS);
+	void output(const std::string& data, unsigned long timeuS);
+	void outputLine(const std::string& data, unsigned long timeuS);
+	void receiveMux(uint8_t c, unsigned long timeuS);
+	void handleMuxFrame(uint8_t dlci, uint8_t control, const std::string& data, unsigned long timeuS);
+	void handleMuxControl(const std::string& data, unsigned long timeuS);
+	void respond(const std::string& response, unsigned long timeuS);
+	void execute(const std::string& command, unsigned long timeuS);
+	bool executeScript(const std::string& command, unsigned long timeuS);
+	std::string executeSocket(const std::string& command, unsigned long timeuS);
+	std::string executeData(const std::string& command);
+	std::string executeSms(const std::string& command, unsigned long timeuS);
+	std::string executeFile(const std::string& command, unsigned long timeuS);
+	void finishBinary(unsigned long timeuS);
+	void flushUrcs();
+	void announce(int socket, unsigned long timeuS);
+
+	static std::string muxFrame(uint8_t dlci, uint8_t control, bool command, const std::string& data);
+	static std::string toHex(const std::string& data);
+	static std::string fromHex(const std::string& hex);
+	static bool parameter(const std::string& command, size_t index, std::string& value);
+	static int intParameter(const std::string& command, size_t index, int defaultValue = -1);
+};
+
+#endif
@@ -0,0 +1,113 @@
+// bench_socket_buffer.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Benchmark of a GSMClient socket read on the modem emulator. 64 KB from the peer are read with the line
+//		speeds of the ESP32 modem UART. Build it with different GSM_SOCKET_BUFFER_SIZE (make bench).
+//		The throughput is in the virtual time (modem line), the CPU time is the host time of the library
+//		and the emulator for the decode of the hex responses.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "ModemEmulator.h"
+
+#include <time.h>
+
+#include <GPRS.h>
+#include <GSMClient.h>
+#include <Modem.h>
+#include <utility/GSMSocketBuffer.h>
+
+#define DATA_SIZE 65536
+#define LATENCY_US 10000
+// The read buffer of the sketch.
+#define READ_SIZE 1024
+
+static ModemEmulator _modem;
+HardwareSerial SerialModem(2);
+ModemClass MODEM(SerialModem);
+
+static void serveModem()
+{
+	_modem.serve();
+}
+
+/**
+* @brief Read DATA_SIZE bytes from a socket with the line speed.
+*
+* @param baud UART baud rate, 10 bits per byte.
+*
+* @return bool true - all data is received.
+*/
+static bool bench(unsigned long baud)
+{
+	_modem.begin();
+	_modem.setLatency(LATENCY_US);
+	_modem.setBandwidth(baud / 10);
+
+	SerialModem.begin(baud);
+	SerialModem.hostAttach(_modem.slaveFd());
+	hostSetIdleCallback(serveModem);
+
+	GPRS gprs;
+	GSMClient client;
+	if (MODEM.begin(false) != 1 || gprs.attachGPRS("internet", "", "") != GPRS_READY || client.connect("example.com", 80) != 1)
+	{
+		printf("%7lu baud: the connection failed\n", baud);
+		return false;
+	}
+
+	std::string data;
+	for (int i = 0; i < DATA_SIZE; i++)
+	{
+		data += (char)(i * 31 + (i >> 8));
+	}
+
+	MODEM.resetStats();
+	_modem.clearCommands();
+	_modem.peerSend(0, data);
+
+	clock_t cpuStart = clock();
+	unsigned long start = micros();
+
+	std::string received;
+	uint8_t buffer[READ_SIZE];
+	while (received.size() < data.size() && micros() - start < 600000000UL)
+	{
+		int n = client.read(buffer, sizeof(buffer));
+		if (n > 0)
+		{
+			received.append((const char*)buffer, n);
+		}
+	}
+
+	double seconds = (micros() - start) / 1000000.0;
+	double cpuMs = (clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC;
+	ModemStats stats = MODEM.stats();
+
+	// The line carries two hex characters per byte.
+	printf("%7lu baud: %7.0f B/s (line limit %6lu B/s), %3u AT+USORD, %3lu mS average latency, %6.1f mS CPU\n",
+		baud, received.size() / seconds, baud / 10 / 2, (unsigned int)_modem.count("AT+USORD"),
+		MODEM.averageLatency(), cpuMs);
+
+	client.stop();
+	_modem.end();
+
+	return received == data && stats.timeouts == 0;
+}
+
+int main()
+{
+	static const unsigned long BAUD_RATES[] = { 115200, 230400, 460800, 921600 };
+
+	printf("GSM_SOCKET_BUFFER_SIZE %d, %d bytes\n", GSM_SOCKET_BUFFER_SIZE, DATA_SIZE);
+
+	bool result = true;
+	for (size_t i = 0; i < sizeof(BAUD_RATES) / sizeof(BAUD_RATES[0]); i++)
+	{
+		result = bench(BAUD_RATES[i]) && result;
+	}
+
+	return result ? 0 : 1;
+}
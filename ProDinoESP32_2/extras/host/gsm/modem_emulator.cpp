@@ -0,0 +1,108 @@
+// modem_emulator.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Real time u-blox modem emulator on a pty. It prints the pty name, a program opens it as the modem UART.
+//		Each line on stdin is sent as an URC, e.g. "+UUPSDD: 0".
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "ModemEmulator.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+// Real time step of the virtual time.
+#define STEP_US 1000
+
+static volatile bool _running = true;
+
+static void onSignal(int)
+{
+	_running = false;
+}
+
+static void usage(const char* name)
+{
+	printf("Usage: %s [-l latency ms] [-b bytes per second] [-e]\n", name);
+	printf("  -l  time from the end of a command to its response, default 10 ms\n");
+	printf("  -b  line speed, default 11520 B/s (115200 baud), 0 - unlimited\n");
+	printf("  -e  TCP peers send back the received data\n");
+	printf("Lines on stdin are sent as URCs.\n");
+}
+
+int main(int argc, char* argv[])
+{
+	ModemEmulator modem;
+	unsigned long latencyMs = 10;
+	unsigned long bandwidth = 11520;
+	bool echo = false;
+
+	int option;
+	while ((option = getopt(argc, argv, "l:b:eh")) != -1)
+	{
+		switch (option)
+		{
+		case 'l':
+			latencyMs = strtoul(optarg, NULL, 10);
+			break;
+		case 'b':
+			bandwidth = strtoul(optarg, NULL, 10);
+			break;
+		case 'e':
+			echo = true;
+			break;
+		default:
+			usage(argv[0]);
+			return option == 'h' ? 0 : 1;
+		}
+	}
+
+	if (!modem.begin())
+	{
+		perror("pty");
+		return 1;
+	}
+
+	modem.setLatency(latencyMs * 1000);
+	modem.setBandwidth(bandwidth);
+	modem.setPeerEcho(echo);
+
+	printf("%s\n", modem.slaveName());
+	fflush(stdout);
+
+	signal(SIGINT, onSignal);
+	signal(SIGTERM, onSignal);
+	fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+
+	std::string line;
+	while (_running)
+	{
+		char c;
+		while (read(STDIN_FILENO, &c, 1) == 1)
+		{
+			if (c != '\n')
+			{
+				line += c;
+				continue;
+			}
+
+			if (!line.empty())
+			{
+				modem.injectUrc(line.c_str());
+				line.clear();
+			}
+		}
+
+		modem.serve();
+
+		usleep(STEP_US);
+		hostAdvanceMicros(STEP_US);
+	}
+
+	modem.end();
+
+	return 0;
+}
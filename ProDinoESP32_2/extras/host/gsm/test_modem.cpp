@@ -0,0 +1,578 @@
+// test_modem.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Host tests of the MKRGSM ModemClass, sockets, GPRS, SMS and files against the u-blox modem emulator on a pty.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "HostTest.h"
+#include "ModemEmulator.h"
+
+#include <GPRS.h>
+#include <GSMClient.h>
+#include <GSMFileUtils.h>
+#include <GSMUdp.h>
+#include <GSM_SMS.h>
+#include <Modem.h>
+#include <ModemMux.h>
+#include <utility/GSMSocketBuffer.h>
+
+int hostTestFailures = 0;
+
+// The line of the library UART.
+#define BAUD 115200
+#define BYTES_PER_SECOND (BAUD / 10)
+#define LATENCY_US 5000
+
+static ModemEmulator _modem;
+HardwareSerial SerialModem(2);
+ModemClass MODEM(SerialModem);
+
+static void serveModem()
+{
+	_modem.serve();
+}
+
+/**
+* @brief Start the emulator and the modem with the default timing.
+*
+* @return bool true - MODEM.begin() is successful.
+*/
+static bool startModem()
+{
+	_modem.begin();
+	_modem.setLatency(LATENCY_US);
+	_modem.setBandwidth(BYTES_PER_SECOND);
+
+	SerialModem.begin(BAUD);
+	SerialModem.hostAttach(_modem.slaveFd());
+	hostSetIdleCallback(serveModem);
+
+	bool result = MODEM.begin(false) == 1;
+	MODEM.resetStats();
+	_modem.clearCommands();
+
+	return result;
+}
+
+/**
+* @brief Attach GPRS with the synchronous API.
+*/
+static bool attachGprs(GPRS& gprs)
+{
+	return gprs.attachGPRS("internet", "", "") == GPRS_READY;
+}
+
+/**
+* @brief Poll the modem for a virtual time.
+*/
+static void pollFor(unsigned long ms)
+{
+	for (unsigned long start = millis(); millis() - start < ms;)
+	{
+		MODEM.poll();
+		delay(1);
+	}
+}
+
+static void testBegin()
+{
+	CHECK(startModem());
+
+	// The URC handler subscriptions don't send commands.
+	CHECK_EQUAL(0, _modem.commands().size());
+
+	MODEM.send("AT+CSQ");
+	CHECK_EQUAL(1, MODEM.waitForResponse());
+	CHECK_EQUAL(1, _modem.count("AT+CSQ"));
+}
+
+static void testLatency()
+{
+	startModem();
+	_modem.setLatency(20000);
+
+	for (int i = 0; i < 10; i++)
+	{
+		CHECK_EQUAL(1, MODEM.noop());
+	}
+
+	ModemStats stats = MODEM.stats();
+	CHECK_EQUAL(10, stats.commands);
+	CHECK_EQUAL(10, stats.ok);
+	CHECK_EQUAL(0, stats.timeouts);
+
+	// 20 mS latency, "AT\r" and "AT\r\r\n\r\nOK\r\n" at 11520 B/s are 1 mS.
+	unsigned long average = MODEM.averageLatency();
+	CHECK(average >= 20 && average <= 23);
+}
+
+static void testBaudNegotiation()
+{
+	startModem();
+	_modem.setUart(&SerialModem);
+	// 921600 and 460800 have bit errors only in long responses, 230400 is the highest stable rate.
+	_modem.setMaxStableBaud(230400);
+
+	ModemClass modem(SerialModem, 921600, -1, -1, -1, -1, -1, -1);
+	CHECK_EQUAL(1, modem.begin(false));
+	CHECK_EQUAL(230400, modem.baudRate());
+	CHECK_EQUAL(230400, _modem.baud());
+	CHECK_EQUAL(230400, SerialModem.baudRate());
+	// Each unstable rate is returned to the working one before the next slower rate.
+	CHECK_EQUAL(2, _modem.count("AT+IPR=115200"));
+	CHECK_EQUAL(1, _modem.count("AT+IPR=230400"));
+	CHECK_EQUAL(1, modem.noop());
+
+	// The modem keeps the rate of a previous begin(), autobaud finds it.
+	_modem.clearCommands();
+	CHECK_EQUAL(1, modem.begin(false));
+	CHECK_EQUAL(230400, modem.baudRate());
+	CHECK_EQUAL(230400, _modem.baud());
+
+	_modem.setUart(NULL);
+	_modem.setMaxStableBaud(0);
+}
+
+static void testResponseScript()
+{
+	startModem();
+
+	String response;
+	_modem.setResponse("AT+CSQ", "+CSQ: 17,99\r\n\r\nOK");
+	MODEM.send("AT+CSQ");
+	CHECK_EQUAL(1, MODEM.waitForResponse(100, &response));
+	CHECK(response == "+CSQ: 17,99");
+
+	_modem.setResponse("AT+COPS", "ERROR");
+	MODEM.send("AT+COPS?");
+	CHECK_EQUAL(2, MODEM.waitForResponse());
+
+	// No response, the library times out.
+	_modem.setResponse("AT+CREG", NULL);
+	unsigned long start = millis();
+	MODEM.send("AT+CREG?");
+	CHECK_EQUAL(-1, MODEM.waitForResponse(300));
+	CHECK(millis() - start >= 300);
+	CHECK_EQUAL(1, MODEM.stats().timeouts);
+
+	// The late response of the next command isn't mixed with the lost one.
+	CHECK_EQUAL(1, MODEM.noop());
+}
+
+/**
+* @brief URC handler which counts the URCs and can change the subscriptions from handleUrc().
+*/
+class TestUrcHandler : public ModemUrcHandler
+{
+ public:
+	TestUrcHandler() : Count(0), RemoveSelf(false), Add(NULL) {}
+
+	void handleUrc(const String& urc)
+	{
+		(void)urc;
+		++Count;
+
+		if (RemoveSelf)
+		{
+			MODEM.removeUrcHandler(this);
+		}
+
+		if (Add != NULL)
+		{
+			MODEM.addUrcHandler(Add, "+TEST");
+			Add = NULL;
+		}
+	}
+
+	int Count;
+	bool RemoveSelf;
+	TestUrcHandler* Add;
+};
+
+static void testUrcHandlerChanges()
+{
+	startModem();
+
+	TestUrcHandler first;
+	TestUrcHandler second;
+	TestUrcHandler third;
+	TestUrcHandler added;
+
+	first.RemoveSelf = true;
+	second.Add = &added;
+	MODEM.addUrcHandler(&first, "+TEST");
+	MODEM.addUrcHandler(&second, "+TEST");
+	MODEM.addUrcHandler(&third, "+TEST");
+
+	// The handler after the removed one is called, the added one gets the next URC.
+	_modem.injectUrc("+TEST: 1");
+	pollFor(10);
+	CHECK_EQUAL(1, first.Count);
+	CHECK_EQUAL(1, second.Count);
+	CHECK_EQUAL(1, third.Count);
+	CHECK_EQUAL(0, added.Count);
+
+	_modem.injectUrc("+TEST: 2");
+	pollFor(10);
+	CHECK_EQUAL(1, first.Count);
+	CHECK_EQUAL(2, second.Count);
+	CHECK_EQUAL(2, third.Count);
+	CHECK_EQUAL(1, added.Count);
+
+	MODEM.removeUrcHandler(&second);
+	MODEM.removeUrcHandler(&third);
+	MODEM.removeUrcHandler(&added);
+}
+
+static void testGprs()
+{
+	startModem();
+
+	GPRS gprs;
+	CHECK(attachGprs(gprs));
+	CHECK_EQUAL(1, _modem.count("AT+UPSDA=0,3"));
+	CHECK(gprs.getIPAddress() == IPAddress(10, 0, 0, 2));
+
+	IPAddress address;
+	_modem.setDnsAddress("192.0.2.7");
+	CHECK_EQUAL(1, gprs.hostByName("example.com", address));
+	CHECK(address == IPAddress(192, 0, 2, 7));
+
+	// The network deactivates the context during a command. The URC follows the response and the URC handler
+	// of GPRS sees it.
+	_modem.setLatency(50000);
+	_modem.injectUrc("+UUPSDD: 0", 10000);
+	CHECK_EQUAL(1, MODEM.noop());
+	pollFor(10);
+	CHECK_EQUAL(IDLE, gprs.status());
+	CHECK_EQUAL(1, MODEM.stats().urcs);
+}
+
+static void testClientEcho()
+{
+	startModem();
+
+	GPRS gprs;
+	CHECK(attachGprs(gprs));
+
+	_modem.setPeerEcho(true);
+	_modem.setNetworkDelay(30000);
+
+	GSMClient client;
+	CHECK_EQUAL(1, client.connect("example.com", 80));
+	CHECK(client.connected());
+
+	const char request[] = "GET / HTTP/1.1\r\nHost: example.com\r\n\r\n";
+	CHECK_EQUAL(strlen(request), client.write((const uint8_t*)request, strlen(request)));
+	CHECK(_modem.peerReceived(0) == request);
+
+	std::string received;
+	for (unsigned long start = millis(); received.size() < strlen(request) && millis() - start < 1000;)
+	{
+		int c = client.read();
+		if (c >= 0)
+		{
+			received += (char)c;
+		}
+	}
+	CHECK(received == request);
+
+	client.stop();
+	CHECK_EQUAL(1, _modem.count("AT+USOCL=0"));
+}
+
+static void testClientAsync()
+{
+	startModem();
+
+	GPRS gprs;
+	CHECK(attachGprs(gprs));
+
+	_modem.setPeerEcho(true);
+	_modem.setNetworkDelay(30000);
+
+	GSMClient client(false);
+	CHECK_EQUAL(1, client.connect("example.com", 80));
+	while (client.ready() == 0)
+	{
+		delay(1);
+	}
+	CHECK(client);
+
+	// The write returns at once, the data is sent by MODEM.poll().
+	client.beginWrite();
+	unsigned long start = millis();
+	CHECK_EQUAL(5, client.write((const uint8_t*)"hello", 5));
+	CHECK(millis() - start < 2);
+	CHECK_EQUAL(1, MODEM.queued());
+	CHECK_EQUAL(0, client.ready());
+
+	// A command of the blocking API in the meantime keeps its own result.
+	CHECK_EQUAL(1, MODEM.noop());
+
+	// The queued command doesn't change the result of send().
+	while (client.ready() == 0)
+	{
+		CHECK_EQUAL(1, MODEM.ready());
+		delay(1);
+	}
+	CHECK(_modem.peerReceived(0) == "hello");
+
+	// The echo is read by a queued AT+USORD, available() doesn't wait for it.
+	std::string received;
+	for (start = millis(); received.size() < 5 && millis() - start < 1000; delay(1))
+	{
+		unsigned long before = millis();
+		int avail = client.available();
+		CHECK(millis() - before < 2);
+
+		for (; avail > 0; avail--)
+		{
+			received += (char)client.read();
+		}
+	}
+	CHECK(received == "hello");
+	CHECK_EQUAL(1, _modem.count("AT+USORD"));
+
+	client.endWrite();
+	client.stop();
+	CHECK_EQUAL(1, _modem.count("AT+USOCL=0"));
+}
+
+static void testClientPeerClose()
+{
+	startModem();
+
+	GPRS gprs;
+	CHECK(attachGprs(gprs));
+
+	GSMClient client;
+	CHECK_EQUAL(1, client.connect("example.com", 80));
+
+	_modem.peerSend(0, "bye");
+	_modem.peerClose(0);
+	pollFor(10);
+
+	// The data received before the close can be read.
+	uint8_t buffer[8];
+	CHECK_EQUAL(3, client.read(buffer, sizeof(buffer)));
+	CHECK(memcmp(buffer, "bye", 3) == 0);
+	CHECK(!client.connected());
+}
+
+static void testClientLargeRead()
+{
+	startModem();
+
+	GPRS gprs;
+	CHECK(attachGprs(gprs));
+
+	GSMClient client;
+	CHECK_EQUAL(1, client.connect("example.com", 80));
+
+	std::string data;
+	for (int i = 0; i < 3000; i++)
+	{
+		data += (char)(i * 7);
+	}
+	_modem.peerSend(0, data);
+	_modem.clearCommands();
+
+	std::string received;
+	uint8_t buffer[700];
+	for (unsigned long start = millis(); received.size() < data.size() && millis() - start < 5000;)
+	{
+		int n = client.read(buffer, sizeof(buffer));
+		if (n > 0)
+		{
+			received.append((const char*)buffer, n);
+		}
+	}
+
+	CHECK(received == data);
+	// The socket buffer reads the modem in blocks of its size, the modem gives max 512 bytes in hex mode.
+	size_t block = min(GSM_SOCKET_BUFFER_SIZE, MODEM_EMULATOR_HEX_READ_MAX);
+	CHECK_EQUAL((data.size() + block - 1) / block, _modem.count("AT+USORD"));
+}
+
+static void testUdp()
+{
+	startModem();
+
+	GPRS gprs;
+	CHECK(attachGprs(gprs));
+
+	GSMUDP udp;
+	CHECK_EQUAL(1, udp.begin(5000));
+	CHECK_EQUAL(1, _modem.count("AT+USOLI=0,5000"));
+
+	CHECK_EQUAL(1, udp.beginPacket(IPAddress(192, 0, 2, 1), 6000));
+	CHECK_EQUAL(4, udp.write((const uint8_t*)"ping", 4));
+	// The packet is queued, the modem gets it from poll().
+	unsigned long start = millis();
+	CHECK_EQUAL(1, udp.endPacket());
+	CHECK(millis() - start < 10);
+
+	int ready;
+	while ((ready = udp.ready()) == 0 && millis() - start < 1000)
+	{
+		delay(1);
+	}
+	CHECK_EQUAL(1, ready);
+
+	CHECK_EQUAL(1, _modem.udpSent().size());
+	CHECK(_modem.udpSent()[0].Ip == "192.0.2.1");
+	CHECK_EQUAL(6000, _modem.udpSent()[0].Port);
+	CHECK(_modem.udpSent()[0].Data == "ping");
+
+	_modem.udpReceive(0, "192.0.2.1", 6000, std::string("pong\0\xff", 6));
+	pollFor(10);
+
+	CHECK_EQUAL(6, udp.parsePacket());
+	CHECK(udp.remoteIP() == IPAddress(192, 0, 2, 1));
+	CHECK_EQUAL(6000, udp.remotePort());
+
+	char buffer[8];
+	CHECK_EQUAL(6, udp.read(buffer, sizeof(buffer)));
+	CHECK(memcmp(buffer, "pong\0\xff", 6) == 0);
+
+	// The next packet waits for the queued one, stop() sends it before the close.
+	CHECK_EQUAL(1, udp.beginPacket("example.com", 7000));
+	CHECK_EQUAL(2, udp.write((const uint8_t*)"p1", 2));
+	CHECK_EQUAL(1, udp.endPacket());
+	CHECK_EQUAL(1, udp.beginPacket("example.com", 7000));
+	CHECK_EQUAL(2, udp.write((const uint8_t*)"p2", 2));
+	CHECK_EQUAL(1, udp.endPacket());
+
+	udp.stop();
+	CHECK_EQUAL(3, _modem.udpSent().size());
+	CHECK(_modem.udpSent()[1].Data == "p1");
+	CHECK(_modem.udpSent()[2].Data == "p2");
+}
+
+static void testMux()
+{
+	startModem();
+	_modem.setMuxLoopback(2);
+
+	CHECK_EQUAL(1, ModemMux.begin());
+	CHECK(_modem.muxActive());
+	CHECK(&MODEM.stream() == &ModemMux.channel(1));
+	CHECK(ModemMux.channel(2).isOpen());
+
+	// MODEM runs on channel 1.
+	MODEM.send("AT+CSQ");
+	CHECK_EQUAL(1, MODEM.waitForResponse());
+	CHECK_EQUAL(1, _modem.count("AT+CSQ"));
+
+	// Channel 2 carries data (PPP) while channel 1 runs AT commands. The data has flags, longer than a frame.
+	ModemMuxChannel& data = ModemMux.channel(2);
+	std::string sent;
+	for (int i = 0; i < 300; i++)
+	{
+		sent += (char)(i * 7);
+	}
+	CHECK_EQUAL(sent.size(), data.write((const uint8_t*)sent.data(), sent.size()));
+	CHECK_EQUAL(1, MODEM.noop());
+
+	std::string received;
+	for (unsigned long start = millis(); received.size() < sent.size() && millis() - start < 1000;)
+	{
+		while (data.available() > 0)
+		{
+			received += (char)data.read();
+		}
+		delay(1);
+	}
+	CHECK(received == sent);
+
+	// The modem stops channel 2 (MSC FC), a write waits until it resumes.
+	_modem.muxFlow(2, true);
+	_modem.muxFlow(2, false, 50000);
+	pollFor(5);
+
+	unsigned long start = millis();
+	CHECK_EQUAL(4, data.write((const uint8_t*)"ping", 4));
+	CHECK(millis() - start >= 40);
+	CHECK_EQUAL(1, MODEM.noop());
+
+	// MODEM returns to the UART.
+	ModemMux.end();
+	CHECK(!_modem.muxActive());
+	CHECK(&MODEM.stream() == &SerialModem);
+	CHECK_EQUAL(1, MODEM.noop());
+}
+
+static void testSms()
+{
+	startModem();
+
+	GSM_SMS sms;
+	_modem.addSms("+359888000001", "Hello");
+	CHECK(sms.available() > 0);
+
+	char number[20];
+	CHECK_EQUAL(1, sms.remoteNumber(number, sizeof(number)));
+	CHECK(strcmp(number, "+359888000001") == 0);
+
+	std::string text;
+	for (int c = sms.read(); c >= 0; c = sms.read())
+	{
+		text += (char)c;
+	}
+	CHECK(text == "Hello");
+
+	sms.flush();
+	CHECK_EQUAL(1, _modem.count("AT+CMGD=1"));
+	CHECK_EQUAL(0, _modem.smsStorage().size());
+
+	CHECK_EQUAL(1, sms.beginSMS("+359888000002"));
+	sms.print("Relay 1 on");
+	CHECK_EQUAL(1, sms.endSMS());
+
+	CHECK_EQUAL(1, _modem.smsSent().size());
+	CHECK(_modem.smsSent()[0].Number == "+359888000002");
+	CHECK(_modem.smsSent()[0].Text == "Relay 1 on");
+}
+
+static void testFiles()
+{
+	startModem();
+
+	GSMFileUtils files;
+	CHECK(files.begin(false));
+	CHECK_EQUAL(0, files.fileCount());
+
+	CHECK_EQUAL(5, files.downloadFile("a.txt", "12345", 5));
+	CHECK(_modem.files().count("a.txt") == 1);
+
+	String content;
+	CHECK_EQUAL(5, files.readFile("a.txt", &content));
+	CHECK(content == "12345");
+
+	CHECK(files.deleteFile("a.txt"));
+	CHECK(_modem.files().empty());
+}
+
+int main()
+{
+	RUN_TEST(testBegin);
+	RUN_TEST(testLatency);
+	RUN_TEST(testBaudNegotiation);
+	RUN_TEST(testResponseScript);
+	RUN_TEST(testUrcHandlerChanges);
+	RUN_TEST(testGprs);
+	RUN_TEST(testClientEcho);
+	RUN_TEST(testClientAsync);
+	RUN_TEST(testClientPeerClose);
+	RUN_TEST(testClientLargeRead);
+	RUN_TEST(testUdp);
+	RUN_TEST(testMux);
+	RUN_TEST(testSms);
+	RUN_TEST(testFiles);
+
+	HOST_TEST_MAIN_END();
+}
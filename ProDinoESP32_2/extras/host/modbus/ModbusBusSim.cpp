@@ -0,0 +1,177 @@
+// ModbusBusSim.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Simulated RS485 bus with Modbus RTU slaves for the host tests.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "ModbusBusSim.h"
+
+ModbusBusSim::ModbusBusSim()
+{
+	begin(19200);
+}
+
+void ModbusBusSim::begin(unsigned long baud, uint32_t config)
+{
+	modbusCalcTiming(baud, config, _timing);
+	memset(_slaves, 0, sizeof(_slaves));
+	_rx.clear();
+	_requests.clear();
+}
+
+int ModbusBusSim::available()
+{
+	int count = 0;
+	for (size_t i = 0; i < _rx.size() && (long)(micros() - _rx[i].Micros) >= 0; i++)
+	{
+		++count;
+	}
+
+	return count;
+}
+
+int ModbusBusSim::peek()
+{
+	if (available() == 0)
+	{
+		return -1;
+	}
+
+	return _rx.front().Value;
+}
+
+int ModbusBusSim::read()
+{
+	int c = peek();
+	if (c >= 0)
+	{
+		_rx.pop_front();
+	}
+
+	return c;
+}
+
+size_t ModbusBusSim::write(const uint8_t* buffer, size_t size)
+{
+	// The master writes the whole frame at once.
+	_requests.push_back(std::vector<uint8_t>(buffer, buffer + size));
+
+	unsigned long endMicros = micros() + size * _timing.CharuS;
+	respond(buffer, size, endMicros);
+
+	return size;
+}
+
+/**
+* @brief Build the slave response and put it on the bus in the time it is received by the master.
+*
+* @param frame Request frame.
+* @param len Request length.
+* @param endMicros End of the request transmission.
+*
+* @return void
+*/
+void ModbusBusSim::respond(const uint8_t* frame, size_t len, unsigned long endMicros)
+{
+	if (!modbusCheckCRC(frame, len) || len < 8)
+	{
+		return;
+	}
+
+	uint8_t id = frame[0];
+	if (id == MODBUS_BROADCAST_ID)
+	{
+		return;
+	}
+
+	ModbusSimSlave_t& sim = _slaves[id];
+	if (!sim.Present)
+	{
+		return;
+	}
+
+	++sim.Requests;
+	if (sim.Mute)
+	{
+		return;
+	}
+
+	uint8_t function = frame[1];
+	uint16_t address = modbusGetUInt16(&frame[2]);
+	uint16_t count = modbusGetUInt16(&frame[4]);
+
+	uint8_t response[MODBUS_MAX_FRAME];
+	size_t responseLen = 0;
+	response[responseLen++] = id;
+	response[responseLen++] = function;
+
+	switch (function)
+	{
+	case ModbusReadCoils:
+	case ModbusReadDiscreteInputs:
+	case ModbusReadHoldingRegisters:
+	case ModbusReadInputRegisters:
+	{
+		if (address + count > MODBUS_SIM_EXCEPTION_ADDRESS)
+		{
+			response[1] |= MODBUS_EXCEPTION_FLAG;
+			response[responseLen++] = ModbusIllegalDataAddress;
+			break;
+		}
+
+		if (function <= ModbusReadDiscreteInputs)
+		{
+			uint8_t bytes = (count + 7) / 8;
+			response[responseLen++] = bytes;
+			memset(&response[responseLen], 0, bytes);
+			for (uint16_t i = 0; i < count; i++)
+			{
+				if (bitValue(address + i))
+				{
+					response[responseLen + i / 8] |= 1 << (i % 8);
+				}
+			}
+			responseLen += bytes;
+		}
+		else
+		{
+			response[responseLen++] = count * 2;
+			for (uint16_t i = 0; i < count; i++)
+			{
+				modbusSetUInt16(&response[responseLen], registerValue(id, address + i));
+				responseLen += 2;
+			}
+		}
+		break;
+	}
+	case ModbusWriteSingleCoil:
+	case ModbusWriteSingleRegister:
+	case ModbusWriteMultipleCoils:
+	case ModbusWriteMultipleRegisters:
+		// Echo of address and value (count).
+		memcpy(&response[responseLen], &frame[2], 4);
+		responseLen += 4;
+		break;
+	default:
+		response[1] |= MODBUS_EXCEPTION_FLAG;
+		response[responseLen++] = ModbusIllegalFunction;
+		break;
+	}
+
+	responseLen = modbusAppendCRC(response, responseLen);
+	if (sim.CorruptCrc)
+	{
+		response[responseLen - 1] ^= 0xFF;
+	}
+
+	unsigned long time = endMicros + sim.LatencyuS;
+	for (size_t i = 0; i < responseLen; i++)
+	{
+		time += _timing.CharuS;
+		Byte_t b = { time, response[i] };
+		_rx.push_back(b);
+	}
+}
@@ -0,0 +1,78 @@
+// ModbusBusSim.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Simulated RS485 bus with Modbus RTU slaves for the host tests. The master writes and reads it as its serial.
+//		Bytes are delivered in the virtual time: a request ends after its transmission time, the response starts
+//		after the slave latency and every byte takes one character time.
+//		Slave values: register = slave * 1000 + address, coil (input) = address % 3 == 0.
+//		Reads over address 1000 answer with Illegal data address exception.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _MODBUSBUSSIM_H
+#define _MODBUSBUSSIM_H
+
+#include <deque>
+#include <vector>
+
+#include "KMPModbus.h"
+
+#define MODBUS_SIM_EXCEPTION_ADDRESS 1000
+
+/**
+ * @brief Simulated slave settings and counters.
+ */
+struct ModbusSimSlave_t {
+	bool Present;
+	// Present, but never responds.
+	bool Mute;
+	// Response CRC is wrong.
+	bool CorruptCrc;
+	// Time from the end of the request to the first response byte.
+	uint32_t LatencyuS;
+	// Received requests.
+	uint32_t Requests;
+};
+
+class ModbusBusSim : public Stream
+{
+ public:
+	ModbusBusSim();
+
+	/**
+	* @brief Set bus speed and remove all slaves and data on the bus.
+	*/
+	void begin(unsigned long baud, uint32_t config = SERIAL_8N1);
+
+	ModbusSimSlave_t& slave(uint8_t id) { return _slaves[id]; }
+
+	static uint16_t registerValue(uint8_t id, uint16_t address) { return id * 1000 + address; }
+	static bool bitValue(uint16_t address) { return address % 3 == 0; }
+
+	// Requests on the bus, including broadcast and not answered ones.
+	const std::vector<std::vector<uint8_t> >& requests() { return _requests; }
+
+	int available();
+	int read();
+	int peek();
+	using Print::write;
+	size_t write(uint8_t c) { return write(&c, 1); }
+	size_t write(const uint8_t* buffer, size_t size);
+
+ private:
+	struct Byte_t {
+		unsigned long Micros;
+		uint8_t Value;
+	};
+
+	ModbusTiming_t _timing;
+	ModbusSimSlave_t _slaves[MODBUS_MAX_SLAVE_ID + 1];
+	std::deque<Byte_t> _rx;
+	std::vector<std::vector<uint8_t> > _requests;
+
+	void respond(const uint8_t* frame, size_t len, unsigned long endMicros);
+};
+
+#endif
@@ -0,0 +1,483 @@
+// test_modbus_master.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Host tests of Modbus RTU CRC, frame timing, KMPModbusMaster and KMPModbusScheduler against simulated slaves.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "HostTest.h"
+#include "KMPModbusMaster.h"
+#include "KMPModbusScheduler.h"
+#include "ModbusBusSim.h"
+
+int hostTestFailures = 0;
+
+#define BAUD 19200
+// Loop period in the virtual time.
+#define LOOP_US 50
+
+struct Result_t {
+	int Calls;
+	ModbusResult Result;
+	uint8_t Exception;
+	uint16_t Count;
+	unsigned long Millis;
+};
+
+static ModbusBusSim _bus;
+// Slave ids in the order of finished requests.
+static std::vector<uint8_t> _finished;
+
+static void onResult(const ModbusRequest_t& request, ModbusResult result)
+{
+	Result_t* r = (Result_t*)request.Arg;
+	++r->Calls;
+	r->Result = result;
+	r->Exception = request.Exception;
+	r->Count = request.Count;
+	r->Millis = millis();
+
+	_finished.push_back(request.SlaveId);
+}
+
+/**
+* @brief Start the master and the bus with present slaves 1 - 10.
+*/
+static KMPModbusMasterClass& startMaster()
+{
+	static KMPModbusMasterClass master;
+	master = KMPModbusMasterClass();
+
+	_bus.begin(BAUD);
+	for (uint8_t id = 1; id <= 10; id++)
+	{
+		_bus.slave(id).Present = true;
+		_bus.slave(id).LatencyuS = 2000;
+	}
+
+	_finished.clear();
+	master.begin(_bus, BAUD);
+
+	return master;
+}
+
+/**
+* @brief Call process() in a loop while the master is busy, max timeoutMs virtual time.
+*
+* @return unsigned long Virtual time in milliseconds.
+*/
+static unsigned long runMaster(KMPModbusMasterClass& master, unsigned long timeoutMs = 5000)
+{
+	unsigned long start = millis();
+	while (master.isBusy() && millis() - start < timeoutMs)
+	{
+		unsigned long before = micros();
+		master.process();
+		// process() never waits, only the loop moves the time.
+		CHECK_EQUAL(before, micros());
+
+		hostAdvanceMicros(LOOP_US);
+	}
+
+	return millis() - start;
+}
+
+static void testCrc()
+{
+	uint8_t frame[8] = { 0x01, 0x03, 0x00, 0x00, 0x00, 0x01 };
+
+	CHECK_EQUAL(0x0A84, modbusCRC16(frame, 6));
+	CHECK_EQUAL(8, modbusAppendCRC(frame, 6));
+	CHECK_EQUAL(0x84, frame[6]);
+	CHECK_EQUAL(0x0A, frame[7]);
+	CHECK(modbusCheckCRC(frame, 8));
+
+	frame[3] ^= 0x01;
+	CHECK(!modbusCheckCRC(frame, 8));
+	CHECK(!modbusCheckCRC(frame, 3));
+}
+
+static void testTiming()
+{
+	ModbusTiming_t timing;
+
+	// 10 bits per character.
+	modbusCalcTiming(9600, SERIAL_8N1, timing);
+	CHECK_EQUAL(1042, timing.CharuS);
+	CHECK_EQUAL(3647, timing.T35uS);
+
+	// 11 bits per character.
+	modbusCalcTiming(19200, SERIAL_8E1, timing);
+	CHECK_EQUAL(573, timing.CharuS);
+	CHECK_EQUAL(2005, timing.T35uS);
+
+	// Fixed t3.5 over 19200.
+	modbusCalcTiming(115200, SERIAL_8N1, timing);
+	CHECK_EQUAL(87, timing.CharuS);
+	CHECK_EQUAL(1750, timing.T35uS);
+}
+
+static void testReadRegisters()
+{
+	KMPModbusMasterClass& master = startMaster();
+
+	uint16_t registers[4] = { 0 };
+	Result_t r = Result_t();
+	CHECK(master.readHoldingRegisters(3, 10, 4, registers, onResult, &r) >= 0);
+	runMaster(master);
+
+	CHECK_EQUAL(1, r.Calls);
+	CHECK_EQUAL(ModbusResultOK, r.Result);
+	for (uint16_t i = 0; i < 4; i++)
+	{
+		CHECK_EQUAL(ModbusBusSim::registerValue(3, 10 + i), registers[i]);
+	}
+
+	// 03 0A 00 04 + CRC.
+	CHECK_EQUAL(1, _bus.requests().size());
+	CHECK_EQUAL(8, _bus.requests()[0].size());
+	CHECK_EQUAL(0x03, _bus.requests()[0][1]);
+	CHECK_EQUAL(4, _bus.requests()[0][5]);
+}
+
+static void testReadCoils()
+{
+	KMPModbusMasterClass& master = startMaster();
+
+	uint8_t bits[2] = { 0 };
+	Result_t r = Result_t();
+	CHECK(master.readCoils(1, 5, 10, bits, onResult, &r) >= 0);
+	runMaster(master);
+
+	CHECK_EQUAL(ModbusResultOK, r.Result);
+	for (uint16_t i = 0; i < 10; i++)
+	{
+		CHECK_EQUAL(ModbusBusSim::bitValue(5 + i), (bits[i / 8] >> (i % 8)) & 1);
+	}
+}
+
+static void testCoalescing()
+{
+	KMPModbusMasterClass& master = startMaster();
+
+	uint16_t a[4], b[4], c[2], d[2];
+	Result_t ra = Result_t(), rb = Result_t(), rc = Result_t(), rd = Result_t();
+
+	CHECK(master.readHoldingRegisters(2, 0, 4, a, onResult, &ra) >= 0);
+	CHECK(master.readHoldingRegisters(2, 8, 2, c, onResult, &rc) >= 0);
+	// Fills the gap between the first two.
+	CHECK(master.readHoldingRegisters(2, 4, 4, b, onResult, &rb) >= 0);
+	// Other function, not coalesced.
+	CHECK(master.readInputRegisters(2, 4, 2, d, onResult, &rd) >= 0);
+	runMaster(master);
+
+	CHECK_EQUAL(2, master.getStats().Frames);
+	CHECK_EQUAL(2, master.getStats().Coalesced);
+	CHECK_EQUAL(2, _bus.requests().size());
+	// One read of 10 registers from 0.
+	CHECK_EQUAL(0, modbusGetUInt16(&_bus.requests()[0][2]));
+	CHECK_EQUAL(10, modbusGetUInt16(&_bus.requests()[0][4]));
+
+	CHECK(ra.Result == ModbusResultOK && rb.Result == ModbusResultOK && rc.Result == ModbusResultOK && rd.Result == ModbusResultOK);
+	CHECK_EQUAL(ModbusBusSim::registerValue(2, 0), a[0]);
+	CHECK_EQUAL(ModbusBusSim::registerValue(2, 7), b[3]);
+	CHECK_EQUAL(ModbusBusSim::registerValue(2, 9), c[1]);
+	CHECK_EQUAL(ModbusBusSim::registerValue(2, 5), d[1]);
+}
+
+static void testCoalesceGap()
+{
+	KMPModbusMasterClass& master = startMaster();
+
+	uint16_t a[2], b[2];
+	Result_t ra = Result_t(), rb = Result_t();
+
+	// Gap of 2 registers isn't coalesced by default.
+	master.readInputRegisters(1, 0, 2, a, onResult, &ra);
+	master.readInputRegisters(1, 4, 2, b, onResult, &rb);
+	runMaster(master);
+	CHECK_EQUAL(2, master.getStats().Frames);
+
+	master.resetStats();
+	master.setCoalesceGap(2);
+	master.readInputRegisters(1, 0, 2, a, onResult, &ra);
+	master.readInputRegisters(1, 4, 2, b, onResult, &rb);
+	runMaster(master);
+	CHECK_EQUAL(1, master.getStats().Frames);
+	CHECK_EQUAL(ModbusBusSim::registerValue(1, 5), b[1]);
+
+	master.resetStats();
+	master.setCoalesceGap(0xFFFF);
+	master.readInputRegisters(1, 0, 2, a, onResult, &ra);
+	master.readInputRegisters(1, 2, 2, b, onResult, &rb);
+	runMaster(master);
+	CHECK_EQUAL(2, master.getStats().Frames);
+}
+
+static void testPipelining()
+{
+	KMPModbusMasterClass& master = startMaster();
+
+	const uint8_t SLAVES = 10;
+	uint16_t registers[SLAVES][8];
+	Result_t r[SLAVES];
+
+	for (uint8_t i = 0; i < SLAVES; i++)
+	{
+		r[i] = Result_t();
+		CHECK(master.readInputRegisters(i + 1, 0, 8, registers[i], onResult, &r[i]) >= 0);
+	}
+	unsigned long elapsed = runMaster(master);
+
+	for (uint8_t i = 0; i < SLAVES; i++)
+	{
+		CHECK_EQUAL(ModbusResultOK, r[i].Result);
+		CHECK_EQUAL(ModbusBusSim::registerValue(i + 1, 7), registers[i][7]);
+	}
+
+	// Request 8 + latency 2 mS + response 21 characters + t3.5, about 21 mS at 19200. No waiting for timeouts.
+	ModbusTiming_t timing = master.getTiming();
+	unsigned long cycleuS = (8 + 21) * timing.CharuS + 2000 + timing.T35uS + 2 * LOOP_US;
+	CHECK(elapsed <= SLAVES * cycleuS / 1000 + 1);
+	CHECK_EQUAL(SLAVES, master.getStats().Frames);
+}
+
+static void testTimeout()
+{
+	KMPModbusMasterClass& master = startMaster();
+	master.setResponseTimeout(100);
+	_bus.slave(4).Mute = true;
+
+	uint16_t registers[1];
+	Result_t r = Result_t();
+	unsigned long start = millis();
+	master.readHoldingRegisters(4, 0, 1, registers, onResult, &r);
+	runMaster(master);
+
+	CHECK_EQUAL(1, r.Calls);
+	CHECK_EQUAL(ModbusResultTimeout, r.Result);
+	CHECK(r.Millis - start >= 100);
+	CHECK(r.Millis - start <= 110);
+	CHECK_EQUAL(1, master.getStats().Timeouts);
+}
+
+static void testSlowSlaveDeferral()
+{
+	KMPModbusMasterClass& master = startMaster();
+	master.setResponseTimeout(50);
+	_bus.slave(9).Mute = true;
+
+	uint16_t registers[MODBUS_MASTER_SLOW_SLAVE_FAILS + 4][1];
+	Result_t r[MODBUS_MASTER_SLOW_SLAVE_FAILS + 4];
+	int n = 0;
+
+	// The slave becomes slow after consecutive timeouts.
+	for (int i = 0; i < MODBUS_MASTER_SLOW_SLAVE_FAILS; i++, n++)
+	{
+		r[n] = Result_t();
+		master.readHoldingRegisters(9, 0, 1, registers[n], onResult, &r[n]);
+		runMaster(master);
+		CHECK_EQUAL(ModbusResultTimeout, r[n].Result);
+	}
+
+	// Queued first, but served after the requests to the other slaves.
+	_finished.clear();
+	r[n] = Result_t();
+	master.readHoldingRegisters(9, 0, 1, registers[n], onResult, &r[n]);
+	n++;
+	for (uint8_t id = 1; id <= 3; id++, n++)
+	{
+		r[n] = Result_t();
+		master.readHoldingRegisters(id, 0, 1, registers[n], onResult, &r[n]);
+	}
+	runMaster(master);
+
+	CHECK_EQUAL(4, _finished.size());
+	CHECK_EQUAL(1, _finished[0]);
+	CHECK_EQUAL(2, _finished[1]);
+	CHECK_EQUAL(3, _finished[2]);
+	CHECK_EQUAL(9, _finished[3]);
+
+	// A response ends the deferral.
+	_bus.slave(9).Mute = false;
+	master.readHoldingRegisters(9, 0, 1, registers[0], onResult, &r[0]);
+	runMaster(master);
+	CHECK_EQUAL(ModbusResultOK, r[0].Result);
+
+	_finished.clear();
+	master.readHoldingRegisters(9, 0, 1, registers[0], onResult, &r[0]);
+	master.readHoldingRegisters(1, 0, 1, registers[1], onResult, &r[1]);
+	runMaster(master);
+	CHECK_EQUAL(9, _finished[0]);
+}
+
+static void testException()
+{
+	KMPModbusMasterClass& master = startMaster();
+
+	uint16_t registers[4];
+	Result_t r = Result_t();
+	master.readHoldingRegisters(1, MODBUS_SIM_EXCEPTION_ADDRESS - 2, 4, registers, onResult, &r);
+	runMaster(master);
+
+	CHECK_EQUAL(ModbusResultException, r.Result);
+	CHECK_EQUAL(ModbusIllegalDataAddress, r.Exception);
+	CHECK_EQUAL(1, master.getStats().Exceptions);
+}
+
+static void testCrcError()
+{
+	KMPModbusMasterClass& master = startMaster();
+	_bus.slave(1).CorruptCrc = true;
+
+	uint16_t registers[2];
+	Result_t r = Result_t();
+	master.readHoldingRegisters(1, 0, 2, registers, onResult, &r);
+	runMaster(master);
+
+	CHECK_EQUAL(ModbusResultCrcError, r.Result);
+	CHECK_EQUAL(1, master.getStats().CrcErrors);
+}
+
+static void testWrites()
+{
+	KMPModbusMasterClass& master = startMaster();
+
+	uint16_t values[3] = { 1, 2, 3 };
+	uint8_t bits[1] = { 0x05 };
+	Result_t r[4] = { Result_t(), Result_t(), Result_t(), Result_t() };
+	master.writeSingleCoil(1, 3, true, onResult, &r[0]);
+	master.writeSingleRegister(1, 7, 1234, onResult, &r[1]);
+	master.writeMultipleRegisters(1, 10, 3, values, onResult, &r[2]);
+	master.writeMultipleCoils(1, 0, 3, bits, onResult, &r[3]);
+	runMaster(master);
+
+	for (int i = 0; i < 4; i++)
+	{
+		CHECK_EQUAL(ModbusResultOK, r[i].Result);
+	}
+	CHECK_EQUAL(0xFF00, modbusGetUInt16(&_bus.requests()[0][4]));
+	CHECK_EQUAL(1234, modbusGetUInt16(&_bus.requests()[1][4]));
+}
+
+static void testRawBroadcast()
+{
+	KMPModbusMasterClass& master = startMaster();
+	master.setBroadcastDelay(20);
+
+	const uint8_t pdu[] = { ModbusWriteSingleRegister, 0x00, 0x01, 0x00, 0x05 };
+	uint8_t response[16];
+	memset(response, 0xAA, sizeof(response));
+	Result_t r = Result_t();
+	CHECK(master.request(MODBUS_BROADCAST_ID, pdu, sizeof(pdu), response, sizeof(response), onResult, &r) >= 0);
+	runMaster(master);
+
+	// Nothing is received after a broadcast.
+	CHECK_EQUAL(ModbusResultOK, r.Result);
+	CHECK_EQUAL(0, r.Count);
+	CHECK_EQUAL(0xAA, response[0]);
+}
+
+static void testRawRequest()
+{
+	KMPModbusMasterClass& master = startMaster();
+
+	const uint8_t pdu[] = { ModbusReadHoldingRegisters, 0x00, 0x02, 0x00, 0x02 };
+	uint8_t response[16];
+	Result_t r = Result_t();
+	master.request(5, pdu, sizeof(pdu), response, sizeof(response), onResult, &r);
+	runMaster(master);
+
+	// Function, byte count and 2 registers.
+	CHECK_EQUAL(ModbusResultOK, r.Result);
+	CHECK_EQUAL(6, r.Count);
+	CHECK_EQUAL(ModbusReadHoldingRegisters, response[0]);
+	CHECK_EQUAL(4, response[1]);
+	CHECK_EQUAL(ModbusBusSim::registerValue(5, 3), modbusGetUInt16(&response[4]));
+}
+
+static void testQueueFull()
+{
+	KMPModbusMasterClass& master = startMaster();
+
+	uint16_t registers[1];
+	Result_t r = Result_t();
+	for (int i = 0; i < MODBUS_MASTER_QUEUE_SIZE; i++)
+	{
+		CHECK(master.readHoldingRegisters(1, i * 10, 1, registers, onResult, &r) >= 0);
+	}
+	CHECK_EQUAL(-1, master.readHoldingRegisters(1, 0, 1, registers, onResult, &r));
+	// Not valid requests.
+	CHECK_EQUAL(-1, master.readHoldingRegisters(MODBUS_BROADCAST_ID, 0, 1, registers, onResult, &r));
+
+	runMaster(master);
+	CHECK_EQUAL(MODBUS_MASTER_QUEUE_SIZE, r.Calls);
+	CHECK_EQUAL(0, master.readHoldingRegisters(1, 0, MODBUS_MAX_READ_REGISTERS + 1, registers, onResult, &r) + 1);
+}
+
+static void testSchedulerHandles()
+{
+	KMPModbusMasterClass& master = startMaster();
+	// The master callback finishes the jobs of the global scheduler.
+	KMPModbusSchedulerClass& scheduler = KMPModbusScheduler;
+	scheduler.begin(master);
+
+	uint16_t registers[1];
+	int periodic = scheduler.addPeriodic(1, ModbusReadHoldingRegisters, 0, 1, registers, 1000);
+	CHECK(periodic >= 0);
+	CHECK(scheduler.remove(periodic));
+	CHECK(!scheduler.remove(periodic));
+
+	// A new job takes the same place, the old handle must not change it.
+	int other = scheduler.addPeriodic(2, ModbusReadHoldingRegisters, 0, 1, registers, 500);
+	CHECK(other >= 0);
+	CHECK_EQUAL(periodic & 0xff, other & 0xff);
+	CHECK(other != periodic);
+	CHECK(!scheduler.setPeriod(periodic, 100));
+	CHECK(!scheduler.remove(periodic));
+	CHECK(scheduler.getTargetPollRate(2) == 2.0f);
+
+	CHECK(scheduler.setPeriod(other, 250));
+	CHECK(scheduler.getTargetPollRate(2) == 4.0f);
+	CHECK(!scheduler.remove(-1));
+	CHECK(!scheduler.remove(other + 1));
+
+	// A finished one-shot job has no handle.
+	Result_t r = Result_t();
+	int oneShot = scheduler.submit(3, ModbusReadHoldingRegisters, 0, 1, registers, ModbusPriorityOperator, 0, onResult, &r);
+	CHECK(oneShot >= 0);
+	for (unsigned long start = millis(); r.Calls == 0 && millis() - start < 1000;)
+	{
+		scheduler.process();
+		hostAdvanceMicros(LOOP_US);
+	}
+	CHECK_EQUAL(1, r.Calls);
+	CHECK(!scheduler.remove(oneShot));
+
+	CHECK(scheduler.remove(other));
+	runMaster(master);
+}
+
+int main()
+{
+	RUN_TEST(testCrc);
+	RUN_TEST(testTiming);
+	RUN_TEST(testReadRegisters);
+	RUN_TEST(testReadCoils);
+	RUN_TEST(testCoalescing);
+	RUN_TEST(testCoalesceGap);
+	RUN_TEST(testPipelining);
+	RUN_TEST(testTimeout);
+	RUN_TEST(testSlowSlaveDeferral);
+	RUN_TEST(testException);
+	RUN_TEST(testCrcError);
+	RUN_TEST(testWrites);
+	RUN_TEST(testRawBroadcast);
+	RUN_TEST(testRawRequest);
+	RUN_TEST(testQueueFull);
+	RUN_TEST(testSchedulerHandles);
+
+	HOST_TEST_MAIN_END();
+}
@@ -0,0 +1,219 @@
+// test_rs485_frames.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Host tests of the KMPRS485Serial frame receiving with the UART RX timeout event (ESP32 Arduino core 2.0.6).
+//		The bytes come as UART driver events, the frame task runs when the test waits, so it can be late.
+// Version: 1.0.0
+// Date: 19.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "HostTest.h"
+#include "KMPRS485Serial.h"
+
+#include <vector>
+
+int hostTestFailures = 0;
+
+#define BAUD 115200
+#define IDLE_CHARS 4
+
+static KMPRS485SerialClass _serial(2);
+
+struct Frame_t {
+	std::string Data;
+	unsigned long StartMicros;
+};
+
+static std::vector<Frame_t> _frames;
+
+static void onFrame(const uint8_t* frame, size_t len, unsigned long startMicros)
+{
+	Frame_t f;
+	f.Data.assign((const char*)frame, len);
+	f.StartMicros = startMicros;
+	_frames.push_back(f);
+}
+
+static std::string makeData(size_t len, uint8_t first)
+{
+	std::string data;
+	for (size_t i = 0; i < len; i++)
+	{
+		data += (char)(first + i);
+	}
+
+	return data;
+}
+
+/**
+* @brief Receive data as the UART interrupts: FIFO full events for each RS485_FRAME_FIFO_FULL bytes and RX timeout event for the rest.
+*/
+static void receive(const std::string& data)
+{
+	size_t pos = 0;
+	while (data.size() - pos > RS485_FRAME_FIFO_FULL)
+	{
+		_serial.hostReceive((const uint8_t*)data.data() + pos, RS485_FRAME_FIFO_FULL, false);
+		pos += RS485_FRAME_FIFO_FULL;
+	}
+
+	_serial.hostReceive((const uint8_t*)data.data() + pos, data.size() - pos, true);
+}
+
+static std::string readFrame()
+{
+	uint8_t buffer[RS485_FRAME_MAX];
+	size_t len = _serial.readFrame(buffer, sizeof(buffer));
+
+	return std::string((const char*)buffer, len);
+}
+
+static void start(int delimiter = -1, RS485FrameCallback callback = NULL)
+{
+	_serial.begin(5, BAUD, 16, 17);
+	_serial.beginFrames(IDLE_CHARS, delimiter, callback);
+	_frames.clear();
+}
+
+static void testEvents()
+{
+	start();
+
+	std::string a = makeData(10, 1);
+	receive(a);
+
+	// The task hasn't run yet.
+	CHECK_EQUAL(0, _serial.frameAvailable());
+
+	delay(1);
+	CHECK_EQUAL(a.size(), _serial.frameAvailable());
+	CHECK(readFrame() == a);
+	CHECK_EQUAL(0, _serial.frameAvailable());
+
+	_serial.endFrames();
+}
+
+static void testLateTask()
+{
+	start();
+
+	// A long frame is read on FIFO full and ended by RX timeout, the next frame follows after the idle time.
+	// Both are in the RX buffer when the frame task runs.
+	std::string a = makeData(150, 0);
+	std::string b = makeData(20, 100);
+	receive(a);
+	receive(b);
+
+	delay(1);
+	CHECK_EQUAL(a.size(), _serial.frameAvailable());
+	CHECK(readFrame() == a);
+	CHECK_EQUAL(b.size(), _serial.frameAvailable());
+	CHECK(readFrame() == b);
+	CHECK_EQUAL(0, _serial.frameAvailable());
+
+	// Two short frames back to back.
+	std::string c = makeData(8, 1);
+	std::string d = makeData(8, 50);
+	receive(c);
+	receive(d);
+
+	delay(1);
+	CHECK(readFrame() == c);
+	CHECK(readFrame() == d);
+	CHECK_EQUAL(0, _serial.getFramesLost());
+
+	_serial.endFrames();
+}
+
+static void testFifoFullOnly()
+{
+	start();
+
+	// FIFO full event doesn't end the frame.
+	std::string a = makeData(RS485_FRAME_FIFO_FULL, 0);
+	_serial.hostReceive((const uint8_t*)a.data(), a.size(), false);
+
+	delay(1);
+	CHECK_EQUAL(0, _serial.frameAvailable());
+
+	std::string b = makeData(10, 200);
+	_serial.hostReceive((const uint8_t*)b.data(), b.size(), true);
+
+	delay(1);
+	CHECK(readFrame() == a + b);
+
+	_serial.endFrames();
+}
+
+static void testDelimiter()
+{
+	start('\n');
+
+	std::string data = "ab\ncd";
+	receive(data);
+
+	delay(1);
+	CHECK(readFrame() == "ab\n");
+	CHECK(readFrame() == "cd");
+
+	_serial.endFrames();
+}
+
+static void testCallback()
+{
+	start(-1, onFrame);
+
+	std::string a = makeData(8, 1);
+	unsigned long now = micros();
+	receive(a);
+
+	delay(1);
+	CHECK_EQUAL(1, _frames.size());
+	CHECK(_frames[0].Data == a);
+	// The start is calculated back from the RX timeout event by the idle time and the frame length.
+	CHECK_EQUAL(now - (IDLE_CHARS + a.size()) * _serial.getCharTimeuS(), _frames[0].StartMicros);
+	CHECK_EQUAL(0, _serial.frameAvailable());
+
+	_serial.endFrames();
+}
+
+static void testEndFrames()
+{
+	start();
+	_serial.endFrames();
+
+	receive(makeData(8, 1));
+	delay(1);
+	CHECK_EQUAL(0, _serial.frameAvailable());
+
+	// Start again, the bytes received before are dropped.
+	_serial.beginFrames(IDLE_CHARS);
+	std::string a = makeData(5, 30);
+	receive(a);
+
+	delay(1);
+	CHECK(readFrame() == a);
+	CHECK_EQUAL(0, _serial.frameAvailable());
+
+	// begin() keeps the frames receiving.
+	_serial.begin(5, BAUD, 16, 17);
+	receive(a);
+
+	delay(1);
+	CHECK(readFrame() == a);
+
+	_serial.endFrames();
+}
+
+int main()
+{
+	RUN_TEST(testEvents);
+	RUN_TEST(testLateTask);
+	RUN_TEST(testFifoFullOnly);
+	RUN_TEST(testDelimiter);
+	RUN_TEST(testCallback);
+	RUN_TEST(testEndFrames);
+
+	HOST_TEST_MAIN_END();
+}
@@ -50,6 +50,7 @@
 uint8_t  W5100Class::chip = 0;
 uint8_t  W5100Class::CH_BASE_MSB;
 uint8_t  W5100Class::ss_pin = SS_PIN_DEFAULT;
+bool (*W5100Class::ready_callback)(void) = NULL;
 #ifdef ETHERNET_LARGE_BUFFERS
 uint16_t W5100Class::SSIZE = 2048;
 uint16_t W5100Class::SMASK = 0x07FF;
@@ -95,7 +96,14 @@ uint8_t W5100Class::init(void)
 	// case maximum 560 ms pulse length.  This delay is meant to wait
 	// until the reset pulse is ended.  If your hardware has a shorter
 	// reset time, this can be edited or removed.
-	delay(560);
+	// Boards which drive the reset pin itself set a ready callback.
+	if (ready_callback) {
+		while (!ready_callback()) {
+			yield();
+		}
+	} else {
+		delay(560);
+	}
 	//Serial.println("w5100 init");
 
 	SPI.begin();
@@ -300,6 +300,7 @@ public:
 private:
   static uint8_t chip;
   static uint8_t ss_pin;
+  static bool (*ready_callback)(void);
   static uint8_t softReset(void);
   static uint8_t isW5100(void);
   static uint8_t isW5200(void);
@@ -334,6 +335,9 @@ public:
     return false;
   }
   static void setSS(uint8_t pin) { ss_pin = pin; }
+  // If the board controls the chip reset it can set a callback which returns true when the chip is ready.
+  // In this case init() doesn't wait for an external reset chip.
+  static void setReadyCallback(bool (*callback)(void)) { ready_callback = callback; }
 
 private:
 #if defined(__AVR__)
@@ -0,0 +1,169 @@
+// KMPDmx.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		DMX512 transmitter on the RS485 port.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPDmx.h"
+
+// Buffers are swapped between the sketch and the DMX task.
+static portMUX_TYPE _dmxMux = portMUX_INITIALIZER_UNLOCKED;
+
+KMPDmxClass KMPDmx;
+
+KMPDmxClass::KMPDmxClass() :
+	_serial(NULL),
+	_task(NULL),
+	_running(false),
+	_slots(DMX_SLOTS),
+	_periodMs(1000 / DMX_REFRESH_HZ),
+	_breakuS(DMX_BREAK_US),
+	_markuS(DMX_MARK_US),
+	_frames(0),
+	_pending(false)
+{
+	memset(_buffers, 0, sizeof(_buffers));
+	_back = _buffers[0];
+	_next = _buffers[1];
+	_front = _buffers[2];
+}
+
+bool KMPDmxClass::begin(KMPRS485SerialClass& serial, uint16_t slots)
+{
+	if (_task != NULL || slots == 0 || slots > DMX_SLOTS)
+	{
+		return false;
+	}
+
+	_serial = &serial;
+	_slots = slots;
+	_frames = 0;
+	_pending = false;
+	memset(_buffers, 0, sizeof(_buffers));
+
+	// DMX has no responses, the transceiver is always in transmit.
+	_serial->setTransmitOnly(true);
+
+	_running = true;
+	TaskHandle_t handle = NULL;
+	if (xTaskCreatePinnedToCore(task, "dmx", DMX_TASK_STACK_SIZE, this, DMX_TASK_PRIORITY, &handle, ARDUINO_RUNNING_CORE) != pdPASS)
+	{
+		_running = false;
+		_serial->setTransmitOnly(false);
+		return false;
+	}
+
+	_task = handle;
+
+	return true;
+}
+
+void KMPDmxClass::end()
+{
+	if (_task == NULL)
+	{
+		return;
+	}
+
+	// The task finishes the current frame.
+	_running = false;
+	while (_task != NULL)
+	{
+		delay(1);
+	}
+
+	_serial->flush();
+	_serial->setTransmitOnly(false);
+}
+
+void KMPDmxClass::setRefreshRate(uint8_t hz)
+{
+	_periodMs = hz > 0 ? 1000 / hz : 1000 / DMX_REFRESH_HZ;
+}
+
+void KMPDmxClass::setBreakTime(uint32_t breakuS, uint32_t markuS)
+{
+	_breakuS = breakuS;
+	_markuS = markuS;
+}
+
+void KMPDmxClass::setChannel(uint16_t channel, uint8_t value)
+{
+	if (channel >= 1 && channel <= DMX_SLOTS)
+	{
+		_back[channel] = value;
+	}
+}
+
+void KMPDmxClass::setChannels(uint16_t channel, const uint8_t* values, uint16_t count)
+{
+	if (channel < 1 || channel > DMX_SLOTS)
+	{
+		return;
+	}
+
+	count = min(count, (uint16_t)(DMX_SLOTS + 1 - channel));
+	memcpy(&_back[channel], values, count);
+}
+
+uint8_t KMPDmxClass::getChannel(uint16_t channel)
+{
+	return channel >= 1 && channel <= DMX_SLOTS ? _back[channel] : 0;
+}
+
+void KMPDmxClass::clear()
+{
+	memset(&_back[1], 0, DMX_SLOTS);
+}
+
+void KMPDmxClass::update()
+{
+	portENTER_CRITICAL(&_dmxMux);
+	memcpy(_next, _back, _slots + 1);
+	_next[0] = DMX_START_CODE;
+	_pending = true;
+	portEXIT_CRITICAL(&_dmxMux);
+}
+
+void KMPDmxClass::task(void* arg)
+{
+	((KMPDmxClass*)arg)->run();
+}
+
+/**
+* @brief Send frames until end(). The task sleeps while the UART sends the slots and until the next period.
+*
+* @return void
+*/
+void KMPDmxClass::run()
+{
+	TickType_t lastWake = xTaskGetTickCount();
+
+	while (_running)
+	{
+		// The previous frame is already in the UART, its buffer is free.
+		portENTER_CRITICAL(&_dmxMux);
+		if (_pending)
+		{
+			uint8_t* front = _front;
+			_front = _next;
+			_next = front;
+			_pending = false;
+		}
+		portEXIT_CRITICAL(&_dmxMux);
+
+		// It waits for the end of the previous frame.
+		_serial->sendBreak(_breakuS, _markuS);
+		_serial->write(_front, _slots + 1);
+		++_frames;
+
+		// If the frame is longer than the period it returns immediately.
+		vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(_periodMs));
+	}
+
+	_task = NULL;
+	vTaskDelete(NULL);
+}
@@ -0,0 +1,169 @@
+// KMPDmx.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		ProDino ESP32 V1 https://kmpelectronics.eu/products/prodino-esp32-v1/
+//		ProDino ESP32 Ethernet V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/
+//		ProDino ESP32 GSM V1 https://kmpelectronics.eu/products/prodino-esp32-gsm-v1/
+//		ProDino ESP32 LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-lora-v1/
+//		ProDino ESP32 LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-lora-rfm-v1/
+//		ProDino ESP32 Ethernet GSM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-gsm-v1/
+//		ProDino ESP32 Ethernet LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-v1/
+//		ProDino ESP32 Ethernet LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-rfm-v1/
+// Description:
+//		DMX512 transmitter on the RS485 port. Frames (break, mark after break, start code and slots) are sent
+//		continuously by a background task. The UART sends the slots from its FIFO, the task sleeps while they are sent.
+//		The sketch changes channels in its own buffer and publishes them by update(), the next frame sends all changes together.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPDMX_H
+#define _KMPDMX_H
+
+#include "KMPRS485Serial.h"
+
+// RS485 must be started with this baud and configuration.
+#define DMX_BAUD 250000
+#define DMX_CONFIG SERIAL_8N2
+#define DMX_SLOTS 512
+#define DMX_START_CODE 0x00
+
+// Break min 92 uS, mark after break min 12 uS.
+#define DMX_BREAK_US 176
+#define DMX_MARK_US 16
+// Max refresh rate of a full universe.
+#define DMX_REFRESH_HZ 44
+
+#ifndef DMX_TASK_STACK_SIZE
+#define DMX_TASK_STACK_SIZE 2048
+#endif
+#ifndef DMX_TASK_PRIORITY
+#define DMX_TASK_PRIORITY 2
+#endif
+
+class KMPDmxClass
+{
+ public:
+	KMPDmxClass();
+
+	/**
+	* @brief Start frame transmission. RS485 must be started before with DMX_BAUD and DMX_CONFIG.
+	*        All channels are 0.
+	*
+	* @param serial Serial port. RS485Serial.
+	* @param slots Count of transmitted channels 1 - DMX_SLOTS. Less slots - higher refresh rate.
+	*
+	* @return bool true - the transmission is started.
+	*/
+	bool begin(KMPRS485SerialClass& serial, uint16_t slots = DMX_SLOTS);
+
+	/**
+	* @brief Stop frame transmission after the current frame and return RS485 to half duplex mode.
+	*
+	* @return void
+	*/
+	void end();
+
+	/**
+	* @brief Check if frames are transmitted.
+	*
+	* @return bool true - running.
+	*/
+	bool isRunning() { return _task != NULL; }
+
+	/**
+	* @brief Set refresh rate. Default DMX_REFRESH_HZ. If the frame is longer than the period, frames are sent one after another.
+	*
+	* @param hz Frames per second.
+	*
+	* @return void
+	*/
+	void setRefreshRate(uint8_t hz);
+
+	/**
+	* @brief Set break and mark after break times. Default DMX_BREAK_US and DMX_MARK_US.
+	*
+	* @param breakuS Break time in microseconds.
+	* @param markuS Mark after break time in microseconds.
+	*
+	* @return void
+	*/
+	void setBreakTime(uint32_t breakuS, uint32_t markuS);
+
+	/**
+	* @brief Set channel value. It is transmitted after update().
+	*
+	* @param channel Channel 1 - DMX_SLOTS.
+	* @param value Value.
+	*
+	* @return void
+	*/
+	void setChannel(uint16_t channel, uint8_t value);
+
+	/**
+	* @brief Set values of consecutive channels. They are transmitted after update().
+	*
+	* @param channel First channel 1 - DMX_SLOTS.
+	* @param values Values.
+	* @param count Channels count.
+	*
+	* @return void
+	*/
+	void setChannels(uint16_t channel, const uint8_t* values, uint16_t count);
+
+	/**
+	* @brief Get channel value set by the sketch.
+	*
+	* @param channel Channel 1 - DMX_SLOTS.
+	*
+	* @return uint8_t Value, 0 if the channel is out of range.
+	*/
+	uint8_t getChannel(uint16_t channel);
+
+	/**
+	* @brief Set all channels to 0. They are transmitted after update().
+	*
+	* @return void
+	*/
+	void clear();
+
+	/**
+	* @brief Publish the changed channels. The next frame contains all of them.
+	*
+	* @return void
+	*/
+	void update();
+
+	/**
+	* @brief Get count of transmitted frames.
+	*
+	* @return uint32_t Frames count.
+	*/
+	uint32_t frames() { return _frames; }
+
+ private:
+	KMPRS485SerialClass* _serial;
+	volatile TaskHandle_t _task;
+	volatile bool _running;
+	uint16_t _slots;
+	uint32_t _periodMs;
+	uint32_t _breakuS;
+	uint32_t _markuS;
+	volatile uint32_t _frames;
+
+	// Start code and slots. The sketch changes _back, update() copies it in _next,
+	// the task swaps _next and _front before the frame.
+	uint8_t _buffers[3][DMX_SLOTS + 1];
+	uint8_t* _back;
+	uint8_t* _next;
+	uint8_t* _front;
+	bool _pending;
+
+	static void task(void* arg);
+	void run();
+};
+
+extern KMPDmxClass KMPDmx;
+
+#endif
@@ -0,0 +1,122 @@
+// KMPModbus.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Modbus RTU common definitions: function codes, exception codes, CRC16 and frame timing.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPMODBUS_H
+#define _KMPMODBUS_H
+
+#include <Arduino.h>
+
+// Max RTU frame size: address (1) + PDU (253) + CRC (2).
+#define MODBUS_MAX_FRAME 256
+// Min RTU frame size: address (1) + function (1) + CRC (2).
+#define MODBUS_MIN_FRAME 4
+#define MODBUS_BROADCAST_ID 0
+#define MODBUS_MAX_SLAVE_ID 247
+
+// Max items in one request.
+#define MODBUS_MAX_READ_BITS       2000
+#define MODBUS_MAX_READ_REGISTERS  125
+#define MODBUS_MAX_WRITE_BITS      1968
+#define MODBUS_MAX_WRITE_REGISTERS 123
+
+#define MODBUS_COIL_ON  0xFF00
+#define MODBUS_COIL_OFF 0x0000
+#define MODBUS_EXCEPTION_FLAG 0x80
+
+/**
+ * @brief Modbus function codes.
+ */
+enum ModbusFunction {
+	ModbusReadCoils = 0x01,
+	ModbusReadDiscreteInputs = 0x02,
+	ModbusReadHoldingRegisters = 0x03,
+	ModbusReadInputRegisters = 0x04,
+	ModbusWriteSingleCoil = 0x05,
+	ModbusWriteSingleRegister = 0x06,
+	ModbusWriteMultipleCoils = 0x0F,
+	ModbusWriteMultipleRegisters = 0x10
+};
+
+/**
+ * @brief Modbus exception codes.
+ */
+enum ModbusExceptionCode {
+	ModbusIllegalFunction = 0x01,
+	ModbusIllegalDataAddress = 0x02,
+	ModbusIllegalDataValue = 0x03,
+	ModbusSlaveDeviceFailure = 0x04,
+	ModbusSlaveDeviceBusy = 0x06,
+	ModbusGatewayPathUnavailable = 0x0A,
+	ModbusGatewayTargetFailed = 0x0B
+};
+
+/**
+ * @brief RTU frame timing for the current baud and configuration.
+ *        Silence inside a frame (t1.5) isn't checked. Received bytes come from the UART buffer in chunks
+ *        and the gaps between them can't be measured. Frames are checked by length and CRC.
+ */
+struct ModbusTiming_t {
+	// One character time in uS.
+	uint32_t CharuS;
+	// Min silence between frames (3.5 characters) in uS.
+	uint32_t T35uS;
+};
+
+/**
+ * @brief Calculate Modbus CRC16 by a table. Result low byte is transmitted first.
+ *
+ * @param data Data.
+ * @param len Data length.
+ *
+ * @return uint16_t CRC.
+ */
+uint16_t modbusCRC16(const uint8_t* data, size_t len);
+
+/**
+ * @brief Add CRC at the end of the frame.
+ *
+ * @param frame Frame with free 2 bytes at the end.
+ * @param len Frame length without CRC.
+ *
+ * @return size_t Frame length with CRC.
+ */
+size_t modbusAppendCRC(uint8_t* frame, size_t len);
+
+/**
+ * @brief Check frame CRC.
+ *
+ * @param frame Frame.
+ * @param len Frame length with CRC.
+ *
+ * @return bool true - CRC is valid.
+ */
+bool modbusCheckCRC(const uint8_t* frame, size_t len);
+
+/**
+ * @brief Calculate frame timing. Over 19200 baud fixed t3.5 1750uS is used as the standard requires.
+ *
+ * @param baud Speed.
+ * @param config Configuration - SERIAL_8N1, SERIAL_8E1 ...
+ * @param timing Result.
+ *
+ * @return void
+ */
+void modbusCalcTiming(unsigned long baud, uint32_t config, ModbusTiming_t& timing);
+
+/**
+ * @brief Read big endian 16 bits value.
+ */
+inline uint16_t modbusGetUInt16(const uint8_t* data) { return ((uint16_t)data[0] << 8) | data[1]; }
+
+/**
+ * @brief Write big endian 16 bits value.
+ */
+inline void modbusSetUInt16(uint8_t* data, uint16_t value) { data[0] = value >> 8; data[1] = (uint8_t)value; }
+
+#endif
@@ -0,0 +1,328 @@
+// KMPModbusGateway.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Modbus TCP to Modbus RTU gateway.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPModbusGateway.h"
+
+// Write response PDU: function, address, value (count).
+#define MODBUS_WRITE_RESPONSE_PDU_LEN 5
+
+KMPModbusGatewayClass KMPModbusGateway;
+
+/**
+* @brief Check if the function can be sent as broadcast - writes only.
+*/
+inline bool isBroadcastFunction(uint8_t function)
+{
+	return function == ModbusWriteSingleCoil || function == ModbusWriteSingleRegister || function == ModbusWriteMultipleCoils || function == ModbusWriteMultipleRegisters;
+}
+
+KMPModbusGatewayClass::KMPModbusGatewayClass() :
+	_server(NULL),
+	_master(NULL)
+{
+	for (uint8_t i = 0; i < MODBUS_GATEWAY_CONNECTIONS; i++)
+	{
+		_connections[i].Active = false;
+		_connections[i].Generation = 0;
+		_connections[i].Len = 0;
+	}
+
+	for (uint8_t i = 0; i < MODBUS_GATEWAY_QUEUE_SIZE; i++)
+	{
+		_transactions[i].Used = false;
+	}
+
+	resetStats();
+}
+
+void KMPModbusGatewayClass::begin(EthernetServer& server, KMPModbusMasterClass& master)
+{
+	_server = &server;
+	_master = &master;
+	_server->begin();
+
+	resetStats();
+}
+
+void KMPModbusGatewayClass::resetStats()
+{
+	memset(&_stats, 0, sizeof(_stats));
+	_statsMillis = millis();
+	_statsBusyMs = _master != NULL ? _master->getStats().BusyMs : 0;
+}
+
+void KMPModbusGatewayClass::process()
+{
+	if (_server == NULL)
+	{
+		return;
+	}
+
+	acceptClients();
+
+	for (uint8_t i = 0; i < MODBUS_GATEWAY_CONNECTIONS; i++)
+	{
+		if (_connections[i].Active)
+		{
+			readConnection(i);
+		}
+	}
+
+	// Responses are sent from the master callback.
+	_master->process();
+}
+
+uint8_t KMPModbusGatewayClass::connections()
+{
+	uint8_t result = 0;
+	for (uint8_t i = 0; i < MODBUS_GATEWAY_CONNECTIONS; i++)
+	{
+		if (_connections[i].Active)
+		{
+			++result;
+		}
+	}
+
+	return result;
+}
+
+uint8_t KMPModbusGatewayClass::queued()
+{
+	uint8_t result = 0;
+	for (uint8_t i = 0; i < MODBUS_GATEWAY_QUEUE_SIZE; i++)
+	{
+		if (_transactions[i].Used)
+		{
+			++result;
+		}
+	}
+
+	return result;
+}
+
+uint32_t KMPModbusGatewayClass::getAverageQueueLatencyMs()
+{
+	uint32_t count = _stats.Responses + _stats.Dropped;
+	return count ? _stats.QueueLatencyTotalMs / count : 0;
+}
+
+uint32_t KMPModbusGatewayClass::getAverageResponseTimeMs()
+{
+	return _stats.Responses ? _stats.ResponseTimeTotalMs / _stats.Responses : 0;
+}
+
+uint8_t KMPModbusGatewayClass::getBusUtilization()
+{
+	unsigned long elapsed = millis() - _statsMillis;
+	if (_master == NULL || elapsed == 0)
+	{
+		return 0;
+	}
+
+	uint32_t busy = _master->getStats().BusyMs - _statsBusyMs;
+
+	return (uint8_t)min((uint32_t)100, (uint32_t)((uint64_t)busy * 100 / elapsed));
+}
+
+void KMPModbusGatewayClass::acceptClients()
+{
+	EthernetClient client = _server->accept();
+	if (!client)
+	{
+		return;
+	}
+
+	for (uint8_t i = 0; i < MODBUS_GATEWAY_CONNECTIONS; i++)
+	{
+		Connection_t& conn = _connections[i];
+		if (conn.Active)
+		{
+			continue;
+		}
+
+		conn.Client = client;
+		conn.Active = true;
+		conn.Len = 0;
+		conn.LastActivityMillis = millis();
+		++_stats.Connections;
+
+		return;
+	}
+
+	// No free connection.
+	client.stop();
+}
+
+void KMPModbusGatewayClass::closeConnection(uint8_t index)
+{
+	Connection_t& conn = _connections[index];
+	conn.Client.stop();
+	conn.Active = false;
+	conn.Len = 0;
+	++conn.Generation;
+}
+
+void KMPModbusGatewayClass::readConnection(uint8_t index)
+{
+	Connection_t& conn = _connections[index];
+
+	if (!conn.Client.connected() || millis() - conn.LastActivityMillis > MODBUS_GATEWAY_IDLE_TIMEOUT_MS)
+	{
+		closeConnection(index);
+		return;
+	}
+
+	while (conn.Client.available())
+	{
+		// Read the header first, then the rest of the frame by the MBAP length.
+		uint16_t need = MODBUS_MBAP_LEN;
+		if (conn.Len >= MODBUS_MBAP_LEN)
+		{
+			uint16_t length = modbusGetUInt16(&conn.Buffer[4]);
+			// Length includes unit ID and PDU.
+			if (modbusGetUInt16(&conn.Buffer[2]) != 0 || length < 2 || length > MODBUS_MAX_PDU + 1)
+			{
+				closeConnection(index);
+				return;
+			}
+
+			need = MODBUS_MBAP_LEN - 1 + length;
+		}
+
+		int len = conn.Client.read(&conn.Buffer[conn.Len], need - conn.Len);
+		if (len <= 0)
+		{
+			break;
+		}
+
+		conn.Len += len;
+		conn.LastActivityMillis = millis();
+
+		if (conn.Len > MODBUS_MBAP_LEN && conn.Len == MODBUS_MBAP_LEN - 1 + modbusGetUInt16(&conn.Buffer[4]))
+		{
+			handleRequest(index);
+			conn.Len = 0;
+		}
+	}
+}
+
+void KMPModbusGatewayClass::handleRequest(uint8_t index)
+{
+	Connection_t& conn = _connections[index];
+
+	uint16_t transactionId = modbusGetUInt16(&conn.Buffer[0]);
+	uint8_t unitId = conn.Buffer[6];
+	uint8_t pduLen = conn.Len - MODBUS_MBAP_LEN;
+	const uint8_t* pdu = &conn.Buffer[MODBUS_MBAP_LEN];
+
+	++_stats.Requests;
+
+	if (unitId > MODBUS_MAX_SLAVE_ID)
+	{
+		sendException(index, transactionId, unitId, pdu[0], ModbusGatewayPathUnavailable);
+		return;
+	}
+
+	// Reads can't be broadcast. Writes have address and value (count), the response is built from them.
+	if (unitId == MODBUS_BROADCAST_ID && (!isBroadcastFunction(pdu[0]) || pduLen < MODBUS_WRITE_RESPONSE_PDU_LEN))
+	{
+		sendException(index, transactionId, unitId, pdu[0], ModbusIllegalFunction);
+		return;
+	}
+
+	for (uint8_t i = 0; i < MODBUS_GATEWAY_QUEUE_SIZE; i++)
+	{
+		Transaction_t& tr = _transactions[i];
+		if (tr.Used)
+		{
+			continue;
+		}
+
+		// The PDU is copied, the connection buffer is used for the next request.
+		memcpy(tr.Pdu, pdu, pduLen);
+		tr.PduLen = pduLen;
+		tr.Connection = index;
+		tr.Generation = conn.Generation;
+		tr.TransactionId = transactionId;
+		tr.UnitId = unitId;
+		tr.ReceivedMillis = millis();
+
+		if (_master->request(unitId, tr.Pdu, tr.PduLen, tr.Response, sizeof(tr.Response), onResponse, &tr) < 0)
+		{
+			break;
+		}
+
+		tr.Used = true;
+		return;
+	}
+
+	++_stats.Rejected;
+	sendException(index, transactionId, unitId, pdu[0], ModbusSlaveDeviceBusy);
+}
+
+void KMPModbusGatewayClass::onResponse(const ModbusRequest_t& request, ModbusResult result)
+{
+	KMPModbusGateway.completeTransaction(*(Transaction_t*)request.Arg, result, request);
+}
+
+void KMPModbusGatewayClass::completeTransaction(Transaction_t& transaction, ModbusResult result, const ModbusRequest_t& request)
+{
+	transaction.Used = false;
+
+	uint32_t latency = request.SentMillis - transaction.ReceivedMillis;
+	_stats.QueueLatencyTotalMs += latency;
+	_stats.QueueLatencyMaxMs = max(_stats.QueueLatencyMaxMs, latency);
+
+	Connection_t& conn = _connections[transaction.Connection];
+	if (!conn.Active || conn.Generation != transaction.Generation)
+	{
+		++_stats.Dropped;
+		return;
+	}
+
+	if (transaction.UnitId == MODBUS_BROADCAST_ID && result == ModbusResultOK)
+	{
+		// RTU slaves don't respond to broadcast. The TCP client waits for a write response: function, address and value (count).
+		sendResponse(transaction.Connection, transaction.TransactionId, transaction.UnitId, transaction.Pdu, MODBUS_WRITE_RESPONSE_PDU_LEN);
+	}
+	else if (result == ModbusResultOK || result == ModbusResultException)
+	{
+		sendResponse(transaction.Connection, transaction.TransactionId, transaction.UnitId, transaction.Response, request.Count);
+	}
+	else
+	{
+		++_stats.TargetFailed;
+		sendException(transaction.Connection, transaction.TransactionId, transaction.UnitId, transaction.Pdu[0], ModbusGatewayTargetFailed);
+	}
+
+	uint32_t responseTime = millis() - transaction.ReceivedMillis;
+	_stats.ResponseTimeTotalMs += responseTime;
+	_stats.ResponseTimeMaxMs = max(_stats.ResponseTimeMaxMs, responseTime);
+}
+
+void KMPModbusGatewayClass::sendResponse(uint8_t index, uint16_t transactionId, uint8_t unitId, const uint8_t* pdu, uint8_t pduLen)
+{
+	modbusSetUInt16(&_txBuffer[0], transactionId);
+	modbusSetUInt16(&_txBuffer[2], 0);
+	modbusSetUInt16(&_txBuffer[4], pduLen + 1);
+	_txBuffer[6] = unitId;
+	memcpy(&_txBuffer[MODBUS_MBAP_LEN], pdu, pduLen);
+
+	// One write - one TCP packet.
+	_connections[index].Client.write(_txBuffer, MODBUS_MBAP_LEN + pduLen);
+
+	++_stats.Responses;
+}
+
+void KMPModbusGatewayClass::sendException(uint8_t index, uint16_t transactionId, uint8_t unitId, uint8_t function, uint8_t code)
+{
+	uint8_t pdu[2] = { (uint8_t)(function | MODBUS_EXCEPTION_FLAG), code };
+
+	sendResponse(index, transactionId, unitId, pdu, sizeof(pdu));
+}
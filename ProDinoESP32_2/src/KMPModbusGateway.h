@@ -0,0 +1,182 @@
+// KMPModbusGateway.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		ProDino ESP32 Ethernet V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/
+//		ProDino ESP32 Ethernet GSM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-gsm-v1/
+//		ProDino ESP32 Ethernet LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-v1/
+//		ProDino ESP32 Ethernet LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-rfm-v1/
+// Description:
+//		Modbus TCP to Modbus RTU gateway. Requests from several TCP connections are queued with their transaction ID
+//		and sent one by one on RS485 by KMPModbusMaster. Responses are returned to the right connection when they arrive.
+//		TCP unit ID is the RTU slave address. Unit ID 0 is an RTU broadcast, only writes (FC05, FC06, FC15, FC16) can be broadcast.
+//		The TCP client gets a normal write response when the broadcast is sent, RTU slaves don't respond to it.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPMODBUSGATEWAY_H
+#define _KMPMODBUSGATEWAY_H
+
+#include "KMPModbusMaster.h"
+#include "Ethernet/Ethernet.h"
+
+#define MODBUS_TCP_PORT 502
+// MBAP header: transaction ID (2), protocol ID (2), length (2), unit ID (1).
+#define MODBUS_MBAP_LEN 7
+#define MODBUS_MAX_PDU 253
+
+// Max TCP connections. W5500 has 8 sockets, one is used by the server.
+#ifndef MODBUS_GATEWAY_CONNECTIONS
+#define MODBUS_GATEWAY_CONNECTIONS 4
+#endif
+
+// Max requests waiting for RTU response. It must not be more than MODBUS_MASTER_QUEUE_SIZE.
+#ifndef MODBUS_GATEWAY_QUEUE_SIZE
+#define MODBUS_GATEWAY_QUEUE_SIZE 8
+#endif
+
+// A connection without requests is closed after this time.
+#define MODBUS_GATEWAY_IDLE_TIMEOUT_MS 60000
+
+/**
+ * @brief Gateway statistics.
+ */
+struct ModbusGatewayStats_t {
+	// Accepted connections.
+	uint32_t Connections;
+	// Valid Modbus TCP requests.
+	uint32_t Requests;
+	// Sent Modbus TCP responses including exceptions.
+	uint32_t Responses;
+	// Requests rejected with exception "slave device busy" because the queue is full.
+	uint32_t Rejected;
+	// Requests answered with exception "gateway target device failed to respond".
+	uint32_t TargetFailed;
+	// Responses not sent because the connection is closed.
+	uint32_t Dropped;
+	// Time from request receiving to RTU transmission.
+	uint32_t QueueLatencyMaxMs;
+	uint32_t QueueLatencyTotalMs;
+	// Time from request receiving to response sending.
+	uint32_t ResponseTimeMaxMs;
+	uint32_t ResponseTimeTotalMs;
+};
+
+class KMPModbusGatewayClass
+{
+ public:
+	KMPModbusGatewayClass();
+
+	/**
+	* @brief Start the gateway. Ethernet and the master must be started before.
+	*
+	* @param server Modbus TCP server. Usually on port MODBUS_TCP_PORT.
+	* @param master RTU master.
+	*
+	* @return void
+	*/
+	void begin(EthernetServer& server, KMPModbusMasterClass& master);
+
+	/**
+	* @brief Accept connections, read requests, serve the master and send responses. Call it in the loop as often as possible.
+	*
+	* @return void
+	*/
+	void process();
+
+	/**
+	* @brief Get count of open connections.
+	*
+	* @return uint8_t Connections count.
+	*/
+	uint8_t connections();
+
+	/**
+	* @brief Get count of requests waiting for RTU response.
+	*
+	* @return uint8_t Requests count.
+	*/
+	uint8_t queued();
+
+	/**
+	* @brief Get average time from request receiving to RTU transmission.
+	*
+	* @return uint32_t Time in milliseconds.
+	*/
+	uint32_t getAverageQueueLatencyMs();
+
+	/**
+	* @brief Get average time from request receiving to response sending.
+	*
+	* @return uint32_t Time in milliseconds.
+	*/
+	uint32_t getAverageResponseTimeMs();
+
+	/**
+	* @brief Get RS485 bus utilization since the last statistics reset.
+	*
+	* @return uint8_t Percent of the time the bus is busy with requests and responses.
+	*/
+	uint8_t getBusUtilization();
+
+	/**
+	* @brief Get statistics.
+	*
+	* @return const ModbusGatewayStats_t& Statistics.
+	*/
+	const ModbusGatewayStats_t& getStats() { return _stats; }
+
+	/**
+	* @brief Reset statistics.
+	*
+	* @return void
+	*/
+	void resetStats();
+
+ private:
+	struct Connection_t {
+		EthernetClient Client;
+		bool Active;
+		// Changed when the connection is closed. Responses for old connection are dropped.
+		uint16_t Generation;
+		unsigned long LastActivityMillis;
+		uint8_t Buffer[MODBUS_MBAP_LEN + MODBUS_MAX_PDU];
+		uint16_t Len;
+	};
+
+	struct Transaction_t {
+		bool Used;
+		uint8_t Connection;
+		uint16_t Generation;
+		uint16_t TransactionId;
+		uint8_t UnitId;
+		unsigned long ReceivedMillis;
+		uint8_t Pdu[MODBUS_MAX_PDU];
+		uint8_t PduLen;
+		uint8_t Response[MODBUS_MAX_PDU];
+	};
+
+	EthernetServer* _server;
+	KMPModbusMasterClass* _master;
+	Connection_t _connections[MODBUS_GATEWAY_CONNECTIONS];
+	Transaction_t _transactions[MODBUS_GATEWAY_QUEUE_SIZE];
+	uint8_t _txBuffer[MODBUS_MBAP_LEN + MODBUS_MAX_PDU];
+
+	ModbusGatewayStats_t _stats;
+	unsigned long _statsMillis;
+	uint32_t _statsBusyMs;
+
+	static void onResponse(const ModbusRequest_t& request, ModbusResult result);
+	void acceptClients();
+	void readConnection(uint8_t index);
+	void closeConnection(uint8_t index);
+	void handleRequest(uint8_t index);
+	void sendResponse(uint8_t index, uint16_t transactionId, uint8_t unitId, const uint8_t* pdu, uint8_t pduLen);
+	void sendException(uint8_t index, uint16_t transactionId, uint8_t unitId, uint8_t function, uint8_t code);
+	void completeTransaction(Transaction_t& transaction, ModbusResult result, const ModbusRequest_t& request);
+};
+
+extern KMPModbusGatewayClass KMPModbusGateway;
+
+#endif
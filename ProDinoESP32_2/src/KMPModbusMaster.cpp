@@ -0,0 +1,682 @@
+// KMPModbusMaster.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Modbus RTU master over RS485.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPModbusMaster.h"
+
+// Exception response: slave, function | 0x80, code, CRC.
+#define MODBUS_EXCEPTION_LEN 5
+// Write response: slave, function, address, value (count), CRC.
+#define MODBUS_WRITE_RESPONSE_LEN 8
+#define MODBUS_COALESCE_DISABLED 0xFFFF
+
+KMPModbusMasterClass KMPModbusMaster;
+
+/**
+* @brief Check if the function is a read of coils, inputs or registers.
+*/
+inline bool isReadFunction(uint8_t function)
+{
+	return function >= ModbusReadCoils && function <= ModbusReadInputRegisters;
+}
+
+/**
+* @brief Check if the function works with bits - coils or discrete inputs.
+*/
+inline bool isBitFunction(uint8_t function)
+{
+	return function == ModbusReadCoils || function == ModbusReadDiscreteInputs || function == ModbusWriteMultipleCoils;
+}
+
+KMPModbusMasterClass::KMPModbusMasterClass() :
+	_serial(NULL),
+	_responseTimeoutMs(MODBUS_MASTER_RESPONSE_TIMEOUT_MS),
+	_broadcastDelayMs(MODBUS_MASTER_BROADCAST_DELAY_MS),
+	_coalesceGap(0),
+	_order(0),
+	_state(MasterIdle),
+	_rxLen(0)
+{
+	memset(_slots, 0, sizeof(_slots));
+	memset(_slaveFails, 0, sizeof(_slaveFails));
+	resetStats();
+}
+
+void KMPModbusMasterClass::begin(Stream& serial, unsigned long baud, uint32_t config)
+{
+	_serial = &serial;
+	modbusCalcTiming(baud, config, _timing);
+
+	_state = MasterIdle;
+	_rxLen = 0;
+	_busSilentMicros = micros();
+}
+
+void KMPModbusMasterClass::resetStats()
+{
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+int KMPModbusMasterClass::readCoils(uint8_t slaveId, uint16_t address, uint16_t count, uint8_t* bits, ModbusMasterCallback callback, void* arg)
+{
+	return addRequest(slaveId, ModbusReadCoils, address, count, bits, 0, callback, arg);
+}
+
+int KMPModbusMasterClass::readDiscreteInputs(uint8_t slaveId, uint16_t address, uint16_t count, uint8_t* bits, ModbusMasterCallback callback, void* arg)
+{
+	return addRequest(slaveId, ModbusReadDiscreteInputs, address, count, bits, 0, callback, arg);
+}
+
+int KMPModbusMasterClass::readHoldingRegisters(uint8_t slaveId, uint16_t address, uint16_t count, uint16_t* registers, ModbusMasterCallback callback, void* arg)
+{
+	return addRequest(slaveId, ModbusReadHoldingRegisters, address, count, registers, 0, callback, arg);
+}
+
+int KMPModbusMasterClass::readInputRegisters(uint8_t slaveId, uint16_t address, uint16_t count, uint16_t* registers, ModbusMasterCallback callback, void* arg)
+{
+	return addRequest(slaveId, ModbusReadInputRegisters, address, count, registers, 0, callback, arg);
+}
+
+int KMPModbusMasterClass::writeSingleCoil(uint8_t slaveId, uint16_t address, bool state, ModbusMasterCallback callback, void* arg)
+{
+	return addRequest(slaveId, ModbusWriteSingleCoil, address, 1, NULL, state ? MODBUS_COIL_ON : MODBUS_COIL_OFF, callback, arg);
+}
+
+int KMPModbusMasterClass::writeSingleRegister(uint8_t slaveId, uint16_t address, uint16_t value, ModbusMasterCallback callback, void* arg)
+{
+	return addRequest(slaveId, ModbusWriteSingleRegister, address, 1, NULL, value, callback, arg);
+}
+
+int KMPModbusMasterClass::writeMultipleCoils(uint8_t slaveId, uint16_t address, uint16_t count, const uint8_t* bits, ModbusMasterCallback callback, void* arg)
+{
+	return addRequest(slaveId, ModbusWriteMultipleCoils, address, count, (void*)bits, 0, callback, arg);
+}
+
+int KMPModbusMasterClass::writeMultipleRegisters(uint8_t slaveId, uint16_t address, uint16_t count, const uint16_t* registers, ModbusMasterCallback callback, void* arg)
+{
+	return addRequest(slaveId, ModbusWriteMultipleRegisters, address, count, (void*)registers, 0, callback, arg);
+}
+
+int KMPModbusMasterClass::addRequest(uint8_t slaveId, uint8_t function, uint16_t address, uint16_t count, void* data, uint16_t value, ModbusMasterCallback callback, void* arg)
+{
+	if (slaveId > MODBUS_MAX_SLAVE_ID)
+	{
+		return -1;
+	}
+
+	uint16_t maxCount = 1;
+	switch (function)
+	{
+	case ModbusReadCoils:
+	case ModbusReadDiscreteInputs:
+		maxCount = MODBUS_MAX_READ_BITS;
+		break;
+	case ModbusReadHoldingRegisters:
+	case ModbusReadInputRegisters:
+		maxCount = MODBUS_MAX_READ_REGISTERS;
+		break;
+	case ModbusWriteMultipleCoils:
+		maxCount = MODBUS_MAX_WRITE_BITS;
+		break;
+	case ModbusWriteMultipleRegisters:
+		maxCount = MODBUS_MAX_WRITE_REGISTERS;
+		break;
+	}
+
+	bool needData = function != ModbusWriteSingleCoil && function != ModbusWriteSingleRegister;
+	// Reads can't be broadcast.
+	if (count == 0 || count > maxCount || (needData && data == NULL) || (isReadFunction(function) && slaveId == MODBUS_BROADCAST_ID))
+	{
+		return -1;
+	}
+
+	int index = allocSlot();
+	if (index < 0)
+	{
+		return -1;
+	}
+
+	ModbusRequest_t& req = _slots[index].Request;
+	req.SlaveId = slaveId;
+	req.Function = function;
+	req.Address = address;
+	req.Count = count;
+	req.Data = data;
+	req.Value = value;
+	req.Callback = callback;
+	req.Arg = arg;
+
+	return index;
+}
+
+int KMPModbusMasterClass::request(uint8_t slaveId, const uint8_t* pdu, uint8_t pduLen, uint8_t* response, uint8_t responseSize, ModbusMasterCallback callback, void* arg)
+{
+	if (slaveId > MODBUS_MAX_SLAVE_ID || pdu == NULL || pduLen == 0 || pduLen > MODBUS_MAX_FRAME - 3 || response == NULL)
+	{
+		return -1;
+	}
+
+	int index = allocSlot();
+	if (index < 0)
+	{
+		return -1;
+	}
+
+	ModbusRequest_t& req = _slots[index].Request;
+	req.SlaveId = slaveId;
+	req.Function = pdu[0];
+	req.Address = pduLen >= 3 ? modbusGetUInt16(&pdu[1]) : 0;
+	req.Count = responseSize;
+	req.Data = response;
+	req.Callback = callback;
+	req.Arg = arg;
+	req.Pdu = pdu;
+	req.PduLen = pduLen;
+
+	return index;
+}
+
+/**
+* @brief Find a free slot and mark it pending.
+*
+* @return int Slot index, -1 if the queue is full.
+*/
+int KMPModbusMasterClass::allocSlot()
+{
+	for (uint8_t i = 0; i < MODBUS_MASTER_QUEUE_SIZE; i++)
+	{
+		Slot_t& slot = _slots[i];
+		if (slot.State != SlotFree)
+		{
+			continue;
+		}
+
+		memset(&slot.Request, 0, sizeof(slot.Request));
+		slot.Request.QueuedMillis = millis();
+		slot.Order = _order++;
+		slot.State = SlotPending;
+
+		++_stats.Requests;
+
+		return i;
+	}
+
+	return -1;
+}
+
+bool KMPModbusMasterClass::isBusy()
+{
+	return _state != MasterIdle || pending() > 0;
+}
+
+uint8_t KMPModbusMasterClass::pending()
+{
+	uint8_t result = 0;
+	for (uint8_t i = 0; i < MODBUS_MASTER_QUEUE_SIZE; i++)
+	{
+		if (_slots[i].State != SlotFree)
+		{
+			++result;
+		}
+	}
+
+	return result;
+}
+
+void KMPModbusMasterClass::process()
+{
+	if (_serial == NULL)
+	{
+		return;
+	}
+
+	switch (_state)
+	{
+	case MasterIdle:
+	{
+		// Data without request is discarded, but it keeps the bus busy.
+		while (_serial->available())
+		{
+			_serial->read();
+			_busSilentMicros = micros();
+		}
+
+		// _busSilentMicros can be in the future while the request is transmitted.
+		if ((long)(micros() - _busSilentMicros) < (long)_timing.T35uS)
+		{
+			return;
+		}
+
+		int next = selectNext();
+		if (next >= 0)
+		{
+			sendFrame(next);
+		}
+		break;
+	}
+	case MasterWaitResponse:
+		receive();
+		break;
+	case MasterWaitBroadcast:
+		if (millis() - _sentMillis >= _txTimeMs + _broadcastDelayMs)
+		{
+			_state = MasterIdle;
+			finishActive(ModbusResultOK, 0);
+		}
+		break;
+	}
+}
+
+/**
+* @brief Select the oldest pending request. Requests to slow slaves are selected only if there are no others.
+*
+* @return int Slot index, -1 if there are no pending requests.
+*/
+int KMPModbusMasterClass::selectNext()
+{
+	int result = -1;
+	int slowResult = -1;
+
+	for (uint8_t i = 0; i < MODBUS_MASTER_QUEUE_SIZE; i++)
+	{
+		Slot_t& slot = _slots[i];
+		if (slot.State != SlotPending)
+		{
+			continue;
+		}
+
+		if (_slaveFails[slot.Request.SlaveId] >= MODBUS_MASTER_SLOW_SLAVE_FAILS)
+		{
+			if (slowResult < 0 || (int32_t)(slot.Order - _slots[slowResult].Order) < 0)
+			{
+				slowResult = i;
+			}
+		}
+		else if (result < 0 || (int32_t)(slot.Order - _slots[result].Order) < 0)
+		{
+			result = i;
+		}
+	}
+
+	return result >= 0 ? result : slowResult;
+}
+
+/**
+* @brief Activate the request and all pending reads which can be served by the same frame.
+*        Sets frame address and count.
+*
+* @param first First request.
+*
+* @return void
+*/
+void KMPModbusMasterClass::coalesce(uint8_t first)
+{
+	ModbusRequest_t& req = _slots[first].Request;
+	_slots[first].State = SlotActive;
+
+	_frameSlave = req.SlaveId;
+	_frameFunction = req.Function;
+	_frameAddress = req.Address;
+	_frameCount = req.Count;
+
+	if (req.Pdu != NULL || !isReadFunction(req.Function) || _coalesceGap == MODBUS_COALESCE_DISABLED)
+	{
+		return;
+	}
+
+	uint32_t maxCount = isBitFunction(req.Function) ? MODBUS_MAX_READ_BITS : MODBUS_MAX_READ_REGISTERS;
+	uint32_t start = req.Address;
+	uint32_t end = start + req.Count;
+
+	// Repeat while the range grows, a new request can fill the gap to another.
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+
+		for (uint8_t i = 0; i < MODBUS_MASTER_QUEUE_SIZE; i++)
+		{
+			Slot_t& slot = _slots[i];
+			if (slot.State != SlotPending || slot.Request.Pdu != NULL || slot.Request.SlaveId != _frameSlave || slot.Request.Function != _frameFunction)
+			{
+				continue;
+			}
+
+			uint32_t slotStart = slot.Request.Address;
+			uint32_t slotEnd = slotStart + slot.Request.Count;
+			if (slotStart > end + _coalesceGap || slotEnd + _coalesceGap < start)
+			{
+				continue;
+			}
+
+			uint32_t newStart = min(start, slotStart);
+			uint32_t newEnd = max(end, slotEnd);
+			if (newEnd - newStart > maxCount)
+			{
+				continue;
+			}
+
+			start = newStart;
+			end = newEnd;
+			slot.State = SlotActive;
+			++_stats.Coalesced;
+			changed = true;
+		}
+	}
+
+	_frameAddress = start;
+	_frameCount = end - start;
+}
+
+/**
+* @brief Build the current frame without CRC.
+*
+* @param req First request of the frame.
+*
+* @return uint16_t Frame length.
+*/
+uint16_t KMPModbusMasterClass::buildFrame(const ModbusRequest_t& req)
+{
+	uint16_t len = 0;
+	_txFrame[len++] = _frameSlave;
+	_txFrame[len++] = _frameFunction;
+	modbusSetUInt16(&_txFrame[len], _frameAddress);
+	len += 2;
+
+	switch (_frameFunction)
+	{
+	case ModbusWriteSingleCoil:
+	case ModbusWriteSingleRegister:
+		modbusSetUInt16(&_txFrame[len], req.Value);
+		len += 2;
+		break;
+	case ModbusWriteMultipleCoils:
+	{
+		uint8_t bytes = (_frameCount + 7) / 8;
+		modbusSetUInt16(&_txFrame[len], _frameCount);
+		len += 2;
+		_txFrame[len++] = bytes;
+		memcpy(&_txFrame[len], req.Data, bytes);
+		len += bytes;
+		break;
+	}
+	case ModbusWriteMultipleRegisters:
+	{
+		const uint16_t* registers = (const uint16_t*)req.Data;
+		modbusSetUInt16(&_txFrame[len], _frameCount);
+		len += 2;
+		_txFrame[len++] = _frameCount * 2;
+		for (uint16_t i = 0; i < _frameCount; i++)
+		{
+			modbusSetUInt16(&_txFrame[len], registers[i]);
+			len += 2;
+		}
+		break;
+	}
+	default:
+		// Reads.
+		modbusSetUInt16(&_txFrame[len], _frameCount);
+		len += 2;
+		break;
+	}
+
+	return len;
+}
+
+void KMPModbusMasterClass::sendFrame(uint8_t first)
+{
+	coalesce(first);
+
+	ModbusRequest_t& req = _slots[first].Request;
+
+	uint16_t len;
+	_frameRaw = req.Pdu != NULL;
+	if (_frameRaw)
+	{
+		_txFrame[0] = _frameSlave;
+		memcpy(&_txFrame[1], req.Pdu, req.PduLen);
+		len = 1 + req.PduLen;
+		// Count is needed to know the response length.
+		_frameCount = isReadFunction(_frameFunction) && req.PduLen >= 5 ? modbusGetUInt16(&req.Pdu[3]) : 0;
+	}
+	else
+	{
+		len = buildFrame(req);
+	}
+
+	len = modbusAppendCRC(_txFrame, len);
+
+	_expectedLen = expectedResponseLen();
+	_rxLen = 0;
+
+	_serial->write(_txFrame, len);
+
+	// Write returns before the end of transmission. The bus is busy until the last character is sent.
+	uint32_t txTimeuS = len * _timing.CharuS;
+	_busSilentMicros = micros() + txTimeuS;
+	_txTimeMs = txTimeuS / 1000 + 1;
+	_sentMillis = millis();
+
+	for (uint8_t i = 0; i < MODBUS_MASTER_QUEUE_SIZE; i++)
+	{
+		if (_slots[i].State == SlotActive)
+		{
+			_slots[i].Request.SentMillis = _sentMillis;
+		}
+	}
+
+	++_stats.Frames;
+
+	_state = _frameSlave == MODBUS_BROADCAST_ID ? MasterWaitBroadcast : MasterWaitResponse;
+}
+
+/**
+* @brief Calculate length of a normal response for the current frame.
+*
+* @return uint16_t Response length with CRC.
+*/
+uint16_t KMPModbusMasterClass::expectedResponseLen()
+{
+	switch (_frameFunction)
+	{
+	case ModbusReadCoils:
+	case ModbusReadDiscreteInputs:
+		return 5 + (_frameCount + 7) / 8;
+	case ModbusReadHoldingRegisters:
+	case ModbusReadInputRegisters:
+		return 5 + _frameCount * 2;
+	case ModbusWriteSingleCoil:
+	case ModbusWriteSingleRegister:
+	case ModbusWriteMultipleCoils:
+	case ModbusWriteMultipleRegisters:
+		return MODBUS_WRITE_RESPONSE_LEN;
+	default:
+		// Unknown function in a raw request. The response ends with t3.5 silence.
+		return MODBUS_MAX_FRAME + 1;
+	}
+}
+
+void KMPModbusMasterClass::receive()
+{
+	while (_serial->available())
+	{
+		int b = _serial->read();
+		if (b < 0)
+		{
+			break;
+		}
+
+		if (_rxLen < MODBUS_MAX_FRAME)
+		{
+			_rxFrame[_rxLen++] = (uint8_t)b;
+		}
+		_busSilentMicros = micros();
+	}
+
+	if (_rxLen == 0)
+	{
+		if (millis() - _sentMillis >= _txTimeMs + _responseTimeoutMs)
+		{
+			++_stats.Timeouts;
+			if (_slaveFails[_frameSlave] < 0xFF)
+			{
+				++_slaveFails[_frameSlave];
+			}
+
+			_state = MasterIdle;
+			finishActive(ModbusResultTimeout, 0);
+		}
+		return;
+	}
+
+	uint16_t expected = _expectedLen;
+	if (_rxLen >= 2 && (_rxFrame[1] & MODBUS_EXCEPTION_FLAG))
+	{
+		expected = MODBUS_EXCEPTION_LEN;
+	}
+
+	// Complete frame by expected length or by t3.5 silence when the frame is shorter.
+	if (_rxLen >= expected || (long)(micros() - _busSilentMicros) >= (long)_timing.T35uS)
+	{
+		completeFrame();
+	}
+}
+
+void KMPModbusMasterClass::completeFrame()
+{
+	_state = MasterIdle;
+
+	if (!modbusCheckCRC(_rxFrame, _rxLen))
+	{
+		++_stats.CrcErrors;
+		finishActive(ModbusResultCrcError, 0);
+		return;
+	}
+
+	if (_rxFrame[0] != _frameSlave || (_rxFrame[1] & ~MODBUS_EXCEPTION_FLAG) != _frameFunction)
+	{
+		++_stats.FrameErrors;
+		finishActive(ModbusResultFrameError, 0);
+		return;
+	}
+
+	// The slave responds.
+	_slaveFails[_frameSlave] = 0;
+	++_stats.Responses;
+
+	if (_rxFrame[1] & MODBUS_EXCEPTION_FLAG)
+	{
+		++_stats.Exceptions;
+		finishActive(ModbusResultException, _rxFrame[2]);
+		return;
+	}
+
+	bool valid;
+	if (_frameRaw)
+	{
+		// Raw response is checked by the requester.
+		valid = true;
+	}
+	else if (isReadFunction(_frameFunction))
+	{
+		valid = _rxLen == _expectedLen && _rxFrame[2] == _expectedLen - 5;
+	}
+	else
+	{
+		valid = _rxLen == MODBUS_WRITE_RESPONSE_LEN && modbusGetUInt16(&_rxFrame[2]) == _frameAddress;
+	}
+
+	if (!valid)
+	{
+		++_stats.FrameErrors;
+		finishActive(ModbusResultFrameError, 0);
+		return;
+	}
+
+	finishActive(ModbusResultOK, 0);
+}
+
+void KMPModbusMasterClass::finishActive(ModbusResult result, uint8_t exception)
+{
+	_stats.BusyMs += millis() - _sentMillis;
+
+	for (uint8_t i = 0; i < MODBUS_MASTER_QUEUE_SIZE; i++)
+	{
+		if (_slots[i].State == SlotActive)
+		{
+			finishSlot(i, result, exception);
+		}
+	}
+}
+
+void KMPModbusMasterClass::finishSlot(uint8_t index, ModbusResult result, uint8_t exception)
+{
+	// The callback can add a new request in the freed slot.
+	ModbusRequest_t request = _slots[index].Request;
+	_slots[index].State = SlotFree;
+
+	request.Exception = exception;
+
+	if (request.Pdu != NULL)
+	{
+		// Raw response PDU without slave address and CRC.
+		uint16_t pduLen = 0;
+		// Nothing is received after a broadcast.
+		if ((result == ModbusResultOK || result == ModbusResultException) && _rxLen > 3)
+		{
+			pduLen = min((uint16_t)(_rxLen - 3), request.Count);
+			memcpy(request.Data, &_rxFrame[1], pduLen);
+		}
+		request.Count = pduLen;
+	}
+	else if (result == ModbusResultOK && isReadFunction(request.Function))
+	{
+		copyReadData(request, &_rxFrame[3]);
+	}
+
+	if (request.Callback != NULL)
+	{
+		request.Callback(request, result);
+	}
+}
+
+/**
+* @brief Copy the request part from the response data.
+*
+* @param request Request.
+* @param data Response data after the byte count.
+*
+* @return void
+*/
+void KMPModbusMasterClass::copyReadData(const ModbusRequest_t& request, const uint8_t* data)
+{
+	uint16_t offset = request.Address - _frameAddress;
+
+	if (isBitFunction(request.Function))
+	{
+		uint8_t* bits = (uint8_t*)request.Data;
+		memset(bits, 0, (request.Count + 7) / 8);
+
+		for (uint16_t i = 0; i < request.Count; i++)
+		{
+			uint16_t bit = offset + i;
+			if (data[bit >> 3] & (1 << (bit & 0x07)))
+			{
+				bits[i >> 3] |= 1 << (i & 0x07);
+			}
+		}
+	}
+	else
+	{
+		uint16_t* registers = (uint16_t*)request.Data;
+		for (uint16_t i = 0; i < request.Count; i++)
+		{
+			registers[i] = modbusGetUInt16(&data[(offset + i) * 2]);
+		}
+	}
+}
@@ -0,0 +1,323 @@
+// KMPModbusMaster.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Modbus RTU master over RS485. Requests are queued and served by process() without blocking the loop.
+//		Queued reads of adjacent registers (coils) from the same slave are sent as one request.
+//		The next request is sent as soon as the bus is silent for t3.5 after the response. Responses are completed by their expected length, not by a timeout.
+//		A slave which doesn't respond doesn't stop the requests to other slaves.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPMODBUSMASTER_H
+#define _KMPMODBUSMASTER_H
+
+#include "KMPModbus.h"
+
+// Max queued requests.
+#ifndef MODBUS_MASTER_QUEUE_SIZE
+#define MODBUS_MASTER_QUEUE_SIZE 16
+#endif
+
+#define MODBUS_MASTER_RESPONSE_TIMEOUT_MS 200
+#define MODBUS_MASTER_BROADCAST_DELAY_MS  100
+// After this count of consecutive timeouts the requests to the slave are sent only if there are no requests to other slaves.
+#define MODBUS_MASTER_SLOW_SLAVE_FAILS    2
+
+/**
+ * @brief Request result.
+ */
+enum ModbusResult {
+	ModbusResultOK = 0,
+	ModbusResultTimeout,
+	ModbusResultCrcError,
+	ModbusResultFrameError,
+	ModbusResultException,
+	// The request isn't sent before its deadline. See KMPModbusScheduler.
+	ModbusResultExpired
+};
+
+struct ModbusRequest_t;
+
+/**
+ * @brief Called when the request is finished.
+ *
+ * @param request Finished request. For reads Data contains the received values.
+ * @param result Result.
+ */
+typedef void (*ModbusMasterCallback)(const ModbusRequest_t& request, ModbusResult result);
+
+/**
+ * @brief Modbus master request.
+ */
+struct ModbusRequest_t {
+	uint8_t SlaveId;
+	// ModbusFunction.
+	uint8_t Function;
+	uint16_t Address;
+	uint16_t Count;
+	// Registers - uint16_t[Count], coils and discrete inputs - packed bits uint8_t[(Count + 7) / 8], bit 0 is the first item.
+	void* Data;
+	// Value for write single coil and single register.
+	uint16_t Value;
+	// Slave exception code if the result is ModbusResultException.
+	uint8_t Exception;
+	ModbusMasterCallback Callback;
+	// User argument.
+	void* Arg;
+	// Raw request PDU (function code and data), NULL for other requests. See request().
+	const uint8_t* Pdu;
+	uint8_t PduLen;
+	// millis() when the request is queued and when it is transmitted.
+	unsigned long QueuedMillis;
+	unsigned long SentMillis;
+};
+
+/**
+ * @brief Master statistics.
+ */
+struct ModbusMasterStats_t {
+	// Accepted requests.
+	uint32_t Requests;
+	// Transmitted frames. Less than Requests if requests are coalesced.
+	uint32_t Frames;
+	uint32_t Responses;
+	uint32_t Timeouts;
+	uint32_t CrcErrors;
+	uint32_t FrameErrors;
+	uint32_t Exceptions;
+	// Requests served by another request frame.
+	uint32_t Coalesced;
+	// Time the bus is occupied by requests and responses.
+	uint32_t BusyMs;
+};
+
+class KMPModbusMasterClass
+{
+ public:
+	KMPModbusMasterClass();
+
+	/**
+	* @brief Start the master. The serial must be started before with the same baud and configuration.
+	*
+	* @param serial Serial port. RS485Serial on ProDino ESP32.
+	* @param baud Speed.
+	* @param config Configuration - SERIAL_8N1, SERIAL_8E1 ...
+	*
+	* @return void
+	*/
+	void begin(Stream& serial, unsigned long baud, uint32_t config = SERIAL_8N1);
+
+	/**
+	* @brief Response timeout. Default MODBUS_MASTER_RESPONSE_TIMEOUT_MS.
+	*
+	* @param timeoutMs Time after the end of request transmission.
+	*
+	* @return void
+	*/
+	void setResponseTimeout(unsigned long timeoutMs) { _responseTimeoutMs = timeoutMs; }
+
+	/**
+	* @brief Wait time after a broadcast request. Default MODBUS_MASTER_BROADCAST_DELAY_MS.
+	*
+	* @param delayMs Time in milliseconds.
+	*
+	* @return void
+	*/
+	void setBroadcastDelay(unsigned long delayMs) { _broadcastDelayMs = delayMs; }
+
+	/**
+	* @brief Max count of not requested registers (coils) between two reads which can be coalesced. Default 0 - only adjacent reads.
+	*
+	* @param gap Registers (coils) count. 0xFFFF - coalescing is disabled.
+	*
+	* @return void
+	*/
+	void setCoalesceGap(uint16_t gap) { _coalesceGap = gap; }
+
+	/**
+	* @brief Read coils (FC01).
+	*
+	* @param slaveId Slave address 1-247.
+	* @param address First coil.
+	* @param count Coils count.
+	* @param bits Result packed bits. It must be valid until the callback.
+	* @param callback Called when the request is finished.
+	* @param arg User argument.
+	*
+	* @return int Request handle, -1 if the queue is full or parameters are not valid.
+	*/
+	int readCoils(uint8_t slaveId, uint16_t address, uint16_t count, uint8_t* bits, ModbusMasterCallback callback, void* arg = NULL);
+
+	/**
+	* @brief Read discrete inputs (FC02). Parameters are the same as readCoils.
+	*/
+	int readDiscreteInputs(uint8_t slaveId, uint16_t address, uint16_t count, uint8_t* bits, ModbusMasterCallback callback, void* arg = NULL);
+
+	/**
+	* @brief Read holding registers (FC03).
+	*
+	* @param slaveId Slave address 1-247.
+	* @param address First register.
+	* @param count Registers count.
+	* @param registers Result. It must be valid until the callback.
+	* @param callback Called when the request is finished.
+	* @param arg User argument.
+	*
+	* @return int Request handle, -1 if the queue is full or parameters are not valid.
+	*/
+	int readHoldingRegisters(uint8_t slaveId, uint16_t address, uint16_t count, uint16_t* registers, ModbusMasterCallback callback, void* arg = NULL);
+
+	/**
+	* @brief Read input registers (FC04). Parameters are the same as readHoldingRegisters.
+	*/
+	int readInputRegisters(uint8_t slaveId, uint16_t address, uint16_t count, uint16_t* registers, ModbusMasterCallback callback, void* arg = NULL);
+
+	/**
+	* @brief Write single coil (FC05). Slave 0 is broadcast.
+	*
+	* @return int Request handle, -1 if the queue is full or parameters are not valid.
+	*/
+	int writeSingleCoil(uint8_t slaveId, uint16_t address, bool state, ModbusMasterCallback callback = NULL, void* arg = NULL);
+
+	/**
+	* @brief Write single register (FC06). Slave 0 is broadcast.
+	*
+	* @return int Request handle, -1 if the queue is full or parameters are not valid.
+	*/
+	int writeSingleRegister(uint8_t slaveId, uint16_t address, uint16_t value, ModbusMasterCallback callback = NULL, void* arg = NULL);
+
+	/**
+	* @brief Write multiple coils (FC15). Slave 0 is broadcast.
+	*
+	* @param bits Packed bits. It must be valid until the callback.
+	*
+	* @return int Request handle, -1 if the queue is full or parameters are not valid.
+	*/
+	int writeMultipleCoils(uint8_t slaveId, uint16_t address, uint16_t count, const uint8_t* bits, ModbusMasterCallback callback = NULL, void* arg = NULL);
+
+	/**
+	* @brief Write multiple registers (FC16). Slave 0 is broadcast.
+	*
+	* @param registers Values. It must be valid until the callback.
+	*
+	* @return int Request handle, -1 if the queue is full or parameters are not valid.
+	*/
+	int writeMultipleRegisters(uint8_t slaveId, uint16_t address, uint16_t count, const uint16_t* registers, ModbusMasterCallback callback = NULL, void* arg = NULL);
+
+	/**
+	* @brief Send a raw request. The response is not checked except CRC, slave and function code. Raw requests are never coalesced.
+	*
+	* @param slaveId Slave address 0-247. 0 - broadcast.
+	* @param pdu Request PDU: function code and data. It must be valid until the callback.
+	* @param pduLen PDU length.
+	* @param response Buffer for the response PDU (normal or exception). In the callback request.Count is the response PDU length.
+	* @param responseSize Response buffer size.
+	* @param callback Called when the request is finished.
+	* @param arg User argument.
+	*
+	* @return int Request handle, -1 if the queue is full or parameters are not valid.
+	*/
+	int request(uint8_t slaveId, const uint8_t* pdu, uint8_t pduLen, uint8_t* response, uint8_t responseSize, ModbusMasterCallback callback, void* arg = NULL);
+
+	/**
+	* @brief Serve the queue. Call it in the loop as often as possible. It never waits.
+	*
+	* @return void
+	*/
+	void process();
+
+	/**
+	* @brief Check if there are requests in the queue or a request is in progress.
+	*
+	* @return bool true - busy.
+	*/
+	bool isBusy();
+
+	/**
+	* @brief Get count of requests in the queue including the current request.
+	*
+	* @return uint8_t Requests count.
+	*/
+	uint8_t pending();
+
+	/**
+	* @brief Get frame timing.
+	*
+	* @return const ModbusTiming_t& Timing.
+	*/
+	const ModbusTiming_t& getTiming() { return _timing; }
+
+	/**
+	* @brief Get statistics.
+	*
+	* @return const ModbusMasterStats_t& Statistics.
+	*/
+	const ModbusMasterStats_t& getStats() { return _stats; }
+
+	/**
+	* @brief Reset statistics.
+	*
+	* @return void
+	*/
+	void resetStats();
+
+ private:
+	enum SlotState { SlotFree = 0, SlotPending, SlotActive };
+	enum MasterState { MasterIdle = 0, MasterWaitResponse, MasterWaitBroadcast };
+
+	struct Slot_t {
+		ModbusRequest_t Request;
+		uint8_t State;
+		uint32_t Order;
+	};
+
+	Stream* _serial;
+	ModbusTiming_t _timing;
+	unsigned long _responseTimeoutMs;
+	unsigned long _broadcastDelayMs;
+	uint16_t _coalesceGap;
+
+	Slot_t _slots[MODBUS_MASTER_QUEUE_SIZE];
+	uint32_t _order;
+	// Consecutive timeouts per slave.
+	uint8_t _slaveFails[MODBUS_MAX_SLAVE_ID + 1];
+
+	uint8_t _state;
+	// Current frame.
+	uint8_t _frameSlave;
+	uint8_t _frameFunction;
+	uint16_t _frameAddress;
+	uint16_t _frameCount;
+	bool _frameRaw;
+	uint16_t _expectedLen;
+	unsigned long _sentMillis;
+	// Request transmission time.
+	unsigned long _txTimeMs;
+	// micros() when the bus became silent - end of last transmitted or received byte.
+	unsigned long _busSilentMicros;
+
+	uint8_t _txFrame[MODBUS_MAX_FRAME];
+	uint8_t _rxFrame[MODBUS_MAX_FRAME];
+	uint16_t _rxLen;
+
+	ModbusMasterStats_t _stats;
+
+	int allocSlot();
+	int addRequest(uint8_t slaveId, uint8_t function, uint16_t address, uint16_t count, void* data, uint16_t value, ModbusMasterCallback callback, void* arg);
+	int selectNext();
+	void coalesce(uint8_t first);
+	uint16_t buildFrame(const ModbusRequest_t& req);
+	void sendFrame(uint8_t first);
+	void receive();
+	void completeFrame();
+	void finishActive(ModbusResult result, uint8_t exception);
+	void finishSlot(uint8_t index, ModbusResult result, uint8_t exception);
+	void copyReadData(const ModbusRequest_t& request, const uint8_t* data);
+	uint16_t expectedResponseLen();
+};
+
+extern KMPModbusMasterClass KMPModbusMaster;
+
+#endif
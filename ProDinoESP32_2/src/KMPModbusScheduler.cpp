@@ -0,0 +1,584 @@
+// KMPModbusScheduler.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		RS485 transaction scheduler on top of KMPModbusMaster.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPModbusScheduler.h"
+#include <limits.h>
+
+KMPModbusSchedulerClass KMPModbusScheduler;
+
+KMPModbusSchedulerClass::KMPModbusSchedulerClass() :
+	_master(NULL),
+	_active(-1),
+	_slavesCount(0)
+{
+	memset(_jobs, 0, sizeof(_jobs));
+	memset(_slaves, 0, sizeof(_slaves));
+	_statsMillis = 0;
+}
+
+void KMPModbusSchedulerClass::begin(KMPModbusMasterClass& master)
+{
+	_master = &master;
+	_active = -1;
+
+	resetStats();
+}
+
+void KMPModbusSchedulerClass::resetStats()
+{
+	for (uint8_t i = 0; i < _slavesCount; i++)
+	{
+		uint8_t slaveId = _slaves[i].SlaveId;
+		memset(&_slaves[i], 0, sizeof(_slaves[i]));
+		_slaves[i].SlaveId = slaveId;
+	}
+
+	_statsMillis = millis();
+}
+
+int KMPModbusSchedulerClass::addPeriodic(uint8_t slaveId, uint8_t function, uint16_t address, uint16_t count, void* data, unsigned long periodMs,
+	uint8_t priority, ModbusMasterCallback callback, void* arg)
+{
+	if (periodMs == 0)
+	{
+		return -1;
+	}
+
+	int index = addJob(slaveId, function, address, count, data, priority, callback, arg);
+	if (index < 0)
+	{
+		return -1;
+	}
+
+	Job_t& job = _jobs[index];
+	job.Periodic = true;
+	job.PeriodMs = periodMs;
+
+	return index | (job.Sequence << 8);
+}
+
+int KMPModbusSchedulerClass::submit(uint8_t slaveId, uint8_t function, uint16_t address, uint16_t count, void* data,
+	uint8_t priority, unsigned long deadlineMs, ModbusMasterCallback callback, void* arg)
+{
+	int index = addJob(slaveId, function, address, count, data, priority, callback, arg);
+	if (index < 0)
+	{
+		return -1;
+	}
+
+	_jobs[index].DeadlineMs = deadlineMs;
+
+	int handle = index | (_jobs[index].Sequence << 8);
+
+	// The bus can be free, don't wait for the next process().
+	sendNext();
+
+	return handle;
+}
+
+/**
+* @brief Find the job of a handle. A handle of a finished job doesn't match the sequence of a new job in the same place.
+*
+* @return int Job index, -1 if the handle isn't valid.
+*/
+int KMPModbusSchedulerClass::findJob(int handle)
+{
+	if (handle < 0)
+	{
+		return -1;
+	}
+
+	int index = handle & 0xff;
+	if (index >= MODBUS_SCHEDULER_JOBS)
+	{
+		return -1;
+	}
+
+	Job_t& job = _jobs[index];
+	if (job.State == JobFree || job.Removed || job.Sequence != (uint16_t)(handle >> 8))
+	{
+		return -1;
+	}
+
+	return index;
+}
+
+/**
+* @brief Check parameters and add a ready job.
+*
+* @return int Job index, -1 if there is no free job or parameters are not valid.
+*/
+int KMPModbusSchedulerClass::addJob(uint8_t slaveId, uint8_t function, uint16_t address, uint16_t count, void* data, uint8_t priority, ModbusMasterCallback callback, void* arg)
+{
+	if (slaveId > MODBUS_MAX_SLAVE_ID || count == 0 || data == NULL)
+	{
+		return -1;
+	}
+
+	switch (function)
+	{
+	case ModbusReadCoils:
+	case ModbusReadDiscreteInputs:
+	case ModbusReadHoldingRegisters:
+	case ModbusReadInputRegisters:
+		// Reads can't be broadcast.
+		if (slaveId == MODBUS_BROADCAST_ID)
+		{
+			return -1;
+		}
+		break;
+	case ModbusWriteSingleCoil:
+	case ModbusWriteSingleRegister:
+		if (count != 1)
+		{
+			return -1;
+		}
+		break;
+	case ModbusWriteMultipleCoils:
+	case ModbusWriteMultipleRegisters:
+		break;
+	default:
+		return -1;
+	}
+
+	for (uint8_t i = 0; i < MODBUS_SCHEDULER_JOBS; i++)
+	{
+		Job_t& job = _jobs[i];
+		if (job.State != JobFree)
+		{
+			continue;
+		}
+
+		uint16_t sequence = job.Sequence + 1;
+		memset(&job, 0, sizeof(job));
+		job.Sequence = sequence;
+		job.State = JobReady;
+		job.Priority = priority;
+		job.SlaveId = slaveId;
+		job.Function = function;
+		job.Address = address;
+		job.Count = count;
+		job.Data = data;
+		job.DueMillis = millis();
+		job.Callback = callback;
+		job.Arg = arg;
+
+		findSlave(slaveId, true);
+
+		return i;
+	}
+
+	return -1;
+}
+
+bool KMPModbusSchedulerClass::setPeriod(int handle, unsigned long periodMs)
+{
+	int index = findJob(handle);
+	if (index < 0 || periodMs == 0)
+	{
+		return false;
+	}
+
+	Job_t& job = _jobs[index];
+	if (!job.Periodic)
+	{
+		return false;
+	}
+
+	job.PeriodMs = periodMs;
+
+	return true;
+}
+
+bool KMPModbusSchedulerClass::remove(int handle)
+{
+	int index = findJob(handle);
+	if (index < 0)
+	{
+		return false;
+	}
+
+	Job_t& job = _jobs[index];
+
+	// The job in progress is freed when the master finishes it.
+	if (job.State == JobActive)
+	{
+		job.Removed = true;
+	}
+	else
+	{
+		job.State = JobFree;
+	}
+
+	return true;
+}
+
+uint8_t KMPModbusSchedulerClass::pending()
+{
+	uint8_t result = 0;
+	for (uint8_t i = 0; i < MODBUS_SCHEDULER_JOBS; i++)
+	{
+		if (_jobs[i].State != JobFree && !_jobs[i].Periodic && !_jobs[i].Removed)
+		{
+			++result;
+		}
+	}
+
+	return result;
+}
+
+void KMPModbusSchedulerClass::process()
+{
+	if (_master == NULL)
+	{
+		return;
+	}
+
+	sendNext();
+
+	// The next job is sent from the completion callback.
+	_master->process();
+}
+
+/**
+* @brief Finish one-shot jobs which are not sent before their deadline.
+*
+* @return void
+*/
+void KMPModbusSchedulerClass::expireJobs()
+{
+	unsigned long now = millis();
+
+	for (uint8_t i = 0; i < MODBUS_SCHEDULER_JOBS; i++)
+	{
+		Job_t& job = _jobs[i];
+		if (job.State != JobReady || job.Periodic || job.DeadlineMs == 0 || now - job.DueMillis <= job.DeadlineMs)
+		{
+			continue;
+		}
+
+		ModbusSchedulerSlaveStats_t* slave = findSlave(job.SlaveId, false);
+		if (slave != NULL)
+		{
+			++slave->Expired;
+		}
+
+		ModbusRequest_t request;
+		memset(&request, 0, sizeof(request));
+		request.SlaveId = job.SlaveId;
+		request.Function = job.Function;
+		request.Address = job.Address;
+		request.Count = job.Count;
+		request.Data = job.Data;
+		request.QueuedMillis = job.DueMillis;
+
+		finishJob(i, request, ModbusResultExpired);
+	}
+}
+
+/**
+* @brief Select the ready job with the highest priority. The earliest deadline and then the oldest job wins between equal priorities.
+*        The deadline of a periodic job is its next due time.
+*
+* @return int Job index, -1 if there are no ready jobs.
+*/
+int KMPModbusSchedulerClass::selectNext()
+{
+	unsigned long now = millis();
+	int result = -1;
+	long resultRemain = 0;
+
+	for (uint8_t i = 0; i < MODBUS_SCHEDULER_JOBS; i++)
+	{
+		Job_t& job = _jobs[i];
+		if (job.State != JobReady || (job.Periodic && (long)(now - job.DueMillis) < 0))
+		{
+			continue;
+		}
+
+		long remain = LONG_MAX;
+		if (job.Periodic)
+		{
+			remain = (long)(job.DueMillis + job.PeriodMs - now);
+		}
+		else if (job.DeadlineMs > 0)
+		{
+			remain = (long)(job.DueMillis + job.DeadlineMs - now);
+		}
+
+		if (result >= 0)
+		{
+			Job_t& best = _jobs[result];
+			if (job.Priority < best.Priority)
+			{
+				continue;
+			}
+
+			if (job.Priority == best.Priority &&
+				(remain > resultRemain || (remain == resultRemain && (long)(job.DueMillis - best.DueMillis) >= 0)))
+			{
+				continue;
+			}
+		}
+
+		result = i;
+		resultRemain = remain;
+	}
+
+	return result;
+}
+
+/**
+* @brief Give the next job to the master if the bus is free.
+*
+* @return void
+*/
+void KMPModbusSchedulerClass::sendNext()
+{
+	if (_master == NULL || _active >= 0 || _master->isBusy())
+	{
+		return;
+	}
+
+	expireJobs();
+
+	// A callback of an expired job can send a new job.
+	int next;
+	while (_active < 0 && (next = selectNext()) >= 0)
+	{
+		if (sendJob(next) >= 0)
+		{
+			return;
+		}
+
+		// The master is free, so the job parameters are not valid.
+		ModbusRequest_t request;
+		memset(&request, 0, sizeof(request));
+		request.SlaveId = _jobs[next].SlaveId;
+		request.Function = _jobs[next].Function;
+		request.Address = _jobs[next].Address;
+
+		// The job is freed, also if it is periodic.
+		_jobs[next].Periodic = false;
+		finishJob(next, request, ModbusResultFrameError);
+	}
+}
+
+/**
+* @brief Add the job to the master queue.
+*
+* @param index Job index.
+*
+* @return int Master request handle, -1 if the master doesn't accept the job.
+*/
+int KMPModbusSchedulerClass::sendJob(uint8_t index)
+{
+	Job_t& job = _jobs[index];
+	Job_t* arg = &job;
+	int result = -1;
+
+	switch (job.Function)
+	{
+	case ModbusReadCoils:
+		result = _master->readCoils(job.SlaveId, job.Address, job.Count, (uint8_t*)job.Data, onComplete, arg);
+		break;
+	case ModbusReadDiscreteInputs:
+		result = _master->readDiscreteInputs(job.SlaveId, job.Address, job.Count, (uint8_t*)job.Data, onComplete, arg);
+		break;
+	case ModbusReadHoldingRegisters:
+		result = _master->readHoldingRegisters(job.SlaveId, job.Address, job.Count, (uint16_t*)job.Data, onComplete, arg);
+		break;
+	case ModbusReadInputRegisters:
+		result = _master->readInputRegisters(job.SlaveId, job.Address, job.Count, (uint16_t*)job.Data, onComplete, arg);
+		break;
+	case ModbusWriteSingleCoil:
+		result = _master->writeSingleCoil(job.SlaveId, job.Address, *(uint8_t*)job.Data & 0x01, onComplete, arg);
+		break;
+	case ModbusWriteSingleRegister:
+		result = _master->writeSingleRegister(job.SlaveId, job.Address, *(uint16_t*)job.Data, onComplete, arg);
+		break;
+	case ModbusWriteMultipleCoils:
+		result = _master->writeMultipleCoils(job.SlaveId, job.Address, job.Count, (uint8_t*)job.Data, onComplete, arg);
+		break;
+	case ModbusWriteMultipleRegisters:
+		result = _master->writeMultipleRegisters(job.SlaveId, job.Address, job.Count, (uint16_t*)job.Data, onComplete, arg);
+		break;
+	}
+
+	if (result < 0)
+	{
+		return -1;
+	}
+
+	job.State = JobActive;
+	_active = index;
+
+	ModbusSchedulerSlaveStats_t* slave = findSlave(job.SlaveId, false);
+	if (slave != NULL)
+	{
+		++slave->Requests;
+	}
+
+	if (job.Periodic)
+	{
+		// Keep the rate: the next due time is counted from this due time.
+		// Periods missed because the bus was busy are skipped.
+		unsigned long missed = (millis() - job.DueMillis) / job.PeriodMs;
+		if (missed > 0 && slave != NULL)
+		{
+			slave->Expired += missed;
+		}
+
+		job.DueMillis += (missed + 1) * job.PeriodMs;
+	}
+
+	return result;
+}
+
+void KMPModbusSchedulerClass::onComplete(const ModbusRequest_t& request, ModbusResult result)
+{
+	KMPModbusScheduler.completeJob((Job_t*)request.Arg - KMPModbusScheduler._jobs, request, result);
+}
+
+void KMPModbusSchedulerClass::completeJob(uint8_t index, const ModbusRequest_t& request, ModbusResult result)
+{
+	_active = -1;
+
+	Job_t& job = _jobs[index];
+
+	ModbusSchedulerSlaveStats_t* slave = findSlave(job.SlaveId, false);
+	if (slave != NULL)
+	{
+		switch (result)
+		{
+		case ModbusResultOK:
+		case ModbusResultException:
+			++slave->Responses;
+			if (job.Periodic)
+			{
+				++slave->Polls;
+			}
+
+			// Broadcast has no response.
+			if (job.SlaveId != MODBUS_BROADCAST_ID)
+			{
+				uint32_t responseTime = millis() - request.SentMillis;
+				slave->ResponseTimeTotalMs += responseTime;
+				slave->ResponseTimeMaxMs = max(slave->ResponseTimeMaxMs, responseTime);
+			}
+			break;
+		case ModbusResultTimeout:
+			++slave->Timeouts;
+			break;
+		default:
+			++slave->Errors;
+			break;
+		}
+	}
+
+	ModbusRequest_t userRequest = request;
+	finishJob(index, userRequest, result);
+
+	// Send the next job right after this one, not in the next loop.
+	sendNext();
+}
+
+/**
+* @brief Free a one-shot or removed job, make a periodic job ready and call the user callback.
+*
+* @return void
+*/
+void KMPModbusSchedulerClass::finishJob(uint8_t index, ModbusRequest_t& request, ModbusResult result)
+{
+	Job_t& job = _jobs[index];
+
+	// The callback can add a new job in the freed place.
+	ModbusMasterCallback callback = job.Callback;
+	void* arg = job.Arg;
+	bool removed = job.Removed;
+
+	job.State = job.Periodic && !removed ? JobReady : JobFree;
+
+	if (removed || callback == NULL)
+	{
+		return;
+	}
+
+	request.Callback = callback;
+	request.Arg = arg;
+	callback(request, result);
+}
+
+ModbusSchedulerSlaveStats_t* KMPModbusSchedulerClass::findSlave(uint8_t slaveId, bool add)
+{
+	for (uint8_t i = 0; i < _slavesCount; i++)
+	{
+		if (_slaves[i].SlaveId == slaveId)
+		{
+			return &_slaves[i];
+		}
+	}
+
+	if (!add || _slavesCount >= MODBUS_SCHEDULER_SLAVES)
+	{
+		return NULL;
+	}
+
+	ModbusSchedulerSlaveStats_t* result = &_slaves[_slavesCount++];
+	memset(result, 0, sizeof(*result));
+	result->SlaveId = slaveId;
+
+	return result;
+}
+
+const ModbusSchedulerSlaveStats_t* KMPModbusSchedulerClass::getSlaveStats(uint8_t slaveId)
+{
+	return findSlave(slaveId, false);
+}
+
+uint32_t KMPModbusSchedulerClass::getAverageResponseTimeMs(uint8_t slaveId)
+{
+	ModbusSchedulerSlaveStats_t* slave = findSlave(slaveId, false);
+
+	return slave != NULL && slave->Responses ? slave->ResponseTimeTotalMs / slave->Responses : 0;
+}
+
+uint8_t KMPModbusSchedulerClass::getTimeoutRate(uint8_t slaveId)
+{
+	ModbusSchedulerSlaveStats_t* slave = findSlave(slaveId, false);
+
+	return slave != NULL && slave->Requests ? (uint8_t)((uint64_t)slave->Timeouts * 100 / slave->Requests) : 0;
+}
+
+float KMPModbusSchedulerClass::getTargetPollRate(uint8_t slaveId)
+{
+	float result = 0;
+	for (uint8_t i = 0; i < MODBUS_SCHEDULER_JOBS; i++)
+	{
+		Job_t& job = _jobs[i];
+		if (job.State != JobFree && job.Periodic && !job.Removed && job.SlaveId == slaveId)
+		{
+			result += 1000.0f / job.PeriodMs;
+		}
+	}
+
+	return result;
+}
+
+float KMPModbusSchedulerClass::getPollRate(uint8_t slaveId)
+{
+	ModbusSchedulerSlaveStats_t* slave = findSlave(slaveId, false);
+	unsigned long elapsed = millis() - _statsMillis;
+	if (slave == NULL || elapsed == 0)
+	{
+		return 0;
+	}
+
+	return slave->Polls * 1000.0f / elapsed;
+}
@@ -0,0 +1,259 @@
+// KMPModbusScheduler.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		RS485 transaction scheduler on top of KMPModbusMaster. Periodic polls are sent with their rate,
+//		one-shot requests (operator commands) are sent with their priority and deadline.
+//		Only one request is given to the master at a time, so a request with higher priority is the next frame on the bus.
+//		Statistics per slave: response time, timeout rate and achieved poll rate versus target.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPMODBUSSCHEDULER_H
+#define _KMPMODBUSSCHEDULER_H
+
+#include "KMPModbusMaster.h"
+
+// Max periodic and one-shot jobs.
+#ifndef MODBUS_SCHEDULER_JOBS
+#define MODBUS_SCHEDULER_JOBS 48
+#endif
+
+// The job index is the low byte of a handle.
+#if MODBUS_SCHEDULER_JOBS > 256
+#error MODBUS_SCHEDULER_JOBS must be 256 or less
+#endif
+
+// Max slaves with statistics.
+#ifndef MODBUS_SCHEDULER_SLAVES
+#define MODBUS_SCHEDULER_SLAVES 32
+#endif
+
+/**
+ * @brief Job priority. The highest ready priority is sent first, the earliest deadline wins between equal priorities.
+ */
+enum ModbusPriority {
+	ModbusPriorityLow = 0,
+	ModbusPriorityNormal,
+	ModbusPriorityHigh,
+	// Operator commands. They are sent right after the current frame.
+	ModbusPriorityOperator
+};
+
+/**
+ * @brief Statistics of one slave.
+ */
+struct ModbusSchedulerSlaveStats_t {
+	uint8_t SlaveId;
+	// Sent requests.
+	uint32_t Requests;
+	// Normal and exception responses.
+	uint32_t Responses;
+	uint32_t Timeouts;
+	// CRC and frame errors.
+	uint32_t Errors;
+	// One-shot requests not sent before the deadline and periodic polls skipped because the bus was busy for a whole period.
+	uint32_t Expired;
+	// Periodic polls with a response.
+	uint32_t Polls;
+	// Time from request transmission to the end of response.
+	uint32_t ResponseTimeMaxMs;
+	uint32_t ResponseTimeTotalMs;
+};
+
+class KMPModbusSchedulerClass
+{
+ public:
+	KMPModbusSchedulerClass();
+
+	/**
+	* @brief Start the scheduler. The master must be started before.
+	*
+	* @param master RTU master.
+	*
+	* @return void
+	*/
+	void begin(KMPModbusMasterClass& master);
+
+	/**
+	* @brief Add a periodic job. The job is sent every periodMs, the period is counted from the previous due time, not from the response.
+	*
+	* @param slaveId Slave address 1-247. 0 (broadcast) only for writes.
+	* @param function ModbusFunction.
+	* @param address First coil (register).
+	* @param count Coils (registers) count.
+	* @param data Registers - uint16_t[count], coils and discrete inputs - packed bits. It must be valid while the job exists.
+	*             For write single coil (register) count is 1 and data is the value.
+	* @param periodMs Period in milliseconds.
+	* @param priority ModbusPriority.
+	* @param callback Called after every poll.
+	* @param arg User argument.
+	*
+	* @return int Job handle, -1 if there is no free job or parameters are not valid.
+	*         The handle isn't valid after the job is finished or removed, also if its place is taken by a new job.
+	*/
+	int addPeriodic(uint8_t slaveId, uint8_t function, uint16_t address, uint16_t count, void* data, unsigned long periodMs,
+		uint8_t priority = ModbusPriorityNormal, ModbusMasterCallback callback = NULL, void* arg = NULL);
+
+	/**
+	* @brief Submit a one-shot job. Parameters are the same as addPeriodic.
+	*
+	* @param deadlineMs The job must be sent within this time or it is finished with ModbusResultExpired. 0 - no deadline.
+	*
+	* @return int Job handle, -1 if there is no free job or parameters are not valid.
+	*         The handle isn't valid after the job is finished or removed, also if its place is taken by a new job.
+	*/
+	int submit(uint8_t slaveId, uint8_t function, uint16_t address, uint16_t count, void* data,
+		uint8_t priority = ModbusPriorityOperator, unsigned long deadlineMs = 0, ModbusMasterCallback callback = NULL, void* arg = NULL);
+
+	/**
+	* @brief Change the period of a periodic job.
+	*
+	* @param handle Job handle.
+	* @param periodMs Period in milliseconds.
+	*
+	* @return bool true - the period is changed, false - the handle isn't valid or the job isn't periodic.
+	*/
+	bool setPeriod(int handle, unsigned long periodMs);
+
+	/**
+	* @brief Remove a job. A job in progress is finished, but its callback isn't called.
+	*
+	* @param handle Job handle.
+	*
+	* @return bool true - the job is removed, false - the handle isn't valid.
+	*/
+	bool remove(int handle);
+
+	/**
+	* @brief Send the due jobs and serve the master. Call it in the loop as often as possible instead of master process(). It never waits.
+	*
+	* @return void
+	*/
+	void process();
+
+	/**
+	* @brief Get count of one-shot jobs waiting or in progress.
+	*
+	* @return uint8_t Jobs count.
+	*/
+	uint8_t pending();
+
+	/**
+	* @brief Get count of slaves with statistics.
+	*
+	* @return uint8_t Slaves count.
+	*/
+	uint8_t slaves() { return _slavesCount; }
+
+	/**
+	* @brief Get slave statistics by index.
+	*
+	* @param index From 0 to slaves() - 1.
+	*
+	* @return const ModbusSchedulerSlaveStats_t& Statistics.
+	*/
+	const ModbusSchedulerSlaveStats_t& getSlaveStatsAt(uint8_t index) { return _slaves[index]; }
+
+	/**
+	* @brief Get slave statistics.
+	*
+	* @param slaveId Slave address.
+	*
+	* @return const ModbusSchedulerSlaveStats_t* Statistics, NULL if the slave has no jobs.
+	*/
+	const ModbusSchedulerSlaveStats_t* getSlaveStats(uint8_t slaveId);
+
+	/**
+	* @brief Get average response time of a slave.
+	*
+	* @param slaveId Slave address.
+	*
+	* @return uint32_t Time in milliseconds.
+	*/
+	uint32_t getAverageResponseTimeMs(uint8_t slaveId);
+
+	/**
+	* @brief Get timeout rate of a slave.
+	*
+	* @param slaveId Slave address.
+	*
+	* @return uint8_t Percent of the sent requests without response.
+	*/
+	uint8_t getTimeoutRate(uint8_t slaveId);
+
+	/**
+	* @brief Get target poll rate of a slave - sum of the rates of its periodic jobs.
+	*
+	* @param slaveId Slave address.
+	*
+	* @return float Polls per second.
+	*/
+	float getTargetPollRate(uint8_t slaveId);
+
+	/**
+	* @brief Get achieved poll rate of a slave since the last statistics reset.
+	*
+	* @param slaveId Slave address.
+	*
+	* @return float Polls with a response per second.
+	*/
+	float getPollRate(uint8_t slaveId);
+
+	/**
+	* @brief Reset statistics.
+	*
+	* @return void
+	*/
+	void resetStats();
+
+ private:
+	enum JobState { JobFree = 0, JobReady, JobActive };
+
+	struct Job_t {
+		uint8_t State;
+		// Changed when a new job takes the place, the high bits of the handle.
+		uint16_t Sequence;
+		// The job is removed while it is in progress.
+		bool Removed;
+		bool Periodic;
+		uint8_t Priority;
+		uint8_t SlaveId;
+		uint8_t Function;
+		uint16_t Address;
+		uint16_t Count;
+		void* Data;
+		unsigned long PeriodMs;
+		// Periodic - next send time, one-shot - submit time.
+		unsigned long DueMillis;
+		// 0 - no deadline.
+		unsigned long DeadlineMs;
+		ModbusMasterCallback Callback;
+		void* Arg;
+	};
+
+	KMPModbusMasterClass* _master;
+	Job_t _jobs[MODBUS_SCHEDULER_JOBS];
+	// Job in progress, -1 - none.
+	int _active;
+
+	ModbusSchedulerSlaveStats_t _slaves[MODBUS_SCHEDULER_SLAVES];
+	uint8_t _slavesCount;
+	unsigned long _statsMillis;
+
+	int findJob(int handle);
+	int addJob(uint8_t slaveId, uint8_t function, uint16_t address, uint16_t count, void* data, uint8_t priority, ModbusMasterCallback callback, void* arg);
+	void expireJobs();
+	int selectNext();
+	void sendNext();
+	int sendJob(uint8_t index);
+	static void onComplete(const ModbusRequest_t& request, ModbusResult result);
+	void completeJob(uint8_t index, const ModbusRequest_t& request, ModbusResult result);
+	void finishJob(uint8_t index, ModbusRequest_t& request, ModbusResult result);
+	ModbusSchedulerSlaveStats_t* findSlave(uint8_t slaveId, bool add);
+};
+
+extern KMPModbusSchedulerClass KMPModbusScheduler;
+
+#endif
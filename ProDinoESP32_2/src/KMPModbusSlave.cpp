@@ -0,0 +1,429 @@
+// KMPModbusSlave.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Modbus RTU slave over RS485.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPModbusSlave.h"
+#include "KMPProDinoESP32.h"
+
+KMPModbusSlaveClass KMPModbusSlave;
+
+// The snapshot, the written relays and the statistics are shared by the serial event task and the loop.
+static portMUX_TYPE _frameMux = portMUX_INITIALIZER_UNLOCKED;
+
+KMPModbusSlaveClass::KMPModbusSlaveClass() :
+	_serial(NULL),
+	_slaveId(1),
+	_rxLen(0),
+	_lastRxMicros(0),
+	_optoIns(0),
+	_coilsMask(0),
+	_coilsState(0)
+{
+	memset((void*)_inputRegisters, 0, sizeof(_inputRegisters));
+	memset(&_stats, 0, sizeof(_stats));
+}
+
+bool KMPModbusSlaveClass::begin(KMPRS485SerialClass& serial, uint8_t slaveId, unsigned long baud, uint32_t config)
+{
+	if (slaveId == MODBUS_BROADCAST_ID || slaveId > MODBUS_MAX_SLAVE_ID)
+	{
+		return false;
+	}
+
+	_serial = &serial;
+	_slaveId = slaveId;
+	_rxLen = 0;
+	modbusCalcTiming(baud, config, _timing);
+
+	// Inputs are valid for the first request.
+	process();
+
+#ifdef MODBUS_SLAVE_RX_EVENT
+	// RX timeout in characters, not less than t3.5.
+	uint32_t symbols = (_timing.T35uS + _timing.CharuS - 1) / _timing.CharuS;
+	_serial->setRxTimeout(symbols > 0xFF ? 0xFF : symbols);
+	// Called from the serial event task only on RX timeout - the end of the frame.
+	_serial->onReceive(onReceive, true);
+#endif
+
+	return true;
+}
+
+void KMPModbusSlaveClass::end()
+{
+#ifdef MODBUS_SLAVE_RX_EVENT
+	if (_serial != NULL)
+	{
+		_serial->onReceive(NULL);
+	}
+#endif
+	_serial = NULL;
+}
+
+void KMPModbusSlaveClass::onReceive()
+{
+	KMPModbusSlave.readFrame();
+	KMPModbusSlave.handleFrame();
+}
+
+void KMPModbusSlaveClass::process()
+{
+	if (_serial == NULL)
+	{
+		return;
+	}
+
+#ifndef MODBUS_SLAVE_RX_EVENT
+	if (_serial->available())
+	{
+		readFrame();
+	}
+
+	// The frame ends with t3.5 silence.
+	if (_rxLen > 0 && micros() - _lastRxMicros >= _timing.T35uS)
+	{
+		handleFrame();
+	}
+#endif
+
+	portENTER_CRITICAL(&_frameMux);
+	uint8_t mask = _coilsMask;
+	uint8_t state = _coilsState;
+	portEXIT_CRITICAL(&_frameMux);
+
+	// Relays are set and logged here, they are answered already.
+	for (uint8_t i = 0; i < MODBUS_SLAVE_COILS; i++)
+	{
+		if (mask & (1 << i))
+		{
+			KMPProDinoESP32.setRelayState(i, state & (1 << i), SourceRS485);
+		}
+	}
+
+	// The written relays are in the OLAT shadow now. Relays written again meanwhile wait for the next call.
+	portENTER_CRITICAL(&_frameMux);
+	_coilsMask &= ~(mask & ~(_coilsState ^ state));
+	portEXIT_CRITICAL(&_frameMux);
+
+	// Inputs are read from the expander (SPI) and logged only in the loop task.
+	uint8_t optoIns = 0;
+	for (uint8_t i = 0; i < MODBUS_SLAVE_DISCRETE_INPUTS; i++)
+	{
+		if (KMPProDinoESP32.getOptoInState(i))
+		{
+			optoIns |= 1 << i;
+		}
+	}
+
+	portENTER_CRITICAL(&_frameMux);
+	_optoIns = optoIns;
+	portEXIT_CRITICAL(&_frameMux);
+}
+
+ModbusSlaveStats_t KMPModbusSlaveClass::getStats()
+{
+	portENTER_CRITICAL(&_frameMux);
+	ModbusSlaveStats_t stats = _stats;
+	portEXIT_CRITICAL(&_frameMux);
+
+	return stats;
+}
+
+void KMPModbusSlaveClass::addStat(uint32_t& counter)
+{
+	portENTER_CRITICAL(&_frameMux);
+	++counter;
+	portEXIT_CRITICAL(&_frameMux);
+}
+
+/**
+* @brief Get the coils. Relays are taken from the expander OLAT shadow (no SPI transfer),
+*        the relays written by the master and not set yet have the written state.
+*
+* @return uint8_t Coils. Bit 0 - Relay1.
+*/
+uint8_t KMPModbusSlaveClass::getCoils()
+{
+	uint8_t relays = 0;
+	for (uint8_t i = 0; i < MODBUS_SLAVE_COILS; i++)
+	{
+		if (KMPProDinoESP32.getRelayState(i))
+		{
+			relays |= 1 << i;
+		}
+	}
+
+	portENTER_CRITICAL(&_frameMux);
+	relays = (relays & ~_coilsMask) | (_coilsState & _coilsMask);
+	portEXIT_CRITICAL(&_frameMux);
+
+	return relays;
+}
+
+/**
+* @brief Write a coil. The relay is set by process() in the loop task.
+*
+* @return void
+*/
+void KMPModbusSlaveClass::setCoil(uint16_t address, bool state)
+{
+	uint8_t bit = 1 << address;
+
+	portENTER_CRITICAL(&_frameMux);
+	_coilsMask |= bit;
+	_coilsState = state ? (_coilsState | bit) : (_coilsState & ~bit);
+	portEXIT_CRITICAL(&_frameMux);
+}
+
+void KMPModbusSlaveClass::setInputRegister(uint16_t address, uint16_t value)
+{
+	if (address < MODBUS_SLAVE_INPUT_REGISTERS)
+	{
+		portENTER_CRITICAL(&_frameMux);
+		_inputRegisters[address] = value;
+		portEXIT_CRITICAL(&_frameMux);
+	}
+}
+
+void KMPModbusSlaveClass::setInputRegister(uint16_t address, float value, uint16_t scale)
+{
+	float scaled = value * scale;
+	scaled = constrain(scaled, -32768.0f, 32767.0f);
+
+	setInputRegister(address, (uint16_t)(int16_t)lroundf(scaled));
+}
+
+uint16_t KMPModbusSlaveClass::getInputRegister(uint16_t address)
+{
+	return address < MODBUS_SLAVE_INPUT_REGISTERS ? _inputRegisters[address] : 0;
+}
+
+void KMPModbusSlaveClass::readFrame()
+{
+	if (_serial == NULL)
+	{
+		return;
+	}
+
+	int b;
+	while ((b = _serial->read()) >= 0)
+	{
+		// Too long frame is kept with the wrong length and it fails CRC check.
+		if (_rxLen < MODBUS_MAX_FRAME)
+		{
+			_rxFrame[_rxLen++] = (uint8_t)b;
+		}
+		_lastRxMicros = micros();
+	}
+}
+
+void KMPModbusSlaveClass::handleFrame()
+{
+	uint16_t len = _rxLen;
+	_rxLen = 0;
+
+	if (_serial == NULL || len == 0)
+	{
+		return;
+	}
+
+	if (!modbusCheckCRC(_rxFrame, len))
+	{
+		addStat(_stats.CrcErrors);
+		return;
+	}
+
+	uint8_t slaveId = _rxFrame[0];
+	if (slaveId != _slaveId && slaveId != MODBUS_BROADCAST_ID)
+	{
+		addStat(_stats.Ignored);
+		return;
+	}
+
+	addStat(_stats.Requests);
+
+	// All supported requests have address and count (value) - 8 bytes with CRC.
+	uint16_t address = len >= 8 ? modbusGetUInt16(&_rxFrame[2]) : 0;
+	uint16_t value = len >= 8 ? modbusGetUInt16(&_rxFrame[4]) : 0;
+	uint16_t respLen;
+
+	if (len < 8)
+	{
+		respLen = exception(ModbusIllegalDataValue);
+	}
+	else
+	{
+		switch (_rxFrame[1])
+		{
+		case ModbusReadCoils:
+			respLen = readBits(address, value, true);
+			break;
+		case ModbusReadDiscreteInputs:
+			respLen = readBits(address, value, false);
+			break;
+		case ModbusReadInputRegisters:
+			respLen = readInputRegisters(address, value);
+			break;
+		case ModbusWriteSingleCoil:
+			respLen = writeSingleCoil(address, value);
+			break;
+		case ModbusWriteMultipleCoils:
+			// Byte count and data are checked against the frame length.
+			respLen = len == 9 + _rxFrame[6] ? writeMultipleCoils(address, value) : exception(ModbusIllegalDataValue);
+			break;
+		default:
+			respLen = exception(ModbusIllegalFunction);
+			break;
+		}
+	}
+
+	// Broadcast requests have no response.
+	if (slaveId == MODBUS_BROADCAST_ID)
+	{
+		return;
+	}
+
+	_txFrame[0] = _slaveId;
+	respLen = modbusAppendCRC(_txFrame, respLen);
+	_serial->write(_txFrame, respLen);
+
+	addStat(_stats.Responses);
+}
+
+/**
+* @brief Check request range.
+*
+* @return uint8_t 0 - valid, otherwise exception code.
+*/
+uint8_t KMPModbusSlaveClass::checkRange(uint16_t address, uint16_t count, uint16_t maxCount, uint16_t size)
+{
+	if (count == 0 || count > maxCount)
+	{
+		return ModbusIllegalDataValue;
+	}
+
+	if ((uint32_t)address + count > size)
+	{
+		return ModbusIllegalDataAddress;
+	}
+
+	return 0;
+}
+
+uint16_t KMPModbusSlaveClass::exception(uint8_t code)
+{
+	addStat(_stats.Exceptions);
+
+	_txFrame[1] = _rxFrame[1] | MODBUS_EXCEPTION_FLAG;
+	_txFrame[2] = code;
+
+	return 3;
+}
+
+uint16_t KMPModbusSlaveClass::readBits(uint16_t address, uint16_t count, bool coils)
+{
+	uint8_t code = checkRange(address, count, MODBUS_MAX_READ_BITS, coils ? MODBUS_SLAVE_COILS : MODBUS_SLAVE_DISCRETE_INPUTS);
+	if (code)
+	{
+		return exception(code);
+	}
+
+	uint8_t bits;
+	if (coils)
+	{
+		bits = getCoils();
+	}
+	else
+	{
+		portENTER_CRITICAL(&_frameMux);
+		bits = _optoIns;
+		portEXIT_CRITICAL(&_frameMux);
+	}
+
+	uint8_t bytes = (count + 7) / 8;
+	_txFrame[1] = _rxFrame[1];
+	_txFrame[2] = bytes;
+	memset(&_txFrame[3], 0, bytes);
+
+	for (uint16_t i = 0; i < count; i++)
+	{
+		if (bits & (1 << (address + i)))
+		{
+			_txFrame[3 + (i >> 3)] |= 1 << (i & 0x07);
+		}
+	}
+
+	return 3 + bytes;
+}
+
+uint16_t KMPModbusSlaveClass::readInputRegisters(uint16_t address, uint16_t count)
+{
+	uint8_t code = checkRange(address, count, MODBUS_MAX_READ_REGISTERS, MODBUS_SLAVE_INPUT_REGISTERS);
+	if (code)
+	{
+		return exception(code);
+	}
+
+	_txFrame[1] = _rxFrame[1];
+	_txFrame[2] = count * 2;
+
+	portENTER_CRITICAL(&_frameMux);
+	for (uint16_t i = 0; i < count; i++)
+	{
+		modbusSetUInt16(&_txFrame[3 + i * 2], _inputRegisters[address + i]);
+	}
+	portEXIT_CRITICAL(&_frameMux);
+
+	return 3 + count * 2;
+}
+
+uint16_t KMPModbusSlaveClass::writeSingleCoil(uint16_t address, uint16_t value)
+{
+	if (value != MODBUS_COIL_ON && value != MODBUS_COIL_OFF)
+	{
+		return exception(ModbusIllegalDataValue);
+	}
+
+	uint8_t code = checkRange(address, 1, 1, MODBUS_SLAVE_COILS);
+	if (code)
+	{
+		return exception(code);
+	}
+
+	setCoil(address, value == MODBUS_COIL_ON);
+
+	// Response is an echo of the request.
+	memcpy(&_txFrame[1], &_rxFrame[1], 5);
+
+	return 6;
+}
+
+uint16_t KMPModbusSlaveClass::writeMultipleCoils(uint16_t address, uint16_t count)
+{
+	if (_rxFrame[6] != (count + 7) / 8)
+	{
+		return exception(ModbusIllegalDataValue);
+	}
+
+	uint8_t code = checkRange(address, count, MODBUS_MAX_WRITE_BITS, MODBUS_SLAVE_COILS);
+	if (code)
+	{
+		return exception(code);
+	}
+
+	const uint8_t* bits = &_rxFrame[7];
+	for (uint16_t i = 0; i < count; i++)
+	{
+		setCoil(address + i, bits[i >> 3] & (1 << (i & 0x07)));
+	}
+
+	// Response: function, address, count.
+	memcpy(&_txFrame[1], &_rxFrame[1], 5);
+
+	return 6;
+}
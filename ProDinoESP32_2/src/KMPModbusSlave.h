@@ -0,0 +1,154 @@
+// KMPModbusSlave.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Modbus RTU slave over RS485. Relays are coils, opto inputs are discrete inputs,
+//		sensor values (DHT, DS18B20 and etc.) set by the sketch are input registers.
+//		The end of request is detected by UART RX timeout (t3.5) and the response is sent from the serial event task,
+//		so it doesn't depend on the main loop duration. Reads are answered from a snapshot: relays from the expander
+//		OLAT shadow, inputs and registers published by the loop. Relay writes are answered at once and done by process()
+//		in the loop, the SPI bus, the event log and the relays persistence are used only from the loop task.
+//		Supported functions: FC01, FC02, FC04, FC05, FC15.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPMODBUSSLAVE_H
+#define _KMPMODBUSSLAVE_H
+
+#include "KMPModbus.h"
+#include "KMPRS485Serial.h"
+
+// Without UART RX timeout event the end of request is detected by process() called in the loop.
+#ifdef RS485_RX_EVENT
+#define MODBUS_SLAVE_RX_EVENT
+#endif
+
+// Coils 0 - 3: Relay1 - Relay4.
+#define MODBUS_SLAVE_COILS 4
+// Discrete inputs 0 - 3: OptoIn1 - OptoIn4.
+#define MODBUS_SLAVE_DISCRETE_INPUTS 4
+// Input registers count.
+#ifndef MODBUS_SLAVE_INPUT_REGISTERS
+#define MODBUS_SLAVE_INPUT_REGISTERS 16
+#endif
+
+/**
+ * @brief Slave statistics.
+ */
+struct ModbusSlaveStats_t {
+	// Valid requests to this slave including broadcast.
+	uint32_t Requests;
+	uint32_t Responses;
+	uint32_t Exceptions;
+	uint32_t CrcErrors;
+	// Valid requests to other slaves.
+	uint32_t Ignored;
+};
+
+class KMPModbusSlaveClass
+{
+ public:
+	KMPModbusSlaveClass();
+
+	/**
+	* @brief Start the slave. RS485 must be started before with the same baud and configuration.
+	*
+	* @param serial Serial port. RS485Serial.
+	* @param slaveId Slave address 1-247.
+	* @param baud Speed.
+	* @param config Configuration - SERIAL_8N1, SERIAL_8E1 ...
+	*
+	* @return bool true - the slave is started.
+	*/
+	bool begin(KMPRS485SerialClass& serial, uint8_t slaveId, unsigned long baud, uint32_t config = SERIAL_8N1);
+
+	/**
+	* @brief Stop the slave.
+	*
+	* @return void
+	*/
+	void end();
+
+	/**
+	* @brief Set the relays written by the master and publish the inputs for the reads. Call it in the loop.
+	*        Without UART RX timeout event it serves the requests too.
+	*
+	* @return void
+	*/
+	void process();
+
+	/**
+	* @brief Set input register value.
+	*
+	* @param address Register address from 0 to MODBUS_SLAVE_INPUT_REGISTERS - 1.
+	* @param value Value.
+	*
+	* @return void
+	*/
+	void setInputRegister(uint16_t address, uint16_t value);
+
+	/**
+	* @brief Set input register from a sensor value. The register contains signed value * scale.
+	*        Example: 23.45 C with scale 10 is 234.
+	*
+	* @param address Register address from 0 to MODBUS_SLAVE_INPUT_REGISTERS - 1.
+	* @param value Sensor value.
+	* @param scale Multiplier.
+	*
+	* @return void
+	*/
+	void setInputRegister(uint16_t address, float value, uint16_t scale = 10);
+
+	/**
+	* @brief Get input register value.
+	*
+	* @param address Register address from 0 to MODBUS_SLAVE_INPUT_REGISTERS - 1.
+	*
+	* @return uint16_t Value, 0 if the address is out of range.
+	*/
+	uint16_t getInputRegister(uint16_t address);
+
+	/**
+	* @brief Get statistics.
+	*
+	* @return ModbusSlaveStats_t Statistics.
+	*/
+	ModbusSlaveStats_t getStats();
+
+ private:
+	KMPRS485SerialClass* _serial;
+	uint8_t _slaveId;
+	ModbusTiming_t _timing;
+	volatile uint16_t _inputRegisters[MODBUS_SLAVE_INPUT_REGISTERS];
+
+	uint8_t _rxFrame[MODBUS_MAX_FRAME];
+	uint16_t _rxLen;
+	unsigned long _lastRxMicros;
+	uint8_t _txFrame[MODBUS_MAX_FRAME];
+
+	// Opto inputs published by process(). Bit 0 - OptoIn1.
+	uint8_t _optoIns;
+	// Relays written by the master and not set yet by process(). Bit 0 - Relay1.
+	uint8_t _coilsMask;
+	uint8_t _coilsState;
+
+	ModbusSlaveStats_t _stats;
+
+	static void onReceive();
+	void readFrame();
+	void addStat(uint32_t& counter);
+	uint8_t getCoils();
+	void setCoil(uint16_t address, bool state);
+	void handleFrame();
+	uint16_t readBits(uint16_t address, uint16_t count, bool coils);
+	uint16_t readInputRegisters(uint16_t address, uint16_t count);
+	uint16_t writeSingleCoil(uint16_t address, uint16_t value);
+	uint16_t writeMultipleCoils(uint16_t address, uint16_t count);
+	uint16_t exception(uint8_t code);
+	uint8_t checkRange(uint16_t address, uint16_t count, uint16_t maxCount, uint16_t size);
+};
+
+extern KMPModbusSlaveClass KMPModbusSlave;
+
+#endif
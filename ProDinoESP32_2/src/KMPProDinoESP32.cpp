@@ -17,6 +17,7 @@
 // Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu> & Dimitar Antonov <d.antonov@kmpelectronics.eu>
 
 #include "KMPProDinoESP32.h"
+#include <Preferences.h>
 
 
 const BoardConfig_t BoardConfig[BOARDS_COUNT] = {
@@ -51,6 +52,12 @@ const uint8_t RELAY_PINS[RELAY_COUNT] = { REL1PIN, REL2PIN, REL3PIN, REL4PIN };
  */
 const int OPTOIN_PINS[OPTOIN_COUNT] = { IN1PIN, IN2PIN, IN3PIN, IN4PIN };
 
+#define ALL_RELAYS_BITS ((1 << RELAY_COUNT) - 1)
+
+// Expander masks.
+#define RELAYS_MASK  ((1 << REL1PIN) | (1 << REL2PIN) | (1 << REL3PIN) | (1 << REL4PIN))
+#define OPTOINS_MASK ((1 << IN1PIN) | (1 << IN2PIN) | (1 << IN3PIN) | (1 << IN4PIN))
+
 // Expander CS pin.
 #define MCP23S08CSPin 32  // IO32
 
@@ -68,7 +75,7 @@ NeoPixelBus<NeoGrbFeature, NeoEsp32BitBang800KbpsMethod> _statusLed(MaxStatusLed
 #define RS485TxPin    16  // IO16
 #define RS485Transmit HIGH
 #define RS485Receive  LOW
-HardwareSerial RS485Serial(1);
+KMPRS485SerialClass RS485Serial(1);
 
 // GSM module pins for Serial2
 #define GSMCTSPin   J14_5
@@ -86,6 +93,22 @@ HardwareSerial RS485Serial(1);
 #define LoRaResetPin J14_12
 HardwareSerial SerialModem(2);
 
+// Reset times in milliseconds.
+// RSTn Pull-up Reset (Active low) RESET should be held low at least 500 us for W5500 reset. After reset PLL locks for max 1 ms.
+#define W5500_RESET_PULSE_MS 10
+#define W5500_START_MS       10
+// GSM reset should be held min 10 mS.
+#define GSM_RESET_PULSE_MS   20
+#define LORA_RESET_PULSE_MS  200
+#define LORA_START_MS        200
+
+// Initialization stages.
+#define INIT_ETHERNET_RESET 0x01
+#define INIT_ETHERNET_START 0x02
+#define INIT_GSM_RESET      0x04
+#define INIT_LORA_RESET     0x08
+#define INIT_LORA_START     0x10
+
 #define colorSaturation 32 // Max 255 but light is too sharp.
 RgbColor yellow(colorSaturation, colorSaturation, 0);
 RgbColor orange(colorSaturation, colorSaturation / 2, 0);
@@ -97,53 +120,79 @@ RgbColor black(0);
 
 KMPProDinoESP32Class KMPProDinoESP32;
 
-uint32_t _TxFlushDelayuS;
+// Relays persistence.
+#define RELAYS_NVS_NAMESPACE "kmpprodino"
+#define RELAYS_NVS_KEY       "relays"
+// RTC value: 0xA5 marker, inverted mask and mask.
+#define RELAYS_RTC_VALUE(mask)    (0xA5000000 | ((uint32_t)(uint8_t)~(mask) << 8) | (uint8_t)(mask))
+#define RELAYS_RTC_IS_VALID(value) (((value) & 0xFF000000) == 0xA5000000 && (uint8_t)((value) >> 8) == (uint8_t)~(uint8_t)(value))
+RTC_NOINIT_ATTR uint32_t _relaysRtc;
 
 unsigned long _blinkIntervalTimeout[MaxStatusLedPixelCount];
 uint8_t _ledState[MaxStatusLedPixelCount];
 
-void KMPProDinoESP32Class::begin(BoardType board)
+void KMPProDinoESP32Class::begin(BoardType board, bool waitReady, GSMDataMode gsmDataMode)
 {
 	if (BOARDS_COUNT < board)return;
-	begin(BoardConfig[board]);
+	begin(BoardConfig[board], waitReady, gsmDataMode);
 }
-void KMPProDinoESP32Class::begin(BoardConfig_t bConfig)
+
+void KMPProDinoESP32Class::begin(BoardConfig_t bConfig, bool waitReady, GSMDataMode gsmDataMode)
 {
-	_boardConfig = bConfig;
+	_initStart = millis();
+	_initPending = 0;
+	memset(&_initMetrics, 0, sizeof(_initMetrics));
 
-	bool isBoardInitialized = false;
+	_boardConfig = bConfig;
+	_gsmDataMode = gsmDataMode;
+	_gsmDataModeRequested = gsmDataMode;
+	_relaysMask = 0;
+	_optoInsMask = 0;
 
-	if (_boardConfig.Ethernet)
+	// The sketch can start a persistent log before.
+	if (!KMPEventLog.isStarted())
 	{
-		beginEthernet(true);
+		KMPEventLog.begin();
 	}
 
-	if (_boardConfig.GSM)
+	if (_boardConfig.Ethernet)
 	{
-		beginGSM(true);
+		// Keep W5500 not selected while the expander is initialized.
+		pinMode(W5500CSPin, OUTPUT);
+		digitalWrite(W5500CSPin, HIGH);
 	}
 
-	if (_boardConfig.LoRa)
+	MCP23S08.init(MCP23S08CSPin);
+
+	// Restore relays before any network initialization. Output latch is set before the pins become outputs.
+	if (_relaysPersistence)
 	{
-		beginLoRa(true);
+		restoreRelays();
 	}
 
-	isBoardInitialized = true;
+	// Set expander pins direction.
+	MCP23S08.SetPinsDirection(RELAYS_MASK, OUTPUT);
+	MCP23S08.SetPinsDirection(OPTOINS_MASK, INPUT);
 
-	// Init expander pins.
-	pinMode(MCP23S08IntetuptPin, INPUT);
+	// Inputs are read by SPI only if the expander signals a change.
+	MCP23S08.EnableInterruptCapture(OPTOINS_MASK, MCP23S08IntetuptPin);
 
-	// Set expander pins direction.
-	MCP23S08.init(MCP23S08CSPin);
+	_initMetrics.IOReadyMs = millis() - _initStart;
 
-	for (uint8_t i = 0; i < RELAY_COUNT; i++)
+	// Start all reset pulses together. They are completed in isReady().
+	if (_boardConfig.Ethernet)
 	{
-		MCP23S08.SetPinDirection(RELAY_PINS[i], OUTPUT);
+		beginEthernet(true);
+	}
+
+	if (_boardConfig.GSM)
+	{
+		beginGSM(true);
 	}
 
-	for (uint8_t i = 0; i < OPTOIN_COUNT; i++)
+	if (_boardConfig.LoRa)
 	{
-		MCP23S08.SetPinDirection(OPTOIN_PINS[i], INPUT);
+		beginLoRa(true);
 	}
 
 	// Status led.
@@ -159,6 +208,99 @@ void KMPProDinoESP32Class::begin(BoardConfig_t bConfig)
 	// RS485 pin init.
 	pinMode(RS485Pin, OUTPUT);
 	digitalWrite(RS485Pin, RS485Receive);
+
+	if (waitReady)
+	{
+		while (!isReady())
+		{
+			delay(1);
+		}
+	}
+	else
+	{
+		isReady();
+	}
+}
+
+bool KMPProDinoESP32Class::isReady()
+{
+	if (_initPending == 0)
+	{
+		return true;
+	}
+
+	unsigned long now = millis();
+	unsigned long elapsed = now - _initStart;
+
+	// Every stage is measured from its own start, the pulses start after the expander initialization.
+	if ((_initPending & INIT_ETHERNET_RESET) && now - _ethernetStageStart >= W5500_RESET_PULSE_MS)
+	{
+		digitalWrite(W5500ResetPin, HIGH);
+		_initPending &= ~INIT_ETHERNET_RESET;
+		_ethernetStageStart = now;
+	}
+	else if ((_initPending & (INIT_ETHERNET_RESET | INIT_ETHERNET_START)) == INIT_ETHERNET_START && now - _ethernetStageStart >= W5500_START_MS)
+	{
+		_initPending &= ~INIT_ETHERNET_START;
+		_initMetrics.EthernetReadyMs = elapsed;
+	}
+
+	if ((_initPending & INIT_GSM_RESET) && now - _gsmStageStart >= GSM_RESET_PULSE_MS)
+	{
+		resetGSMOff();
+		_initPending &= ~INIT_GSM_RESET;
+		_initMetrics.GSMReadyMs = elapsed;
+	}
+
+	if ((_initPending & INIT_LORA_RESET) && now - _loraStageStart >= LORA_RESET_PULSE_MS)
+	{
+		resetLoRaOff();
+		_initPending &= ~INIT_LORA_RESET;
+		_loraStageStart = now;
+	}
+	else if ((_initPending & (INIT_LORA_RESET | INIT_LORA_START)) == INIT_LORA_START && now - _loraStageStart >= LORA_START_MS)
+	{
+		_initPending &= ~INIT_LORA_START;
+		_initMetrics.LoRaReadyMs = elapsed;
+	}
+
+	if (_initPending == 0)
+	{
+		_initMetrics.ReadyMs = elapsed;
+	}
+
+	return _initPending == 0;
+}
+
+bool KMPProDinoESP32Class::isEthernetReady()
+{
+	isReady();
+
+	return !(_initPending & (INIT_ETHERNET_RESET | INIT_ETHERNET_START));
+}
+
+bool KMPProDinoESP32Class::isGSMReady()
+{
+	isReady();
+
+	return !(_initPending & INIT_GSM_RESET);
+}
+
+bool KMPProDinoESP32Class::isLoRaReady()
+{
+	isReady();
+
+	return !(_initPending & (INIT_LORA_RESET | INIT_LORA_START));
+}
+
+/**
+* @brief W5100 library waits for the chip with this callback instead of fixed delay.
+*
+* @return bool true - W5500 is ready.
+*/
+bool ethernetReadyCallback()
+{
+	return KMPProDinoESP32.isEthernetReady();
 }
 
 void KMPProDinoESP32Class::beginEthernet(bool startEthernet)
@@ -168,8 +310,13 @@ void KMPProDinoESP32Class::beginEthernet(bool startEthernet)
 
 	if (startEthernet)
 	{
-		restartEthernet();
+		// The reset pulse ends in isReady().
+		digitalWrite(W5500ResetPin, LOW);
+		_initPending |= INIT_ETHERNET_RESET | INIT_ETHERNET_START;
+		_ethernetStageStart = millis();
+
 		Ethernet.init(W5500CSPin);
+		W5100Class::setReadyCallback(ethernetReadyCallback);
 	}
 	else
 	{
@@ -179,26 +326,23 @@ void KMPProDinoESP32Class::beginEthernet(bool startEthernet)
 
 void KMPProDinoESP32Class::beginGSM(bool startGSM)
 {
-	// Start serial communication with the GSM modem.
-	SerialModem.begin(115200, SERIAL_8N1, GSMRxPin, GSMTxPin);
+	// Start serial communication with the GSM modem. The modem autobauds at 115200, MODEM.begin negotiates a higher baud.
+	// MODEM owns the UART setup: pins, RX buffer and RTS/CTS flow control.
+	MODEM.beginUart();
 
 	// Turn on the GSM module by triggering GSM_RESETN pin.
 	pinMode(GSMResetPin, OUTPUT);
 	if (startGSM)
 	{
-		restartGSM();
+		// The reset pulse ends in isReady().
+		resetGSMOn();
+		_initPending |= INIT_GSM_RESET;
+		_gsmStageStart = millis();
 	}
 	else
 	{
 		resetGSMOn();
 	}
-
-	// The GSM pin is output.
-	pinMode(GSMCTSPin, INPUT);
-
-	// RTS pin should be in LOW to the GSM modem works.
-	pinMode(GSMRTSPin, OUTPUT);
-	digitalWrite(GSMRTSPin, LOW);
 }
 
 void KMPProDinoESP32Class::beginLoRa(bool startLora)
@@ -210,7 +354,10 @@ void KMPProDinoESP32Class::beginLoRa(bool startLora)
 	pinMode(LoRaResetPin, OUTPUT);
 	if (startLora)
 	{
-		restartLoRa();
+		// The reset pulse ends in isReady().
+		resetLoRaOn();
+		_initPending |= INIT_LORA_RESET | INIT_LORA_START;
+		_loraStageStart = millis();
 	}
 	else
 	{
@@ -226,9 +373,9 @@ void KMPProDinoESP32Class::restartLoRa()
 {
 	// Reset occurs when a low level is applied to the RESET_N pin, which is normally set high by an internal pull-up, for a valid time period min 10 mS.
 	resetLoRaOn();
-	delay(200);
+	delay(LORA_RESET_PULSE_MS);
 	resetLoRaOff();
-	delay(200);
+	delay(LORA_START_MS);
 }
 
 void KMPProDinoESP32Class::resetLoRaOn()
@@ -246,10 +393,68 @@ void KMPProDinoESP32Class::restartGSM()
 	// Reset occurs when a low level is applied to the RESET_N pin, which is normally set high by an internal pull-up, for a valid time period min 10 mS.
 	// In our device this pin is inverted.
 	resetGSMOn();
-	delay(20);
+	delay(GSM_RESET_PULSE_MS);
 	resetGSMOff();
 }
 
+/**
+* @brief GPRS used by AT sockets. It is created at first use, boards without GSM don't register its URC handlers.
+*
+* @return GPRS& GPRS.
+*/
+static GPRS& getGPRS()
+{
+	static GPRS gprs;
+	return gprs;
+}
+
+bool KMPProDinoESP32Class::attachGSMData(const char* apn, const char* user, const char* password)
+{
+	if (!_boardConfig.GSM)
+	{
+		return false;
+	}
+
+	// A fallback from previous attach is retried.
+	_gsmDataMode = _gsmDataModeRequested;
+
+	if (_gsmDataMode == GSMDataPPP)
+	{
+		// PPP runs on multiplexer channel 2, MODEM stays in AT command mode on channel 1 (SMS, signal quality, calls).
+		// Without the multiplexer PPP takes the UART and MODEM is in data mode until detachGSMData.
+		if (ModemMux.begin() == 1)
+		{
+			if (GSMPPP.begin(ModemMux.channel(2), apn, user, password))
+			{
+				return true;
+			}
+
+			ModemMux.end();
+		}
+		else if (GSMPPP.begin(apn, user, password))
+		{
+			return true;
+		}
+
+		_gsmDataMode = GSMDataATSockets;
+	}
+
+	return getGPRS().attachGPRS(apn, user != NULL ? user : "", password != NULL ? password : "") == GPRS_READY;
+}
+
+void KMPProDinoESP32Class::detachGSMData()
+{
+	if (_gsmDataMode == GSMDataPPP)
+	{
+		GSMPPP.end();
+		// MODEM returns to the UART.
+		ModemMux.end();
+		return;
+	}
+
+	getGPRS().detachGPRS();
+}
+
 void KMPProDinoESP32Class::resetGSMOn()
 {
 	digitalWrite(GSMResetPin, HIGH);
@@ -262,10 +467,10 @@ void KMPProDinoESP32Class::resetGSMOff()
 
 void KMPProDinoESP32Class::restartEthernet()
 {
-	// RSTn Pull-up Reset (Active low) RESET should be held low at least 500 us for W5500 reset.
 	digitalWrite(W5500ResetPin, LOW);
-	delay(600);
+	delay(W5500_RESET_PULSE_MS);
 	digitalWrite(W5500ResetPin, HIGH);
+	delay(W5500_START_MS);
 }
 
 RgbColor KMPProDinoESP32Class::getStatusLed(uint8_t num)
@@ -319,7 +524,7 @@ void KMPProDinoESP32Class::processStatusLed(RgbColor color, int blinkInterval, u
 /* Relays methods. */
 /* ----------------------------------------------------------------------- */
 
-void KMPProDinoESP32Class::setRelayState(uint8_t relayNumber, bool state)
+void KMPProDinoESP32Class::setRelayState(uint8_t relayNumber, bool state, EventSource source)
 {
 	// Check if relayNumber is out of range - return.
 	if (relayNumber > RELAY_COUNT - 1)
@@ -328,18 +533,138 @@ void KMPProDinoESP32Class::setRelayState(uint8_t relayNumber, bool state)
 	}
 
 	MCP23S08.SetPinState(RELAY_PINS[relayNumber], state);
+
+	uint8_t bit = 1 << relayNumber;
+	updateRelaysMask(state ? (_relaysMask | bit) : (_relaysMask & ~bit), source);
+}
+
+void KMPProDinoESP32Class::setRelayState(Relay relay, bool state, EventSource source)
+{
+	setRelayState((uint8_t)relay, state, source);
 }
 
-void KMPProDinoESP32Class::setRelayState(Relay relay, bool state)
+void KMPProDinoESP32Class::setAllRelaysState(bool state, EventSource source)
 {
-	setRelayState((uint8_t)relay, state);
+	// All relays with one SPI write.
+	MCP23S08.SetPinsState(RELAYS_MASK, state ? RELAYS_MASK : 0);
+
+	updateRelaysMask(state ? ALL_RELAYS_BITS : 0, source);
 }
 
-void KMPProDinoESP32Class::setAllRelaysState(bool state)
+/**
+* @brief Save new relays states. Changed relays are written in event log.
+*
+* @param mask New relays states. Bit 0 - Relay1 ...
+* @param source Who requests the change.
+*
+* @return void
+*/
+void KMPProDinoESP32Class::updateRelaysMask(uint8_t mask, EventSource source)
 {
+	uint8_t changed = _relaysMask ^ mask;
+
+	if (changed == 0)
+	{
+		return;
+	}
+
+	_relaysMask = mask;
+
+	for (uint8_t i = 0; i < RELAY_COUNT; i++)
+	{
+		if (changed & (1 << i))
+		{
+			KMPEventLog.add(ChannelRelay, i, mask & (1 << i), source);
+		}
+	}
+
+	if (_relaysPersistence)
+	{
+		// RTC memory is written immediately, flash - after quiet interval.
+		_relaysRtc = RELAYS_RTC_VALUE(mask);
+		_relaysChangedMillis = millis();
+		_relaysDirty = true;
+	}
+}
+
+/* ----------------------------------------------------------------------- */
+/* Relays persistence. */
+/* ----------------------------------------------------------------------- */
+
+void KMPProDinoESP32Class::enableRelaysPersistence(unsigned long quietIntervalMs)
+{
+	_relaysPersistence = true;
+	_relaysQuietIntervalMs = quietIntervalMs;
+}
+
+void KMPProDinoESP32Class::disableRelaysPersistence()
+{
+	processRelaysPersistence(true);
+	_relaysPersistence = false;
+}
+
+void KMPProDinoESP32Class::restoreRelays()
+{
+	uint8_t mask;
+
+	// RTC memory keeps the last state after software, watchdog reset. It is newer than the flash.
+	if (RELAYS_RTC_IS_VALID(_relaysRtc))
+	{
+		mask = (uint8_t)_relaysRtc;
+	}
+	else
+	{
+		Preferences preferences;
+		preferences.begin(RELAYS_NVS_NAMESPACE, true);
+		mask = preferences.getUChar(RELAYS_NVS_KEY, 0);
+		preferences.end();
+	}
+
+	mask &= ALL_RELAYS_BITS;
+	_relaysSaved = mask;
+	_relaysDirty = false;
+
+	uint8_t pins = 0;
 	for (uint8_t i = 0; i < RELAY_COUNT; i++)
 	{
-		setRelayState(i, state);
+		if (mask & (1 << i))
+		{
+			pins |= 1 << RELAY_PINS[i];
+		}
+	}
+
+	MCP23S08.SetPinsState(RELAYS_MASK, pins);
+
+	updateRelaysMask(mask, SourceRestore);
+	_relaysDirty = false;
+}
+
+void KMPProDinoESP32Class::processRelaysPersistence(bool force)
+{
+	if (!_relaysPersistence || !_relaysDirty)
+	{
+		return;
+	}
+
+	if (!force && millis() - _relaysChangedMillis < _relaysQuietIntervalMs)
+	{
+		return;
+	}
+
+	_relaysDirty = false;
+
+	// Flash is written only if the state is different from the saved one.
+	if (_relaysMask == _relaysSaved)
+	{
+		return;
+	}
+
+	Preferences preferences;
+	if (preferences.begin(RELAYS_NVS_NAMESPACE, false))
+	{
+		preferences.putUChar(RELAYS_NVS_KEY, _relaysMask);
+		preferences.end();
+		_relaysSaved = _relaysMask;
 	}
 }
 
@@ -380,7 +705,16 @@ bool KMPProDinoESP32Class::getOptoInState(uint8_t optoInNumber)
 		return false;
 	}
 
-	return !MCP23S08.GetPinState(OPTOIN_PINS[optoInNumber]);
+	bool state = !MCP23S08.GetPinState(OPTOIN_PINS[optoInNumber]);
+
+	uint8_t bit = 1 << optoInNumber;
+	if (((_optoInsMask & bit) != 0) != state)
+	{
+		_optoInsMask ^= bit;
+		KMPEventLog.add(ChannelOptoIn, optoInNumber, state, SourceHardware);
+	}
+
+	return state;
 }
 
 bool KMPProDinoESP32Class::getOptoInState(OptoIn optoIn)
@@ -398,8 +732,7 @@ void KMPProDinoESP32Class::rs485Begin(unsigned long baud)
 
 void KMPProDinoESP32Class::rs485Begin(unsigned long baud, uint32_t config)
 {
-	RS485Serial.begin(baud, config, RS485RxPin, RS485TxPin);
-	_TxFlushDelayuS = (uint32_t)((1000000 / baud) * 15);
+	RS485Serial.begin(RS485Pin, baud, RS485RxPin, RS485TxPin, config);
 }
 
 void KMPProDinoESP32Class::rs485End()
@@ -407,50 +740,15 @@ void KMPProDinoESP32Class::rs485End()
 	RS485Serial.end();
 }
 
-/**
-* @brief Begin write data to RS485.
-*
-* @return void
-*/
-void RS485BeginWrite()
-{
-	digitalWrite(RS485Pin, RS485Transmit);
-	// Allowing pin should delay for 50 nS
-	delayMicroseconds(70);
-}
-
-/**
-* @brief End write data to RS485.
-*
-* @return void
-*/
-void RS485EndWrite()
-{
-	RS485Serial.flush();
-	delayMicroseconds(_TxFlushDelayuS);
-	digitalWrite(RS485Pin, RS485Receive);
-}
-
 size_t KMPProDinoESP32Class::rs485Write(const uint8_t data)
 {
-	RS485BeginWrite();
-
-	size_t result = RS485Serial.write(data);
-
-	RS485EndWrite();
-
-	return result;
+	return RS485Serial.write(data);
 }
 
 size_t KMPProDinoESP32Class::rs485Write(const uint8_t* data, size_t dataLen)
 {
-	RS485BeginWrite();
-
-	size_t result = RS485Serial.write(data, dataLen);
-
-	RS485EndWrite();
-
-	return result;
+	// Transceiver direction is controlled by RS485Serial.
+	return RS485Serial.write(data, dataLen);
 }
 
 int KMPProDinoESP32Class::rs485Read()
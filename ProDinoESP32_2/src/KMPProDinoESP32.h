@@ -22,6 +22,8 @@
 #include <Arduino.h>
 #include <HardwareSerial.h>
 #include "MCP23S08.h"
+#include "KMPRS485Serial.h"
+#include "KMPEventLog.h"
 // When the library is fixed to work with ESP32 we will change this reference.
 //#include <Ethernet.h>
 #include "Ethernet/Ethernet.h"
@@ -36,6 +38,9 @@
 // Inputs count
 #define OPTOIN_COUNT 4
 
+// Time without relays changes before saving them in flash.
+#define RELAYS_SAVE_QUIET_MS 5000
+
 // Expander interrupt pin 
 #define MCP23S08IntetuptPin 36  // IO36
 
@@ -98,6 +103,16 @@ enum BoardType {
 
 #define BOARDS_COUNT ProDino_ESP32_Ethernet_LoRa_RFM + 1
 
+/**
+ * @brief GSM data transport.
+ *        GSMDataATSockets - TCP/UDP in the modem by AT commands (GSMClient, GSMUDP).
+ *        GSMDataPPP - the modem carries a PPP link, TCP/UDP in the ESP32 lwIP stack (GSMPPPClient, GSMPPPUDP).
+ */
+enum GSMDataMode {
+	GSMDataATSockets = 0,
+	GSMDataPPP
+};
+
 const char TEXT_HTML[] = "text/html; charset=utf-8";
 const char PRODINO_ESP32[] = "ProDino ESP32";
 const char URL_KMPELECTRONICS_EU_PRODINO_ESP32[] = "https://kmpelectronics.eu/products/prodino-esp32-v1/";
@@ -110,7 +125,7 @@ extern RgbColor blue;
 extern RgbColor white;
 extern RgbColor black;
 
-extern HardwareSerial RS485Serial;
+extern KMPRS485SerialClass RS485Serial;
 
 extern HardwareSerial SerialModem;
 
@@ -122,19 +137,99 @@ struct BoardConfig_t {
 	uint8_t StatusLedCnt;
 };
 
+/**
+ * @brief Board initialization times in milliseconds from begin start. 0 - not ready or the module isn't available.
+ */
+struct BoardInitMetrics_t {
+	// Relays and inputs are usable.
+	unsigned long IOReadyMs;
+	unsigned long EthernetReadyMs;
+	unsigned long GSMReadyMs;
+	unsigned long LoRaReadyMs;
+	// All modules are ready.
+	unsigned long ReadyMs;
+};
+
 class KMPProDinoESP32Class
 {
  public:
 	/**
 	* @brief Initialize ProDino ESP32 board.
+	*        Relays and inputs are initialized first. Reset pulses of Ethernet, GSM and LoRa modules run in parallel.
 	* @param board Initialize specific bard. Mandatory.
+	* @param waitReady If true - the method returns when all modules are ready.
+	*                  If false - the method returns immediately after relays and inputs are ready,
+	*                  modules become ready in background. Call isReady() in loop to complete initialization.
+	* @param gsmDataMode GSM data transport used by attachGSMData. Default GSMDataATSockets.
 	*
 	* @return void
 	*/
-	void begin(BoardType board);
+	void begin(BoardType board, bool waitReady = true, GSMDataMode gsmDataMode = GSMDataATSockets);
+
+	void begin(BoardConfig_t bConfig, bool waitReady = true, GSMDataMode gsmDataMode = GSMDataATSockets);
+
+	/**
+	* @brief Process not blocking initialization. It should be called in loop while it returns false.
+	*
+	* @return bool true - all modules are ready.
+	*/
+	bool isReady();
 
-	void begin(BoardConfig_t bConfig);
+	/**
+	* @brief Check if Ethernet module is out of reset and ready for Ethernet.begin.
+	*
+	* @return bool true - ready.
+	*/
+	bool isEthernetReady();
+
+	/**
+	* @brief Check if GSM module reset is completed.
+	*
+	* @return bool true - ready.
+	*/
+	bool isGSMReady();
+
+	/**
+	* @brief Check if LoRa module reset is completed.
+	*
+	* @return bool true - ready.
+	*/
+	bool isLoRaReady();
+
+	/**
+	* @brief Get board initialization times.
+	*
+	* @return const BoardInitMetrics_t& Initialization times.
+	*/
+	const BoardInitMetrics_t& getInitMetrics() { return _initMetrics; }
 	
+	/**
+	* @brief Enable saving relays states. It should be called before begin. In begin the relays are restored
+	*        before any network initialization. States are kept in RTC memory immediately and in NVS flash
+	*        after quiet interval without changes, so often switching doesn't wear the flash.
+	*
+	* @param quietIntervalMs Time without relays changes before writing in flash. Default RELAYS_SAVE_QUIET_MS.
+	*
+	* @return void
+	*/
+	void enableRelaysPersistence(unsigned long quietIntervalMs = RELAYS_SAVE_QUIET_MS);
+
+	/**
+	* @brief Disable saving relays states. Not saved changes are written in flash.
+	*
+	* @return void
+	*/
+	void disableRelaysPersistence();
+
+	/**
+	* @brief Write relays states in flash if quiet interval passed. It should be called in loop if persistence is enabled.
+	*
+	* @param force Write now, without waiting quiet interval.
+	*
+	* @return void
+	*/
+	void processRelaysPersistence(bool force = false);
+
 	/**
 	* @brief Restarts (Stop & Start) GSM module.
 	*
@@ -142,6 +237,33 @@ class KMPProDinoESP32Class
 	*/
 	void restartGSM();
 
+	/**
+	* @brief Attach GSM data with the transport selected in begin. The modem should be registered in the network (GSM.begin).
+	*        PPP runs on ModemMux channel 2 and MODEM keeps AT commands on channel 1. If the modem has no multiplexer,
+	*        PPP takes the UART. If PPP can't be started, AT sockets are attached and getGSMDataMode returns GSMDataATSockets.
+	*
+	* @param apn APN of the network operator.
+	* @param user User name. NULL or "" without authentication.
+	* @param password Password.
+	*
+	* @return bool true - attached.
+	*/
+	bool attachGSMData(const char* apn, const char* user = NULL, const char* password = NULL);
+
+	/**
+	* @brief Detach GSM data. After PPP the multiplexer is closed and the modem returns to AT command mode on the UART.
+	*
+	* @return void
+	*/
+	void detachGSMData();
+
+	/**
+	* @brief Get GSM data transport. Use GSMPPPClient and GSMPPPUDP for GSMDataPPP, GSMClient and GSMUDP for GSMDataATSockets.
+	*
+	* @return GSMDataMode Transport.
+	*/
+	GSMDataMode getGSMDataMode() { return _gsmDataMode; }
+
 	/**
 	* @brief Restarts (Stop & Start) Ethernet.
 	*
@@ -187,27 +309,30 @@ class KMPProDinoESP32Class
 	*
 	* @param relayNumber Number of relay from 0 to RELAY_COUNT - 1. 0 - Relay1, 1 - Relay2 ...
 	* @param state New state of relay, true - On, false = Off.
+	* @param source Who requests the change. It is written in KMPEventLog if the relay state is changed.
 	*
 	* @return void
 	*/
-	void setRelayState(uint8_t relayNumber, bool state);
+	void setRelayState(uint8_t relayNumber, bool state, EventSource source = SourceLocal);
 	/**
 	* @brief Set relay new state.
 	*
 	* @param relay Relays - Relay1, Relay2 ...
 	* @param state New state of relay, true - On, false = Off.
+	* @param source Who requests the change.
 	*
 	* @return void
 	*/
-	void setRelayState(Relay relay, bool state);
+	void setRelayState(Relay relay, bool state, EventSource source = SourceLocal);
 	/**
 	* @brief Set all relays new state.
 	*
 	* @param state New state of relay, true - On, false = Off.
+	* @param source Who requests the change.
 	*
 	* @return void
 	*/
-	void setAllRelaysState(bool state);
+	void setAllRelaysState(bool state, EventSource source = SourceLocal);
 	/**
 	* @brief Set all relays in ON state.
 	*
@@ -355,6 +480,28 @@ class KMPProDinoESP32Class
 		void resetLoRaOff();
 
 		BoardConfig_t _boardConfig;
+		GSMDataMode _gsmDataMode;
+		GSMDataMode _gsmDataModeRequested;
+		BoardInitMetrics_t _initMetrics;
+		// Not completed initialization stages.
+		uint8_t _initPending;
+		unsigned long _initStart;
+		// Start of current reset or start stage of every module. Stage times are measured from it.
+		unsigned long _ethernetStageStart;
+		unsigned long _gsmStageStart;
+		unsigned long _loraStageStart;
+		void updateRelaysMask(uint8_t mask, EventSource source);
+		void restoreRelays();
+
+		// Last commanded relays states and last read inputs states. Used for event log.
+		uint8_t _relaysMask;
+		uint8_t _optoInsMask;
+
+		bool _relaysPersistence;
+		bool _relaysDirty;
+		uint8_t _relaysSaved;
+		unsigned long _relaysChangedMillis;
+		unsigned long _relaysQuietIntervalMs;
 };
 
 extern KMPProDinoESP32Class KMPProDinoESP32;
@@ -0,0 +1,347 @@
+// KMPRS485AutoDetect.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		RS485 baud and framing auto detection.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPRS485AutoDetect.h"
+#include "KMPProDinoESP32.h"
+
+// The most used bauds are first.
+static const unsigned long DETECT_BAUDS[] = { 9600, 19200, 38400, 57600, 115200, 4800, 2400, 1200, 300, 110, 75 };
+static const uint32_t DETECT_CONFIGS[] = { SERIAL_8N1, SERIAL_8E1, SERIAL_8O1, SERIAL_8N2 };
+#define DETECT_BAUDS_COUNT (sizeof(DETECT_BAUDS) / sizeof(DETECT_BAUDS[0]))
+#define DETECT_CONFIGS_COUNT (sizeof(DETECT_CONFIGS) / sizeof(DETECT_CONFIGS[0]))
+static_assert(DETECT_BAUDS_COUNT * DETECT_CONFIGS_COUNT == RS485_DETECT_CANDIDATES, "RS485_DETECT_CANDIDATES doesn't match the candidates lists.");
+
+// Score weights.
+#define DETECT_SCORE_FRAME     16
+#define DETECT_SCORE_BAD_FRAME 4
+#define DETECT_SCORE_ERROR     1
+
+// Max Modbus function code.
+#define DETECT_MAX_FUNCTION 0x2B
+
+// UART errors are counted in the serial event task.
+static portMUX_TYPE _detectMux = portMUX_INITIALIZER_UNLOCKED;
+
+KMPRS485AutoDetectClass KMPRS485AutoDetect;
+
+volatile uint16_t KMPRS485AutoDetectClass::_rxErrors = 0;
+
+KMPRS485AutoDetectClass::KMPRS485AutoDetectClass() :
+	_state(RS485DetectIdle),
+	_probeSlaveId(0),
+	_cycles(RS485_DETECT_CYCLES),
+	_dwellMs(RS485_DETECT_DWELL_MS),
+	_baud(0),
+	_config(SERIAL_8N1),
+	_index(0),
+	_cycle(0),
+	_windowMillis(0),
+	_windowMs(0),
+	_rxLen(0),
+	_lastRxMicros(0)
+{
+	memset(_candidates, 0, sizeof(_candidates));
+}
+
+void KMPRS485AutoDetectClass::begin(uint8_t probeSlaveId, uint8_t cycles, unsigned long dwellMs)
+{
+	_probeSlaveId = probeSlaveId <= MODBUS_MAX_SLAVE_ID ? probeSlaveId : 0;
+	_cycles = cycles > 0 ? cycles : 1;
+	_dwellMs = dwellMs;
+	_baud = 0;
+	_config = SERIAL_8N1;
+
+	memset(_candidates, 0, sizeof(_candidates));
+	for (uint8_t i = 0; i < RS485_DETECT_CANDIDATES; i++)
+	{
+		_candidates[i].Baud = DETECT_BAUDS[i / DETECT_CONFIGS_COUNT];
+		_candidates[i].Config = DETECT_CONFIGS[i % DETECT_CONFIGS_COUNT];
+	}
+
+	_index = 0;
+	_cycle = 0;
+	_state = RS485DetectRunning;
+
+	startCandidate();
+}
+
+void KMPRS485AutoDetectClass::end()
+{
+	if (_state != RS485DetectRunning)
+	{
+		return;
+	}
+
+#ifdef RS485_DETECT_RX_ERRORS
+	RS485Serial.onReceiveError(NULL);
+#endif
+	_state = RS485DetectIdle;
+}
+
+#ifdef RS485_DETECT_RX_ERRORS
+void KMPRS485AutoDetectClass::onReceiveError(hardwareSerial_error_t error)
+{
+	if (error == UART_FRAME_ERROR || error == UART_PARITY_ERROR)
+	{
+		portENTER_CRITICAL(&_detectMux);
+		++_rxErrors;
+		portEXIT_CRITICAL(&_detectMux);
+	}
+}
+#endif
+
+/**
+* @brief Configure RS485 for the current candidate and start its window. In probe mode the request is sent.
+*
+* @return void
+*/
+void KMPRS485AutoDetectClass::startCandidate()
+{
+	RS485DetectCandidate_t& candidate = _candidates[_index];
+
+	KMPProDinoESP32.rs485Begin(candidate.Baud, candidate.Config);
+	modbusCalcTiming(candidate.Baud, candidate.Config, _timing);
+
+	// Data received with the previous candidate.
+	while (RS485Serial.read() >= 0);
+
+#ifdef RS485_DETECT_RX_ERRORS
+	RS485Serial.onReceiveError(onReceiveError);
+#endif
+	portENTER_CRITICAL(&_detectMux);
+	_rxErrors = 0;
+	portEXIT_CRITICAL(&_detectMux);
+
+	_rxLen = 0;
+	_lastRxMicros = micros();
+	_windowMillis = millis();
+
+	if (_probeSlaveId == 0)
+	{
+		_windowMs = max(_dwellMs, (unsigned long)(RS485_DETECT_MIN_CHARS * _timing.CharuS / 1000 + 1));
+		return;
+	}
+
+	// Read holding register 0. Any normal or exception response with valid CRC is accepted.
+	uint8_t request[8] = { _probeSlaveId, ModbusReadHoldingRegisters, 0, 0, 0, 1 };
+	size_t len = modbusAppendCRC(request, 6);
+	RS485Serial.write(request, len);
+
+	// Request and the longest response (7 bytes) transmission.
+	_windowMs = RS485_DETECT_PROBE_TIMEOUT_MS + (len + 7) * _timing.CharuS / 1000 + 1;
+}
+
+/**
+* @brief Go to the next candidate. After the last candidate select the best one or finish the detection.
+*
+* @return void
+*/
+void KMPRS485AutoDetectClass::nextCandidate()
+{
+	if (++_index < RS485_DETECT_CANDIDATES)
+	{
+		startCandidate();
+		return;
+	}
+
+	_index = 0;
+	++_cycle;
+
+	int best = -1;
+	for (uint8_t i = 0; i < RS485_DETECT_CANDIDATES; i++)
+	{
+		if (_candidates[i].Frames > 0 && getScore(i) > 0 && (best < 0 || getScore(i) > getScore(best)))
+		{
+			best = i;
+		}
+	}
+
+	if (best >= 0)
+	{
+		finish(best);
+		return;
+	}
+
+	if (_cycle >= _cycles)
+	{
+		finish(-1);
+		return;
+	}
+
+	startCandidate();
+}
+
+void KMPRS485AutoDetectClass::process()
+{
+	if (_state != RS485DetectRunning)
+	{
+		return;
+	}
+
+	RS485DetectCandidate_t& candidate = _candidates[_index];
+
+	int b;
+	while ((b = RS485Serial.read()) >= 0)
+	{
+		if (_rxLen == MODBUS_MAX_FRAME)
+		{
+			analyzeFrame();
+		}
+
+		_rxFrame[_rxLen++] = (uint8_t)b;
+		_lastRxMicros = micros();
+		++candidate.Bytes;
+	}
+
+	// The line is idle for t3.5 - frame end.
+	if (_rxLen > 0 && micros() - _lastRxMicros >= _timing.T35uS)
+	{
+		analyzeFrame();
+	}
+
+	portENTER_CRITICAL(&_detectMux);
+	candidate.Errors += _rxErrors;
+	_rxErrors = 0;
+	portEXIT_CRITICAL(&_detectMux);
+
+	if (isSelected(candidate))
+	{
+		finish(_index);
+		return;
+	}
+
+	// Much data without valid frame - wrong candidate, don't wait for the window end.
+	bool reject = _probeSlaveId == 0 && candidate.Frames == 0 && candidate.Bytes >= RS485_DETECT_REJECT_BYTES;
+	if (!reject && millis() - _windowMillis < _windowMs)
+	{
+		return;
+	}
+
+	if (_rxLen > 0)
+	{
+		analyzeFrame();
+		if (isSelected(candidate))
+		{
+			finish(_index);
+			return;
+		}
+	}
+
+	nextCandidate();
+}
+
+/**
+* @brief Split the received data in Modbus frames by CRC and count valid and invalid frames.
+*
+* @return void
+*/
+void KMPRS485AutoDetectClass::analyzeFrame()
+{
+	RS485DetectCandidate_t& candidate = _candidates[_index];
+
+	uint16_t start = 0;
+	while (_rxLen - start >= MODBUS_MIN_FRAME)
+	{
+		const uint8_t* frame = &_rxFrame[start];
+		uint8_t function = frame[1] & ~MODBUS_EXCEPTION_FLAG;
+		bool plausible = function >= 1 && function <= DETECT_MAX_FUNCTION &&
+			(_probeSlaveId == 0 ? frame[0] <= MODBUS_MAX_SLAVE_ID : frame[0] == _probeSlaveId);
+
+		// Several frames can be received without a gap.
+		uint16_t len = 0;
+		for (uint16_t i = MODBUS_MIN_FRAME; plausible && i <= _rxLen - start; i++)
+		{
+			if (modbusCheckCRC(frame, i))
+			{
+				len = i;
+				break;
+			}
+		}
+
+		if (len == 0)
+		{
+			break;
+		}
+
+		++candidate.Frames;
+		start += len;
+	}
+
+	if (start < _rxLen)
+	{
+		++candidate.BadFrames;
+	}
+
+	_rxLen = 0;
+}
+
+/**
+* @brief Check if the candidate can be selected without trying the others.
+*
+* @return bool true - selected.
+*/
+bool KMPRS485AutoDetectClass::isSelected(const RS485DetectCandidate_t& candidate)
+{
+	if (_probeSlaveId != 0)
+	{
+		return candidate.Frames > 0;
+	}
+
+	return candidate.Frames >= RS485_DETECT_MIN_FRAMES && candidate.Frames > candidate.BadFrames && candidate.Errors == 0;
+}
+
+/**
+* @brief Finish detection and configure RS485 with the result.
+*
+* @param index Selected candidate, -1 - detection failed.
+*
+* @return void
+*/
+void KMPRS485AutoDetectClass::finish(int index)
+{
+#ifdef RS485_DETECT_RX_ERRORS
+	RS485Serial.onReceiveError(NULL);
+#endif
+
+	if (index < 0)
+	{
+		_state = RS485DetectFailed;
+		return;
+	}
+
+	_baud = _candidates[index].Baud;
+	_config = _candidates[index].Config;
+	_state = RS485DetectDone;
+
+	// The selected candidate can be other than the last tried.
+	KMPProDinoESP32.rs485Begin(_baud, _config);
+}
+
+int32_t KMPRS485AutoDetectClass::getScore(uint8_t index)
+{
+	const RS485DetectCandidate_t& candidate = _candidates[index];
+
+	return (int32_t)candidate.Frames * DETECT_SCORE_FRAME
+		- (int32_t)candidate.BadFrames * DETECT_SCORE_BAD_FRAME
+		- (int32_t)candidate.Errors * DETECT_SCORE_ERROR;
+}
+
+uint8_t KMPRS485AutoDetectClass::getProgress()
+{
+	switch (_state)
+	{
+	case RS485DetectRunning:
+		return (uint8_t)(((uint32_t)_cycle * RS485_DETECT_CANDIDATES + _index) * 100 / ((uint32_t)_cycles * RS485_DETECT_CANDIDATES));
+	case RS485DetectDone:
+	case RS485DetectFailed:
+		return 100;
+	default:
+		return 0;
+	}
+}
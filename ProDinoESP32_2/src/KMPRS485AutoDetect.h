@@ -0,0 +1,192 @@
+// KMPRS485AutoDetect.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards:
+//		ProDino ESP32 V1 https://kmpelectronics.eu/products/prodino-esp32-v1/
+//		ProDino ESP32 Ethernet V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/
+//		ProDino ESP32 GSM V1 https://kmpelectronics.eu/products/prodino-esp32-gsm-v1/
+//		ProDino ESP32 LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-lora-v1/
+//		ProDino ESP32 LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-lora-rfm-v1/
+//		ProDino ESP32 Ethernet GSM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-gsm-v1/
+//		ProDino ESP32 Ethernet LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-v1/
+//		ProDino ESP32 Ethernet LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-rfm-v1/
+// Description:
+//		RS485 baud and framing auto detection. Every candidate (baud and configuration) is tried for a short window:
+//		received data is split in frames by the line idle time and every frame is checked for a valid Modbus RTU CRC.
+//		UART framing and parity errors lower the candidate score. In probe mode a Modbus request is sent to a known slave
+//		and a valid response selects the candidate immediately.
+//		Detection is done by process() called in the loop, it never waits.
+//		Passive listening can't distinguish one and two stop bits, use probe mode for this.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPRS485AUTODETECT_H
+#define _KMPRS485AUTODETECT_H
+
+#include "KMPModbus.h"
+#include "KMPRS485Serial.h"
+
+// UART framing and parity error event is available with the RX timeout event.
+#ifdef RS485_RX_EVENT
+#define RS485_DETECT_RX_ERRORS
+#endif
+
+// Baud candidates: 11, configuration candidates: SERIAL_8N1, SERIAL_8E1, SERIAL_8O1, SERIAL_8N2.
+#define RS485_DETECT_CANDIDATES 44
+
+// Passive listening time for one candidate. It is longer for low bauds, at least RS485_DETECT_MIN_CHARS.
+#define RS485_DETECT_DWELL_MS 1500
+#define RS485_DETECT_MIN_CHARS 40
+// Response timeout in probe mode after the request transmission.
+#define RS485_DETECT_PROBE_TIMEOUT_MS 100
+// Valid frames which select the candidate in passive mode.
+#define RS485_DETECT_MIN_FRAMES 2
+// Count of received bytes without a valid frame after which the candidate is rejected before the window end.
+#define RS485_DETECT_REJECT_BYTES 64
+// Max passes through all candidates.
+#define RS485_DETECT_CYCLES 2
+
+/**
+ * @brief Detection state.
+ */
+enum RS485DetectState {
+	RS485DetectIdle = 0,
+	RS485DetectRunning,
+	RS485DetectDone,
+	RS485DetectFailed
+};
+
+/**
+ * @brief Statistics of one candidate.
+ */
+struct RS485DetectCandidate_t {
+	unsigned long Baud;
+	uint32_t Config;
+	// Received bytes.
+	uint32_t Bytes;
+	// Frames with valid CRC.
+	uint16_t Frames;
+	// Frames with invalid CRC.
+	uint16_t BadFrames;
+	// UART framing and parity errors.
+	uint16_t Errors;
+};
+
+class KMPRS485AutoDetectClass
+{
+ public:
+	KMPRS485AutoDetectClass();
+
+	/**
+	* @brief Start detection. RS485 is reconfigured by KMPProDinoESP32.rs485Begin for every candidate.
+	*        Don't use RS485 in the sketch until the detection is finished.
+	*
+	* @param probeSlaveId 0 - passive listening. 1-247 - send a request "read holding register 0" to this slave.
+	* @param cycles Max passes through all candidates.
+	* @param dwellMs Passive listening time for one candidate.
+	*
+	* @return void
+	*/
+	void begin(uint8_t probeSlaveId = 0, uint8_t cycles = RS485_DETECT_CYCLES, unsigned long dwellMs = RS485_DETECT_DWELL_MS);
+
+	/**
+	* @brief Stop detection.
+	*
+	* @return void
+	*/
+	void end();
+
+	/**
+	* @brief Receive data and change candidates. Call it in the loop as often as possible. It never waits.
+	*
+	* @return void
+	*/
+	void process();
+
+	/**
+	* @brief Get detection state.
+	*
+	* @return RS485DetectState State.
+	*/
+	RS485DetectState getState() { return _state; }
+
+	/**
+	* @brief Check if detection is in progress.
+	*
+	* @return bool true - running.
+	*/
+	bool isRunning() { return _state == RS485DetectRunning; }
+
+	/**
+	* @brief Get detected baud. Valid when the state is RS485DetectDone.
+	*
+	* @return unsigned long Baud.
+	*/
+	unsigned long getBaud() { return _baud; }
+
+	/**
+	* @brief Get detected configuration. Valid when the state is RS485DetectDone.
+	*
+	* @return uint32_t Configuration - SERIAL_8N1 ...
+	*/
+	uint32_t getConfig() { return _config; }
+
+	/**
+	* @brief Get detection progress.
+	*
+	* @return uint8_t Percent of the max detection time.
+	*/
+	uint8_t getProgress();
+
+	/**
+	* @brief Get candidate statistics.
+	*
+	* @param index From 0 to RS485_DETECT_CANDIDATES - 1.
+	*
+	* @return const RS485DetectCandidate_t& Statistics.
+	*/
+	const RS485DetectCandidate_t& getCandidate(uint8_t index) { return _candidates[index]; }
+
+	/**
+	* @brief Get candidate score. Valid frames increase it, invalid frames and UART errors decrease it.
+	*
+	* @param index From 0 to RS485_DETECT_CANDIDATES - 1.
+	*
+	* @return int32_t Score.
+	*/
+	int32_t getScore(uint8_t index);
+
+ private:
+	RS485DetectState _state;
+	uint8_t _probeSlaveId;
+	uint8_t _cycles;
+	unsigned long _dwellMs;
+	unsigned long _baud;
+	uint32_t _config;
+
+	RS485DetectCandidate_t _candidates[RS485_DETECT_CANDIDATES];
+	uint8_t _index;
+	uint8_t _cycle;
+	ModbusTiming_t _timing;
+	unsigned long _windowMillis;
+	unsigned long _windowMs;
+
+	uint8_t _rxFrame[MODBUS_MAX_FRAME];
+	uint16_t _rxLen;
+	unsigned long _lastRxMicros;
+
+	static volatile uint16_t _rxErrors;
+#ifdef RS485_DETECT_RX_ERRORS
+	static void onReceiveError(hardwareSerial_error_t error);
+#endif
+	void startCandidate();
+	void nextCandidate();
+	void analyzeFrame();
+	bool isSelected(const RS485DetectCandidate_t& candidate);
+	void finish(int index);
+};
+
+extern KMPRS485AutoDetectClass KMPRS485AutoDetect;
+
+#endif
@@ -0,0 +1,476 @@
+// KMPRS485Serial.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Source for KMP RS485 Serial.
+// Version: 1.3.0
+// Date: 18.10.2026
+// Authors: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu> & Dimitar Antonov <d.antonov@kmpelectronics.eu>
+
+#include "KMPRS485Serial.h"
+
+#define RS485Transmit HIGH
+#define RS485Receive  LOW
+
+// Transceiver driver enable time is max few hundreds nS.
+#define RS485_DE_SETUP_US 1
+
+#if (RS485_FRAME_BUFFER_SIZE & (RS485_FRAME_BUFFER_SIZE - 1)) != 0 || (RS485_FRAME_QUEUE_SIZE & (RS485_FRAME_QUEUE_SIZE - 1)) != 0
+#error "RS485_FRAME_BUFFER_SIZE and RS485_FRAME_QUEUE_SIZE must be a power of two."
+#endif
+
+// Frame queue is shared between the frame task and the loop.
+static portMUX_TYPE _frameMux = portMUX_INITIALIZER_UNLOCKED;
+
+KMPRS485SerialClass::KMPRS485SerialClass(int uartNr) :
+	HardwareSerial(uartNr),
+	_rs485Pin(0),
+	_charTimeuS(0),
+	_hwDirection(false),
+	_transmitOnly(false),
+	_framesEnabled(false),
+	_frameIdleChars(RS485_FRAME_IDLE_CHARS),
+	_frameDelimiter(-1),
+	_frameCallback(NULL),
+	_frameAssemblyLen(0),
+	_lastRxMicros(0),
+	_frameStartMicros(0),
+	_frameDataHead(0),
+	_frameDataTail(0),
+	_frameLensHead(0),
+	_frameLensTail(0),
+	_framesLost(0)
+#ifdef RS485_RX_EVENT
+	, _frameQueue(NULL),
+	_frameTask(NULL),
+	_frameTaskStop(false)
+#endif
+{
+}
+
+void KMPRS485SerialClass::begin(uint8_t rs485Pin, unsigned long baud, 
+	int8_t rxPin, int8_t txPin, uint32_t config, bool invert, unsigned long timeout_ms)
+{
+	// The UART driver and its event queue are created again.
+	bool frames = _framesEnabled;
+	if (frames)
+	{
+		endFrames();
+	}
+
+	_rs485Pin = rs485Pin;
+	_charTimeuS = (uint32_t)((1000000UL * getCharBits(config) + baud - 1) / baud);
+
+	HardwareSerial::begin(baud, config, rxPin, txPin, invert, timeout_ms);
+
+	_hwDirection = false;
+	_transmitOnly = false;
+
+#ifdef RS485_HW_DIRECTION_CONTROL
+	// DE pin works as RTS. UART asserts it before the start bit and releases it after the last stop bit.
+	if (setPins(-1, -1, -1, _rs485Pin))
+	{
+		_hwDirection = setMode(UART_MODE_RS485_HALF_DUPLEX);
+	}
+#endif
+
+	if (!_hwDirection)
+	{
+		pinMode(_rs485Pin, OUTPUT);
+		digitalWrite(_rs485Pin, RS485Receive);
+	}
+
+	if (frames)
+	{
+		beginFrames(_frameIdleChars, _frameDelimiter, _frameCallback);
+	}
+}
+
+uint8_t KMPRS485SerialClass::getCharBits(uint32_t config)
+{
+	// Config bits: [1:0] parity (2 - even, 3 - odd), [3:2] data bits - 5, [5:4] stop bits (1 - one, 2 - one and half, 3 - two).
+	uint8_t dataBits = 5 + ((config >> 2) & 0x03);
+	uint8_t parityBits = (config & 0x02) ? 1 : 0;
+	uint8_t stopBits = ((config >> 4) & 0x03) == 1 ? 1 : 2;
+
+	return 1 + dataBits + parityBits + stopBits;
+}
+
+/**
+* @brief Begin write data to RS485. Only in software direction control.
+*
+* @return void
+*/
+void KMPRS485SerialClass::rs485BeginWrite()
+{
+	digitalWrite(_rs485Pin, RS485Transmit);
+	delayMicroseconds(RS485_DE_SETUP_US);
+}
+
+/**
+* @brief End write data to RS485. Only in software direction control.
+*        Flush returns when the TX FIFO is empty, but the last character is still in the shift register.
+*
+* @return void
+*/
+void KMPRS485SerialClass::rs485EndWrite()
+{
+	HardwareSerial::flush();
+	delayMicroseconds(_charTimeuS);
+	digitalWrite(_rs485Pin, RS485Receive);
+}
+
+size_t KMPRS485SerialClass::write(uint8_t n)
+{
+	return write(&n, 1);
+}
+
+size_t KMPRS485SerialClass::write(const uint8_t *buffer, size_t size)
+{
+	if (_hwDirection || _transmitOnly)
+	{
+		return HardwareSerial::write(buffer, size);
+	}
+
+	rs485BeginWrite();
+
+	size_t result = HardwareSerial::write(buffer, size);
+
+	rs485EndWrite();
+
+	return result;
+}
+
+void KMPRS485SerialClass::flush()
+{
+	// In hardware mode flush waits for UART TX done - after the last stop bit.
+	HardwareSerial::flush();
+}
+
+void KMPRS485SerialClass::setTransmitOnly(bool enable)
+{
+	if (enable == _transmitOnly)
+	{
+		return;
+	}
+
+	HardwareSerial::flush();
+	_transmitOnly = enable;
+
+	if (enable)
+	{
+#ifdef RS485_HW_DIRECTION_CONTROL
+		if (_hwDirection)
+		{
+			setMode(UART_MODE_UART);
+		}
+#endif
+		// pinMode disconnects RTS from the pin.
+		pinMode(_rs485Pin, OUTPUT);
+		digitalWrite(_rs485Pin, RS485Transmit);
+		return;
+	}
+
+	digitalWrite(_rs485Pin, RS485Receive);
+
+#ifdef RS485_HW_DIRECTION_CONTROL
+	if (_hwDirection)
+	{
+		setPins(-1, -1, -1, _rs485Pin);
+		setMode(UART_MODE_RS485_HALF_DUPLEX);
+	}
+#endif
+}
+
+void KMPRS485SerialClass::sendBreak(uint32_t breakuS, uint32_t markuS)
+{
+	if (!_transmitOnly)
+	{
+		return;
+	}
+
+	// Wait for the last stop bit. Old cores return when the TX FIFO is empty.
+	HardwareSerial::flush();
+#ifndef RS485_HW_DIRECTION_CONTROL
+	delayMicroseconds(_charTimeuS);
+#endif
+
+	// Inverted idle line is a break.
+	uart_set_line_inverse((uart_port_t)_uart_nr, UART_SIGNAL_TXD_INV);
+	delayMicroseconds(breakuS);
+	uart_set_line_inverse((uart_port_t)_uart_nr, UART_SIGNAL_INV_DISABLE);
+	delayMicroseconds(markuS);
+}
+
+void KMPRS485SerialClass::beginFrames(uint8_t idleChars, int delimiter, RS485FrameCallback callback)
+{
+	if (_framesEnabled)
+	{
+		endFrames();
+	}
+
+	_frameIdleChars = idleChars > 0 ? idleChars : 1;
+	_frameDelimiter = delimiter;
+	_frameCallback = callback;
+	_frameAssemblyLen = 0;
+	_frameDataHead = _frameDataTail = 0;
+	_frameLensHead = _frameLensTail = 0;
+	_framesLost = 0;
+
+#ifdef RS485_RX_EVENT
+	setRxTimeout(_frameIdleChars);
+	setRxFIFOFull(RS485_FRAME_FIFO_FULL);
+
+	// The events of the bytes received before are dropped with the bytes.
+	uartGetEventQueue(_uart, &_frameQueue);
+	if (_frameQueue == NULL)
+	{
+		return;
+	}
+	uart_flush_input((uart_port_t)_uart_nr);
+	xQueueReset(_frameQueue);
+
+	_frameTaskStop = false;
+	if (xTaskCreate(frameTask, "RS485Frames", RS485_FRAME_TASK_STACK, this, RS485_FRAME_TASK_PRIORITY, &_frameTask) != pdPASS)
+	{
+		_frameTask = NULL;
+		_frameQueue = NULL;
+		return;
+	}
+#endif
+
+	_framesEnabled = true;
+}
+
+void KMPRS485SerialClass::endFrames()
+{
+#ifdef RS485_RX_EVENT
+	if (_frameTask != NULL)
+	{
+		uart_event_t event;
+		memset(&event, 0, sizeof(event));
+		event.type = UART_EVENT_MAX;
+		_frameTaskStop = true;
+
+		// The task stops on its next event. The wake up event is sent again, an RX buffer overflow drops the queued events.
+		while (_frameTask != NULL)
+		{
+			xQueueSend(_frameQueue, &event, 0);
+			delay(1);
+		}
+	}
+	_frameQueue = NULL;
+#endif
+	_framesEnabled = false;
+}
+
+#ifdef RS485_RX_EVENT
+void KMPRS485SerialClass::frameTask(void* arg)
+{
+	KMPRS485SerialClass* serial = (KMPRS485SerialClass*)arg;
+	uart_event_t event;
+
+	for (;;)
+	{
+		if (xQueueReceive(serial->_frameQueue, &event, portMAX_DELAY) != pdTRUE)
+		{
+			continue;
+		}
+
+		if (serial->_frameTaskStop)
+		{
+			serial->_frameTask = NULL;
+			vTaskDelete(NULL);
+		}
+
+		serial->receiveEvent(event);
+	}
+}
+
+/**
+* @brief Read the bytes of one UART driver event. The core serial event task calls onReceive without the event,
+*        then available() counts the bytes of the next events too and a late task can't find the frame end.
+*
+* @return void
+*/
+void KMPRS485SerialClass::receiveEvent(const uart_event_t& event)
+{
+	switch (event.type)
+	{
+	case UART_DATA:
+		// FIFO full event continues the frame, RX timeout event ends it.
+		collectFrame(event.size, event.timeout_flag);
+		break;
+	case UART_FIFO_OVF:
+	case UART_BUFFER_FULL:
+		// Bytes are lost, the events don't match the buffered bytes any more. All is dropped.
+		uart_flush_input((uart_port_t)_uart_nr);
+		xQueueReset(_frameQueue);
+
+		portENTER_CRITICAL(&_frameMux);
+		_frameAssemblyLen = 0;
+		++_framesLost;
+		portEXIT_CRITICAL(&_frameMux);
+		break;
+	default:
+		break;
+	}
+}
+#endif
+
+void KMPRS485SerialClass::processFrames()
+{
+#ifndef RS485_RX_EVENT
+	if (!_framesEnabled)
+	{
+		return;
+	}
+
+	collectFrame(HardwareSerial::available(), false);
+
+	if (_frameAssemblyLen > 0 && micros() - _lastRxMicros >= (unsigned long)_frameIdleChars * _charTimeuS)
+	{
+		completeFrame();
+	}
+#endif
+}
+
+/**
+* @brief Read received bytes in the assembly buffer. Complete the frame on delimiter, when the buffer is full or when the line is idle.
+*        The bytes are received one after another, so the start of the frame is calculated back from the read time.
+*
+* @param count Bytes to read.
+* @param lineIdle The line is idle for idle time after the last byte (RX timeout event).
+*
+* @return void
+*/
+void KMPRS485SerialClass::collectFrame(int count, bool lineIdle)
+{
+	// End of the last received byte.
+	unsigned long endMicros = micros();
+	if (lineIdle)
+	{
+		endMicros -= (unsigned long)_frameIdleChars * _charTimeuS;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		int b = HardwareSerial::read();
+		if (b < 0)
+		{
+			break;
+		}
+
+		portENTER_CRITICAL(&_frameMux);
+		if (_frameAssemblyLen == 0)
+		{
+			_frameStartMicros = endMicros - (unsigned long)(count - i) * _charTimeuS;
+		}
+		_frameAssembly[_frameAssemblyLen++] = (uint8_t)b;
+		_lastRxMicros = micros();
+		uint16_t len = _frameAssemblyLen;
+		portEXIT_CRITICAL(&_frameMux);
+
+		if (b == _frameDelimiter || len == RS485_FRAME_MAX)
+		{
+			completeFrame();
+		}
+	}
+
+	if (lineIdle)
+	{
+		completeFrame();
+	}
+}
+
+/**
+* @brief End the assembled frame. Called only from the task which collects the frame.
+*
+* @return void
+*/
+void KMPRS485SerialClass::completeFrame()
+{
+	portENTER_CRITICAL(&_frameMux);
+	uint16_t len = _frameAssemblyLen;
+	unsigned long startMicros = _frameStartMicros;
+	_frameAssemblyLen = 0;
+	portEXIT_CRITICAL(&_frameMux);
+
+	// The assembly buffer is changed only by this task, so it is valid until the next collect.
+	if (len > 0)
+	{
+		deliverFrame(_frameAssembly, len, startMicros);
+	}
+}
+
+/**
+* @brief Pass the frame to the callback or to the queue.
+*
+* @return void
+*/
+void KMPRS485SerialClass::deliverFrame(const uint8_t* frame, uint16_t len, unsigned long startMicros)
+{
+	if (_frameCallback != NULL)
+	{
+		_frameCallback(frame, len, startMicros);
+		return;
+	}
+
+	portENTER_CRITICAL(&_frameMux);
+
+	uint16_t freeBytes = RS485_FRAME_BUFFER_SIZE - (uint16_t)(_frameDataHead - _frameDataTail);
+	uint8_t freeFrames = RS485_FRAME_QUEUE_SIZE - (uint8_t)(_frameLensHead - _frameLensTail);
+
+	if (len > freeBytes || freeFrames == 0)
+	{
+		++_framesLost;
+	}
+	else
+	{
+		for (uint16_t i = 0; i < len; i++)
+		{
+			_frameData[(_frameDataHead + i) & (RS485_FRAME_BUFFER_SIZE - 1)] = frame[i];
+		}
+		_frameDataHead += len;
+		_frameLens[_frameLensHead++ & (RS485_FRAME_QUEUE_SIZE - 1)] = len;
+	}
+
+	portEXIT_CRITICAL(&_frameMux);
+}
+
+size_t KMPRS485SerialClass::frameAvailable()
+{
+	size_t result = 0;
+
+	portENTER_CRITICAL(&_frameMux);
+	if (_frameLensHead != _frameLensTail)
+	{
+		result = _frameLens[_frameLensTail & (RS485_FRAME_QUEUE_SIZE - 1)];
+	}
+	portEXIT_CRITICAL(&_frameMux);
+
+	return result;
+}
+
+size_t KMPRS485SerialClass::readFrame(uint8_t* buffer, size_t size)
+{
+	size_t result = 0;
+
+	portENTER_CRITICAL(&_frameMux);
+
+	if (_frameLensHead != _frameLensTail)
+	{
+		uint16_t len = _frameLens[_frameLensTail++ & (RS485_FRAME_QUEUE_SIZE - 1)];
+		result = min((size_t)len, size);
+
+		for (size_t i = 0; i < result; i++)
+		{
+			buffer[i] = _frameData[(_frameDataTail + i) & (RS485_FRAME_BUFFER_SIZE - 1)];
+		}
+		_frameDataTail += len;
+	}
+
+	portEXIT_CRITICAL(&_frameMux);
+
+	return result;
+}
@@ -0,0 +1,235 @@
+// KMPRS485Serial.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Supported boards: 
+//		ProDino ESP32 V1 https://kmpelectronics.eu/products/prodino-esp32-v1/
+//		ProDino ESP32 Ethernet V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-v1/
+//		ProDino ESP32 GSM V1 https://kmpelectronics.eu/products/prodino-esp32-gsm-v1/
+//		ProDino ESP32 LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-lora-v1/
+//		ProDino ESP32 LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-lora-rfm-v1/
+//		ProDino ESP32 Ethernet GSM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-gsm-v1/
+//		ProDino ESP32 Ethernet LoRa V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-v1/
+//		ProDino ESP32 Ethernet LoRa RFM V1 https://kmpelectronics.eu/products/prodino-esp32-ethernet-lora-rfm-v1/
+// Description:
+//		Header for KMP RS485 Serial. The UART works in RS485 half duplex mode and the hardware drives
+//		the transceiver DE pin (as RTS). DE is released after the last stop bit from UART TX done event,
+//		so write doesn't wait for the transmission end.
+//		If the core doesn't support RS485 mode the DE pin is driven by software after flush and one character time.
+//		In transmit only mode (DMX512 and etc.) the transceiver is always in transmit and a line break can be sent.
+// Version: 1.3.0
+// Date: 18.10.2026
+// Authors: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu> & Dimitar Antonov <d.antonov@kmpelectronics.eu>
+
+#ifndef _KMPRS485SERIAL_H
+#define _KMPRS485SERIAL_H
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include "driver/uart.h"
+
+#if defined(ESP_ARDUINO_VERSION) && defined(ESP_ARDUINO_VERSION_VAL)
+// RS485 half duplex UART mode (HardwareSerial::setMode) is available in ESP32 Arduino core 2.0.5 and next.
+#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(2, 0, 5)
+#define RS485_HW_DIRECTION_CONTROL
+#endif
+
+// UART RX timeout event is available in ESP32 Arduino core 2.0.6 and next.
+#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(2, 0, 6)
+#define RS485_RX_EVENT
+#endif
+#endif
+
+// Max frame length. Longer data is split.
+#define RS485_FRAME_MAX 256
+// Received frames buffer in bytes. Must be a power of two.
+#ifndef RS485_FRAME_BUFFER_SIZE
+#define RS485_FRAME_BUFFER_SIZE 1024
+#endif
+// Max received frames count in the buffer. Must be a power of two.
+#ifndef RS485_FRAME_QUEUE_SIZE
+#define RS485_FRAME_QUEUE_SIZE 16
+#endif
+// Default frame end: the line is idle for 4 characters.
+#define RS485_FRAME_IDLE_CHARS 4
+// UART RX FIFO full threshold in bytes. With RX timeout event the received bytes are read on FIFO full too,
+// so a long frame or continuous traffic doesn't overflow the RX buffer.
+#define RS485_FRAME_FIFO_FULL 120
+// Frame task reads the UART driver events. Each event has the count of bytes it brings, so the frames are split
+// right even if the task is late.
+#define RS485_FRAME_TASK_STACK 2048
+#define RS485_FRAME_TASK_PRIORITY (configMAX_PRIORITIES - 1)
+
+/**
+ * @brief Called when a frame is received.
+ *
+ * @param frame Frame data. Valid only in the callback.
+ * @param len Frame length.
+ * @param startMicros Start of the first frame byte (micros()). It is calculated back from the read time by the baud.
+ */
+typedef void (*RS485FrameCallback)(const uint8_t* frame, size_t len, unsigned long startMicros);
+
+class KMPRS485SerialClass : public HardwareSerial
+{
+ public:
+	KMPRS485SerialClass(int uartNr);
+
+	/**
+	* @brief Start RS485 serial.
+	*
+	* @param rs485Pin Transceiver DE pin (transmit enable).
+	* @param baud Speed.
+	* @param rxPin UART RX pin.
+	* @param txPin UART TX pin.
+	* @param config Configuration - data bits, parity, stop bits. SERIAL_8N1 ...
+	*
+	* @return void
+	*/
+	void begin(uint8_t rs485Pin, unsigned long baud, int8_t rxPin, int8_t txPin, uint32_t config = SERIAL_8N1, bool invert = false, unsigned long timeout_ms = 20000UL);
+
+	using HardwareSerial::write;
+	size_t write(uint8_t n);
+	size_t write(const uint8_t *buffer, size_t size);
+
+	/**
+	* @brief Wait while all data is transmitted and the line is released.
+	*
+	* @return void
+	*/
+	void flush();
+
+	/**
+	* @brief Keep the transceiver in transmit mode. Used by protocols without responses (DMX512).
+	*
+	* @param enable true - transmit only, false - half duplex with direction control.
+	*
+	* @return void
+	*/
+	void setTransmitOnly(bool enable);
+
+	/**
+	* @brief Wait for the end of transmission and send a line break (space) followed by a mark. Only in transmit only mode.
+	*
+	* @param breakuS Break time in microseconds.
+	* @param markuS Mark after break time in microseconds.
+	*
+	* @return void
+	*/
+	void sendBreak(uint32_t breakuS, uint32_t markuS);
+
+	/**
+	* @brief Check if DE pin is driven by UART hardware.
+	*
+	* @return bool true - hardware, false - software.
+	*/
+	bool isHardwareDirectionControl() { return _hwDirection; }
+
+	/**
+	* @brief One character time for current baud and configuration.
+	*
+	* @return uint32_t Time in microseconds.
+	*/
+	uint32_t getCharTimeuS() { return _charTimeuS; }
+
+	/**
+	* @brief Count of bits in one character: start, data, parity and stop bits.
+	*
+	* @param config Configuration - SERIAL_8N1 ...
+	*
+	* @return uint8_t Bits count.
+	*/
+	static uint8_t getCharBits(uint32_t config);
+
+	/**
+	* @brief Start frame receiving. Received bytes are grouped in frames by the line idle time or by a delimiter.
+	*        With RX timeout event (RS485_RX_EVENT) frames are collected in a task from the UART driver events and the frame latency
+	*        is the idle time. Only RX timeout event ends a frame, FIFO full event only reads the bytes it brings.
+	*        Call processFrames() in the loop in both cases. Call it after begin().
+	*        Don't use it together with read() or with onReceive and onReceiveError handlers, their task reads the same events.
+	*        Don't call endFrames() from the callback.
+	*
+	* @param idleChars Line idle time in characters which ends the frame.
+	* @param delimiter Byte which ends the frame, it is included in the frame. -1 - not used.
+	* @param callback Called for each frame. If it is NULL frames are queued, read them by readFrame().
+	*
+	* @return void
+	*/
+	void beginFrames(uint8_t idleChars = RS485_FRAME_IDLE_CHARS, int delimiter = -1, RS485FrameCallback callback = NULL);
+
+	/**
+	* @brief Stop frame receiving.
+	*
+	* @return void
+	*/
+	void endFrames();
+
+	/**
+	* @brief Collect received bytes and check frame end by idle time. With RS485_RX_EVENT it does nothing,
+	*        the frames are collected and ended by the frame task.
+	*
+	* @return void
+	*/
+	void processFrames();
+
+	/**
+	* @brief Get length of the next queued frame.
+	*
+	* @return size_t Frame length, 0 - there is no frame.
+	*/
+	size_t frameAvailable();
+
+	/**
+	* @brief Read the next queued frame and remove it from the queue.
+	*
+	* @param buffer Result.
+	* @param size Buffer size. If the frame is longer the rest is lost.
+	*
+	* @return size_t Copied bytes, 0 - there is no frame.
+	*/
+	size_t readFrame(uint8_t* buffer, size_t size);
+
+	/**
+	* @brief Get count of frames lost because the queue is full or the UART RX buffer overflowed.
+	*
+	* @return uint32_t Lost frames count.
+	*/
+	uint32_t getFramesLost() { return _framesLost; }
+
+ private:
+	 void rs485BeginWrite();
+	 void rs485EndWrite();
+
+	 uint8_t _rs485Pin;
+	 uint32_t _charTimeuS;
+	 bool _hwDirection;
+	 bool _transmitOnly;
+
+	 bool _framesEnabled;
+	 uint8_t _frameIdleChars;
+	 int _frameDelimiter;
+	 RS485FrameCallback _frameCallback;
+	 uint8_t _frameAssembly[RS485_FRAME_MAX];
+	 uint16_t _frameAssemblyLen;
+	 unsigned long _lastRxMicros;
+	 unsigned long _frameStartMicros;
+	 uint8_t _frameData[RS485_FRAME_BUFFER_SIZE];
+	 uint16_t _frameDataHead;
+	 uint16_t _frameDataTail;
+	 uint16_t _frameLens[RS485_FRAME_QUEUE_SIZE];
+	 uint8_t _frameLensHead;
+	 uint8_t _frameLensTail;
+	 uint32_t _framesLost;
+
+#ifdef RS485_RX_EVENT
+	 QueueHandle_t _frameQueue;
+	 TaskHandle_t _frameTask;
+	 volatile bool _frameTaskStop;
+
+	 static void frameTask(void* arg);
+	 void receiveEvent(const uart_event_t& event);
+#endif
+	 void collectFrame(int count, bool lineIdle);
+	 void completeFrame();
+	 void deliverFrame(const uint8_t* frame, uint16_t len, unsigned long startMicros);
+};
+
+#endif
@@ -0,0 +1,216 @@
+// KMPRS485Sniffer.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Passive RS485 bus capture in pcap format.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPRS485Sniffer.h"
+#include <sys/time.h>
+
+#if (RS485_SNIFFER_BUFFER_SIZE & (RS485_SNIFFER_BUFFER_SIZE - 1)) != 0
+#error "RS485_SNIFFER_BUFFER_SIZE must be a power of two."
+#endif
+
+#define SNIFFER_MASK (RS485_SNIFFER_BUFFER_SIZE - 1)
+#define PCAP_MAGIC 0xA1B2C3D4
+#define PCAP_SNAPLEN 65535
+
+static portMUX_TYPE _snifferMux = portMUX_INITIALIZER_UNLOCKED;
+
+KMPRS485SnifferClass KMPRS485Sniffer;
+
+/**
+* @brief Write uint32_t in little endian in a buffer.
+*/
+inline void setUInt32LE(uint8_t* data, uint32_t value)
+{
+	data[0] = (uint8_t)value;
+	data[1] = (uint8_t)(value >> 8);
+	data[2] = (uint8_t)(value >> 16);
+	data[3] = (uint8_t)(value >> 24);
+}
+
+KMPRS485SnifferClass::KMPRS485SnifferClass() :
+	_serial(NULL),
+	_idleChars(RS485_SNIFFER_IDLE_CHARS),
+	_head(0),
+	_tail(0),
+	_frames(0),
+	_bytes(0),
+	_lost(0),
+	_recordLeft(0)
+{
+}
+
+void KMPRS485SnifferClass::begin(KMPRS485SerialClass& serial, uint8_t idleChars)
+{
+	_serial = &serial;
+	_idleChars = idleChars;
+	_frames = _bytes = _lost = 0;
+	clear();
+
+	_serial->beginFrames(idleChars, -1, onFrame);
+}
+
+void KMPRS485SnifferClass::end()
+{
+	if (_serial != NULL)
+	{
+		_serial->endFrames();
+		_serial = NULL;
+	}
+}
+
+void KMPRS485SnifferClass::process()
+{
+	if (_serial != NULL)
+	{
+		_serial->processFrames();
+	}
+}
+
+void KMPRS485SnifferClass::clear()
+{
+	portENTER_CRITICAL(&_snifferMux);
+	_head = _tail = 0;
+	_recordLeft = 0;
+	portEXIT_CRITICAL(&_snifferMux);
+}
+
+size_t KMPRS485SnifferClass::buffered()
+{
+	portENTER_CRITICAL(&_snifferMux);
+	size_t result = _head - _tail;
+	portEXIT_CRITICAL(&_snifferMux);
+
+	return result;
+}
+
+void KMPRS485SnifferClass::onFrame(const uint8_t* frame, size_t len, unsigned long startMicros)
+{
+	KMPRS485Sniffer.add(frame, len, startMicros);
+}
+
+void KMPRS485SnifferClass::put(const uint8_t* data, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		_buffer[(_head + i) & SNIFFER_MASK] = data[i];
+	}
+	_head += len;
+}
+
+/**
+* @brief Add the frame as pcap record. Called from the RS485 frame task or from the loop.
+*
+* @return void
+*/
+void KMPRS485SnifferClass::add(const uint8_t* frame, size_t len, unsigned long startMicros)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+
+	// Frame start in the real time.
+	uint64_t timeuS = (uint64_t)tv.tv_sec * 1000000ULL + tv.tv_usec;
+	uint64_t ageuS = (unsigned long)(micros() - startMicros);
+	if (timeuS > ageuS)
+	{
+		timeuS -= ageuS;
+	}
+
+	uint8_t header[PCAP_RECORD_HEADER_LEN];
+	setUInt32LE(&header[0], (uint32_t)(timeuS / 1000000ULL));
+	setUInt32LE(&header[4], (uint32_t)(timeuS % 1000000ULL));
+	setUInt32LE(&header[8], len);
+	setUInt32LE(&header[12], len);
+
+	portENTER_CRITICAL(&_snifferMux);
+
+	if (RS485_SNIFFER_BUFFER_SIZE - (_head - _tail) < PCAP_RECORD_HEADER_LEN + len)
+	{
+		++_lost;
+	}
+	else
+	{
+		put(header, sizeof(header));
+		put(frame, len);
+		++_frames;
+		_bytes += len;
+	}
+
+	portEXIT_CRITICAL(&_snifferMux);
+}
+
+size_t KMPRS485SnifferClass::writePcapHeader(Print& out)
+{
+	uint8_t header[PCAP_HEADER_LEN];
+	setUInt32LE(&header[0], PCAP_MAGIC);
+	// Version 2.4.
+	header[4] = 2; header[5] = 0;
+	header[6] = 4; header[7] = 0;
+	// Time zone and accuracy.
+	setUInt32LE(&header[8], 0);
+	setUInt32LE(&header[12], 0);
+	setUInt32LE(&header[16], PCAP_SNAPLEN);
+	setUInt32LE(&header[20], PCAP_LINKTYPE_USER0);
+
+	return out.write(header, sizeof(header));
+}
+
+size_t KMPRS485SnifferClass::stream(Print& out, size_t maxBytes)
+{
+	size_t result = 0;
+
+	while (true)
+	{
+		// Records are added only at the head, the tail is moved only here.
+		portENTER_CRITICAL(&_snifferMux);
+		uint32_t available = _head - _tail;
+		portEXIT_CRITICAL(&_snifferMux);
+
+		if (available == 0)
+		{
+			break;
+		}
+
+		// Records are added whole, so the header of the next record is in the buffer.
+		if (_recordLeft == 0)
+		{
+			uint32_t len = 0;
+			for (uint8_t i = 0; i < 4; i++)
+			{
+				len |= (uint32_t)_buffer[(_tail + 8 + i) & SNIFFER_MASK] << (i * 8);
+			}
+
+			if (result > 0 && result + PCAP_RECORD_HEADER_LEN + len > maxBytes)
+			{
+				break;
+			}
+
+			_recordLeft = PCAP_RECORD_HEADER_LEN + len;
+		}
+
+		// The record isn't changed until the tail is moved. It is written in max two parts if it wraps the buffer end.
+		uint32_t start = _tail & SNIFFER_MASK;
+		uint32_t count = min(_recordLeft, (uint32_t)RS485_SNIFFER_BUFFER_SIZE - start);
+		size_t written = out.write(&_buffer[start], count);
+
+		portENTER_CRITICAL(&_snifferMux);
+		_tail += written;
+		portEXIT_CRITICAL(&_snifferMux);
+
+		_recordLeft -= written;
+		result += written;
+
+		// The output is full.
+		if (written < count)
+		{
+			break;
+		}
+	}
+
+	return result;
+}
@@ -0,0 +1,133 @@
+// KMPRS485Sniffer.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Passive RS485 bus capture. Received bytes are grouped in frames by the line idle time and stored with
+//		microsecond timestamp in a ring buffer as pcap records. The capture can be streamed to a TCP client (Ethernet or WiFi)
+//		and opened by Wireshark or tcpdump. Link type is USER0 (147), in Wireshark it can be decoded as Modbus RTU
+//		from Preferences -> Protocols -> DLT_USER.
+//		The timestamp is the start of the first frame byte. It is calculated by the serial from the read time, the bytes count and the baud.
+//		Frames longer than RS485_FRAME_MAX are split, each part has its own timestamp.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPRS485SNIFFER_H
+#define _KMPRS485SNIFFER_H
+
+#include "KMPRS485Serial.h"
+
+// Capture buffer in bytes. Must be a power of two.
+#ifndef RS485_SNIFFER_BUFFER_SIZE
+#define RS485_SNIFFER_BUFFER_SIZE 8192
+#endif
+
+// Recommended UART RX buffer. Set it by RS485Serial.setRxBufferSize() before rs485Begin().
+#define RS485_SNIFFER_RX_BUFFER 1024
+// Default frame gap in characters.
+#define RS485_SNIFFER_IDLE_CHARS 2
+
+#define PCAP_LINKTYPE_USER0 147
+// pcap global header length.
+#define PCAP_HEADER_LEN 24
+// pcap record header length.
+#define PCAP_RECORD_HEADER_LEN 16
+
+class KMPRS485SnifferClass
+{
+ public:
+	KMPRS485SnifferClass();
+
+	/**
+	* @brief Start capture. RS485 must be started before. The sniffer never transmits.
+	*
+	* @param serial Serial port. RS485Serial.
+	* @param idleChars Line idle time in characters between frames.
+	*
+	* @return void
+	*/
+	void begin(KMPRS485SerialClass& serial, uint8_t idleChars = RS485_SNIFFER_IDLE_CHARS);
+
+	/**
+	* @brief Stop capture.
+	*
+	* @return void
+	*/
+	void end();
+
+	/**
+	* @brief Call it in the loop. Without RS485_RX_EVENT frames are collected here.
+	*
+	* @return void
+	*/
+	void process();
+
+	/**
+	* @brief Remove all captured frames.
+	*
+	* @return void
+	*/
+	void clear();
+
+	/**
+	* @brief Write pcap global header. Write it once at the beginning of each stream (new client, new file).
+	*
+	* @param out Output. Ethernet or WiFi client, file and etc.
+	*
+	* @return size_t Written bytes.
+	*/
+	size_t writePcapHeader(Print& out);
+
+	/**
+	* @brief Write captured frames as pcap records and remove the written bytes from the buffer.
+	*        If the output takes less bytes (client buffer is full) the rest of the record is written by the next call.
+	*
+	* @param out Output. Ethernet or WiFi client, file and etc.
+	* @param maxBytes Max bytes to write in one call. A record is started only if it fits, but at least one is started if there is any.
+	*
+	* @return size_t Written bytes.
+	*/
+	size_t stream(Print& out, size_t maxBytes = 1460);
+
+	/**
+	* @brief Get bytes waiting in the buffer.
+	*
+	* @return size_t Bytes count.
+	*/
+	size_t buffered();
+
+	/**
+	* @brief Get captured frames count since begin.
+	*/
+	uint32_t frames() { return _frames; }
+
+	/**
+	* @brief Get captured bytes count since begin.
+	*/
+	uint32_t bytes() { return _bytes; }
+
+	/**
+	* @brief Get count of frames lost because the buffer is full.
+	*/
+	uint32_t lost() { return _lost; }
+
+ private:
+	KMPRS485SerialClass* _serial;
+	uint8_t _idleChars;
+	uint8_t _buffer[RS485_SNIFFER_BUFFER_SIZE];
+	uint32_t _head;
+	uint32_t _tail;
+	uint32_t _frames;
+	uint32_t _bytes;
+	uint32_t _lost;
+	// Not written bytes of the record at the tail.
+	uint32_t _recordLeft;
+
+	static void onFrame(const uint8_t* frame, size_t len, unsigned long startMicros);
+	void add(const uint8_t* frame, size_t len, unsigned long startMicros);
+	void put(const uint8_t* data, size_t len);
+};
+
+extern KMPRS485SnifferClass KMPRS485Sniffer;
+
+#endif
@@ -1,35 +1,119 @@
 // MCP23S08.h
 // Company: KMP Electronics Ltd, Bulgaria
 // Web: https://kmpelectronics.eu/
-// Supported hardware: 
+// Supported hardware:
 //		Expander MCP23S08
 // Description:
 //		Header file for work with expander.
-// Version: 0.0.1
-// Date: 14.12.2018
+//		The driver keeps shadow copies of IODIR, OLAT and GPINTEN registers, so setting output pins costs one SPI write
+//		and reading output pins costs no SPI transfers. In interrupt capture mode inputs are read only when the expander INT pin is active.
+// Version: 0.1.0
+// Date: 18.10.2026
 // Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
 
 #ifndef _MCP23S08_h
-#define _MCP2S308_h
+#define _MCP23S08_h
 
-#include "arduino.h"
+#include "Arduino.h"
 #include <SPI.h>
 
+// Max count of registers read/write in one transfer.
+#define MCP23S08_MAX_REGISTERS 11
+
 class MCP23S08Class
 {
  protected:
 	 uint8_t ReadRegister(uint8_t address);
 	 void WriteRegister(uint8_t address, uint8_t data);
-	 void TransferBytes();
+	 void ReadRegisters(uint8_t address, uint8_t* data, uint8_t count);
+	 void TransferBytes(uint8_t count);
 
  public:
 	void init(int cs);
+
+	/**
+	 * @brief Read registers from the expander and refresh shadow copies. Use it if the expander is reset outside from the driver.
+	 *
+	 * @return void
+	 */
+	void Refresh();
+
 	void SetPinState(uint8_t pinNumber, bool state);
 	bool GetPinState(uint8_t pinNumber);
 	void SetPinDirection(uint8_t pinNumber, uint8_t mode);
+
+	/**
+	 * @brief Set state of several pins with one SPI write.
+	 *
+	 * @param mask Pins to be changed. Bit 0 - pin 0 ... bit 7 - pin 7.
+	 * @param states New states of pins in mask.
+	 *
+	 * @return void
+	 */
+	void SetPinsState(uint8_t mask, uint8_t states);
+
+	/**
+	 * @brief Get all pins state. Output pins are taken from shadow OLAT, input pins are read from GPIO if it is necessary.
+	 *
+	 * @return uint8_t Pins state. Bit 0 - pin 0 ... bit 7 - pin 7.
+	 */
+	uint8_t GetPinsState();
+
+	/**
+	 * @brief Set direction of several pins with one SPI write.
+	 *
+	 * @param mask Pins to be changed.
+	 * @param mode INPUT or OUTPUT.
+	 *
+	 * @return void
+	 */
+	void SetPinsDirection(uint8_t mask, uint8_t mode);
+
+	/**
+	 * @brief Start interrupt capture mode. The expander activates its INT pin (active low) when any pin from mask changes.
+	 *        While INT pin is inactive input states are returned from the cache without SPI transfer.
+	 *
+	 * @param mask Input pins to watch.
+	 * @param intPin MCU pin connected to the expander INT. If -1 INT is not connected and interrupt flags are read by SPI.
+	 *
+	 * @return void
+	 */
+	void EnableInterruptCapture(uint8_t mask, int intPin);
+
+	/**
+	 * @brief Stop interrupt capture mode.
+	 *
+	 * @return void
+	 */
+	void DisableInterruptCapture();
+
+	/**
+	 * @brief Check for captured inputs change. Reads INTF and INTCAP in one transfer.
+	 *
+	 * @param flags Pins which caused the interrupt.
+	 * @param captured Pins state at the interrupt moment.
+	 *
+	 * @return bool true - there is a change, false - no change.
+	 */
+	bool ReadInterrupt(uint8_t& flags, uint8_t& captured);
+
+ private:
+	int _cs;
+	int _intPin;
+	uint8_t _iodir;
+	uint8_t _olat;
+	uint8_t _gpinten;
+	// Last read GPIO. Valid in interrupt capture mode.
+	uint8_t _gpio;
+	bool _gpioValid;
+
+	uint8_t _txData[MCP23S08_MAX_REGISTERS + 2] __attribute__((aligned(4)));
+	uint8_t _rxData[MCP23S08_MAX_REGISTERS + 2] __attribute__((aligned(4)));
+
+	bool IsInterruptActive();
+	uint8_t ReadInputs();
 };
 
 extern MCP23S08Class MCP23S08;
 
 #endif
-
@@ -51,7 +51,9 @@ GPRS::GPRS() :
   _status(IDLE),
   _timeout(0)
 {
-  MODEM.addUrcHandler(this);
+  MODEM.addUrcHandler(this, "+UUPINGER");
+  MODEM.addUrcHandler(this, "+UUPING");
+  MODEM.addUrcHandler(this, "+UUPSDD");
 }
 
 GPRS::~GPRS()
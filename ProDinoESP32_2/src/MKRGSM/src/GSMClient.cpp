@@ -23,6 +23,11 @@
 
 #include "GSMClient.h"
 
+// max data length of AT+USOWR in binary mode
+#ifndef GSM_SOCKET_WRITE_MAX_SIZE
+#define GSM_SOCKET_WRITE_MAX_SIZE 1024
+#endif
+
 enum {
   CLIENT_STATE_IDLE,
   CLIENT_STATE_CREATE_SOCKET,
@@ -52,18 +57,41 @@ GSMClient::GSMClient(int socket, bool synch) :
   _port(0),
   _ssl(false),
   _sslprofile(1),
-  _writeSync(true)
+  _writeSync(true),
+  _writeBuffer(NULL),
+  _writeId(-1),
+  _writeResult(1)
 {
-  MODEM.addUrcHandler(this);
+  MODEM.addUrcHandler(this, "+UUSORD");
 }
 
 GSMClient::~GSMClient()
 {
+  // the modem reads the buffer until the queued write is done
+  flush();
+  free(_writeBuffer);
+
   MODEM.removeUrcHandler(this);
 }
 
 int GSMClient::ready()
 {
+  if (_writeId != -1) {
+    MODEM.poll();
+
+    if (_writeId != -1) {
+      return 0;
+    }
+  }
+
+  // the error of an async write is returned once
+  if (_writeResult != 1) {
+    int result = _writeResult;
+    _writeResult = 1;
+
+    return result;
+  }
+
   int ready = MODEM.ready();
 
   if (ready == 0) {
@@ -91,6 +119,9 @@ int GSMClient::ready()
       } else {
         _socket = _response.charAt(_response.length() - 1) - '0';
 
+        // data and close URCs of a previous socket with this number
+        GSMSocketBuffer.close(_socket);
+
         if (_ssl) {
           _state = CLIENT_STATE_ENABLE_SSL;
         } else {
@@ -277,41 +308,51 @@ size_t GSMClient::write(const uint8_t* buf, size_t size)
     return 0;
   }
 
-  size_t written = 0;
-  String command;
+  if (!_writeSync) {
+    if (_writeBuffer == NULL) {
+      _writeBuffer = (uint8_t*)malloc(GSM_SOCKET_WRITE_MAX_SIZE);
 
-  command.reserve(19 + (size > 256 ? 256 : size) * 2);
+      if (_writeBuffer == NULL) {
+        return 0;
+      }
+    }
 
-  while (size) {
-    size_t chunkSize = size;
+    if (size > GSM_SOCKET_WRITE_MAX_SIZE) {
+      size = GSM_SOCKET_WRITE_MAX_SIZE;
+    }
 
-    if (chunkSize > 256) {
-      chunkSize = 256;
+    memcpy(_writeBuffer, buf, size);
+
+    char command[24];
+    snprintf(command, sizeof(command), "AT+USOWR=%d,%d", _socket, (int)size);
+
+    // poll() sends it when the modem is free, ready() is 0 until the result
+    _writeId = MODEM.enqueue(command, _writeBuffer, size, onWriteResult, this);
+    if (_writeId == -1) {
+      return 0;
     }
 
-    command = "AT+USOWR=";
-    command += _socket;
-    command += ",";
-    command += chunkSize;
-    command += ",\"";
+    return size;
+  }
 
-    for (size_t i = 0; i < chunkSize; i++) {
-      byte b = buf[i + written];
+  size_t written = 0;
 
-      byte n1 = (b >> 4) & 0x0f;
-      byte n2 = (b & 0x0f);
+  while (size) {
+    size_t chunkSize = size;
 
-      command += (char)(n1 > 9 ? 'A' + n1 - 10 : '0' + n1);
-      command += (char)(n2 > 9 ? 'A' + n2 - 10 : '0' + n2);
+    if (chunkSize > GSM_SOCKET_WRITE_MAX_SIZE) {
+      chunkSize = GSM_SOCKET_WRITE_MAX_SIZE;
     }
 
-    command += "\"";
+    // binary mode, the data follows the '@' prompt
+    MODEM.sendf("AT+USOWR=%d,%d", _socket, (int)chunkSize);
+    if (MODEM.writeBinary(buf + written, chunkSize) != 1) {
+      MODEM.waitForResponse(10000);
+      break;
+    }
 
-    MODEM.send(command);
-    if (_writeSync) {
-      if (MODEM.waitForResponse(10000) != 1) {
-        break;
-      }
+    if (MODEM.waitForResponse(10000) != 1) {
+      break;
     }
 
     written += chunkSize;
@@ -335,7 +376,7 @@ uint8_t GSMClient::connected()
   }
 
   // call available to update socket state
-  if ((GSMSocketBuffer.available(_socket) < 0) || (_ssl && !_connected)) {
+  if ((GSMSocketBuffer.available(_socket, _synch) < 0) || (_ssl && !_connected)) {
     stop();
 
     return 0;
@@ -391,7 +432,8 @@ int GSMClient::available()
     return 0;
   }
 
-  int avail = GSMSocketBuffer.available(_socket);
+  // async mode, the data of AT+USORD is received by MODEM.poll()
+  int avail = GSMSocketBuffer.available(_socket, _synch);
 
   if (avail < 0) {
     stop();
@@ -413,10 +455,16 @@ int GSMClient::peek()
 
 void GSMClient::flush()
 {
+  while (_writeId != -1) {
+    MODEM.poll();
+  }
 }
 
 void GSMClient::stop()
 {
+  // the queued data is sent before the close
+  flush();
+
   _state = CLIENT_STATE_IDLE;
 
   if (_socket < 0) {
@@ -431,6 +479,15 @@ void GSMClient::stop()
   _connected = false;
 }
 
+void GSMClient::onWriteResult(int result, const char* /*response*/, void* arg)
+{
+  GSMClient* client = (GSMClient*)arg;
+
+  client->_writeId = -1;
+  // a timeout is an error for ready()
+  client->_writeResult = (result == -1) ? 2 : result;
+}
+
 void GSMClient::handleUrc(const String& urc)
 {
   if (urc.startsWith("+UUSORD: ")) {
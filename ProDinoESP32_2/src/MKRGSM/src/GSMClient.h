@@ -64,7 +64,8 @@ public:
   int connectSSL(const char *host, uint16_t port);
 
   /** Initialize write in request
-      @param sync     Sync mode
+      @param sync     Sync mode. In async mode write() copies max 1024 bytes, queues AT+USOWR (MODEM.enqueue)
+                      and returns at once, ready() is 0 until the modem confirms the data.
    */
   void beginWrite(bool sync = false);
 
@@ -121,7 +122,7 @@ public:
    */
   int peek();
 
-  /** Flush response buffer
+  /** Wait for the data of an async write
    */
   void flush();
 
@@ -151,6 +152,13 @@ private:
   int _sslprofile;
   bool _writeSync;
   String _response;
+
+  // async write, the data must be valid until the queued AT+USOWR is done
+  uint8_t* _writeBuffer;
+  int _writeId;
+  int _writeResult;
+
+  static void onWriteResult(int result, const char* response, void* arg);
 };
 
 #endif
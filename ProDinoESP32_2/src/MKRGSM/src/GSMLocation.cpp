@@ -29,7 +29,7 @@ GSMLocation::GSMLocation() :
   _altitude(0),
   _uncertainty(0)
 {
-  MODEM.addUrcHandler(this);
+  MODEM.addUrcHandler(this, "+UULOC");
 }
 
 GSMLocation::~GSMLocation()
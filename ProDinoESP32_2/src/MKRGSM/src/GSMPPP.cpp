@@ -0,0 +1,405 @@
+/*
+  This file is part of the MKR GSM library.
+  Copyright (C) 2026  KMP Electronics Ltd (https://kmpelectronics.eu/)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Modem.h"
+
+#include "GSMPPP.h"
+
+#ifdef GSM_PPP_SUPPORTED
+#include <lwip/api.h>
+#include <lwip/dns.h>
+#include <netif/ppp/pppapi.h>
+#endif
+
+// guard time of the "+++" escape sequence
+#define GSM_PPP_ESCAPE_GUARD_MS 1000
+
+#ifdef GSM_PPP_SUPPORTED
+static IPAddress toIPAddress(const ip_addr_t* addr)
+{
+  if (addr == NULL || !IP_IS_V4(addr)) {
+    return IPAddress(0, 0, 0, 0);
+  }
+
+  return IPAddress(ip4_addr_get_u32(ip_2_ip4(addr)));
+}
+#endif
+
+GSMPPPClass::GSMPPPClass() :
+  _stream(NULL),
+  _task(NULL),
+  _running(false),
+  _connected(false),
+  _dead(true)
+#ifdef GSM_PPP_SUPPORTED
+  ,
+  _pcb(NULL)
+#endif
+{
+}
+
+int GSMPPPClass::begin(const char* apn, const char* user, const char* password, unsigned long timeout)
+{
+  return begin(MODEM.stream(), apn, user, password, timeout);
+}
+
+int GSMPPPClass::begin(Stream& stream, const char* apn, const char* user, const char* password, unsigned long timeout)
+{
+#ifdef GSM_PPP_SUPPORTED
+  if (_stream != NULL) {
+    return 0;
+  }
+
+  unsigned long start = millis();
+
+  if (!dial(stream, apn, timeout)) {
+    return 0;
+  }
+
+  _stream = &stream;
+
+  // MODEM doesn't read or write its stream while PPP runs on it
+  if (&stream == &MODEM.stream()) {
+    MODEM.setDataMode(true);
+  }
+
+  unsigned long elapsed = millis() - start;
+  if (!this->start(user, password, elapsed < timeout ? timeout - elapsed : 0)) {
+    end();
+    return 0;
+  }
+
+  return 1;
+#else
+  (void)stream;
+  (void)apn;
+  (void)user;
+  (void)password;
+  (void)timeout;
+
+  return 0;
+#endif
+}
+
+void GSMPPPClass::end()
+{
+  if (_stream == NULL) {
+    return;
+  }
+
+  stop();
+
+  // LCP terminate returns the modem to command mode, else the data call is escaped
+  Stream& stream = *_stream;
+  _stream = NULL;
+
+  if (&stream == &MODEM.stream()) {
+    MODEM.setDataMode(false);
+
+    MODEM.send("AT");
+    if (MODEM.waitForResponse(GSM_PPP_ESCAPE_GUARD_MS) == 1) {
+      return;
+    }
+  }
+
+  delay(GSM_PPP_ESCAPE_GUARD_MS);
+  stream.print("+++");
+  delay(GSM_PPP_ESCAPE_GUARD_MS);
+  stream.print("ATH\r");
+
+  if (&stream == &MODEM.stream()) {
+    MODEM.waitForResponse(GSM_PPP_ESCAPE_GUARD_MS);
+  }
+}
+
+bool GSMPPPClass::connected()
+{
+  return _connected;
+}
+
+IPAddress GSMPPPClass::localIP()
+{
+#ifdef GSM_PPP_SUPPORTED
+  if (_connected) {
+    return IPAddress(ip4_addr_get_u32(netif_ip4_addr(&_netif)));
+  }
+#endif
+
+  return IPAddress(0, 0, 0, 0);
+}
+
+IPAddress GSMPPPClass::gatewayIP()
+{
+#ifdef GSM_PPP_SUPPORTED
+  if (_connected) {
+    return IPAddress(ip4_addr_get_u32(netif_ip4_gw(&_netif)));
+  }
+#endif
+
+  return IPAddress(0, 0, 0, 0);
+}
+
+IPAddress GSMPPPClass::dnsIP(int index)
+{
+#ifdef GSM_PPP_SUPPORTED
+  if (_connected && index >= 0 && index < DNS_MAX_SERVERS) {
+    return toIPAddress(dns_getserver(index));
+  }
+#else
+  (void)index;
+#endif
+
+  return IPAddress(0, 0, 0, 0);
+}
+
+int GSMPPPClass::hostByName(const char* host, IPAddress& ip)
+{
+  if (ip.fromString(host)) {
+    return 1;
+  }
+
+#ifdef GSM_PPP_SUPPORTED
+  ip_addr_t addr;
+
+  if (_connected && netconn_gethostbyname(host, &addr) == ERR_OK) {
+    ip = toIPAddress(&addr);
+
+    return 1;
+  }
+#endif
+
+  return 0;
+}
+
+int GSMPPPClass::dial(Stream& stream, const char* apn, unsigned long timeout)
+{
+  MODEM.sendf("AT+CGDCONT=1,\"IP\",\"%s\"", apn);
+  if (MODEM.waitForResponse(1000) != 1) {
+    return 0;
+  }
+
+  if (&stream == &MODEM.stream()) {
+    MODEM.send("ATD*99***1#");
+
+    return (MODEM.waitForResponse(timeout) == 4);
+  }
+
+  // another channel, the result line is read here. available() receives the data of a ModemMux channel.
+  while (stream.available()) {
+    stream.read();
+  }
+  stream.print("ATD*99***1#\r");
+
+  char line[16];
+  size_t length = 0;
+
+  for (unsigned long start = millis(); (millis() - start) < timeout;) {
+    if (!stream.available()) {
+      delay(1);
+      continue;
+    }
+
+    int c = stream.read();
+
+    if (c != '\r' && c != '\n') {
+      if (length < sizeof(line) - 1) {
+        line[length++] = c;
+      }
+      continue;
+    }
+
+    line[length] = '\0';
+    length = 0;
+
+    if (strncmp(line, "CONNECT", 7) == 0) {
+      return 1;
+    } else if (strcmp(line, "NO CARRIER") == 0 || strcmp(line, "ERROR") == 0 || strncmp(line, "+CME ERROR", 10) == 0) {
+      return 0;
+    }
+  }
+
+  return 0;
+}
+
+#ifdef GSM_PPP_SUPPORTED
+int GSMPPPClass::start(const char* user, const char* password, unsigned long timeout)
+{
+  _connected = false;
+  _dead = false;
+
+  _pcb = pppapi_pppos_create(&_netif, output, status, this);
+  if (_pcb == NULL) {
+    _dead = true;
+    return 0;
+  }
+
+  _running = true;
+  if (xTaskCreatePinnedToCore(task, "ppp", GSM_PPP_TASK_STACK_SIZE, this, GSM_PPP_TASK_PRIORITY, &_task, ARDUINO_RUNNING_CORE) != pdPASS) {
+    _running = false;
+    _task = NULL;
+    stop();
+    return 0;
+  }
+
+  pppapi_set_default(_pcb);
+  ppp_set_usepeerdns(_pcb, 1);
+
+  if (user != NULL && *user != '\0') {
+    pppapi_set_auth(_pcb, PPPAUTHTYPE_ANY, user, password != NULL ? password : "");
+  }
+
+  if (pppapi_connect(_pcb, 0) != ERR_OK) {
+    return 0;
+  }
+
+  for (unsigned long start = millis(); !_connected && !_dead && (millis() - start) < timeout;) {
+    delay(10);
+  }
+
+  return _connected;
+}
+
+void GSMPPPClass::stop()
+{
+  if (_pcb != NULL) {
+    // the status callback reports PPPERR_USER when the link is down
+    if (!_dead) {
+      pppapi_close(_pcb, 0);
+
+      for (unsigned long start = millis(); !_dead && (millis() - start) < 5000;) {
+        delay(10);
+      }
+
+      if (!_dead) {
+        pppapi_close(_pcb, 1);
+      }
+    }
+  }
+
+  _running = false;
+  while (_task != NULL) {
+    delay(1);
+  }
+
+  if (_pcb != NULL) {
+    pppapi_free(_pcb);
+    _pcb = NULL;
+  }
+
+  _connected = false;
+  _dead = true;
+}
+
+void GSMPPPClass::task(void* arg)
+{
+  GSMPPPClass* ppp = (GSMPPPClass*)arg;
+  u8_t buffer[GSM_PPP_RX_BUFFER_SIZE];
+
+  while (ppp->_running) {
+    // available() also receives the frames of a ModemMux channel
+    int length = ppp->_stream->available();
+
+    if (length > (int)sizeof(buffer)) {
+      length = sizeof(buffer);
+    }
+
+    for (int i = 0; i < length; i++) {
+      buffer[i] = ppp->_stream->read();
+    }
+
+    if (length > 0) {
+      pppos_input_tcpip(ppp->_pcb, buffer, length);
+    } else {
+      vTaskDelay(1);
+    }
+  }
+
+  ppp->_task = NULL;
+  vTaskDelete(NULL);
+}
+
+u32_t GSMPPPClass::output(ppp_pcb* /*pcb*/, u8_t* data, u32_t length, void* ctx)
+{
+  GSMPPPClass* ppp = (GSMPPPClass*)ctx;
+
+  if (ppp->_stream == NULL) {
+    return 0;
+  }
+
+  return ppp->_stream->write(data, length);
+}
+
+void GSMPPPClass::status(ppp_pcb* /*pcb*/, int error, void* ctx)
+{
+  GSMPPPClass* ppp = (GSMPPPClass*)ctx;
+
+  if (error == PPPERR_NONE) {
+    ppp->_connected = true;
+    return;
+  }
+
+  // PPPERR_USER and the errors of the peer, the link is down and the pcb can be freed
+  ppp->_connected = false;
+  ppp->_dead = true;
+}
+#else
+int GSMPPPClass::start(const char* /*user*/, const char* /*password*/, unsigned long /*timeout*/)
+{
+  return 0;
+}
+
+void GSMPPPClass::stop()
+{
+}
+#endif
+
+int GSMPPPClient::connect(const char* host, uint16_t port)
+{
+  IPAddress ip;
+
+  if (!GSMPPP.hostByName(host, ip)) {
+    return 0;
+  }
+
+  return WiFiClient::connect(ip, port);
+}
+
+int GSMPPPClient::connect(const char* host, uint16_t port, int32_t timeout)
+{
+  IPAddress ip;
+
+  if (!GSMPPP.hostByName(host, ip)) {
+    return 0;
+  }
+
+  return WiFiClient::connect(ip, port, timeout);
+}
+
+int GSMPPPUDP::beginPacket(const char* host, uint16_t port)
+{
+  IPAddress ip;
+
+  if (!GSMPPP.hostByName(host, ip)) {
+    return 0;
+  }
+
+  return WiFiUDP::beginPacket(ip, port);
+}
+
+GSMPPPClass GSMPPP;
@@ -0,0 +1,133 @@
+/*
+  This file is part of the MKR GSM library.
+  Copyright (C) 2026  KMP Electronics Ltd (https://kmpelectronics.eu/)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _GSM_PPP_INCLUDED_H
+#define _GSM_PPP_INCLUDED_H
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <WiFiClient.h>
+#include <WiFiUdp.h>
+#include <lwip/opt.h>
+
+#if PPP_SUPPORT && PPPOS_SUPPORT
+#include <netif/ppp/pppos.h>
+#define GSM_PPP_SUPPORTED
+#endif
+
+// PPP data mode. The modem dials the packet data service (ATD*99***1#) and only carries the link,
+// TCP/IP runs in the lwIP stack of the ESP32. GSMPPPClient and GSMPPPUDP are the standard lwIP
+// socket clients with host names resolved over the PPP link.
+// MODEM's stream is used by PPP until end(). In this time MODEM is in data mode: send() gives ERROR
+// and poll() doesn't read, so the AT socket clients fail at once. On a ModemMux channel
+// (begin(channel, ...)) MODEM stays in command mode on channel 1, the PPP task receives the frames
+// of the multiplexer and lwIP writes the PPP frames from its own task.
+// lwIP must be built with PPP_SUPPORT and PPPOS_SUPPORT (CONFIG_LWIP_PPP_SUPPORT), otherwise
+// begin() fails and the AT socket clients (GSMClient, GSMUDP) should be used.
+
+// receive task
+#ifndef GSM_PPP_TASK_STACK_SIZE
+#define GSM_PPP_TASK_STACK_SIZE 4096
+#endif
+
+#ifndef GSM_PPP_TASK_PRIORITY
+#define GSM_PPP_TASK_PRIORITY 5
+#endif
+
+#ifndef GSM_PPP_RX_BUFFER_SIZE
+#define GSM_PPP_RX_BUFFER_SIZE 256
+#endif
+
+class GSMPPPClass {
+
+public:
+  GSMPPPClass();
+
+  /** Dial the packet data service and start PPP on MODEM's stream
+      @param apn        APN of the network operator
+      @param user       user name, NULL or "" without authentication
+      @param password   password
+      @param timeout    time for the dial and the PPP negotiation in ms
+      @return 1 if the link is up, 0 if not, the modem stays in command mode
+   */
+  int begin(const char* apn, const char* user = NULL, const char* password = NULL, unsigned long timeout = 30000);
+
+  /** Start PPP on another stream, e.g. a ModemMux channel, MODEM stays in command mode
+      @return 1 if the link is up, 0 if not
+   */
+  int begin(Stream& stream, const char* apn, const char* user = NULL, const char* password = NULL, unsigned long timeout = 30000);
+
+  /** Close PPP and return the modem to command mode
+   */
+  void end();
+
+  /** @return true if PPP is up and has an IP address
+   */
+  bool connected();
+
+  // PPP is the default network interface while it is up
+  IPAddress localIP();
+  IPAddress gatewayIP();
+  IPAddress dnsIP(int index = 0);
+
+  /** Resolve a host name with the DNS servers of the network
+      @return 1 if resolved, 0 if not
+   */
+  int hostByName(const char* host, IPAddress& ip);
+
+private:
+  Stream* _stream;
+  TaskHandle_t _task;
+  volatile bool _running;
+  volatile bool _connected;
+  volatile bool _dead;
+#ifdef GSM_PPP_SUPPORTED
+  ppp_pcb* _pcb;
+  struct netif _netif;
+
+  static void task(void* arg);
+  static u32_t output(ppp_pcb* pcb, u8_t* data, u32_t length, void* ctx);
+  static void status(ppp_pcb* pcb, int error, void* ctx);
+#endif
+
+  int dial(Stream& stream, const char* apn, unsigned long timeout);
+  int start(const char* user, const char* password, unsigned long timeout);
+  void stop();
+};
+
+class GSMPPPClient : public WiFiClient {
+
+public:
+  using WiFiClient::connect;
+  // the host is resolved by GSMPPP
+  int connect(const char* host, uint16_t port);
+  int connect(const char* host, uint16_t port, int32_t timeout);
+};
+
+class GSMPPPUDP : public WiFiUDP {
+
+public:
+  using WiFiUDP::beginPacket;
+  // the host is resolved by GSMPPP
+  int beginPacket(const char* host, uint16_t port);
+};
+
+extern GSMPPPClass GSMPPP;
+
+#endif
@@ -17,11 +17,17 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <MD5Builder.h>
+
 #include "Modem.h"
 
 #include "GSMSSLClient.h"
 
 enum {
+  SSL_CLIENT_STATE_LIST_ROOT_CERTS,
+  SSL_CLIENT_STATE_WAIT_LIST_ROOT_CERTS_RESPONSE,
+  SSL_CLIENT_STATE_CHECK_ROOT_CERT,
+  SSL_CLIENT_STATE_WAIT_MD5_ROOT_CERT_RESPONSE,
   SSL_CLIENT_STATE_LOAD_ROOT_CERT,
   SSL_CLIENT_STATE_WAIT_LOAD_ROOT_CERT_RESPONSE,
   SSL_CLIENT_STATE_WAIT_DELETE_ROOT_CERT_RESPONSE
@@ -55,25 +61,88 @@ int GSMSSLClient::ready()
   }
 
   switch (_state) {
-    case SSL_CLIENT_STATE_LOAD_ROOT_CERT: {
-      if (_gsmRoots[_certIndex].size) {
-        // load the next root cert
-        MODEM.sendf("AT+USECMNG=0,0,\"%s\",%d", _gsmRoots[_certIndex].name, _gsmRoots[_certIndex].size);
-        if (MODEM.waitForPrompt() != 1) {
-          // failure
-          ready = -1;
-        } else {
-          // send the cert contents
-          MODEM.write(_gsmRoots[_certIndex].data, _gsmRoots[_certIndex].size);
+    case SSL_CLIENT_STATE_LIST_ROOT_CERTS: {
+      // the certs stored in the modem, only missing or changed ones are loaded
+      _certList = "";
+      MODEM.send("AT+USECMNG=3,0");
+      MODEM.setResponseDataStorage(&_certList);
+
+      _state = SSL_CLIENT_STATE_WAIT_LIST_ROOT_CERTS_RESPONSE;
+      ready = 0;
+      break;
+    }
+
+    case SSL_CLIENT_STATE_WAIT_LIST_ROOT_CERTS_RESPONSE: {
+      if (ready > 1) {
+        // the list isn't available, all certs are loaded
+        _certList = "";
+      }
+
+      _state = SSL_CLIENT_STATE_CHECK_ROOT_CERT;
+      ready = 0;
+      break;
+    }
 
-          _state = SSL_CLIENT_STATE_WAIT_LOAD_ROOT_CERT_RESPONSE;
-          ready = 0;
+    case SSL_CLIENT_STATE_CHECK_ROOT_CERT: {
+      if (_certIndex >= _sizeRoot) {
+        // all certs loaded
+        _rootCertsLoaded = true;
+        _certList = "";
+        _certMd5 = "";
+
+        ready = 0;
+        break;
+      }
+
+      const GSMRootCert& cert = _gsmRoots[_certIndex];
+
+      if (!isRootCertStored(cert)) {
+        if (cert.size) {
+          _state = SSL_CLIENT_STATE_LOAD_ROOT_CERT;
+        } else {
+          // nothing to remove
+          nextRootCert();
         }
+      } else if (cert.size) {
+        // compare the MD5 of the stored cert
+        _certMd5 = "";
+        MODEM.sendf("AT+USECMNG=4,0,\"%s\"", cert.name);
+        MODEM.setResponseDataStorage(&_certMd5);
+
+        _state = SSL_CLIENT_STATE_WAIT_MD5_ROOT_CERT_RESPONSE;
       } else {
-        // remove the next root cert name
-        MODEM.sendf("AT+USECMNG=2,0,\"%s\"", _gsmRoots[_certIndex].name);
+        // remove the root cert name
+        MODEM.sendf("AT+USECMNG=2,0,\"%s\"", cert.name);
 
         _state = SSL_CLIENT_STATE_WAIT_DELETE_ROOT_CERT_RESPONSE;
+      }
+
+      ready = 0;
+      break;
+    }
+
+    case SSL_CLIENT_STATE_WAIT_MD5_ROOT_CERT_RESPONSE: {
+      if (ready == 1 && !isRootCertChanged(_gsmRoots[_certIndex])) {
+        nextRootCert();
+      } else {
+        _state = SSL_CLIENT_STATE_LOAD_ROOT_CERT;
+      }
+
+      ready = 0;
+      break;
+    }
+
+    case SSL_CLIENT_STATE_LOAD_ROOT_CERT: {
+      // load the next root cert
+      MODEM.sendf("AT+USECMNG=0,0,\"%s\",%d", _gsmRoots[_certIndex].name, _gsmRoots[_certIndex].size);
+      if (MODEM.waitForPrompt() != 1) {
+        // failure
+        ready = -1;
+      } else {
+        // send the cert contents
+        MODEM.write(_gsmRoots[_certIndex].data, _gsmRoots[_certIndex].size);
+
+        _state = SSL_CLIENT_STATE_WAIT_LOAD_ROOT_CERT_RESPONSE;
         ready = 0;
       }
       break;
@@ -83,16 +152,7 @@ int GSMSSLClient::ready()
       if (ready > 1) {
         // error
       } else {
-        _certIndex++;
-
-        if (_certIndex == _sizeRoot) {
-          // all certs loaded
-          _rootCertsLoaded = true;
-        } else {
-          // load next
-          _state = SSL_CLIENT_STATE_LOAD_ROOT_CERT;
-        }
-
+        nextRootCert();
         ready = 0;
       }
       break;
@@ -100,16 +160,7 @@ int GSMSSLClient::ready()
 
     case SSL_CLIENT_STATE_WAIT_DELETE_ROOT_CERT_RESPONSE: {
       // ignore ready response, root cert might not exist
-      _certIndex++;
-
-      if (_certIndex == GSM_NUM_ROOT_CERTS) {
-        // all certs loaded
-        _rootCertsLoaded = true;
-      } else {
-        // load next
-        _state = SSL_CLIENT_STATE_LOAD_ROOT_CERT;
-      }
-
+      nextRootCert();
       ready = 0;
       break;
     }
@@ -118,10 +169,51 @@ int GSMSSLClient::ready()
   return ready;
 }
 
+bool GSMSSLClient::isRootCertStored(const GSMRootCert& cert)
+{
+  // CA,"<name>","<subject>","<expiration>"
+  String name = "\"";
+  name += cert.name;
+  name += "\",";
+
+  return _certList.indexOf(name) != -1;
+}
+
+bool GSMSSLClient::isRootCertChanged(const GSMRootCert& cert)
+{
+  // +USECMNG: 4,0,"<name>","<md5>"
+  int end = _certMd5.lastIndexOf('"');
+  int start = end > 0 ? _certMd5.lastIndexOf('"', end - 1) : -1;
+
+  if (start < 0) {
+    return true;
+  }
+
+  String md5 = _certMd5.substring(start + 1, end);
+
+  if (cert.md5) {
+    return !md5.equalsIgnoreCase(cert.md5);
+  }
+
+  // a user root without the hash
+  MD5Builder builder;
+  builder.begin();
+  builder.add((uint8_t*)cert.data, cert.size);
+  builder.calculate();
+
+  return !md5.equalsIgnoreCase(builder.toString());
+}
+
+void GSMSSLClient::nextRootCert()
+{
+  _certIndex++;
+  _state = SSL_CLIENT_STATE_CHECK_ROOT_CERT;
+}
+
 int GSMSSLClient::connect(IPAddress ip, uint16_t port)
 {
   _certIndex = 0;
-  _state = SSL_CLIENT_STATE_LOAD_ROOT_CERT;
+  _state = SSL_CLIENT_STATE_LIST_ROOT_CERTS;
 
   return connectSSL(ip, port);
 }
@@ -129,7 +221,7 @@ int GSMSSLClient::connect(IPAddress ip, uint16_t port)
 int GSMSSLClient::connect(const char* host, uint16_t port)
 {
   _certIndex = 0;
-  _state = SSL_CLIENT_STATE_LOAD_ROOT_CERT;
+  _state = SSL_CLIENT_STATE_LIST_ROOT_CERTS;
 
   return connectSSL(host, port);
 }
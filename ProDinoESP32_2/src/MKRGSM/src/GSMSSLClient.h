@@ -46,6 +46,13 @@ private:
   int _state;
   const GSMRootCert * _gsmRoots;
   int _sizeRoot;
+  // AT+USECMNG=3 list of the certs in the modem and AT+USECMNG=4 MD5 response
+  String _certList;
+  String _certMd5;
+
+  bool isRootCertStored(const GSMRootCert& cert);
+  bool isRootCertChanged(const GSMRootCert& cert);
+  void nextRootCert();
 
 };
 
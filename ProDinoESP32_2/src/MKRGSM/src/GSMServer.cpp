@@ -41,7 +41,9 @@ GSMServer::GSMServer(uint16_t port, bool synch) :
     _childSockets[i].available = 0;
   }
 
-  MODEM.addUrcHandler(this);
+  MODEM.addUrcHandler(this, "+UUSOLI");
+  MODEM.addUrcHandler(this, "+UUSOCL");
+  MODEM.addUrcHandler(this, "+UUSORD");
 }
 
 GSMServer::~GSMServer()
@@ -147,25 +149,13 @@ GSMClient GSMServer::available(bool synch)
     }
 
     if (socket == -1) {
-      // no new accepted sockets, search for one with data to be read
+      // no new accepted sockets, search for one with data to be read,
+      // closed sockets are removed by +UUSOCL
       for (int i = 0; i < MAX_CHILD_SOCKETS; i++) {
-        if (_childSockets[i].socket != -1) {
-          // check if socket is still alive
-          MODEM.sendf("AT+USORD=%d,0", _childSockets[i].socket);
-          if (MODEM.waitForResponse(10000) != 1) {
-            // closed
-            _childSockets[i].socket = -1;
-            _childSockets[i].accepted = false;
-            _childSockets[i].available = 0;
-
-            continue;
-          }
-
-          if (_childSockets[i].available) {
-            _childSockets[i].available = 0;
-            socket = _childSockets[i].socket;
-            break;
-          }
+        if (_childSockets[i].socket != -1 && _childSockets[i].available) {
+          _childSockets[i].available = 0;
+          socket = _childSockets[i].socket;
+          break;
         }
       }
     }
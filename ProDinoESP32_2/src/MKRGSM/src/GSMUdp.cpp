@@ -31,13 +31,19 @@ GSMUDP::GSMUDP() :
   _rxIp((uint32_t)0),
   _rxPort(0),
   _rxSize(0),
-  _rxIndex(0)
+  _rxIndex(0),
+  _txId(-1),
+  _txResult(1)
 {
-  MODEM.addUrcHandler(this);
+  MODEM.addUrcHandler(this, "+UUSORF");
+  MODEM.addUrcHandler(this, "+UUSOCL");
 }
 
 GSMUDP::~GSMUDP()
 {
+  // the modem reads the buffer until the queued packet is sent
+  waitSend();
+
   MODEM.removeUrcHandler(this);
 }
 
@@ -64,6 +70,9 @@ uint8_t GSMUDP::begin(uint16_t port)
 
 void GSMUDP::stop()
 {
+  // the queued packet is sent before the close
+  waitSend();
+
   if (_socket < 0) {
     return;
   }
@@ -76,6 +85,9 @@ void GSMUDP::stop()
 
 int GSMUDP::beginPacket(IPAddress ip, uint16_t port)
 {
+  // _txBuffer is in use until the queued packet is sent
+  waitSend();
+
   if (_socket < 0) {
     return 0;
   }
@@ -90,6 +102,9 @@ int GSMUDP::beginPacket(IPAddress ip, uint16_t port)
 
 int GSMUDP::beginPacket(const char *host, uint16_t port)
 {
+  // _txBuffer is in use until the queued packet is sent
+  waitSend();
+
   if (_socket < 0) {
     return 0;
   }
@@ -104,49 +119,33 @@ int GSMUDP::beginPacket(const char *host, uint16_t port)
 
 int GSMUDP::endPacket()
 {
-  String command;
-
-  if (_txHost != NULL) {
-    command.reserve(26 + strlen(_txHost) + _txSize * 2);
-  } else {
-    command.reserve(41 + _txSize * 2);
+  if (_socket < 0) {
+    return 0;
   }
 
-  command += "AT+USOST=";
-  command += _socket;
-  command += ",\"";
+  char command[MODEM_COMMAND_SIZE];
+  int length;
 
   if (_txHost != NULL) {
-    command += _txHost;
+    length = snprintf(command, sizeof(command), "AT+USOST=%d,\"%s\",%d,%d", _socket, _txHost, _txPort, (int)_txSize);
   } else {
-    command += _txIp[0];
-    command += '.';
-    command += _txIp[1];
-    command += '.';
-    command += _txIp[2];
-    command += '.';
-    command += _txIp[3];
+    length = snprintf(command, sizeof(command), "AT+USOST=%d,\"%d.%d.%d.%d\",%d,%d", _socket, _txIp[0], _txIp[1], _txIp[2], _txIp[3], _txPort, (int)_txSize);
   }
 
-  command += "\",";
-  command += _txPort;
-  command += ",",
-  command += _txSize;
-  command += ",\"";
-
-  for (size_t i = 0; i < _txSize; i++) {
-    byte b = _txBuffer[i];
+  // poll() sends it when the modem is free, the data follows the '@' prompt
+  if (length > 0 && length < (int)sizeof(command)) {
+    _txId = MODEM.enqueue(command, _txBuffer, _txSize, onSendResult, this);
 
-    byte n1 = (b >> 4) & 0x0f;
-    byte n2 = (b & 0x0f);
-
-    command += (char)(n1 > 9 ? 'A' + n1 - 10 : '0' + n1);
-    command += (char)(n2 > 9 ? 'A' + n2 - 10 : '0' + n2);
+    return (_txId == -1) ? 0 : 1;
   }
 
-  command += "\"";
+  // a long host name doesn't fit in the queue
+  MODEM.sendf("AT+USOST=%d,\"%s\",%d,%d", _socket, _txHost, _txPort, (int)_txSize);
 
-  MODEM.send(command);
+  if (MODEM.writeBinary(_txBuffer, _txSize) != 1) {
+    MODEM.waitForResponse();
+    return 0;
+  }
 
   if (MODEM.waitForResponse() == 1) {
     return 1;
@@ -155,6 +154,39 @@ int GSMUDP::endPacket()
   }
 }
 
+int GSMUDP::ready()
+{
+  if (_txId != -1) {
+    MODEM.poll();
+
+    if (_txId != -1) {
+      return 0;
+    }
+  }
+
+  // the error of a queued packet is returned once
+  int result = _txResult;
+  _txResult = 1;
+
+  return result;
+}
+
+void GSMUDP::waitSend()
+{
+  while (_txId != -1) {
+    MODEM.poll();
+  }
+}
+
+void GSMUDP::onSendResult(int result, const char* /*response*/, void* arg)
+{
+  GSMUDP* udp = (GSMUDP*)arg;
+
+  udp->_txId = -1;
+  // a timeout is an error for ready()
+  udp->_txResult = (result == -1) ? 2 : result;
+}
+
 size_t GSMUDP::write(uint8_t b)
 {
   return write(&b, sizeof(b));
@@ -230,19 +262,12 @@ int GSMUDP::parsePacket()
   _rxSize = response.length() / 2;
 
   for (size_t i = 0; i < _rxSize; i++) {
-    byte n1 = response[i * 2];
-    byte n2 = response[i * 2 + 1];
-
-    if (n1 > '9') {
-      n1 = (n1 - 'A') + 10;
-    } else {
-      n1 = (n1 - '0');
-    }
+    int n1 = ModemClass::hexValue(response[i * 2]);
+    int n2 = ModemClass::hexValue(response[i * 2 + 1]);
 
-    if (n2 > '9') {
-      n2 = (n2 - 'A') + 10;
-    } else {
-      n2 = (n2 - '0');
+    if (n1 < 0 || n2 < 0) {
+      _rxSize = i;
+      break;
     }
 
     _rxBuffer[i] = (n1 << 4) | n2;
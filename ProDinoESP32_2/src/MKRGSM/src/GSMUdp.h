@@ -41,9 +41,11 @@ public:
   // Start building up a packet to send to the remote host specific in host and port
   // Returns 1 if successful, 0 if there was a problem resolving the hostname or port
   virtual int beginPacket(const char *host, uint16_t port);
-  // Finish off this packet and send it
-  // Returns 1 if the packet was sent successfully, 0 if there was an error
+  // Finish off this packet and queue it (MODEM.enqueue), poll() sends it when the modem is free
+  // Returns 1 if the packet is queued, 0 if there was an error
   virtual int endPacket();
+  // Result of the last queued packet: 0 if it is still queued, 1 if it was sent, 2 if there was an error (returned once)
+  int ready();
   // Write a single byte into the packet
   virtual size_t write(uint8_t);
   // Write size bytes from buffer into the packet
@@ -90,6 +92,13 @@ private:
   size_t _rxSize;
   size_t _rxIndex;
   uint8_t _rxBuffer[512];
+
+  // the queued AT+USOST, _txBuffer must be valid until it is done
+  int _txId;
+  int _txResult;
+
+  void waitSend();
+  static void onSendResult(int result, const char* response, void* arg);
 };
 
 #endif
@@ -23,7 +23,8 @@ GSMVoiceCall::GSMVoiceCall(bool synch) :
   _synch(synch),
   _callStatus(IDLE_CALL)
 {
-  MODEM.addUrcHandler(this);
+  MODEM.addUrcHandler(this, "+UCALLSTAT");
+  MODEM.addUrcHandler(this, "+UUDTMFD");
 }
 
 GSMVoiceCall::~GSMVoiceCall()
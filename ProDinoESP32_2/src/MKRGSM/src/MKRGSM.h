@@ -36,5 +36,7 @@
 #include "GSMLocation.h"
 
 #include "GSMFileUtils.h"
+#include "ModemMux.h"
+#include "GSMPPP.h"
 
 #endif
@@ -20,24 +20,68 @@
 #include "Modem.h"
 
 #define MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS 20
+// the modem wakes up after DTR LOW in the low power mode
+#define MODEM_WAKE_UP_TIME_MS 5
+// the modem accepts binary data at least 50ms after the '@' prompt
+#ifndef MODEM_BINARY_DATA_WAIT_TIME_MS
+#define MODEM_BINARY_DATA_WAIT_TIME_MS 50
+#endif
+
+// AT+IPR rates from the fastest, the modem autobauds at MODEM_AUTOBAUD_RATE after the reset
+static const unsigned long MODEM_BAUD_RATES[] = { 921600, 460800, 230400, 115200 };
+#define MODEM_BAUD_RATES_COUNT (sizeof(MODEM_BAUD_RATES) / sizeof(MODEM_BAUD_RATES[0]))
+#define MODEM_AUTOBAUD_RATE 115200
+// the new rate is used after the OK of AT+IPR
+#define MODEM_BAUD_SWITCH_TIME_MS 100
+// equal responses of a long command which confirm a new rate, a bit error of an unstable line is found in
+// the active profile (AT&V, several hundred bytes) and rarely in the OK of a bare AT
+#define MODEM_BAUD_CHECK_COMMAND "AT&V"
+#define MODEM_BAUD_CHECK_COUNT 3
+#define MODEM_BAUD_CHECK_TIMEOUT_MS 1000
+// AT+IPR attempts to return the modem to the rate which works
+#define MODEM_BAUD_RESTORE_COUNT 3
+// RTS is released when the UART FIFO has this count of bytes
+#define MODEM_UART_RTS_THRESHOLD 64
 
 #define GSM_RESETN 14
 #define GSM_DTR 26
 #define GSM_Rx 34
 #define GSM_Tx 25
 #define GSM_CTS 35 //Input !!!
-#define GSM_RTS 27 //Output LOW !!!
-HardwareSerial SerialGSM(2);
+#define GSM_RTS 27 //Output LOW without MODEM_UART_HW_FLOW_CONTROL !!!
 
+// define MODEM_CUSTOM_TRANSPORT to create MODEM in the sketch, e.g. ModemClass MODEM(stream);
+#ifndef MODEM_CUSTOM_TRANSPORT
+// the board UART of the modem (KMPProDinoESP32.cpp), sketches with other modem libraries use it directly
+extern HardwareSerial SerialModem;
+#endif
 
 
 
-ModemUrcHandler* ModemClass::_urcHandlers[MAX_URC_HANDLERS] = { NULL };
+
+// hex digit values from '0' to 'f', 0xff - not a hex digit
+static const uint8_t HEX_VALUES['f' - '0' + 1] = {
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  10, 11, 12, 13, 14, 15,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  10, 11, 12, 13, 14, 15
+};
+
+// handlers are added by global objects, the subscriptions can't depend on the MODEM construction
+ModemClass::UrcSubscription* ModemClass::_urcSubscriptions = NULL;
+size_t ModemClass::_urcSubscriptionsCount = 0;
+size_t ModemClass::_urcSubscriptionsCapacity = 0;
+size_t ModemClass::_urcSubscriptionsAdded = 0;
+int ModemClass::_urcDispatchDepth = 0;
 Print* ModemClass::_debugPrint = NULL;
 
 ModemClass::ModemClass(HardwareSerial& uart, unsigned long baud, int resetPin, int dtrPin, int ctsPin, int rtsPin, int rxPin, int txPin) :
   _uart(&uart),
+  _stream(&uart),
   _baud(baud),
+  _lineBaud(MODEM_AUTOBAUD_RATE),
   _resetPin(resetPin),
   _dtrPin(dtrPin),
   _ctsPin(ctsPin),
@@ -46,20 +90,70 @@ ModemClass::ModemClass(HardwareSerial& uart, unsigned long baud, int resetPin, i
   _txPin(txPin),
   _lowPowerMode(false),
   _lastResponseOrUrcMillis(0),
+  _commandMillis(0),
   _atCommandState(AT_COMMAND_IDLE),
   _ready(1),
-  _responseDataStorage(NULL)
+  _length(0),
+  _lineStart(0),
+  _lineLength(0),
+  _responseDataStorage(NULL),
+  _hexState(HEX_DONE),
+  _hexData(NULL),
+  _hexSize(0),
+  _hexLength(0),
+  _hexNibble(-1),
+  _queueCount(0),
+  _queueActive(-1),
+  _queueSequence(0),
+  _queueState(QUEUE_IDLE),
+  _queueMillis(0),
+  _sendPending(false),
+  _dataMode(false)
 {
-  _buffer.reserve(64);
+  _urc.reserve(64);
+  resetStats();
 }
 
-int ModemClass::begin(bool restart)
+ModemClass::ModemClass(Stream& stream, int resetPin, int dtrPin) :
+  _uart(NULL),
+  _stream(&stream),
+  _baud(0),
+  _lineBaud(0),
+  _resetPin(resetPin),
+  _dtrPin(dtrPin),
+  _ctsPin(-1),
+  _rtsPin(-1),
+  _rxPin(-1),
+  _txPin(-1),
+  _lowPowerMode(false),
+  _lastResponseOrUrcMillis(0),
+  _commandMillis(0),
+  _atCommandState(AT_COMMAND_IDLE),
+  _ready(1),
+  _length(0),
+  _lineStart(0),
+  _lineLength(0),
+  _responseDataStorage(NULL),
+  _hexState(HEX_DONE),
+  _hexData(NULL),
+  _hexSize(0),
+  _hexLength(0),
+  _hexNibble(-1),
+  _queueCount(0),
+  _queueActive(-1),
+  _queueSequence(0),
+  _queueState(QUEUE_IDLE),
+  _queueMillis(0),
+  _sendPending(false),
+  _dataMode(false)
 {
-   pinMode(_ctsPin, INPUT);
-   pinMode(_rtsPin, OUTPUT);
-   digitalWrite(_rtsPin, LOW);
+  _urc.reserve(64);
+  resetStats();
+}
 
-  _uart->begin(_baud > 115200 ? 115200 : _baud, SERIAL_8N1, _rxPin, _txPin);
+int ModemClass::begin(bool restart)
+{
+  beginUart();
 
   if (_resetPin > -1 && restart) {
     pinMode(_resetPin, OUTPUT);
@@ -67,7 +161,7 @@ int ModemClass::begin(bool restart)
     delay(100);
     digitalWrite(_resetPin, LOW);
   } else {
-    if (!autosense()) {
+    if (!autobaud()) {
       return 0;
     }
 
@@ -76,21 +170,20 @@ int ModemClass::begin(bool restart)
     }
   }
 
-  if (!autosense()) {
+  if (!autobaud()) {
     return 0;
   }
 
-  if (_baud > 115200) {
-    sendf("AT+IPR=%ld", _baud);
+  if (_uart) {
+#ifdef MODEM_UART_HW_FLOW_CONTROL
+    send("AT&K3");
     if (waitForResponse() != 1) {
       return 0;
     }
+#endif
 
-    _uart->end();
-    delay(100);
-	_uart->begin(_baud, SERIAL_8N1, _rxPin, _txPin);
-
-    if (!autosense()) {
+    // a failed negotiation keeps the rate which works, 0 - the modem answers at no rate
+    if (_baud > _lineBaud && !negotiateBaud()) {
       return 0;
     }
   }
@@ -108,10 +201,37 @@ int ModemClass::begin(bool restart)
   return 1;
 }
 
+void ModemClass::beginUart()
+{
+  if (!_uart) {
+    return;
+  }
+
+  // the size can be changed only before the UART is started
+  _uart->setRxBufferSize(MODEM_UART_RX_BUFFER_SIZE);
+  _uart->begin(MODEM_AUTOBAUD_RATE, SERIAL_8N1, _rxPin, _txPin);
+  _lineBaud = MODEM_AUTOBAUD_RATE;
+
+#ifdef MODEM_UART_HW_FLOW_CONTROL
+  // RTS is LOW while the UART has space, the data to the modem waits for CTS LOW
+  _uart->setPins(_rxPin, _txPin, _ctsPin, _rtsPin);
+  _uart->setHwFlowCtrlMode(UART_HW_FLOWCTRL_CTS_RTS, MODEM_UART_RTS_THRESHOLD);
+#else
+  pinMode(_ctsPin, INPUT);
+  pinMode(_rtsPin, OUTPUT);
+  digitalWrite(_rtsPin, LOW);
+#endif
+}
+
 void ModemClass::end()
 {
-  _uart->end();
-  digitalWrite(_resetPin, HIGH);
+  if (_uart) {
+    _uart->end();
+  }
+
+  if (_resetPin > -1) {
+    digitalWrite(_resetPin, HIGH);
+  }
 
   if (_dtrPin > -1) {
     digitalWrite(_dtrPin, LOW);
@@ -146,6 +266,119 @@ int ModemClass::autosense(unsigned int timeout)
   return 0;
 }
 
+int ModemClass::autobaud(unsigned int timeout)
+{
+  if (!_uart) {
+    return autosense(timeout);
+  }
+
+  for (unsigned long start = millis(); (millis() - start) < timeout;) {
+    if (noop() == 1) {
+      return 1;
+    }
+
+    // the next rate, the current one is first
+    size_t i = 0;
+    while (i < MODEM_BAUD_RATES_COUNT && MODEM_BAUD_RATES[i] != _lineBaud) {
+      i++;
+    }
+
+    switchBaud(MODEM_BAUD_RATES[(i + 1) % MODEM_BAUD_RATES_COUNT]);
+  }
+
+  return 0;
+}
+
+int ModemClass::negotiateBaud()
+{
+  unsigned long working = _lineBaud;
+
+  for (size_t i = 0; i < MODEM_BAUD_RATES_COUNT; i++) {
+    unsigned long baud = MODEM_BAUD_RATES[i];
+
+    if (baud > _baud || baud <= working) {
+      continue;
+    }
+
+    sendf("AT+IPR=%lu", baud);
+    if (waitForResponse() != 1) {
+      continue;
+    }
+
+    switchBaud(baud);
+
+    if (checkLink()) {
+      return 1;
+    }
+
+    // the line isn't stable, the modem is returned to the rate which works and the next slower rate is tried
+    if (!restoreBaud(working)) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+int ModemClass::restoreBaud(unsigned long baud)
+{
+  for (int i = 0; i < MODEM_BAUD_RESTORE_COUNT; i++) {
+    // the AT+IPR can be lost at an unstable rate
+    sendf("AT+IPR=%lu", baud);
+    waitForResponse();
+    switchBaud(baud);
+
+    if (autosense(1000)) {
+      return 1;
+    }
+
+    // the modem keeps another rate, AT+IPR is sent again at the rate it answers
+    if (!autobaud()) {
+      return 0;
+    }
+
+    if (_lineBaud == baud) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+int ModemClass::checkLink()
+{
+  String first;
+  String response;
+
+  for (int i = 0; i < MODEM_BAUD_CHECK_COUNT; i++) {
+    send(MODEM_BAUD_CHECK_COMMAND);
+    if (waitForResponse(MODEM_BAUD_CHECK_TIMEOUT_MS, (i == 0) ? &first : &response) != 1) {
+      return 0;
+    }
+
+    // a bit error changes the response
+    if (i > 0 && response != first) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+void ModemClass::switchBaud(unsigned long baud)
+{
+  // the OK of AT+IPR is sent with the old rate
+  _uart->flush();
+  _uart->updateBaudRate(baud);
+  _lineBaud = baud;
+
+  delay(MODEM_BAUD_SWITCH_TIME_MS);
+
+  // the characters received during the switch are garbage
+  while (_uart->read() >= 0);
+  clearBuffer();
+}
+
 int ModemClass::noop()
 {
   send("AT");
@@ -188,19 +421,45 @@ int ModemClass::noLowPowerMode()
 
 size_t ModemClass::write(uint8_t c)
 {
-  return _uart->write(c);
+  if (_dataMode) {
+    return 0;
+  }
+
+  size_t n = _stream->write(c);
+  _stats.txBytes += n;
+
+  return n;
 }
 
 size_t ModemClass::write(const uint8_t* buf, size_t size)
 {
-  return _uart->write(buf, size);
+  if (_dataMode) {
+    return 0;
+  }
+
+  size_t n = _stream->write(buf, size);
+  _stats.txBytes += n;
+
+  return n;
 }
 
 void ModemClass::send(const char* command)
 {
+  // the stream belongs to PPP, the command fails at once
+  if (_dataMode) {
+    _ready = 2;
+    _sendPending = false;
+    return;
+  }
+
+  // a queued command is running
+  while (_queueState != QUEUE_IDLE) {
+    poll();
+  }
+
   if (_lowPowerMode) {
     digitalWrite(_dtrPin, LOW);
-    delay(5);
+    delay(MODEM_WAKE_UP_TIME_MS);
   }
 
   // compare the time of the last response or URC and ensure 
@@ -210,12 +469,171 @@ void ModemClass::send(const char* command)
     delay(MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS - delta);
   }
 
-  _uart->println(command);
-  _uart->flush();
-  _atCommandState = AT_COMMAND_IDLE;
+  sendCommand(command);
+  _sendPending = true;
   _ready = 0;
 }
 
+void ModemClass::sendCommand(const char* command)
+{
+  _stats.txBytes += _stream->println(command);
+  _stream->flush();
+  _stats.commands++;
+  _commandMillis = millis();
+  _atCommandState = AT_COMMAND_IDLE;
+}
+
+int ModemClass::enqueue(const char* command, ModemCommandCallback callback, void* arg, unsigned long timeout, int priority)
+{
+  return enqueue(command, NULL, 0, callback, arg, timeout, priority);
+}
+
+int ModemClass::enqueue(const char* command, const uint8_t* data, size_t length, ModemCommandCallback callback, void* arg, unsigned long timeout, int priority)
+{
+  if (_queueCount == MODEM_QUEUE_SIZE || strlen(command) >= MODEM_COMMAND_SIZE) {
+    return -1;
+  }
+
+  QueuedCommand& queued = _queue[_queueCount++];
+
+  _queueSequence = (_queueSequence + 1) & 0x7fffffff;
+  queued.id = _queueSequence;
+  queued.priority = priority;
+  strcpy(queued.command, command);
+  queued.data = data;
+  queued.length = length;
+  queued.timeout = timeout;
+  queued.callback = callback;
+  queued.arg = arg;
+
+  return queued.id;
+}
+
+bool ModemClass::cancel(int id)
+{
+  for (int i = 0; i < _queueCount; i++) {
+    if (_queue[i].id != id) {
+      continue;
+    }
+
+    if (i == _queueActive) {
+      _queue[i].callback = NULL;
+      return true;
+    }
+
+    memmove(&_queue[i], &_queue[i + 1], (_queueCount - i - 1) * sizeof(QueuedCommand));
+    _queueCount--;
+    if (_queueActive > i) {
+      _queueActive--;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+int ModemClass::queued()
+{
+  return _queueCount;
+}
+
+void ModemClass::processQueue()
+{
+  switch (_queueState) {
+    case QUEUE_IDLE:
+    default: {
+      if (_queueCount == 0 || _sendPending) {
+        return;
+      }
+
+      // the same pause as send(), without delay()
+      if ((millis() - _lastResponseOrUrcMillis) < MODEM_MIN_RESPONSE_OR_URC_WAIT_TIME_MS) {
+        return;
+      }
+
+      // the highest priority, the commands with the same priority in the order they are added
+      _queueActive = 0;
+      for (int i = 1; i < _queueCount; i++) {
+        if (_queue[i].priority > _queue[_queueActive].priority) {
+          _queueActive = i;
+        }
+      }
+
+      if (_lowPowerMode) {
+        digitalWrite(_dtrPin, LOW);
+        _queueMillis = millis();
+        _queueState = QUEUE_WAKE_UP;
+      } else {
+        sendQueued();
+      }
+      return;
+    }
+
+    case QUEUE_WAKE_UP: {
+      if ((millis() - _queueMillis) >= MODEM_WAKE_UP_TIME_MS) {
+        sendQueued();
+      }
+      return;
+    }
+
+    case QUEUE_WAIT_PROMPT: {
+      if (_lineLength && _lineLength <= sizeof(_line) && _line[_lineLength - 1] == '@') {
+        // the prompt isn't a part of the response
+        _length = _lineStart;
+        _lineLength = 0;
+        _queueMillis = millis();
+        _queueState = QUEUE_WAIT_DATA;
+        return;
+      }
+      break;
+    }
+
+    case QUEUE_WAIT_DATA: {
+      if ((millis() - _queueMillis) >= MODEM_BINARY_DATA_WAIT_TIME_MS) {
+        write(_queue[_queueActive].data, _queue[_queueActive].length);
+        _queueState = QUEUE_WAIT_RESULT;
+        return;
+      }
+      break;
+    }
+
+    case QUEUE_WAIT_RESULT:
+      // the result is received by poll()
+      break;
+  }
+
+  if ((millis() - _commandMillis) >= _queue[_queueActive].timeout) {
+    _atCommandState = AT_COMMAND_IDLE;
+    clearBuffer();
+    _stats.timeouts++;
+
+    finishQueued(-1, "");
+  }
+}
+
+void ModemClass::sendQueued()
+{
+  sendCommand(_queue[_queueActive].command);
+  _queueState = _queue[_queueActive].data ? QUEUE_WAIT_PROMPT : QUEUE_WAIT_RESULT;
+}
+
+void ModemClass::finishQueued(int result, const char* response)
+{
+  ModemCommandCallback callback = _queue[_queueActive].callback;
+  void* arg = _queue[_queueActive].arg;
+
+  // the callback can add commands
+  memmove(&_queue[_queueActive], &_queue[_queueActive + 1], (_queueCount - _queueActive - 1) * sizeof(QueuedCommand));
+  _queueCount--;
+  _queueActive = -1;
+  _queueState = QUEUE_IDLE;
+
+  if (callback) {
+    callback(result, response, arg);
+  }
+}
+
 void ModemClass::sendf(const char *fmt, ...)
 {
   char buf[BUFSIZ];
@@ -241,16 +659,65 @@ int ModemClass::waitForResponse(unsigned long timeout, String* responseDataStora
   }
 
   _responseDataStorage = NULL;
-  _buffer = "";
+  clearBuffer();
+  _sendPending = false;
+  _stats.timeouts++;
   return -1;
 }
 
-int ModemClass::waitForPrompt(unsigned long timeout)
+int ModemClass::waitForHexResponse(unsigned long timeout, uint8_t* data, size_t* length)
+{
+  // the quoted hex string is decoded in poll() as it comes, it isn't stored in the response buffer
+  _hexData = data;
+  _hexSize = *length;
+  _hexLength = 0;
+  _hexNibble = -1;
+  _hexState = HEX_WAIT_QUOTE;
+
+  int r = waitForResponse(timeout);
+
+  *length = _hexLength;
+  _hexData = NULL;
+  _hexState = HEX_DONE;
+
+  return r;
+}
+
+void ModemClass::decodeHex(char c)
+{
+  if (c == '"') {
+    _hexState = HEX_DONE;
+    return;
+  }
+
+  int n = hexValue(c);
+  if (n < 0) {
+    return;
+  }
+
+  if (_hexNibble < 0) {
+    _hexNibble = n;
+  } else {
+    if (_hexLength < _hexSize) {
+      _hexData[_hexLength++] = (_hexNibble << 4) | n;
+    }
+    _hexNibble = -1;
+  }
+}
+
+int ModemClass::hexValue(char c)
+{
+  uint8_t n = (c >= '0' && c <= 'f') ? HEX_VALUES[c - '0'] : 0xff;
+
+  return (n == 0xff) ? -1 : n;
+}
+
+int ModemClass::waitForPrompt(unsigned long timeout, char prompt)
 {
   for (unsigned long start = millis(); (millis() - start) < timeout;) {
     ready();
 
-    if (_buffer.endsWith(">")) {
+    if (_lineLength && _lineLength <= sizeof(_line) && _line[_lineLength - 1] == prompt) {
       return 1;
     }
   }
@@ -258,6 +725,20 @@ int ModemClass::waitForPrompt(unsigned long timeout)
   return -1;
 }
 
+int ModemClass::writeBinary(const uint8_t* buf, size_t size, unsigned long timeout)
+{
+  if (waitForPrompt(timeout, '@') != 1) {
+    return -1;
+  }
+
+  // the prompt isn't a part of the response
+  _length = _lineStart;
+  _lineLength = 0;
+  delay(MODEM_BINARY_DATA_WAIT_TIME_MS);
+
+  return (write(buf, size) == size) ? 1 : -1;
+}
+
 int ModemClass::ready()
 {
   poll();
@@ -267,85 +748,176 @@ int ModemClass::ready()
 
 void ModemClass::poll()
 {
-  while (_uart->available()) {
-    char c = _uart->read();
+  // the received bytes belong to PPP, the queued commands wait
+  if (_dataMode) {
+    return;
+  }
+
+  processQueue();
+
+  while (_stream->available()) {
+    char c = _stream->read();
+    _stats.rxBytes++;
 
     if (_debugPrint) {
       _debugPrint->write(c);
     }
 
-    _buffer += c;
+    if (_hexState == HEX_DATA && _atCommandState == AT_RECEIVING_RESPONSE) {
+      decodeHex(c);
+      continue;
+    }
+
+    if (c == '"' && _hexState == HEX_WAIT_QUOTE && _atCommandState == AT_RECEIVING_RESPONSE) {
+      _hexState = HEX_DATA;
+    }
+
+    if (c != '\n') {
+      append(c);
+      continue;
+    }
 
     switch (_atCommandState) {
       case AT_COMMAND_IDLE:
       default: {
-
-        if (_buffer.startsWith("AT") && _buffer.endsWith("\r\n")) {
+        if (_lineLength >= 2 && _line[0] == 'A' && _line[1] == 'T') {
           _atCommandState = AT_RECEIVING_RESPONSE;
-          _buffer = "";
-        }  else if (_buffer.endsWith("\r\n")) {
-          _buffer.trim();
+        } else {
+          size_t start = 0;
+          size_t end = _length;
+          trim(start, end);
 
-          if (_buffer.length()) {
+          if (end > start) {
             _lastResponseOrUrcMillis = millis();
+            _stats.urcs++;
 
-            for (int i = 0; i < MAX_URC_HANDLERS; i++) {
-              if (_urcHandlers[i] != NULL) {
-                _urcHandlers[i]->handleUrc(_buffer);
-              }
-            }
+            dispatchUrc(start, end);
           }
-
-          _buffer = "";
         }
 
+        clearBuffer();
         break;
       }
 
       case AT_RECEIVING_RESPONSE: {
-        if (c == '\n') {
-          _lastResponseOrUrcMillis = millis();
-
-          int responseResultIndex = _buffer.lastIndexOf("OK\r\n");
-          if (responseResultIndex != -1) {
-            _ready = 1;
-          } else {
-            responseResultIndex = _buffer.lastIndexOf("ERROR\r\n");
-            if (responseResultIndex != -1) {
-              _ready = 2;
-            } else {
-              responseResultIndex = _buffer.lastIndexOf("NO CARRIER\r\n");
-              if (responseResultIndex != -1) {
-                _ready = 3;
-              }
-            }
-          }
+        _lastResponseOrUrcMillis = millis();
+
+        int result = resultCode();
+        if (result == 0) {
+          // the line is a part of the response data
+          append(c);
+          _lineStart = _length;
+          _lineLength = 0;
+          break;
+        }
 
-          if (_ready != 0) {
-            if (_lowPowerMode) {
-              digitalWrite(_dtrPin, HIGH);
-            }
+        unsigned long latency = _lastResponseOrUrcMillis - _commandMillis;
+        _stats.latencyTotal += latency;
+        if (latency > _stats.latencyMax) {
+          _stats.latencyMax = latency;
+        }
 
-            if (_responseDataStorage != NULL) {
-              _buffer.remove(responseResultIndex);
-              _buffer.trim();
+        if (result == 1 || result == 4) {
+          _stats.ok++;
+        } else {
+          _stats.errors++;
+        }
+
+        if (_lowPowerMode) {
+          digitalWrite(_dtrPin, HIGH);
+        }
 
-              *_responseDataStorage = _buffer;
+        // without the result code line
+        size_t start = 0;
+        size_t end = _lineStart;
+        trim(start, end);
+        _buffer[end] = '\0';
 
-              _responseDataStorage = NULL;
-            }
+        _atCommandState = AT_COMMAND_IDLE;
+        clearBuffer();
 
-            _atCommandState = AT_COMMAND_IDLE;
-            _buffer = "";
-            return;
+        if (_queueActive >= 0 && _queueState != QUEUE_WAKE_UP) {
+          // the response stays in _buffer until the next received byte, ready() keeps the result of send()
+          finishQueued(result, &_buffer[start]);
+        } else {
+          if (_responseDataStorage != NULL) {
+            *_responseDataStorage = &_buffer[start];
+
+            _responseDataStorage = NULL;
           }
+
+          _ready = result;
+          _sendPending = false;
         }
-        break;
+        return;
       }
     }
   }
 }
 
+void ModemClass::append(char c)
+{
+  if (_lineLength < sizeof(_line)) {
+    _line[_lineLength] = c;
+  }
+  _lineLength++;
+
+  // one byte is kept for the terminating '\0', the rest of a longer response is lost
+  if (_length < sizeof(_buffer) - 1) {
+    _buffer[_length++] = c;
+  }
+}
+
+void ModemClass::clearBuffer()
+{
+  _length = 0;
+  _lineStart = 0;
+  _lineLength = 0;
+}
+
+int ModemClass::resultCode()
+{
+  size_t length = _lineLength;
+
+  // data mode, "CONNECT" or "CONNECT <speed>"
+  if (length >= 7 && memcmp(_line, "CONNECT", 7) == 0 && (length == 7 || _line[7] == '\r' || _line[7] == ' ')) {
+    return 4;
+  }
+
+  if (length > sizeof(_line)) {
+    return 0;
+  }
+
+  if (length && _line[length - 1] == '\r') {
+    length--;
+  }
+
+  if (length == 2 && memcmp(_line, "OK", 2) == 0) {
+    return 1;
+  }
+
+  if (length == 5 && memcmp(_line, "ERROR", 5) == 0) {
+    return 2;
+  }
+
+  if (length == 10 && memcmp(_line, "NO CARRIER", 10) == 0) {
+    return 3;
+  }
+
+  return 0;
+}
+
+void ModemClass::trim(size_t& start, size_t& end)
+{
+  while (start < end && isspace(_buffer[start])) {
+    start++;
+  }
+
+  while (end > start && isspace(_buffer[end - 1])) {
+    end--;
+  }
+}
+
 void ModemClass::setResponseDataStorage(String* responseDataStorage)
 {
   _responseDataStorage = responseDataStorage;
@@ -353,22 +925,176 @@ void ModemClass::setResponseDataStorage(String* responseDataStorage)
 
 void ModemClass::addUrcHandler(ModemUrcHandler* handler)
 {
-  for (int i = 0; i < MAX_URC_HANDLERS; i++) {
-    if (_urcHandlers[i] == NULL) {
-      _urcHandlers[i] = handler;
-      break;
-    }
+  addUrcSubscription(handler, NULL);
+}
+
+void ModemClass::addUrcHandler(ModemUrcHandler* handler, const char* prefix)
+{
+  if (prefix != NULL && *prefix != '\0') {
+    addUrcSubscription(handler, prefix);
   }
 }
 
 void ModemClass::removeUrcHandler(ModemUrcHandler* handler)
 {
-  for (int i = 0; i < MAX_URC_HANDLERS; i++) {
-    if (_urcHandlers[i] == handler) {
-      _urcHandlers[i] = NULL;
-      break;
+  if (_urcDispatchDepth > 0) {
+    // the dispatch loop indexes the subscriptions, they are removed after it
+    for (size_t i = 0; i < _urcSubscriptionsCount + _urcSubscriptionsAdded; i++) {
+      if (_urcSubscriptions[i].handler == handler) {
+        _urcSubscriptions[i].handler = NULL;
+      }
+    }
+
+    return;
+  }
+
+  size_t count = 0;
+
+  for (size_t i = 0; i < _urcSubscriptionsCount; i++) {
+    if (_urcSubscriptions[i].handler != handler) {
+      _urcSubscriptions[count++] = _urcSubscriptions[i];
     }
   }
+
+  _urcSubscriptionsCount = count;
+}
+
+int ModemClass::compareUrcPrefix(const UrcSubscription& subscription, const char* prefix, size_t length)
+{
+  if (subscription.prefix == NULL) {
+    return (prefix == NULL) ? 0 : -1;
+  }
+
+  if (prefix == NULL) {
+    return 1;
+  }
+
+  int r = strncmp(subscription.prefix, prefix, subscription.length < length ? subscription.length : length);
+  if (r != 0) {
+    return r;
+  }
+
+  return (subscription.length > length) - (subscription.length < length);
+}
+
+void ModemClass::addUrcSubscription(ModemUrcHandler* handler, const char* prefix)
+{
+  size_t total = _urcSubscriptionsCount + _urcSubscriptionsAdded;
+
+  if (total == _urcSubscriptionsCapacity) {
+    size_t capacity = _urcSubscriptionsCapacity ? _urcSubscriptionsCapacity * 2 : 16;
+    UrcSubscription* subscriptions = (UrcSubscription*)realloc(_urcSubscriptions, capacity * sizeof(UrcSubscription));
+
+    if (subscriptions == NULL) {
+      return;
+    }
+
+    _urcSubscriptions = subscriptions;
+    _urcSubscriptionsCapacity = capacity;
+  }
+
+  _urcSubscriptions[total].prefix = prefix;
+  _urcSubscriptions[total].length = (prefix != NULL) ? strlen(prefix) : 0;
+  _urcSubscriptions[total].handler = handler;
+
+  if (_urcDispatchDepth > 0) {
+    // the dispatch loop indexes the sorted subscriptions, the new one is sorted in after it
+    _urcSubscriptionsAdded++;
+    return;
+  }
+
+  insertUrcSubscription(total);
+}
+
+void ModemClass::insertUrcSubscription(size_t index)
+{
+  UrcSubscription subscription = _urcSubscriptions[index];
+  size_t i = 0;
+
+  // after the subscriptions with the same prefix, the handlers are called in the order they are added
+  while (i < _urcSubscriptionsCount && compareUrcPrefix(_urcSubscriptions[i], subscription.prefix, subscription.length) <= 0) {
+    if (_urcSubscriptions[i].handler == subscription.handler && compareUrcPrefix(_urcSubscriptions[i], subscription.prefix, subscription.length) == 0) {
+      return;
+    }
+    i++;
+  }
+
+  // the entries up to index are moved, a dropped duplicate before it is overwritten
+  memmove(&_urcSubscriptions[i + 1], &_urcSubscriptions[i], (index - i) * sizeof(UrcSubscription));
+  _urcSubscriptions[i] = subscription;
+  _urcSubscriptionsCount++;
+}
+
+void ModemClass::endUrcDispatch()
+{
+  if (--_urcDispatchDepth > 0) {
+    return;
+  }
+
+  // the removed subscriptions have no handler
+  size_t total = _urcSubscriptionsCount + _urcSubscriptionsAdded;
+  size_t count = 0;
+  size_t sorted = 0;
+
+  for (size_t i = 0; i < total; i++) {
+    if (_urcSubscriptions[i].handler != NULL) {
+      _urcSubscriptions[count++] = _urcSubscriptions[i];
+    }
+
+    if (i + 1 == _urcSubscriptionsCount) {
+      sorted = count;
+    }
+  }
+
+  _urcSubscriptionsCount = sorted;
+  _urcSubscriptionsAdded = 0;
+
+  for (size_t i = sorted; i < count; i++) {
+    insertUrcSubscription(i);
+  }
+}
+
+void ModemClass::dispatchUrc(size_t start, size_t end)
+{
+  // the URC name is the text before ':', "RING" and others have no parameters
+  const char* name = &_buffer[start];
+  const char* colon = (const char*)memchr(name, ':', end - start);
+  size_t length = (colon != NULL) ? (size_t)(colon - name) : end - start;
+
+  // the first subscription with this prefix
+  size_t low = 0;
+  size_t high = _urcSubscriptionsCount;
+
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+
+    if (compareUrcPrefix(_urcSubscriptions[middle], name, length) < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  // the String keeps its capacity, it isn't allocated for every URC
+  _buffer[end] = '\0';
+  _urc = name;
+
+  // a handler can add and remove handlers, the changes are applied after the dispatch
+  _urcDispatchDepth++;
+
+  for (size_t i = 0; i < _urcSubscriptionsCount && _urcSubscriptions[i].prefix == NULL; i++) {
+    if (_urcSubscriptions[i].handler != NULL) {
+      _urcSubscriptions[i].handler->handleUrc(_urc);
+    }
+  }
+
+  for (size_t i = low; i < _urcSubscriptionsCount && compareUrcPrefix(_urcSubscriptions[i], name, length) == 0; i++) {
+    if (_urcSubscriptions[i].handler != NULL) {
+      _urcSubscriptions[i].handler->handleUrc(_urc);
+    }
+  }
+
+  endUrcDispatch();
 }
 
 void ModemClass::setBaudRate(unsigned long baud)
@@ -376,7 +1102,21 @@ void ModemClass::setBaudRate(unsigned long baud)
   _baud = baud;
 }
 
+unsigned long ModemClass::averageLatency()
+{
+  unsigned long results = _stats.ok + _stats.errors;
+
+  return results ? _stats.latencyTotal / results : 0;
+}
+
+void ModemClass::resetStats()
+{
+  memset(&_stats, 0, sizeof(_stats));
+}
+
 
 
 
-ModemClass MODEM(SerialGSM, 921600, GSM_RESETN, GSM_DTR, GSM_CTS, GSM_RTS, GSM_Rx, GSM_Tx);
+#ifndef MODEM_CUSTOM_TRANSPORT
+ModemClass MODEM(SerialModem, 921600, GSM_RESETN, GSM_DTR, GSM_CTS, GSM_RTS, GSM_Rx, GSM_Tx);
+#endif
@@ -25,23 +25,84 @@
 
 #include <Arduino.h>
 
+// response data and URC lines buffer, a longer response is truncated
+#ifndef MODEM_BUFFER_SIZE
+#define MODEM_BUFFER_SIZE 2048
+#endif
+
+// UART receive buffer, it keeps a burst at the max baud while poll() isn't called
+#ifndef MODEM_UART_RX_BUFFER_SIZE
+#define MODEM_UART_RX_BUFFER_SIZE 4096
+#endif
+
+// RTS/CTS hardware flow control of the UART, 0 - RTS is held LOW and CTS is ignored
+#ifndef MODEM_UART_FLOW_CONTROL
+#define MODEM_UART_FLOW_CONTROL 1
+#endif
+
+// HardwareSerial::setPins with CTS/RTS and setHwFlowCtrlMode are available in ESP32 Arduino core 2.0.3
+// and next, the older cores hold RTS LOW
+#if MODEM_UART_FLOW_CONTROL && defined(ESP_ARDUINO_VERSION) && defined(ESP_ARDUINO_VERSION_VAL)
+#if ESP_ARDUINO_VERSION >= ESP_ARDUINO_VERSION_VAL(2, 0, 3)
+#define MODEM_UART_HW_FLOW_CONTROL
+#endif
+#endif
+
+// queued commands, see ModemClass::enqueue(...)
+#ifndef MODEM_QUEUE_SIZE
+#define MODEM_QUEUE_SIZE 8
+#endif
+#ifndef MODEM_COMMAND_SIZE
+#define MODEM_COMMAND_SIZE 96
+#endif
+
+enum {
+  MODEM_PRIORITY_LOW,
+  MODEM_PRIORITY_NORMAL,
+  MODEM_PRIORITY_HIGH
+};
+
+// result: 1 OK, 2 ERROR, 3 NO CARRIER, 4 CONNECT, -1 timeout
+// response: the response data without the result code, it is valid until the callback returns or calls MODEM
+typedef void (*ModemCommandCallback)(int result, const char* response, void* arg);
+
 class ModemUrcHandler {
 public:
   virtual void handleUrc(const String& urc) = 0;
 };
 
+// AT command counters, see ModemClass::stats()
+struct ModemStats {
+  unsigned long commands;      // commands sent
+  unsigned long ok;            // OK and CONNECT results
+  unsigned long errors;        // ERROR and NO CARRIER results
+  unsigned long timeouts;      // waitForResponse(...) timeouts
+  unsigned long urcs;          // URC lines
+  unsigned long txBytes;       // bytes written to the modem
+  unsigned long rxBytes;       // bytes read from the modem
+  unsigned long latencyTotal;  // ms from the command to the result, sum of all results
+  unsigned long latencyMax;    // ms, the slowest result
+};
+
 class ModemClass {
 public:
 	ModemClass(HardwareSerial& uart, unsigned long baud, int resetPin, int dtrPin, int ctsPin, int rtsPin, int rxPin, int txPin);
+  // any other transport (a pty on a host build, a modem emulator ...), it must be opened already
+  ModemClass(Stream& stream, int resetPin = -1, int dtrPin = -1);
 
   int begin(bool restart = true);
   void end();
+  // starts the UART at the autobaud rate with the pins, the RX buffer and the flow control, begin() calls it.
+  // The board calls it for the sketches which use the UART with another modem library.
+  void beginUart();
 
   void debug();
   void debug(Print& p);
   void noDebug();
 
   int autosense(unsigned int timeout = 10000);
+  // autosense at every supported baud, the modem may keep a rate from a previous begin()
+  int autobaud(unsigned int timeout = 10000);
 
   int noop();
   int reset();
@@ -56,20 +117,56 @@ public:
   void send(const String& command) { send(command.c_str()); }
   void sendf(const char *fmt, ...);
 
+  // the command is sent by poll() when the modem is free, the callback is called from poll() with the result.
+  // ready() and the response data storage stay with the commands from send().
+  // returns the command id or -1 if the queue is full
+  int enqueue(const char* command, ModemCommandCallback callback = NULL, void* arg = NULL, unsigned long timeout = 100, int priority = MODEM_PRIORITY_NORMAL);
+  // the data is written after the '@' prompt (AT+USOWR, AT+USOST ...), it must be valid until the callback
+  int enqueue(const char* command, const uint8_t* data, size_t length, ModemCommandCallback callback = NULL, void* arg = NULL, unsigned long timeout = 10000, int priority = MODEM_PRIORITY_NORMAL);
+  // a sent command can't be stopped, only its callback isn't called
+  bool cancel(int id);
+  int queued();
+
   int waitForResponse(unsigned long timeout = 100, String* responseDataStorage = NULL);
-  int waitForPrompt(unsigned long timeout = 500);
+  int waitForHexResponse(unsigned long timeout, uint8_t* data, size_t* length);
+  int waitForPrompt(unsigned long timeout = 500, char prompt = '>');
+  int writeBinary(const uint8_t* buf, size_t size, unsigned long timeout = 500);
   int ready();
   void poll();
   void setResponseDataStorage(String* responseDataStorage);
 
+  // the handler gets all URCs
   void addUrcHandler(ModemUrcHandler* handler);
+  // the handler gets only URCs with this name (the text before ':', e.g. "+UUSORD"), it can be added for several names.
+  // The prefix isn't copied, it must be a constant string.
+  void addUrcHandler(ModemUrcHandler* handler, const char* prefix);
+  // a handler can be added and removed from handleUrc(), the change is applied after the URC is dispatched
   void removeUrcHandler(ModemUrcHandler* handler);
 
+  // the max baud, begin() negotiates the highest one which works
   void setBaudRate(unsigned long baud);
+  // the current baud of the UART
+  unsigned long baudRate() { return _lineBaud; }
+
+  // the transport of the AT commands, ModemMux replaces it with a virtual channel
+  Stream& stream() { return *_stream; }
+  void setStream(Stream& stream) { _stream = &stream; }
+  // the stream carries data (PPP), send() gives ERROR without writing and poll() doesn't read
+  void setDataMode(bool dataMode) { _dataMode = dataMode; }
+  bool dataMode() { return _dataMode; }
+
+  const ModemStats& stats() { return _stats; }
+  unsigned long averageLatency();
+  void resetStats();
+
+  // hex digit value of the hex responses (+USORD, +USORF ...), -1 - not a hex digit
+  static int hexValue(char c);
 
 private:
-  HardwareSerial* _uart;
+  HardwareSerial* _uart; // NULL when the transport isn't a UART
+  Stream* _stream;
   unsigned long _baud;
+  unsigned long _lineBaud;
   int _resetPin;
   int _dtrPin;
   int _ctsPin;
@@ -78,17 +175,98 @@ private:
   int _txPin;
   bool _lowPowerMode;
   unsigned long _lastResponseOrUrcMillis;
+  unsigned long _commandMillis;
+  ModemStats _stats;
 
   enum {
     AT_COMMAND_IDLE,
     AT_RECEIVING_RESPONSE
   } _atCommandState;
+  // the result of the last send(), 0 until it is received. The queued commands don't change it.
   int _ready;
-  String _buffer;
+  char _buffer[MODEM_BUFFER_SIZE];
+  size_t _length;
+  // start of the current line in _buffer
+  size_t _lineStart;
+  // the first bytes of the current line, result codes and prompts are found in it even if _buffer is full
+  char _line[12];
+  size_t _lineLength;
+  String _urc;
   String* _responseDataStorage;
 
-  #define MAX_URC_HANDLERS 10 // 7 sockets + GPRS + GSMLocation + GSMVoiceCall
-  static ModemUrcHandler* _urcHandlers[MAX_URC_HANDLERS];
+  enum {
+    HEX_WAIT_QUOTE,
+    HEX_DATA,
+    HEX_DONE
+  } _hexState;
+  uint8_t* _hexData;
+  size_t _hexSize;
+  size_t _hexLength;
+  int _hexNibble;
+
+  int negotiateBaud();
+  int restoreBaud(unsigned long baud);
+  int checkLink();
+  void switchBaud(unsigned long baud);
+
+  void decodeHex(char c);
+  void append(char c);
+  void clearBuffer();
+  int resultCode();
+  void trim(size_t& start, size_t& end);
+
+  // sorted by prefix, the handlers of all URCs (prefix NULL) are first
+  struct UrcSubscription {
+    const char* prefix;
+    size_t length;
+    ModemUrcHandler* handler;
+  };
+  static UrcSubscription* _urcSubscriptions;
+  static size_t _urcSubscriptionsCount;
+  static size_t _urcSubscriptionsCapacity;
+  // added during a dispatch, unsorted after the sorted subscriptions
+  static size_t _urcSubscriptionsAdded;
+  // a handler can call MODEM, the dispatches can be nested
+  static int _urcDispatchDepth;
+
+  static int compareUrcPrefix(const UrcSubscription& subscription, const char* prefix, size_t length);
+  void addUrcSubscription(ModemUrcHandler* handler, const char* prefix);
+  // sorts in the subscription at index, which is after the sorted ones, a duplicate is dropped
+  void insertUrcSubscription(size_t index);
+  void endUrcDispatch();
+  void dispatchUrc(size_t start, size_t end);
+
+  struct QueuedCommand {
+    int id;
+    int priority;
+    char command[MODEM_COMMAND_SIZE];
+    const uint8_t* data;
+    size_t length;
+    unsigned long timeout;
+    ModemCommandCallback callback;
+    void* arg;
+  };
+  QueuedCommand _queue[MODEM_QUEUE_SIZE];
+  int _queueCount;
+  int _queueActive;
+  int _queueSequence;
+  enum {
+    QUEUE_IDLE,
+    QUEUE_WAKE_UP,
+    QUEUE_WAIT_PROMPT,
+    QUEUE_WAIT_DATA,
+    QUEUE_WAIT_RESULT
+  } _queueState;
+  unsigned long _queueMillis;
+  // a command sent by send() hasn't a result yet
+  bool _sendPending;
+  bool _dataMode;
+
+  void sendCommand(const char* command);
+  void processQueue();
+  void sendQueued();
+  void finishQueued(int result, const char* response);
+
   static Print* _debugPrint;
 };
 
@@ -0,0 +1,607 @@
+/*
+  This file is part of the MKR GSM library.
+  Copyright (C) 2026  KMP Electronics Ltd (https://kmpelectronics.eu/)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#include "Modem.h"
+
+#include "ModemMux.h"
+
+#define MUX_FLAG 0xf9
+#define MUX_EA   0x01
+#define MUX_CR   0x02
+#define MUX_PF   0x10
+
+// frame types
+#define MUX_SABM 0x2f
+#define MUX_UA   0x63
+#define MUX_DM   0x0f
+#define MUX_DISC 0x43
+#define MUX_UIH  0xef
+#define MUX_UI   0x03
+
+// control channel messages
+#define MUX_MSC   0xe1
+#define MUX_FCON  0xa1
+#define MUX_FCOFF 0x61
+#define MUX_CLD   0xc1
+#define MUX_TEST  0x21
+
+// MSC V.24 signals
+#define MUX_SIGNAL_FC  0x02
+#define MUX_SIGNAL_RTC 0x04
+#define MUX_SIGNAL_RTR 0x08
+#define MUX_SIGNAL_DV  0x80
+
+// FCS of a frame with a correct FCS field
+#define MUX_FCS_GOOD 0xcf
+
+// max time to wait the modem to accept data
+#define MODEM_MUX_WRITE_TIMEOUT_MS 5000
+#define MODEM_MUX_CLOSE_TIMEOUT_MS 1000
+
+// the receive buffers of the channels are shared by the receiving task and the reading task
+static portMUX_TYPE _bufferMux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint8_t muxCrc(uint8_t crc, uint8_t c)
+{
+  // reversed polynomial x^8 + x^2 + x + 1
+  crc ^= c;
+  for (int i = 0; i < 8; i++) {
+    crc = (crc & 0x01) ? (crc >> 1) ^ 0xe0 : (crc >> 1);
+  }
+
+  return crc;
+}
+
+ModemMuxChannel::ModemMuxChannel() :
+  _mux(NULL),
+  _dlci(0),
+  _open(false),
+  _remoteStopped(false),
+  _localStopped(false),
+  _overflows(0),
+  _head(0),
+  _count(0)
+{
+}
+
+int ModemMuxChannel::available()
+{
+  if (_mux) {
+    _mux->poll();
+  }
+
+  portENTER_CRITICAL(&_bufferMux);
+  int count = _count;
+  portEXIT_CRITICAL(&_bufferMux);
+
+  return count;
+}
+
+int ModemMuxChannel::read()
+{
+  portENTER_CRITICAL(&_bufferMux);
+  if (_count == 0) {
+    portEXIT_CRITICAL(&_bufferMux);
+    return -1;
+  }
+
+  uint8_t c = _buffer[_head];
+  _head = (_head + 1) % sizeof(_buffer);
+  _count--;
+  portEXIT_CRITICAL(&_bufferMux);
+
+  if (_localStopped) {
+    _mux->checkFlow(*this);
+  }
+
+  return c;
+}
+
+int ModemMuxChannel::peek()
+{
+  portENTER_CRITICAL(&_bufferMux);
+  int c = (_count == 0) ? -1 : _buffer[_head];
+  portEXIT_CRITICAL(&_bufferMux);
+
+  return c;
+}
+
+size_t ModemMuxChannel::write(uint8_t c)
+{
+  return write(&c, 1);
+}
+
+size_t ModemMuxChannel::write(const uint8_t* buf, size_t size)
+{
+  if (_mux == NULL) {
+    return 0;
+  }
+
+  return _mux->writeData(*this, buf, size);
+}
+
+void ModemMuxChannel::flush()
+{
+  if (_mux && _mux->_uart) {
+    _mux->_uart->flush();
+  }
+}
+
+void ModemMuxChannel::receive(const uint8_t* data, size_t length)
+{
+  portENTER_CRITICAL(&_bufferMux);
+  for (size_t i = 0; i < length; i++) {
+    if (_count == sizeof(_buffer)) {
+      _overflows += length - i;
+      break;
+    }
+
+    _buffer[(_head + _count) % sizeof(_buffer)] = data[i];
+    _count++;
+  }
+  portEXIT_CRITICAL(&_bufferMux);
+}
+
+ModemMuxClass::ModemMuxClass() :
+  _uart(NULL),
+  _active(false),
+  _remoteStopped(false),
+  _control0Open(false),
+  _polling(false),
+  _lock(NULL),
+  _frameState(FRAME_FLAG),
+  _frameAddress(0),
+  _frameControl(0),
+  _frameLength(0),
+  _frameIndex(0),
+  _frameFcs(0),
+  _frameTooLong(false)
+{
+  for (int i = 0; i < MODEM_MUX_CHANNELS; i++) {
+    _channels[i]._mux = this;
+    _channels[i]._dlci = i + 1;
+  }
+}
+
+int ModemMuxClass::begin(unsigned long timeout)
+{
+  if (_active) {
+    return 1;
+  }
+
+  if (_lock == NULL) {
+    _lock = xSemaphoreCreateRecursiveMutex();
+
+    if (_lock == NULL) {
+      return 0;
+    }
+  }
+
+  MODEM.sendf("AT+CMUX=0,0,,%d", MODEM_MUX_FRAME_SIZE);
+  if (MODEM.waitForResponse() != 1) {
+    return 0;
+  }
+
+  // the frames go through the UART of MODEM
+  _uart = &MODEM.stream();
+  _frameState = FRAME_FLAG;
+  _remoteStopped = false;
+  _active = true;
+
+  // the control channel first
+  if (open(0, timeout) != 1) {
+    end();
+    return 0;
+  }
+
+  for (int i = 0; i < MODEM_MUX_CHANNELS; i++) {
+    if (open(i + 1, timeout) != 1) {
+      end();
+      return 0;
+    }
+
+    sendStatus(i + 1, false);
+  }
+
+  MODEM.setStream(_channels[0]);
+
+  return 1;
+}
+
+void ModemMuxClass::end()
+{
+  if (!_active) {
+    return;
+  }
+
+  // the modem returns to AT commands mode
+  uint8_t cld[2] = { MUX_CLD | MUX_CR, MUX_EA };
+  sendFrame(0, MUX_UIH, true, cld, sizeof(cld));
+
+  for (unsigned long start = millis(); _control0Open && (millis() - start) < MODEM_MUX_CLOSE_TIMEOUT_MS;) {
+    poll();
+  }
+
+  lock();
+  _active = false;
+  _control0Open = false;
+
+  for (int i = 0; i < MODEM_MUX_CHANNELS; i++) {
+    ModemMuxChannel& channel = _channels[i];
+
+    channel._open = false;
+    channel._remoteStopped = false;
+    channel._localStopped = false;
+
+    portENTER_CRITICAL(&_bufferMux);
+    channel._head = 0;
+    channel._count = 0;
+    portEXIT_CRITICAL(&_bufferMux);
+  }
+  unlock();
+
+  MODEM.setStream(*_uart);
+}
+
+ModemMuxChannel& ModemMuxClass::channel(int index)
+{
+  if (index < 1 || index > MODEM_MUX_CHANNELS) {
+    index = 1;
+  }
+
+  return _channels[index - 1];
+}
+
+void ModemMuxClass::poll()
+{
+  if (!_active) {
+    return;
+  }
+
+  lock();
+
+  // a frame can be sent while the received frames are handled
+  if (!_polling) {
+    _polling = true;
+    while (_uart->available()) {
+      parse(_uart->read());
+    }
+    _polling = false;
+  }
+
+  unlock();
+}
+
+void ModemMuxClass::lock()
+{
+  xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+}
+
+void ModemMuxClass::unlock()
+{
+  xSemaphoreGiveRecursive(_lock);
+}
+
+int ModemMuxClass::open(uint8_t dlci, unsigned long timeout)
+{
+  sendFrame(dlci, MUX_SABM | MUX_PF, true, NULL, 0);
+
+  for (unsigned long start = millis(); (millis() - start) < timeout;) {
+    poll();
+
+    if (dlci == 0 ? _control0Open : _channels[dlci - 1]._open) {
+      return 1;
+    }
+  }
+
+  return -1;
+}
+
+void ModemMuxClass::sendFrame(uint8_t dlci, uint8_t control, bool command, const uint8_t* data, size_t length)
+{
+  uint8_t header[5];
+  size_t headerLength = 0;
+
+  header[headerLength++] = MUX_FLAG;
+  header[headerLength++] = (dlci << 2) | (command ? MUX_CR : 0) | MUX_EA;
+  header[headerLength++] = control;
+  if (length <= 0x7f) {
+    header[headerLength++] = (length << 1) | MUX_EA;
+  } else {
+    header[headerLength++] = (length << 1) & 0xfe;
+    header[headerLength++] = length >> 7;
+  }
+
+  // the FCS of UIH frames is calculated without the data
+  uint8_t fcs = 0xff;
+  for (size_t i = 1; i < headerLength; i++) {
+    fcs = muxCrc(fcs, header[i]);
+  }
+
+  if (control != MUX_UIH) {
+    for (size_t i = 0; i < length; i++) {
+      fcs = muxCrc(fcs, data[i]);
+    }
+  }
+
+  uint8_t trailer[2] = { (uint8_t)(0xff - fcs), MUX_FLAG };
+
+  // the frames of other tasks aren't mixed in
+  lock();
+  _uart->write(header, headerLength);
+  if (length) {
+    _uart->write(data, length);
+  }
+  _uart->write(trailer, sizeof(trailer));
+  unlock();
+}
+
+void ModemMuxClass::sendStatus(uint8_t dlci, bool stop)
+{
+  uint8_t msc[4] = {
+    MUX_MSC | MUX_CR,
+    (2 << 1) | MUX_EA,
+    (uint8_t)((dlci << 2) | MUX_CR | MUX_EA),
+    (uint8_t)(MUX_EA | MUX_SIGNAL_RTC | MUX_SIGNAL_RTR | MUX_SIGNAL_DV | (stop ? MUX_SIGNAL_FC : 0))
+  };
+
+  sendFrame(0, MUX_UIH, true, msc, sizeof(msc));
+}
+
+size_t ModemMuxClass::writeData(ModemMuxChannel& channel, const uint8_t* data, size_t length)
+{
+  size_t written = 0;
+
+  while (written < length) {
+    // the modem accepts data again with MSC or FCON. The writer can be the lwIP task,
+    // it sleeps between the polls and the other tasks run.
+    for (unsigned long start = millis(); channel._remoteStopped || _remoteStopped;) {
+      if ((millis() - start) >= MODEM_MUX_WRITE_TIMEOUT_MS) {
+        return written;
+      }
+
+      poll();
+
+      if (channel._remoteStopped || _remoteStopped) {
+        vTaskDelay(1);
+      }
+    }
+
+    if (!channel._open) {
+      break;
+    }
+
+    size_t chunkSize = length - written;
+    if (chunkSize > MODEM_MUX_FRAME_SIZE) {
+      chunkSize = MODEM_MUX_FRAME_SIZE;
+    }
+
+    sendFrame(channel._dlci, MUX_UIH, true, data + written, chunkSize);
+    written += chunkSize;
+  }
+
+  return written;
+}
+
+void ModemMuxClass::parse(uint8_t c)
+{
+  switch (_frameState) {
+    case FRAME_FLAG:
+    default: {
+      if (c == MUX_FLAG) {
+        _frameState = FRAME_ADDRESS;
+      }
+      break;
+    }
+
+    case FRAME_ADDRESS: {
+      // several flags between the frames
+      if (c == MUX_FLAG) {
+        break;
+      }
+
+      _frameAddress = c;
+      _frameFcs = muxCrc(0xff, c);
+      _frameState = FRAME_CONTROL;
+      break;
+    }
+
+    case FRAME_CONTROL: {
+      _frameControl = c;
+      _frameFcs = muxCrc(_frameFcs, c);
+      _frameState = FRAME_LENGTH;
+      break;
+    }
+
+    case FRAME_LENGTH:
+    case FRAME_LENGTH2: {
+      _frameFcs = muxCrc(_frameFcs, c);
+
+      if (_frameState == FRAME_LENGTH) {
+        _frameLength = c >> 1;
+        if (!(c & MUX_EA)) {
+          _frameState = FRAME_LENGTH2;
+          break;
+        }
+      } else {
+        _frameLength |= (size_t)c << 7;
+      }
+
+      _frameIndex = 0;
+      _frameTooLong = _frameLength > sizeof(_frame);
+      _frameState = _frameLength ? FRAME_DATA : FRAME_FCS;
+      break;
+    }
+
+    case FRAME_DATA: {
+      if (_frameIndex < sizeof(_frame)) {
+        _frame[_frameIndex] = c;
+      }
+
+      if ((_frameControl & ~MUX_PF) != MUX_UIH) {
+        _frameFcs = muxCrc(_frameFcs, c);
+      }
+
+      if (++_frameIndex == _frameLength) {
+        _frameState = FRAME_FCS;
+      }
+      break;
+    }
+
+    case FRAME_FCS: {
+      _frameFcs = muxCrc(_frameFcs, c);
+      _frameState = FRAME_END;
+      break;
+    }
+
+    case FRAME_END: {
+      if (c == MUX_FLAG && _frameFcs == MUX_FCS_GOOD && !_frameTooLong) {
+        handleFrame();
+      }
+
+      // the closing flag can be the opening flag of the next frame
+      _frameState = (c == MUX_FLAG) ? FRAME_ADDRESS : FRAME_FLAG;
+      break;
+    }
+  }
+}
+
+void ModemMuxClass::handleFrame()
+{
+  uint8_t dlci = _frameAddress >> 2;
+  ModemMuxChannel* channel = (dlci >= 1 && dlci <= MODEM_MUX_CHANNELS) ? &_channels[dlci - 1] : NULL;
+
+  switch (_frameControl & ~MUX_PF) {
+    case MUX_UA: {
+      if (dlci == 0) {
+        _control0Open = true;
+      } else if (channel) {
+        channel->_open = true;
+      }
+      break;
+    }
+
+    case MUX_DM: {
+      if (channel) {
+        channel->_open = false;
+      }
+      break;
+    }
+
+    case MUX_DISC: {
+      sendFrame(dlci, MUX_UA | MUX_PF, false, NULL, 0);
+
+      if (dlci == 0) {
+        _control0Open = false;
+      } else if (channel) {
+        channel->_open = false;
+      }
+      break;
+    }
+
+    case MUX_UIH:
+    case MUX_UI: {
+      if (dlci == 0) {
+        handleControl(_frame, _frameLength);
+      } else if (channel) {
+        channel->receive(_frame, _frameLength);
+        checkFlow(*channel);
+      }
+      break;
+    }
+  }
+}
+
+void ModemMuxClass::handleControl(const uint8_t* data, size_t length)
+{
+  if (length < 2 || 2 + (size_t)(data[1] >> 1) > length) {
+    return;
+  }
+
+  bool command = data[0] & MUX_CR;
+  const uint8_t* value = &data[2];
+  size_t valueLength = data[1] >> 1;
+
+  switch (data[0] & ~MUX_CR) {
+    case MUX_MSC: {
+      if (command && valueLength >= 2) {
+        uint8_t dlci = value[0] >> 2;
+
+        if (dlci >= 1 && dlci <= MODEM_MUX_CHANNELS) {
+          _channels[dlci - 1]._remoteStopped = value[1] & MUX_SIGNAL_FC;
+        }
+      }
+      break;
+    }
+
+    case MUX_FCON:
+    case MUX_FCOFF: {
+      if (command) {
+        _remoteStopped = (data[0] & ~MUX_CR) == MUX_FCOFF;
+      }
+      break;
+    }
+
+    case MUX_CLD: {
+      // the answer of end()
+      if (!command) {
+        _control0Open = false;
+      }
+      return;
+    }
+
+    case MUX_TEST:
+      break;
+
+    default:
+      return;
+  }
+
+  if (command) {
+    // the same message confirms the command
+    uint8_t response[MODEM_MUX_FRAME_SIZE];
+
+    memcpy(response, data, length);
+    response[0] &= ~MUX_CR;
+    sendFrame(0, MUX_UIH, true, response, length);
+  }
+}
+
+void ModemMuxClass::checkFlow(ModemMuxChannel& channel)
+{
+  // the receiving task and the reading task
+  lock();
+
+  portENTER_CRITICAL(&_bufferMux);
+  size_t count = channel._count;
+  portEXIT_CRITICAL(&_bufferMux);
+
+  // room for two frames more, the modem can send some data before it stops
+  if (!channel._localStopped && (sizeof(channel._buffer) - count) < 2 * MODEM_MUX_FRAME_SIZE) {
+    channel._localStopped = true;
+    sendStatus(channel._dlci, true);
+  } else if (channel._localStopped && count <= sizeof(channel._buffer) / 2) {
+    channel._localStopped = false;
+    sendStatus(channel._dlci, false);
+  }
+
+  unlock();
+}
+
+ModemMuxClass ModemMux;
@@ -0,0 +1,145 @@
+/*
+  This file is part of the MKR GSM library.
+  Copyright (C) 2026  KMP Electronics Ltd (https://kmpelectronics.eu/)
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+*/
+
+#ifndef _MODEM_MUX_INCLUDED_H
+#define _MODEM_MUX_INCLUDED_H
+
+#include <Arduino.h>
+#include <freertos/semphr.h>
+
+// 3GPP TS 27.010 multiplexer, basic option. Every virtual channel (DLC) is a Stream with its own
+// receive buffer and flow control. MODEM runs on channel 1, the others are free for a second
+// AT command interpreter (ModemClass(stream)), bulk data or PPP.
+// The channels can be used from different tasks (e.g. GSMPPP): available() receives the frames
+// of all channels, the receiving and the frame writes are serialized by a mutex.
+
+// virtual channels, DLC 1 to MODEM_MUX_CHANNELS
+#ifndef MODEM_MUX_CHANNELS
+#define MODEM_MUX_CHANNELS 3
+#endif
+
+// max information field length (N1)
+#ifndef MODEM_MUX_FRAME_SIZE
+#define MODEM_MUX_FRAME_SIZE 127
+#endif
+
+// receive buffer of one channel, the modem is stopped (MSC FC) when it is almost full
+#ifndef MODEM_MUX_BUFFER_SIZE
+#define MODEM_MUX_BUFFER_SIZE 1024
+#endif
+
+class ModemMuxClass;
+
+class ModemMuxChannel : public Stream {
+public:
+  ModemMuxChannel();
+
+  virtual int available();
+  virtual int read();
+  virtual int peek();
+  virtual size_t write(uint8_t c);
+  virtual size_t write(const uint8_t* buf, size_t size);
+  virtual void flush();
+  using Print::write;
+
+  bool isOpen() { return _open; }
+  // received bytes lost because the buffer was full
+  unsigned long overflows() { return _overflows; }
+
+private:
+  friend class ModemMuxClass;
+
+  ModemMuxClass* _mux;
+  uint8_t _dlci;
+  bool _open;
+  // the modem doesn't accept data (MSC FC)
+  bool _remoteStopped;
+  // the modem is asked to stop sending
+  bool _localStopped;
+  unsigned long _overflows;
+
+  uint8_t _buffer[MODEM_MUX_BUFFER_SIZE];
+  size_t _head;
+  size_t _count;
+
+  void receive(const uint8_t* data, size_t length);
+};
+
+class ModemMuxClass {
+public:
+  ModemMuxClass();
+
+  // switches the modem to multiplexer mode (AT+CMUX) and opens the channels,
+  // MODEM continues on channel 1, its UART is used for the frames
+  int begin(unsigned long timeout = 3000);
+  // closes the multiplexer, MODEM returns to the UART
+  void end();
+
+  // channel from 1 to MODEM_MUX_CHANNELS
+  ModemMuxChannel& channel(int index);
+
+  // receives the frames, it is called by the channels
+  void poll();
+
+private:
+  friend class ModemMuxChannel;
+
+  Stream* _uart;
+  ModemMuxChannel _channels[MODEM_MUX_CHANNELS];
+  bool _active;
+  // FCOFF from the modem, no data on all channels
+  bool _remoteStopped;
+  bool _control0Open;
+  bool _polling;
+  // recursive, the received frames are answered while it is taken
+  SemaphoreHandle_t _lock;
+
+  enum {
+    FRAME_FLAG,
+    FRAME_ADDRESS,
+    FRAME_CONTROL,
+    FRAME_LENGTH,
+    FRAME_LENGTH2,
+    FRAME_DATA,
+    FRAME_FCS,
+    FRAME_END
+  } _frameState;
+  uint8_t _frameAddress;
+  uint8_t _frameControl;
+  size_t _frameLength;
+  size_t _frameIndex;
+  uint8_t _frameFcs;
+  uint8_t _frame[MODEM_MUX_FRAME_SIZE];
+  bool _frameTooLong;
+
+  void lock();
+  void unlock();
+  int open(uint8_t dlci, unsigned long timeout);
+  void sendFrame(uint8_t dlci, uint8_t control, bool command, const uint8_t* data, size_t length);
+  void sendStatus(uint8_t dlci, bool stop);
+  size_t writeData(ModemMuxChannel& channel, const uint8_t* data, size_t length);
+  void parse(uint8_t c);
+  void handleFrame();
+  void handleControl(const uint8_t* data, size_t length);
+  void checkFlow(ModemMuxChannel& channel);
+};
+
+extern ModemMuxClass ModemMux;
+
+#endif
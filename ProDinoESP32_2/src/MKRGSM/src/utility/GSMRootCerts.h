@@ -27,6 +27,8 @@ struct GSMRootCert {
   const char* name;
   const uint8_t* data;
   const int size;
+  // MD5 of data as reported by AT+USECMNG=4, NULL - calculated when the cert is checked
+  const char* md5;
 };
 
 static const GSMRootCert GSM_ROOT_CERTS[] = {
@@ -125,7 +127,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x92, 0x94, 0xd8, 0x82, 0x17, 0x5a, 0x7b, 0xd0, 0xbc, 0xc7, 0x8f, 0x4e,
       0x86, 0x04
     },
-    1082
+    1082,
+    "1d3554048578b03f42424dbf20730a3f"
   },
   {
     "Baltimore_CyberTrust_Root",
@@ -206,7 +209,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0xee, 0x3c, 0xd5, 0xfc, 0xe7, 0x81, 0x1d, 0x19, 0xc3, 0x24, 0x42, 0xea,
       0x63, 0x39, 0xa9
     },
-    891
+    891,
+    "acb694a59c17e0d791529bb19706a6e4"
   },
   {
     "COMODO_RSA_Certification_Authority",
@@ -337,7 +341,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x0e, 0x82, 0xe7, 0xcd, 0xce, 0xc8, 0x2d, 0xa6, 0x51, 0x7f, 0x21, 0xc1,
       0x35, 0x53, 0x85, 0x06, 0x4a, 0x5d, 0x9f, 0xad, 0xbb, 0x1b, 0x5f, 0x74
     },
-    1500
+    1500,
+    "1b31b0714036cc143691adc43efdec18"
   },
   {
     "DST_Root_CA_X3",
@@ -414,7 +419,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x77, 0x0b, 0xd8, 0x91, 0x0b, 0x04, 0x8e, 0x07, 0xdb, 0x29, 0xb6, 0x0a,
       0xee, 0x9d, 0x82, 0x35, 0x35, 0x10
     },
-    846
+    846,
+    "410352dc0ff7501b16f0028eba6f45c5"
   },
   {
     "DigiCert_High_Assurance_EV_Root_CA",
@@ -501,7 +507,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x25, 0x27, 0x67, 0xa0, 0x37, 0xf3, 0x00, 0x82, 0x7d, 0x54, 0xd7, 0xa9,
       0xf8, 0xe9, 0x2e, 0x13, 0xa3, 0x77, 0xe8, 0x1f, 0x4a
     },
-    969
+    969,
+    "d474de575c39b2d39c8583c5c065498a"
   },
   {
     "Entrust_Root_Certification_Authority",
@@ -605,7 +612,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0xd2, 0xf7, 0x57, 0x70, 0x36, 0xb3, 0xbf, 0xfc, 0x28, 0xaf, 0x71, 0x25,
       0x85, 0x5b, 0x13, 0xfe, 0x1e, 0x7f, 0x5a, 0xb4, 0x3c
     },
-    1173
+    1173,
+    "d6a5c3ed5ddd3e00c13d87921f1d3fe4"
   },
   {
     "Equifax_Secure_Certificate_Authority",
@@ -678,7 +686,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x70, 0xf1, 0x94, 0x21, 0x65, 0x44, 0x5f, 0xfa, 0xfc, 0xef, 0x29, 0x68,
       0xa9, 0xa2, 0x87, 0x79, 0xef, 0x79, 0xef, 0x4f, 0xac, 0x07, 0x77, 0x38
     },
-    804
+    804,
+    "67cb9dc013248a829bb2171ed11becd4"
   },
   {
     "GeoTrust_Global_CA",
@@ -756,7 +765,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x75, 0xe8, 0xd5, 0xd0, 0xdc, 0x4f, 0x34, 0xed, 0xc2, 0x05, 0x66, 0x80,
       0xa1, 0xcb, 0xe6, 0x33
     },
-    856
+    856,
+    "f775ab29fb514eb7775eff053c998ef5"
   },
   {
     "GeoTrust_Primary_Certification_Authority_G3",
@@ -848,7 +858,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0xb2, 0x99, 0x22, 0xe1, 0xc1, 0x2b, 0xc7, 0x9c, 0xf8, 0xf3, 0x5f, 0xa8,
       0x82, 0x12, 0xeb, 0x19, 0x11, 0x2d
     },
-    1026
+    1026,
+    "b5e83436c910445848706d2e83d4b805"
   },
   {
     "GlobalSign",
@@ -934,7 +945,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x78, 0xc2, 0x60, 0x12, 0xdb, 0x25, 0x40, 0x8c, 0x6a, 0xfc, 0x7e, 0x42,
       0x38, 0x40, 0x64, 0x12, 0xf7, 0x9e, 0x81, 0xe1, 0x93, 0x2e
     },
-    958
+    958,
+    "9414777e3e5efd8f30bd41b0cfe7d030"
   },
   {
     "Go_Daddy_Root_Certificate_Authority_G2",
@@ -1021,7 +1033,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x0c, 0x4d, 0xf6, 0xa7, 0x6b, 0xb4, 0x99, 0x84, 0x65, 0xca, 0x7a, 0x88,
       0xe2, 0xe2, 0x44, 0xbe, 0x5c, 0xf7, 0xea, 0x1c, 0xf5
     },
-    969
+    969,
+    "803abc22c1e6fb8d9b3b274a321b9a01"
   },
   {
     "VeriSign_Class_3_Public_Primary_Certification_Authority_G5",
@@ -1131,12 +1144,14 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x38, 0x54, 0x83, 0x5f, 0xd1, 0xe8, 0x2c, 0xf2, 0xac, 0x11, 0xd6, 0xa8,
       0xed, 0x63, 0x6a
     },
-    1239
+    1239,
+    "cb17e431673ee209fe455793f30afa1c"
   },
   {
     "AmazonRootCA1",
     NULL, // remove
-    0
+    0,
+    NULL
   },
   {
     "Starfield_Services_Root_Certificate_Authority_G2",
@@ -1227,7 +1242,8 @@ static const GSMRootCert GSM_ROOT_CERTS[] = {
       0x0d, 0x4d, 0x26, 0x57, 0x71, 0xda, 0x20, 0xfc, 0xc1, 0x4a, 0x50, 0x8d,
       0xb1, 0x28, 0xba
     },
-    1011
+    1011,
+    "173574af7b611cebf4f93ce2ee40f9a2"
   }
 };
 
@@ -17,6 +17,7 @@
   Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
 */
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -26,11 +27,16 @@
 
 #define GSM_SOCKET_NUM_BUFFERS (sizeof(_buffers) / sizeof(_buffers[0]))
 
-#define GSM_SOCKET_BUFFER_SIZE 512
+// max data length of AT+USORD in hex mode
+#define GSM_SOCKET_READ_MAX_SIZE 512
 
 GSMSocketBufferClass::GSMSocketBufferClass()
 {
   memset(&_buffers, 0x00, sizeof(_buffers));
+
+  MODEM.addUrcHandler(this, "+UUSORD");
+  MODEM.addUrcHandler(this, "+UUSOCL");
+  MODEM.addUrcHandler(this, "+UUSOLI");
 }
 
 GSMSocketBufferClass::~GSMSocketBufferClass()
@@ -42,57 +48,90 @@ GSMSocketBufferClass::~GSMSocketBufferClass()
 
 void GSMSocketBufferClass::close(int socket)
 {
+  // a sent command isn't stopped, only its result is dropped
+  if (_buffers[socket].reading) {
+    MODEM.cancel(_buffers[socket].readId);
+    _buffers[socket].reading = false;
+  }
+
   if (_buffers[socket].data) {
     free(_buffers[socket].data);
     _buffers[socket].data = _buffers[socket].head = NULL;
     _buffers[socket].length = 0;
   }
+
+  _buffers[socket].pending = 0;
+  _buffers[socket].closed = false;
 }
 
-int GSMSocketBufferClass::available(int socket)
+int GSMSocketBufferClass::available(int socket, bool synch)
 {
+  if (_buffers[socket].reading) {
+    MODEM.poll();
+
+    while (synch && _buffers[socket].reading) {
+      MODEM.poll();
+    }
+
+    if (_buffers[socket].reading) {
+      return 0;
+    }
+  }
+
   if (_buffers[socket].length == 0) {
+    if (_buffers[socket].pending == 0) {
+      // +UUSORD and +UUSOCL
+      MODEM.poll();
+
+      if (_buffers[socket].pending == 0) {
+        return _buffers[socket].closed ? -1 : 0;
+      }
+    }
+
     if (_buffers[socket].data == NULL) {
       _buffers[socket].data = _buffers[socket].head = (uint8_t*)malloc(GSM_SOCKET_BUFFER_SIZE);
       _buffers[socket].length = 0;
     }
 
-    String response;
-
-    MODEM.sendf("AT+USORD=%d,%d", socket, GSM_SOCKET_BUFFER_SIZE);
-    int status = MODEM.waitForResponse(10000, &response);
-    if (status != 1) {
-      return -1;
+    if (!synch) {
+      return readQueued(socket);
     }
 
-    if (!response.startsWith("+USORD: ")) {
-      return 0;
-    }
+    size_t size = 0;
 
-    int firstQuoteIndex = response.indexOf("\"");
+    while (size < GSM_SOCKET_BUFFER_SIZE && _buffers[socket].pending) {
+      size_t chunkSize = GSM_SOCKET_BUFFER_SIZE - size;
+
+      if (chunkSize > GSM_SOCKET_READ_MAX_SIZE) {
+        chunkSize = GSM_SOCKET_READ_MAX_SIZE;
+      }
 
-    response.remove(0, firstQuoteIndex + 1);
-    response.remove(response.length() - 1);
+      // exactly the announced data
+      if (chunkSize > _buffers[socket].pending) {
+        chunkSize = _buffers[socket].pending;
+      }
 
-    size_t size = response.length() / 2;
+      size_t length = chunkSize;
 
-    for (size_t i = 0; i < size; i++) {
-      byte n1 = response[i * 2];
-      byte n2 = response[i * 2 + 1];
+      MODEM.sendf("AT+USORD=%d,%d", socket, (int)chunkSize);
+      int status = MODEM.waitForHexResponse(10000, _buffers[socket].data + size, &length);
+      if (status != 1) {
+        if (size) {
+          break;
+        }
 
-      if (n1 > '9') {
-        n1 = (n1 - 'A') + 10;
-      } else {
-        n1 = (n1 - '0');
+        return -1;
       }
 
-      if (n2 > '9') {
-        n2 = (n2 - 'A') + 10;
-      } else {
-        n2 = (n2 - '0');
+      size += length;
+
+      // the modem has no more data
+      if (length < chunkSize) {
+        _buffers[socket].pending = 0;
+        break;
       }
 
-      _buffers[socket].data[i] = (n1 << 4) | n2;
+      _buffers[socket].pending -= length;
     }
 
     _buffers[socket].head = _buffers[socket].data;
@@ -102,6 +141,78 @@ int GSMSocketBufferClass::available(int socket)
   return _buffers[socket].length;
 }
 
+int GSMSocketBufferClass::readQueued(int socket)
+{
+  // one AT+USORD, the next one is queued when the data is read
+  size_t chunkSize = GSM_SOCKET_BUFFER_SIZE;
+
+  if (chunkSize > GSM_SOCKET_READ_MAX_SIZE) {
+    chunkSize = GSM_SOCKET_READ_MAX_SIZE;
+  }
+
+  if (chunkSize > _buffers[socket].pending) {
+    chunkSize = _buffers[socket].pending;
+  }
+
+  char command[24];
+  snprintf(command, sizeof(command), "AT+USORD=%d,%d", socket, (int)chunkSize);
+
+  // the hex response is decoded from the response buffer, it fits in MODEM_BUFFER_SIZE
+  int id = MODEM.enqueue(command, onReadResult, (void*)(intptr_t)socket, 10000);
+  if (id < 0) {
+    // the queue is full, the next call tries again
+    return 0;
+  }
+
+  _buffers[socket].reading = true;
+  _buffers[socket].readId = id;
+  _buffers[socket].requested = chunkSize;
+
+  return 0;
+}
+
+void GSMSocketBufferClass::onReadResult(int result, const char* response, void* arg)
+{
+  int socket = (int)(intptr_t)arg;
+  GSMSocketBufferClass& buffers = GSMSocketBuffer;
+
+  buffers._buffers[socket].reading = false;
+
+  // the same as a failed AT+USORD in the synch mode, available() returns -1
+  if (result != 1) {
+    buffers._buffers[socket].pending = 0;
+    buffers._buffers[socket].closed = true;
+    return;
+  }
+
+  // +USORD: 0,12,"48656C6C6F20776F726C6421"
+  const char* hex = strchr(response, '"');
+  size_t length = 0;
+
+  if (hex != NULL) {
+    for (hex++; length < buffers._buffers[socket].requested; hex += 2) {
+      int high = ModemClass::hexValue(hex[0]);
+      int low = (high < 0) ? -1 : ModemClass::hexValue(hex[1]);
+
+      if (low < 0) {
+        break;
+      }
+
+      buffers._buffers[socket].data[length++] = (high << 4) | low;
+    }
+  }
+
+  // the modem has no more data
+  if (length < buffers._buffers[socket].requested) {
+    buffers._buffers[socket].pending = 0;
+  } else {
+    buffers._buffers[socket].pending -= length;
+  }
+
+  buffers._buffers[socket].head = buffers._buffers[socket].data;
+  buffers._buffers[socket].length = length;
+}
+
 int GSMSocketBufferClass::peek(int socket)
 {
   if (!available(socket)) {
@@ -130,4 +241,32 @@ int GSMSocketBufferClass::read(int socket, uint8_t* data, size_t length)
   return length;
 }
 
+void GSMSocketBufferClass::handleUrc(const String& urc)
+{
+  int socket = urc.charAt(9) - '0';
+
+  if (socket < 0 || socket >= (int)GSM_SOCKET_NUM_BUFFERS) {
+    return;
+  }
+
+  if (urc.startsWith("+UUSORD: ")) {
+    // SSL socket closed
+    if (urc.endsWith(",4294967295")) {
+      _buffers[socket].closed = true;
+      return;
+    }
+
+    // the data in the modem, not only the new data, parsed in place without a String copy
+    int commaIndex = urc.indexOf(',');
+    if (commaIndex != -1) {
+      _buffers[socket].pending = atoi(urc.c_str() + commaIndex + 1);
+    }
+  } else if (urc.startsWith("+UUSOCL: ")) {
+    _buffers[socket].closed = true;
+  } else if (urc.startsWith("+UUSOLI: ")) {
+    // new accepted socket
+    close(socket);
+  }
+}
+
 GSMSocketBufferClass GSMSocketBuffer;
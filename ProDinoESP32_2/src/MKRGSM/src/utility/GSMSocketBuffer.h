@@ -23,25 +23,49 @@
 #include <stddef.h>
 #include <stdint.h>
 
-class GSMSocketBufferClass {
+#include "../Modem.h"
+
+// per socket receive buffer, it is filled by several AT+USORD if it is bigger than GSM_SOCKET_READ_MAX_SIZE
+#ifndef GSM_SOCKET_BUFFER_SIZE
+#define GSM_SOCKET_BUFFER_SIZE 512
+#endif
+
+// AT+USORD is sent only for the data announced by +UUSORD, idle sockets cost no AT commands
+class GSMSocketBufferClass : public ModemUrcHandler {
 
 public:
 public:
   GSMSocketBufferClass();
   virtual ~GSMSocketBufferClass();
 
+  // releases the buffer and clears the socket state, it is called when the socket is closed or created
   void close(int socket);
 
-  int available(int socket);
+  // -1 when the socket is closed and all data is read.
+  // synch false - AT+USORD is queued (MODEM.enqueue) and the data is available after MODEM.poll() receives it
+  int available(int socket, bool synch = true);
   int peek(int socket);
   int read(int socket, uint8_t* data, size_t length);
 
+  virtual void handleUrc(const String& urc);
+
 private:
   struct {
     uint8_t* data;
     uint8_t* head;
     int length;
+    // bytes in the modem from +UUSORD
+    size_t pending;
+    // +UUSOCL
+    bool closed;
+    // a queued AT+USORD
+    bool reading;
+    int readId;
+    size_t requested;
   } _buffers[7];
+
+  int readQueued(int socket);
+  static void onReadResult(int result, const char* response, void* arg);
 };
 
 extern GSMSocketBufferClass GSMSocketBuffer;
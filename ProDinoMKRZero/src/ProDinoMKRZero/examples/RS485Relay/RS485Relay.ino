@@ -123,7 +123,7 @@ void ProcessData()
 			// Set relay status if only chars are 0 or 1.
 			if (_dataBuffer[i] == CH_0 || _dataBuffer[i] == CH_1)
 			{
-				KMPProDinoMKRZero.SetRelayState(relayNum, _dataBuffer[i] == CH_1);
+				KMPProDinoMKRZero.SetRelayState(relayNum, _dataBuffer[i] == CH_1, SourceRS485);
 			}
 
 			++relayNum;
@@ -0,0 +1,216 @@
+// KMPEventLog.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Fixed size RAM event log for relays and inputs changes.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPEventLog.h"
+
+#define EVENT_LOG_MASK (EVENT_LOG_SIZE - 1)
+// Marker of valid persistent log.
+#define EVENT_LOG_VALID 0x4B454C31 // KEL1
+
+// Critical section. Short - only index update and entry copy.
+#if defined(ARDUINO_ARCH_ESP32)
+static portMUX_TYPE _eventLogMux = portMUX_INITIALIZER_UNLOCKED;
+#define EVENT_LOG_LOCK()   portENTER_CRITICAL_ISR(&_eventLogMux)
+#define EVENT_LOG_UNLOCK() portEXIT_CRITICAL_ISR(&_eventLogMux)
+#define EVENT_LOG_ISR_ATTR IRAM_ATTR
+#define EVENT_LOG_NOINIT   RTC_NOINIT_ATTR
+#elif defined(ARDUINO_ARCH_ESP8266)
+#define EVENT_LOG_LOCK()   uint32_t savedPS = xt_rsil(15)
+#define EVENT_LOG_UNLOCK() xt_wsr_ps(savedPS)
+#define EVENT_LOG_ISR_ATTR IRAM_ATTR
+// ESP8266 doesn't keep RAM after reset. Persistent log isn't supported.
+#define EVENT_LOG_NOINIT
+#else
+#define EVENT_LOG_LOCK()   uint32_t primask = __get_PRIMASK(); __disable_irq()
+#define EVENT_LOG_UNLOCK() __set_PRIMASK(primask)
+#define EVENT_LOG_ISR_ATTR
+#define EVENT_LOG_NOINIT   __attribute__((section(".noinit")))
+#endif
+
+struct EventLogData_t {
+	uint32_t Valid;
+	uint32_t Lost;
+	uint16_t Head;
+	uint16_t Count;
+	uint8_t Sequence;
+	EventLogEntry Entries[EVENT_LOG_SIZE];
+};
+
+// Always in the no init RAM, begin decides if the content is kept.
+static EVENT_LOG_NOINIT EventLogData_t _eventLog;
+static bool _eventLogStarted = false;
+
+static const char* const EVENT_SOURCE_NAMES[] = { "local", "web", "mqtt", "rs485", "schedule", "hardware", "restore" };
+#define EVENT_SOURCE_NAMES_COUNT (sizeof(EVENT_SOURCE_NAMES) / sizeof(EVENT_SOURCE_NAMES[0]))
+
+KMPEventLogClass KMPEventLog;
+
+void KMPEventLogClass::begin(bool persist)
+{
+	_eventLogStarted = true;
+
+	// Persistent log is kept if it is valid.
+	if (persist && _eventLog.Valid == EVENT_LOG_VALID && _eventLog.Head < EVENT_LOG_SIZE && _eventLog.Count <= EVENT_LOG_SIZE)
+	{
+		return;
+	}
+
+	clear();
+}
+
+bool KMPEventLogClass::isStarted()
+{
+	return _eventLogStarted;
+}
+
+void EVENT_LOG_ISR_ATTR KMPEventLogClass::add(EventChannelType type, uint8_t channel, bool state, EventSource source)
+{
+	uint32_t now = millis();
+
+	EVENT_LOG_LOCK();
+
+	// The head is masked, the no init RAM isn't valid before begin.
+	EventLogEntry* entry = &_eventLog.Entries[_eventLog.Head & EVENT_LOG_MASK];
+	entry->Timestamp = now;
+	entry->Channel = (channel & EVENT_CHANNEL_NUM_MASK) | type;
+	entry->State = state;
+	entry->Source = source;
+	entry->Sequence = _eventLog.Sequence++;
+
+	_eventLog.Head = (_eventLog.Head + 1) & EVENT_LOG_MASK;
+
+	if (_eventLog.Count < EVENT_LOG_SIZE)
+	{
+		++_eventLog.Count;
+	}
+	else
+	{
+		++_eventLog.Lost;
+	}
+
+	EVENT_LOG_UNLOCK();
+}
+
+void KMPEventLogClass::clear()
+{
+	EVENT_LOG_LOCK();
+
+	_eventLog.Head = 0;
+	_eventLog.Count = 0;
+	_eventLog.Lost = 0;
+	_eventLog.Sequence = 0;
+	_eventLog.Valid = EVENT_LOG_VALID;
+
+	EVENT_LOG_UNLOCK();
+}
+
+uint16_t KMPEventLogClass::count()
+{
+	return _eventLog.Count;
+}
+
+uint32_t KMPEventLogClass::lost()
+{
+	return _eventLog.Lost;
+}
+
+bool KMPEventLogClass::get(uint16_t index, EventLogEntry& entry)
+{
+	bool result = false;
+
+	EVENT_LOG_LOCK();
+
+	if (index < _eventLog.Count)
+	{
+		// The oldest entry is Count positions before the head.
+		uint16_t pos = (_eventLog.Head - _eventLog.Count + index) & EVENT_LOG_MASK;
+		entry = _eventLog.Entries[pos];
+		result = true;
+	}
+
+	EVENT_LOG_UNLOCK();
+
+	return result;
+}
+
+/**
+* @brief Write uint32_t in little endian.
+*
+* @return size_t Written bytes.
+*/
+static size_t writeUInt32LE(Print& out, uint32_t value)
+{
+	uint8_t buff[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24) };
+
+	return out.write(buff, sizeof(buff));
+}
+
+size_t KMPEventLogClass::exportBinary(Print& out)
+{
+	uint16_t cnt = count();
+
+	size_t result = out.write((const uint8_t*)EVENT_LOG_MAGIC, 3);
+	result += out.write((uint8_t)EVENT_LOG_VERSION);
+	result += out.write((uint8_t)cnt);
+	result += out.write((uint8_t)(cnt >> 8));
+	result += writeUInt32LE(out, lost());
+	result += writeUInt32LE(out, millis());
+
+	EventLogEntry entry;
+	for (uint16_t i = 0; i < cnt; i++)
+	{
+		if (!get(i, entry))
+		{
+			break;
+		}
+
+		result += writeUInt32LE(out, entry.Timestamp);
+		uint8_t buff[4] = { entry.Channel, entry.State, entry.Source, entry.Sequence };
+		result += out.write(buff, sizeof(buff));
+	}
+
+	return result;
+}
+
+size_t KMPEventLogClass::exportCsv(Print& out)
+{
+	size_t result = out.println("timestamp,type,channel,state,source,sequence");
+
+	uint16_t cnt = count();
+	EventLogEntry entry;
+	for (uint16_t i = 0; i < cnt; i++)
+	{
+		if (!get(i, entry))
+		{
+			break;
+		}
+
+		result += out.print(entry.Timestamp);
+		result += out.print((entry.Channel & EVENT_CHANNEL_TYPE_MASK) == ChannelOptoIn ? ",input," : ",relay,");
+		result += out.print(entry.Channel & EVENT_CHANNEL_NUM_MASK);
+		result += out.print(',');
+		result += out.print(entry.State);
+		result += out.print(',');
+		result += out.print(sourceName(entry.Source));
+		result += out.print(',');
+		result += out.println(entry.Sequence);
+	}
+
+	return result;
+}
+
+const char* KMPEventLogClass::sourceName(uint8_t source)
+{
+	if (source >= EVENT_SOURCE_NAMES_COUNT)
+	{
+		return "unknown";
+	}
+
+	return EVENT_SOURCE_NAMES[source];
+}
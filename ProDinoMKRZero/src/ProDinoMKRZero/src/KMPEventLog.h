@@ -0,0 +1,165 @@
+// KMPEventLog.h
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		Fixed size RAM event log for relays and inputs changes.
+//		Append is constant time and can be called from an interrupt.
+//		Input changes are found when the input is read (getOptoInState), the sketch should poll the inputs.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#ifndef _KMPEVENTLOG_H
+#define _KMPEVENTLOG_H
+
+#include <Arduino.h>
+
+// Event log entries count. Must be a power of two.
+// It is a library constant, KMPEventLog.cpp is compiled apart from the sketch and doesn't see its defines.
+#define EVENT_LOG_SIZE 128
+
+#if (EVENT_LOG_SIZE & (EVENT_LOG_SIZE - 1)) != 0
+#error "EVENT_LOG_SIZE must be a power of two."
+#endif
+
+// Binary export header: "KEL" + version.
+#define EVENT_LOG_MAGIC   "KEL"
+#define EVENT_LOG_VERSION 1
+
+/**
+ * @brief Who requests the change.
+ */
+enum EventSource {
+	SourceLocal = 0,
+	SourceWeb,
+	SourceMqtt,
+	SourceRS485,
+	SourceSchedule,
+	SourceHardware,
+	SourceRestore
+};
+
+/**
+ * @brief Channel type, it is stored in the high bit of EventLogEntry.Channel.
+ */
+enum EventChannelType {
+	ChannelRelay = 0x00,
+	ChannelOptoIn = 0x80
+};
+
+#define EVENT_CHANNEL_TYPE_MASK 0x80
+#define EVENT_CHANNEL_NUM_MASK  0x7F
+
+/**
+ * @brief One event - 8 bytes.
+ */
+struct __attribute__((packed)) EventLogEntry {
+	// millis() when the event happened.
+	uint32_t Timestamp;
+	// Channel number and type (ChannelRelay or ChannelOptoIn).
+	uint8_t Channel;
+	// New state 0 - Off, 1 - On.
+	uint8_t State;
+	// EventSource.
+	uint8_t Source;
+	// Sequence number low byte. Helps to find lost events.
+	uint8_t Sequence;
+};
+
+class KMPEventLogClass
+{
+ public:
+	/**
+	* @brief Initialize event log. It is called by the board begin if the sketch didn't call it before.
+	*
+	* @param persist true - the log is kept in a no init RAM and survives a software or a watchdog reset.
+	*                If the kept log is valid it continues, otherwise it is cleared. Not supported on ESP8266.
+	*
+	* @return void
+	*/
+	void begin(bool persist = false);
+
+	/**
+	* @brief Check if begin is called.
+	*
+	* @return bool true - started.
+	*/
+	bool isStarted();
+
+	/**
+	* @brief Add an event in the log. If the log is full the oldest event is overwritten.
+	*        Constant time, it can be called from ISR.
+	*
+	* @param type ChannelRelay or ChannelOptoIn.
+	* @param channel Channel number from 0.
+	* @param state New state.
+	* @param source Who requests the change.
+	*
+	* @return void
+	*/
+	void add(EventChannelType type, uint8_t channel, bool state, EventSource source);
+
+	/**
+	* @brief Clear the log.
+	*
+	* @return void
+	*/
+	void clear();
+
+	/**
+	* @brief Get events count in the log.
+	*
+	* @return uint16_t Events count, max EVENT_LOG_SIZE.
+	*/
+	uint16_t count();
+
+	/**
+	* @brief Get count of overwritten events since last clear.
+	*
+	* @return uint32_t Lost events count.
+	*/
+	uint32_t lost();
+
+	/**
+	* @brief Get an event. Index 0 is the oldest.
+	*
+	* @param index Event index from 0 to count() - 1.
+	* @param entry Result.
+	*
+	* @return bool true - the event exists, false - index is out of range.
+	*/
+	bool get(uint16_t index, EventLogEntry& entry);
+
+	/**
+	* @brief Write events in compact binary format.
+	*        Header: "KEL", version (1 byte), count (2 bytes LE), lost (4 bytes LE), now millis (4 bytes LE).
+	*        Each event: 8 bytes, see EventLogEntry. All numbers are little endian.
+	*
+	* @param out Output stream. Serial, Ethernet client, file and etc.
+	*
+	* @return size_t Written bytes.
+	*/
+	size_t exportBinary(Print& out);
+
+	/**
+	* @brief Write events as CSV with header line: timestamp,type,channel,state,source,sequence
+	*
+	* @param out Output stream. Serial, Ethernet client, file and etc.
+	*
+	* @return size_t Written bytes.
+	*/
+	size_t exportCsv(Print& out);
+
+	/**
+	* @brief Get source name. Example: SourceWeb -> "web".
+	*
+	* @param source Event source.
+	*
+	* @return const char* Source name.
+	*/
+	static const char* sourceName(uint8_t source);
+};
+
+extern KMPEventLogClass KMPEventLog;
+
+#endif
@@ -13,6 +13,7 @@
 // Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu> & Dimitar Antonov <d.antonov@kmpelectronics.eu>
 
 #include "KMPProDinoMKRZero.h"
+#include "KMPRS485Tx.h"
 
 // Relay outputs pins.
 #define Rel1Pin  21 // PA07
@@ -38,6 +39,8 @@
 #define RS485Transmit HIGH
 #define RS485Receive  LOW
 
+KMPRS485TxClass _rs485Tx(RS485Serial, RS485Pin, RS485Transmit);
+
 /**
  * @brief Relay pins.
  */
@@ -61,6 +64,13 @@ void KMPProDinoMKRZeroClass::init(BoardType board)
 void KMPProDinoMKRZeroClass::init(BoardType board, bool startEthernet, bool startGSM)
 {
 	_board = board;
+	_relaysMask = 0;
+	_optoInsMask = 0;
+	// The sketch can start a persistent log before.
+	if (!KMPEventLog.isStarted())
+	{
+		KMPEventLog.begin();
+	}
 
 	// Relay pins init.
 	pinMode(Rel1Pin, OUTPUT);
@@ -170,7 +180,7 @@ void KMPProDinoMKRZeroClass::NotStatusLed()
 /* Relays methods. */
 /* ----------------------------------------------------------------------- */
 
-void KMPProDinoMKRZeroClass::SetRelayState(uint8_t relayNumber, bool state)
+void KMPProDinoMKRZeroClass::SetRelayState(uint8_t relayNumber, bool state, EventSource source)
 {
 	// Check if relayNumber is out of range - return.
 	if (relayNumber > RELAY_COUNT - 1)
@@ -179,18 +189,25 @@ void KMPProDinoMKRZeroClass::SetRelayState(uint8_t relayNumber, bool state)
 	}
 
 	digitalWrite(Relay_Pins[relayNumber], state);
+
+	uint8_t bit = 1 << relayNumber;
+	if (((_relaysMask & bit) != 0) != state)
+	{
+		_relaysMask ^= bit;
+		KMPEventLog.add(ChannelRelay, relayNumber, state, source);
+	}
 }
 
-void KMPProDinoMKRZeroClass::SetRelayState(Relay relay, bool state)
+void KMPProDinoMKRZeroClass::SetRelayState(Relay relay, bool state, EventSource source)
 {
-	SetRelayState((uint8_t)relay, state);
+	SetRelayState((uint8_t)relay, state, source);
 }
 
-void KMPProDinoMKRZeroClass::SetAllRelaysState(bool state)
+void KMPProDinoMKRZeroClass::SetAllRelaysState(bool state, EventSource source)
 {
 	for (uint8_t i = 0; i < RELAY_COUNT; i++)
 	{
-		SetRelayState(i, state);
+		SetRelayState(i, state, source);
 	}
 }
 
@@ -232,7 +249,16 @@ bool KMPProDinoMKRZeroClass::GetOptoInState(uint8_t optoInNumber)
 		return false;
 	}
 
-	return !digitalRead(OPTOIN_PINS[optoInNumber]);
+	bool state = !digitalRead(OPTOIN_PINS[optoInNumber]);
+
+	uint8_t bit = 1 << optoInNumber;
+	if (((_optoInsMask & bit) != 0) != state)
+	{
+		_optoInsMask ^= bit;
+		KMPEventLog.add(ChannelOptoIn, optoInNumber, state, SourceHardware);
+	}
+
+	return state;
 }
 
 bool KMPProDinoMKRZeroClass::GetOptoInState(OptoIn optoIn)
@@ -252,6 +278,7 @@ void KMPProDinoMKRZeroClass::RS485Begin(unsigned long baud)
 void KMPProDinoMKRZeroClass::RS485Begin(unsigned long baud, uint16_t config)
 {
 	RS485Serial.begin(baud, config);
+	_rs485Tx.begin(baud, config);
 }
 
 void KMPProDinoMKRZeroClass::RS485End()
@@ -259,36 +286,9 @@ void KMPProDinoMKRZeroClass::RS485End()
 	RS485Serial.end();
 }
 
-/**
-* @brief Begin write data to RS485.
-*
-* @return void
-*/
-void RS485BeginWrite()
-{
-	digitalWrite(RS485Pin, RS485Transmit);
-}
-
-/**
-* @brief End write data to RS485.
-*
-* @return void
-*/
-void RS485EndWrite()
-{
-	RS485Serial.flush();
-	digitalWrite(RS485Pin, RS485Receive);
-}
-
 size_t KMPProDinoMKRZeroClass::RS485Write(uint8_t data)
 {
-	RS485BeginWrite();
-
-	size_t result = RS485Serial.write(data);
-
-	RS485EndWrite();
-
-	return result;
+	return _rs485Tx.write(&data, 1);
 }
 
 size_t KMPProDinoMKRZeroClass::RS485Write(char data)
@@ -298,34 +298,12 @@ size_t KMPProDinoMKRZeroClass::RS485Write(char data)
 
 size_t KMPProDinoMKRZeroClass::RS485Write(const char* data)
 {
-	RS485BeginWrite();
-
-	size_t len = strlen(data);
-	size_t result = 0;
-	while (len > 0)
-	{
-		result += RS485Serial.write(*data++);
-		--len;
-	}
-
-	RS485EndWrite();
-
-	return result;
+	return _rs485Tx.write((const uint8_t*)data, strlen(data));
 }
 
 size_t KMPProDinoMKRZeroClass::RS485Write(uint8_t* data, uint8_t dataLen)
 {
-	RS485BeginWrite();
-
-	size_t result = 0;
-	for (size_t i = 0; i < dataLen; i++)
-	{
-		result += RS485Serial.write(data[i]);
-	}
-
-	RS485EndWrite();
-
-	return result;
+	return _rs485Tx.write(data, dataLen);
 }
 
 int KMPProDinoMKRZeroClass::RS485Read()
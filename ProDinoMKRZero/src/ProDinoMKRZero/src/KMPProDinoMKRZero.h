@@ -19,6 +19,7 @@
 #include <Arduino.h>
 #include <Ethernet.h>
 #include <HardwareSerial.h>
+#include "KMPEventLog.h"
 
 // Inputs and outputs count.
 #define RELAY_COUNT  4
@@ -139,27 +140,30 @@ class KMPProDinoMKRZeroClass
 	*
 	* @param relayNumber Number of relay from 0 to RELAY_COUNT - 1. 0 - Relay1, 1 - Relay2 ...
 	* @param state New state of relay, true - On, false = Off.
+	* @param source Who requests the change. It is written in KMPEventLog if the relay state is changed.
 	*
 	* @return void
 	*/
-	void SetRelayState(uint8_t relayNumber, bool state);
+	void SetRelayState(uint8_t relayNumber, bool state, EventSource source = SourceLocal);
 	/**
 	* @brief Set relay new state.
 	*
 	* @param relay Relays - Relay1, Relay2 ...
 	* @param state New state of relay, true - On, false = Off.
+	* @param source Who requests the change.
 	*
 	* @return void
 	*/
-	void SetRelayState(Relay relay, bool state);
+	void SetRelayState(Relay relay, bool state, EventSource source = SourceLocal);
 	/**
 	* @brief Set all relays new state.
 	*
 	* @param state New state of relay, true - On, false = Off.
+	* @param source Who requests the change.
 	*
 	* @return void
 	*/
-	void SetAllRelaysState(bool state);
+	void SetAllRelaysState(bool state, EventSource source = SourceLocal);
 	/**
 	* @brief Set all relays in ON state.
 	*
@@ -298,6 +302,10 @@ class KMPProDinoMKRZeroClass
 	private:
 		void InitEthernet(bool startEthernet);
 		void InitGSM(bool startGSM);
+
+		// Last commanded relays states and last read inputs states. Used for event log.
+		uint8_t _relaysMask;
+		uint8_t _optoInsMask;
 };
 
 extern KMPProDinoMKRZeroClass KMPProDinoMKRZero;
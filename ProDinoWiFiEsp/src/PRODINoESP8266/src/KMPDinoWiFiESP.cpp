@@ -11,25 +11,11 @@
 // Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu> & Dimitar Antonov <d.antonov@kmpelectronics.eu>
 
 #include "KMPDinoWiFiESP.h"
+#include "KMPRS485Tx.h"
 #include <HardwareSerial.h>
 
 #define CS 0x0F
 
-#define READ_CMD  0x41
-#define WRITE_CMD 0x40
-
-#define IODIR   0x00
-#define IPOL    0x01
-#define GPINTEN 0x02
-#define DEFVAL  0x03
-#define INTCON  0x04
-#define IOCON   0x05
-#define GPPU    0x06
-#define INTF    0x07
-#define INTCAP  0x08
-#define GPIO    0x09
-#define OLAT    0x0A
-
 // Relay pins
 #define REL1PIN 0x04
 #define REL2PIN 0x05
@@ -45,6 +31,9 @@
 
 #define RS485PIN 0x10
 
+// RS485 transmitter. DE pin is active low.
+KMPRS485TxClass _rs485Tx(Serial, RS485PIN, LOW);
+
 /**
  * @brief Relay pins.
  */
@@ -57,28 +46,32 @@ const uint8_t RELAY_PINS[RELAY_COUNT] =
 const int OPTOIN_PINS[OPTOIN_COUNT] =
 { IN1PIN, IN2PIN, IN3PIN, IN4PIN };
 
-uint8_t  _expTxData[16]  __attribute__((aligned(4)));
-uint8_t  _expRxData[16]  __attribute__((aligned(4)));
+// Expander masks.
+#define RELAYS_MASK  ((1 << REL1PIN) | (1 << REL2PIN) | (1 << REL3PIN) | (1 << REL4PIN))
+#define OPTOINS_MASK ((1 << IN1PIN) | (1 << IN2PIN) | (1 << IN3PIN) | (1 << IN4PIN))
 
 KMPDinoWiFiESPClass KMPDinoWiFiESP;
 
 /**
  * @brief Initialize KMP Dino WiFi board.
- *		   WiFi module ESP8266, Expander MCP23S17, relays and opto inputs.
+ *		   WiFi module ESP8266, Expander MCP23S08, relays and opto inputs.
  *
  * @return void
  */
 void KMPDinoWiFiESPClass::init()
 {
-	// Expander settings.
-	SPI.begin();
-	SPI.setHwCs(CS);
-	SPI.setFrequency(1000000);
-	SPI.setDataMode(SPI_MODE0);
+	_relaysMask = 0;
+	_optoInsMask = 0;
+	// The sketch can start a persistent log before.
+	if (!KMPEventLog.isStarted())
+	{
+		KMPEventLog.begin();
+	}
 
-	pinMode(CS, OUTPUT);
-	digitalWrite(CS, HIGH);
-	ExpanderInitGPIO();
+	// Expander settings.
+	MCP23S08.init(CS);
+	MCP23S08.SetPinsDirection(RELAYS_MASK, OUTPUT);
+	MCP23S08.SetPinsDirection(OPTOINS_MASK, INPUT);
 
 	// RS485 init.
 	pinMode(RS485PIN, OUTPUT);
@@ -94,10 +87,11 @@ void KMPDinoWiFiESPClass::init()
  *
  * @param relayNumber Number of relay from 0 to RELAY_COUNT - 1. 0 - Relay1, 1 - Relay2 ...
  * @param state New state of relay, true - On, false = Off.
+ * @param source Who requests the change. It is written in KMPEventLog if the relay state is changed.
  *
  * @return void
  */
-void KMPDinoWiFiESPClass::SetRelayState(uint8_t relayNumber, bool state)
+void KMPDinoWiFiESPClass::SetRelayState(uint8_t relayNumber, bool state, EventSource source)
 {
 	// Check if relayNumber is out of range - return.
 	if (relayNumber > RELAY_COUNT - 1)
@@ -105,7 +99,14 @@ void KMPDinoWiFiESPClass::SetRelayState(uint8_t relayNumber, bool state)
 		return;
 	}
 	
-	ExpanderSetPin(RELAY_PINS[relayNumber], state);
+	MCP23S08.SetPinState(RELAY_PINS[relayNumber], state);
+
+	uint8_t bit = 1 << relayNumber;
+	if (((_relaysMask & bit) != 0) != state)
+	{
+		_relaysMask ^= bit;
+		KMPEventLog.add(ChannelRelay, relayNumber, state, source);
+	}
 }
 
 /**
@@ -113,26 +114,36 @@ void KMPDinoWiFiESPClass::SetRelayState(uint8_t relayNumber, bool state)
  *
  * @param relay Relays - Relay1, Relay2 ...
  * @param state New state of relay, true - On, false = Off.
+ * @param source Who requests the change.
  *
  * @return void
  */
-void KMPDinoWiFiESPClass::SetRelayState(Relay relay, bool state)
+void KMPDinoWiFiESPClass::SetRelayState(Relay relay, bool state, EventSource source)
 {
-	SetRelayState((uint8_t)relay, state);
+	SetRelayState((uint8_t)relay, state, source);
 }
 
 /**
  * @brief Set all relays new state.
  *
  * @param state New state of relay, true - On, false = Off.
+ * @param source Who requests the change.
  *
  * @return void
  */
-void KMPDinoWiFiESPClass::SetAllRelaysState(bool state)
+void KMPDinoWiFiESPClass::SetAllRelaysState(bool state, EventSource source)
 {
+	// All relays with one SPI write.
+	MCP23S08.SetPinsState(RELAYS_MASK, state ? RELAYS_MASK : 0);
+
 	for (uint8_t i = 0; i < RELAY_COUNT; i++)
 	{
-		SetRelayState(i, state);
+		uint8_t bit = 1 << i;
+		if (((_relaysMask & bit) != 0) != state)
+		{
+			_relaysMask ^= bit;
+			KMPEventLog.add(ChannelRelay, i, state, source);
+		}
 	}
 }
 
@@ -171,7 +182,7 @@ bool KMPDinoWiFiESPClass::GetRelayState(uint8_t relayNumber)
 		return false;
 	}
 
-	return ExpanderGetPin(RELAY_PINS[relayNumber]);
+	return MCP23S08.GetPinState(RELAY_PINS[relayNumber]);
 }
 
 /**
@@ -205,7 +216,16 @@ bool KMPDinoWiFiESPClass::GetOptoInState(uint8_t optoInNumber)
 		return false;
 	}
 
-	return !ExpanderGetPin(OPTOIN_PINS[optoInNumber]);
+	bool state = !MCP23S08.GetPinState(OPTOIN_PINS[optoInNumber]);
+
+	uint8_t bit = 1 << optoInNumber;
+	if (((_optoInsMask & bit) != 0) != state)
+	{
+		_optoInsMask ^= bit;
+		KMPEventLog.add(ChannelOptoIn, optoInNumber, state, SourceHardware);
+	}
+
+	return state;
 }
 
 /**
@@ -220,133 +240,6 @@ bool KMPDinoWiFiESPClass::GetOptoInState(OptoIn optoIn)
 	return GetOptoInState((uint8_t)optoIn);
 }
 
-/* ----------------------------------------------------------------------- */
-/* Expander MCP23S17 methods. */
-/* ----------------------------------------------------------------------- */
-
-/**
- * @brief Set expander MCP23S17 pin state.
- *
- * @param pinNumber The number of pin to be set.
- * @param state The pin state, true - 1, false - 0.
- *
- * @return void
- */
-void KMPDinoWiFiESPClass::ExpanderSetPin(uint8_t pinNumber, bool state)
-{
-	uint8_t registerData = ExpanderReadRegister(OLAT);
-
-	if (state)
-	{
-		registerData |= (1 << pinNumber);
-	}
-	else
-	{
-		registerData &= ~(1 << pinNumber);
-	}
-
-	ExpanderWriteRegister(OLAT, registerData);
-}
-
-/**
- * @brief Get expander MCP23S17 pin state.
- *
- * @param pinNumber The number of pin to be get.
- *
- * @return State true - 1, false - 0.
- */
-bool KMPDinoWiFiESPClass::ExpanderGetPin(uint8_t pinNumber)
-{
-	uint8_t registerData = ExpanderReadRegister(GPIO);
-
-	return registerData & (1 << pinNumber);
-}
-
-/**
- * @brief Read an expander MCP23S17 a register.
- *
- * @param address A register address.
- *
- * @return The data from the register.
- */
-uint8_t KMPDinoWiFiESPClass::ExpanderReadRegister(uint8_t address)
-{
-	_expTxData[0] = READ_CMD;
-	_expTxData[1] = address;
-
-	digitalWrite(CS, LOW);
-	SPI.transferBytes(_expTxData, _expRxData, 3);
-	digitalWrite(CS, HIGH);
-
-	return _expRxData[2];
-}
-
-/**
- * @brief Write data in expander MCP23S17 register.
- *
- * @param address A register address.
- * @param data A byte for write.
- *
- * @return void.
- */
-void KMPDinoWiFiESPClass::ExpanderWriteRegister(uint8_t address, uint8_t data)
-{
-	_expTxData[0] = WRITE_CMD;
-	_expTxData[1] = address;
-	_expTxData[2] = data;
-
-	digitalWrite(CS, LOW);
-	SPI.transferBytes(_expTxData, _expRxData, 3);
-	digitalWrite(CS, HIGH);
-}
-
-/**
- * @brief Set a expander MCP23S17 the pin direction.
- *
- * @param pinNumber Pin number for set.
- * @param mode direction mode. 0 - INPUT, 1 - OUTPUT.
- *
- * @return void
- */
-void KMPDinoWiFiESPClass::ExpanderSetDirection(uint8_t pinNumber, uint8_t mode)
-{
-	uint8_t registerData = ExpanderReadRegister(IODIR);
-
-	if (INPUT == mode)
-	{
-		registerData |= (1 << pinNumber);
-	}
-	else
-	{
-		registerData &= ~(1 << pinNumber);
-	}
-
-	ExpanderWriteRegister(IODIR, registerData);
-}
-
-/**
- * @brief Set expander MCP23S17 pin direction.
- *
- * @param address Register address.
- * @param data Byte to write.
- *
- * @return void.
- */
-void KMPDinoWiFiESPClass::ExpanderInitGPIO()
-{
-	// Relays.
-	for (uint8_t i = 0; i < RELAY_COUNT; i++)
-	{
-		ExpanderSetDirection(RELAY_PINS[i], OUTPUT);
-	}
-
-	// Opto inputs.
-	for (uint8_t i = 0; i < OPTOIN_COUNT; i++)
-	{
-		ExpanderSetDirection(OPTOIN_PINS[i], INPUT);
-	}
-}
-
 /**
 * @brief Connect to RS485. With default configuration SERIAL_8N1.
 *
@@ -374,6 +267,7 @@ void KMPDinoWiFiESPClass::RS485Begin(unsigned long baud)
 void KMPDinoWiFiESPClass::RS485Begin(unsigned long baud, SerialConfig config)
 {
 	Serial.begin(baud, config);
+	_rs485Tx.begin(baud, config);
 }
 
 /**
@@ -386,29 +280,6 @@ void KMPDinoWiFiESPClass::RS485End()
 	Serial.end();
 }
 
-/**
-* @brief Begin write data to RS485. 
-*
-* @return void
-*/
-void RS485BeginWrite()
-{
-	digitalWrite(RS485PIN, LOW);
-	delay(1);
-}
-
-/**
-* @brief End write data to RS485.
-*
-* @return void
-*/
-void RS485EndWrite()
-{
-	Serial.flush();
-	delay(1);
-	digitalWrite(RS485PIN, HIGH);
-}
-
 /**
 * @brief Transmit one byte data to RS485.
 *
@@ -418,13 +289,7 @@ void RS485EndWrite()
 */
 size_t KMPDinoWiFiESPClass::RS485Write(uint8_t data)
 {
-	RS485BeginWrite();
-
-	size_t result = Serial.write(data);
-
-	RS485EndWrite();
-
-	return result;
+	return _rs485Tx.write(&data, 1);
 }
 
 /**
@@ -448,19 +313,7 @@ size_t KMPDinoWiFiESPClass::RS485Write(char data)
 */
 size_t KMPDinoWiFiESPClass::RS485Write(const char* data)
 {
-	RS485BeginWrite();
-
-	size_t len = strlen(data);
-	size_t result = 0;
-	while(len > 0)
-	{
-		result += Serial.write(*data++);
-		--len;
-	}
-
-	RS485EndWrite();
-
-	return result;
+	return _rs485Tx.write((const uint8_t*)data, strlen(data));
 }
 
 /**
@@ -473,17 +326,7 @@ size_t KMPDinoWiFiESPClass::RS485Write(const char* data)
 */
 size_t KMPDinoWiFiESPClass::RS485Write(uint8_t* data, uint8_t dataLen)
 {
-	RS485BeginWrite();
-
-	size_t result = 0;
-	for (size_t i = 0; i < dataLen; i++)
-	{
-		result += Serial.write(data[i]);
-	}
-
-	RS485EndWrite();
-
-	return result;
+	return _rs485Tx.write(data, dataLen);
 }
 
 /**
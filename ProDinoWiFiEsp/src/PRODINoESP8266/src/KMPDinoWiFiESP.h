@@ -15,6 +15,8 @@
 #include <Arduino.h>
 #include <SPI.h>
 #include <HardwareSerial.h>
+#include "MCP23S08.h"
+#include "KMPEventLog.h"
 
 // Inputs and outputs count.
 #define RELAY_COUNT  4
@@ -68,20 +70,12 @@ const char URL_KMPELECTRONICS_EU_DINO_WIFI[] = "https://kmpelectronics.eu/tutori
 
 class KMPDinoWiFiESPClass
 {
- protected:
-	 void ExpanderSetPin(uint8_t pinNumber, bool state);
-	 bool ExpanderGetPin(uint8_t pinNumber);
-	 uint8_t ExpanderReadRegister(uint8_t address);
-	 void ExpanderWriteRegister(uint8_t address, uint8_t data);
-	 void ExpanderSetDirection(uint8_t pinNumber, uint8_t mode);
-	 void ExpanderInitGPIO();
-
  public:
 	void init();
 
-	void SetRelayState(uint8_t relayNumber, bool state);
-	void SetRelayState(Relay relay, bool state);
-	void SetAllRelaysState(bool state);
+	void SetRelayState(uint8_t relayNumber, bool state, EventSource source = SourceLocal);
+	void SetRelayState(Relay relay, bool state, EventSource source = SourceLocal);
+	void SetAllRelaysState(bool state, EventSource source = SourceLocal);
 	void SetAllRelaysOn();
 	void SetAllRelaysOff();
 	bool GetRelayState(uint8_t relayNumber);
@@ -100,6 +94,11 @@ class KMPDinoWiFiESPClass
 	size_t RS485Write(uint8_t* data, uint8_t dataLen);
 	int RS485Read();
 	int RS485Read(unsigned long delayWait, uint8_t repeatTime);
+
+ private:
+	// Last commanded relays states and last read inputs states. Used for event log.
+	uint8_t _relaysMask;
+	uint8_t _optoInsMask;
 };
 
 extern KMPDinoWiFiESPClass KMPDinoWiFiESP;
@@ -0,0 +1,83 @@
+// KMPRS485Tx.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: https://kmpelectronics.eu/
+// Description:
+//		RS485 transmit layer shared by ProDino WiFi-ESP, ProDino MKR Zero and ProDino Ethernet boards.
+// Version: 1.0.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "KMPRS485Tx.h"
+
+KMPRS485TxClass::KMPRS485TxClass(HardwareSerial& serial, uint8_t dePin, uint8_t transmitLevel) :
+	_serial(serial),
+	_dePin(dePin),
+	_transmitLevel(transmitLevel)
+#if defined(ARDUINO_ARCH_SAMD)
+	, _charTimeuS(0)
+#endif
+{
+}
+
+void KMPRS485TxClass::begin(unsigned long baud, uint32_t config)
+{
+	pinMode(_dePin, OUTPUT);
+	digitalWrite(_dePin, !_transmitLevel);
+
+#if defined(ARDUINO_ARCH_SAMD)
+	if (baud == 0)
+	{
+		baud = 9600;
+	}
+
+	_charTimeuS = (uint32_t)((1000000UL * getCharBits(config) + baud - 1) / baud);
+#else
+	(void)baud;
+	(void)config;
+#endif
+}
+
+#if defined(ARDUINO_ARCH_SAMD)
+/**
+* @brief Count of bits in one character: start, data, parity and stop bits.
+*
+* @param config UART configuration - SERIAL_8N1 ...
+*
+* @return uint8_t Bits count.
+*/
+uint8_t KMPRS485TxClass::getCharBits(uint32_t config)
+{
+	uint8_t dataBits = 4 + ((config & HARDSER_DATA_MASK) >> 8);
+	uint8_t parityBits = (config & HARDSER_PARITY_MASK) == HARDSER_PARITY_NONE ? 0 : 1;
+	uint8_t stopBits = (config & HARDSER_STOP_BIT_MASK) == HARDSER_STOP_BIT_1 ? 1 : 2;
+
+	return 1 + dataBits + parityBits + stopBits;
+}
+#endif
+
+size_t KMPRS485TxClass::write(const uint8_t* data, size_t len)
+{
+	if (len == 0)
+	{
+		return 0;
+	}
+
+	// The transceiver enable time is less than 1uS, it doesn't need a delay.
+	digitalWrite(_dePin, _transmitLevel);
+
+	size_t result = _serial.write(data, len);
+
+	// AVR flush waits for TXC. ESP8266 flush waits one character time after the TX FIFO is empty.
+	_serial.flush();
+
+#if defined(ARDUINO_ARCH_SAMD)
+	// Uart::flush() doesn't wait for TXC if the data register is already empty.
+	// TXC is cleared by the write of new data, so it is set only after the last stop bit of this data.
+	unsigned long start = micros();
+	while (!RS485_SERCOM->USART.INTFLAG.bit.TXC && micros() - start < RS485_TXC_TIMEOUT_CHARS * _charTimeuS);
+#endif
+
+	digitalWrite(_dePin, !_transmitLevel);
+
+	return result;
+}
@@ -0,0 +1,324 @@
+// MCP23S08.cpp
+// Company: KMP Electronics Ltd, Bulgaria
+// Web: http://kmpelectronics.eu/
+// Supported hardware: 
+//		Expander MCP23S08
+// Description:
+//		Source file for work with expander.
+// Version: 0.1.0
+// Date: 18.10.2026
+// Author: Plamen Kovandjiev <p.kovandiev@kmpelectronics.eu>
+
+#include "MCP23S08.h"
+
+#define READ_CMD  0x41
+#define WRITE_CMD 0x40
+
+#define IODIR   0x00
+#define IPOL    0x01
+#define GPINTEN 0x02
+#define DEFVAL  0x03
+#define INTCON  0x04
+#define IOCON   0x05
+#define GPPU    0x06
+#define INTF    0x07
+#define INTCAP  0x08
+#define GPIO    0x09
+#define OLAT    0x0A
+
+#define MAX_PIN_POS 7
+
+void MCP23S08Class::init(int cs)
+{
+	_cs = cs;
+	_intPin = -1;
+	_gpioValid = false;
+
+	// Expander settings.
+	SPI.begin();
+	SPI.setHwCs(true);
+#ifndef ESP32
+	SPI.setFrequency(1000000);
+	SPI.setDataMode(SPI_MODE0);
+#endif // ESP32
+
+	pinMode(_cs, OUTPUT);
+	digitalWrite(_cs, HIGH);
+
+	Refresh();
+}
+
+void MCP23S08Class::Refresh()
+{
+	uint8_t registers[MCP23S08_MAX_REGISTERS];
+	// All registers from IODIR to OLAT in one transfer. Sequential operation is enabled by default (IOCON.SEQOP = 0).
+	ReadRegisters(IODIR, registers, MCP23S08_MAX_REGISTERS);
+
+	_iodir = registers[IODIR];
+	_gpinten = registers[GPINTEN];
+	_gpio = registers[GPIO];
+	_olat = registers[OLAT];
+	_gpioValid = _gpinten != 0;
+}
+
+/**
+ * @brief Set a pin state.
+ *
+ * @param pinNumber The number of pin to be set.
+ * @param state The pin state, true - 1, false - 0.
+ *
+ * @return void
+ */
+void MCP23S08Class::SetPinState(uint8_t pinNumber, bool state)
+{
+	if (pinNumber > MAX_PIN_POS)
+	{
+		return;
+	}
+
+	uint8_t bit = 1 << pinNumber;
+	SetPinsState(bit, state ? bit : 0);
+}
+
+void MCP23S08Class::SetPinsState(uint8_t mask, uint8_t states)
+{
+	uint8_t registerData = (_olat & ~mask) | (states & mask);
+
+	if (registerData == _olat)
+	{
+		return;
+	}
+
+	_olat = registerData;
+	WriteRegister(OLAT, registerData);
+}
+
+/**
+ * @brief Get a pin state.
+ *
+ * @param pinNumber The number of pin to be get.
+ *
+ * @return State true - 1, false - 0.
+ */
+bool MCP23S08Class::GetPinState(uint8_t pinNumber)
+{
+	if (pinNumber > MAX_PIN_POS)
+	{
+		return false;
+	}
+
+	uint8_t bit = 1 << pinNumber;
+
+	// Output pin - the state is in the shadow register.
+	if (!(_iodir & bit))
+	{
+		return _olat & bit;
+	}
+
+	return ReadInputs() & bit;
+}
+
+uint8_t MCP23S08Class::GetPinsState()
+{
+	if (_iodir == 0)
+	{
+		return _olat;
+	}
+
+	return (_olat & ~_iodir) | (ReadInputs() & _iodir);
+}
+
+/**
+ * @brief Read input pins. In interrupt capture mode the SPI transfer is skipped while INT pin is inactive.
+ *
+ * @return uint8_t GPIO register.
+ */
+uint8_t MCP23S08Class::ReadInputs()
+{
+	// All inputs should be watched, otherwise not watched inputs can be changed without INT.
+	bool canUseCache = _gpioValid && (_iodir & ~_gpinten) == 0;
+
+	if (canUseCache && !IsInterruptActive())
+	{
+		return _gpio;
+	}
+
+	// Reading GPIO clears the interrupt.
+	_gpio = ReadRegister(GPIO);
+	_gpioValid = _gpinten != 0;
+
+	return _gpio;
+}
+
+bool MCP23S08Class::IsInterruptActive()
+{
+	if (_intPin < 0)
+	{
+		return true;
+	}
+
+	// INT output is active low (IOCON.INTPOL = 0).
+	return digitalRead(_intPin) == LOW;
+}
+
+void MCP23S08Class::EnableInterruptCapture(uint8_t mask, int intPin)
+{
+	_intPin = intPin;
+
+	if (_intPin > -1)
+	{
+		pinMode(_intPin, INPUT);
+	}
+
+	// Compare with previous pin value.
+	WriteRegister(INTCON, 0);
+	_gpinten = mask;
+	WriteRegister(GPINTEN, mask);
+
+	// Clear pending interrupt and fill the cache.
+	_gpio = ReadRegister(GPIO);
+	_gpioValid = _gpinten != 0;
+}
+
+void MCP23S08Class::DisableInterruptCapture()
+{
+	_gpinten = 0;
+	_gpioValid = false;
+	WriteRegister(GPINTEN, 0);
+}
+
+bool MCP23S08Class::ReadInterrupt(uint8_t& flags, uint8_t& captured)
+{
+	flags = 0;
+	captured = 0;
+
+	if (_intPin > -1 && !IsInterruptActive())
+	{
+		return false;
+	}
+
+	uint8_t registers[2];
+	// INTF and INTCAP are consecutive.
+	ReadRegisters(INTF, registers, 2);
+
+	flags = registers[0];
+	captured = registers[1];
+
+	if (flags == 0)
+	{
+		return false;
+	}
+
+	// Reading INTCAP clears the interrupt. GPIO should be read again to catch changes after the capture.
+	_gpioValid = false;
+
+	return true;
+}
+
+/**
+ * @brief Read an expander MCP23S08 a register.
+ *
+ * @param address A register address.
+ *
+ * @return The data from the register.
+ */
+uint8_t MCP23S08Class::ReadRegister(uint8_t address)
+{
+	_txData[0] = READ_CMD;
+	_txData[1] = address;
+
+	TransferBytes(3);
+
+	return _rxData[2];
+}
+
+/**
+ * @brief Read several consecutive registers in one transfer.
+ *
+ * @param address First register address.
+ * @param data Result.
+ * @param count Registers count. Max MCP23S08_MAX_REGISTERS.
+ *
+ * @return void
+ */
+void MCP23S08Class::ReadRegisters(uint8_t address, uint8_t* data, uint8_t count)
+{
+	if (count > MCP23S08_MAX_REGISTERS)
+	{
+		count = MCP23S08_MAX_REGISTERS;
+	}
+
+	_txData[0] = READ_CMD;
+	_txData[1] = address;
+
+	TransferBytes(count + 2);
+
+	memcpy(data, &_rxData[2], count);
+}
+
+/**
+ * @brief Write data in expander MCP23S08 register.
+ *
+ * @param address A register address.
+ * @param data A byte for write.
+ *
+ * @return void.
+ */
+void MCP23S08Class::WriteRegister(uint8_t address, uint8_t data)
+{
+	_txData[0] = WRITE_CMD;
+	_txData[1] = address;
+	_txData[2] = data;
+
+	TransferBytes(3);
+}
+
+void MCP23S08Class::TransferBytes(uint8_t count)
+{
+	digitalWrite(_cs, LOW);
+	SPI.transferBytes(_txData, _rxData, count);
+	digitalWrite(_cs, HIGH);
+}
+
+/**
+ * @brief Set the expander MCP23S08 a pin direction.
+ *
+ * @param pinNumber Pin number for set.
+ * @param mode direction mode. 0 - INPUT, 1 - OUTPUT.
+ *
+ * @return void
+ */
+void MCP23S08Class::SetPinDirection(uint8_t pinNumber, uint8_t mode)
+{
+	if (pinNumber > MAX_PIN_POS)
+	{
+		return;
+	}
+
+	SetPinsDirection(1 << pinNumber, mode);
+}
+
+void MCP23S08Class::SetPinsDirection(uint8_t mask, uint8_t mode)
+{
+	uint8_t registerData = _iodir;
+
+	if (INPUT == mode)
+	{
+		registerData |= mask;
+	}
+	else
+	{
+		registerData &= ~mask;
+	}
+
+	if (registerData == _iodir)
+	{
+		return;
+	}
+
+	_iodir = registerData;
+	_gpioValid = false;
+	WriteRegister(IODIR, registerData);
+}
+
+MCP23S08Class MCP23S08;